@@ -0,0 +1,285 @@
+/*
+* MCE, the real life implementation of McEliece encryption scheme.
+* Copyright Projet SECRET, INRIA, Rocquencourt and Bhaskar Biswas and 
+* Nicolas Sendrier (Bhaskar.Biswas@inria.fr, Nicolas.Sendrier@inria.fr).
+*
+* This is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 2.1 of
+* the License, or (at your option) any later version.
+*
+* This software is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with this software; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+* 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+*/
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keymem.h"
+
+#define HUGEPAGE_SIZE (2UL << 20)
+
+// Every key starts with a header recording how it was obtained, so
+// that key_free() can release it. The header is KEY_HEADER bytes long
+// to keep the key itself aligned on a cache line.
+#define KEY_HEADER 64
+
+enum { KEY_MALLOC, KEY_MMAP };
+
+struct key_header {
+  int kind;
+  void * base; // start of the mapping or of the malloc'ed block
+  size_t length; // length of the mapping
+};
+
+static void * key_set_header(void * base, size_t length, int kind)
+{
+  struct key_header * h = base;
+
+  h->kind = kind;
+  h->base = base;
+  h->length = length;
+  return ((unsigned char *) base) + KEY_HEADER;
+}
+
+#if defined(__linux__) && !defined(KEYMEM_NO_HUGEPAGES)
+
+// round up to a multiple of the huge page size
+#define HUGEPAGE_ROUND(x) (((x) + HUGEPAGE_SIZE - 1) & ~(HUGEPAGE_SIZE - 1))
+
+static void * key_alloc_huge(size_t size)
+{
+  unsigned char * pt, * aligned;
+  size_t length, head, tail;
+
+  length = HUGEPAGE_ROUND(size + KEY_HEADER);
+
+#ifdef MAP_HUGETLB
+  // explicit huge pages, only available if the administrator
+  // reserved a pool of them (vm.nr_hugepages)
+  pt = mmap(NULL, length, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (pt != MAP_FAILED)
+    return key_set_header(pt, length, KEY_MMAP);
+#endif
+
+  // transparent huge pages, the mapping must be 2MB aligned for the
+  // kernel to back it with huge pages
+  pt = mmap(NULL, length + HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (pt == MAP_FAILED)
+    return NULL;
+  aligned = (unsigned char *) HUGEPAGE_ROUND((unsigned long) pt);
+  head = aligned - pt;
+  tail = HUGEPAGE_SIZE - head;
+  if (head > 0)
+    munmap(pt, head);
+  if (tail > 0)
+    munmap(aligned + length, tail);
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+  return key_set_header(aligned, length, KEY_MMAP);
+}
+
+#endif
+
+void * key_alloc(size_t size)
+{
+  void * pt;
+
+#if defined(__linux__) && !defined(KEYMEM_NO_HUGEPAGES)
+  // below half a huge page the gain does not justify the waste
+  if (size >= HUGEPAGE_SIZE / 2) {
+    pt = key_alloc_huge(size);
+    if (pt != NULL)
+      return pt;
+  }
+#endif
+
+  pt = malloc(size + KEY_HEADER);
+  if (pt == NULL)
+    return NULL;
+  return key_set_header(pt, size + KEY_HEADER, KEY_MALLOC);
+}
+
+void key_free(void * key)
+{
+  struct key_header * h;
+
+  if (key == NULL)
+    return;
+  h = (struct key_header *) (((unsigned char *) key) - KEY_HEADER);
+#ifdef __linux__
+  if (h->kind == KEY_MMAP) {
+    munmap(h->base, h->length);
+    return;
+  }
+#endif
+  free(h->base);
+}
+
+/*********************************************************************************************/
+////////////////////////////////////NUMA replication///////////////////////////////////////////
+/*********************************************************************************************/
+
+#ifdef __linux__
+
+#define NODE_PATH "/sys/devices/system/node/node%d/cpulist"
+
+// parse a cpulist ("0-3,8-11") and set the node of each cpu listed,
+// returns the largest cpu number found or -1
+static int read_cpulist(int node, int * cpu_node, int nb_cpus, cpu_set_t * set)
+{
+  char filename[64];
+  FILE * f;
+  int a, b, c, max;
+  char sep;
+
+  sprintf(filename, NODE_PATH, node);
+  f = fopen(filename, "r");
+  if (f == NULL)
+    return -1;
+  max = -1;
+  if (set != NULL)
+    CPU_ZERO(set);
+  while (fscanf(f, "%d", &a) == 1) {
+    b = a;
+    sep = fgetc(f);
+    if (sep == '-') {
+      if (fscanf(f, "%d", &b) != 1)
+	break;
+      sep = fgetc(f);
+    }
+    for (c = a; c <= b; ++c) {
+      if ((cpu_node != NULL) && (c < nb_cpus))
+	cpu_node[c] = node;
+      if ((set != NULL) && (c < CPU_SETSIZE))
+	CPU_SET(c, set);
+    }
+    if (b > max)
+      max = b;
+    if (sep != ',')
+      break;
+  }
+  fclose(f);
+  return max;
+}
+
+static int count_nodes(int * max_cpu)
+{
+  int n, m;
+
+  *max_cpu = -1;
+  for (n = 0; ; ++n) {
+    m = read_cpulist(n, NULL, 0, NULL);
+    if (m < 0)
+      break;
+    if (m > *max_cpu)
+      *max_cpu = m;
+  }
+  return n;
+}
+
+#endif
+
+key_replicas_t key_replicate(const unsigned char * key, size_t size)
+{
+  key_replicas_t r;
+  int i, nb_nodes = 1, max_cpu = -1;
+#ifdef __linux__
+  cpu_set_t saved, set;
+  int pinned;
+#endif
+
+  r = malloc(sizeof (struct key_replicas));
+  if (r == NULL)
+    return NULL;
+#ifdef __linux__
+  nb_nodes = count_nodes(&max_cpu);
+  if (nb_nodes < 1)
+    nb_nodes = 1;
+#endif
+  r->nb_nodes = nb_nodes;
+  r->size = size;
+  r->copy = calloc(nb_nodes, sizeof (unsigned char *));
+  r->nb_cpus = max_cpu + 1;
+  r->cpu_node = (r->nb_cpus > 0) ? calloc(r->nb_cpus, sizeof (int)) : NULL;
+  if ((r->copy == NULL) || ((r->nb_cpus > 0) && (r->cpu_node == NULL))) {
+    key_replicas_free(r);
+    return NULL;
+  }
+
+  if (nb_nodes == 1) {
+    r->copy[0] = key_alloc(size);
+    if (r->copy[0] == NULL) {
+      key_replicas_free(r);
+      return NULL;
+    }
+    memcpy(r->copy[0], key, size);
+    return r;
+  }
+
+#ifdef __linux__
+  // the first touch policy places each page on the node of the cpu
+  // which first writes it, so we migrate to each node in turn and
+  // copy the key from there
+  pinned = (sched_getaffinity(0, sizeof (cpu_set_t), &saved) == 0);
+  for (i = 0; i < nb_nodes; ++i) {
+    read_cpulist(i, r->cpu_node, r->nb_cpus, &set);
+    if (pinned)
+      sched_setaffinity(0, sizeof (cpu_set_t), &set);
+    r->copy[i] = key_alloc(size);
+    if (r->copy[i] == NULL)
+      break;
+    memcpy(r->copy[i], key, size);
+  }
+  if (pinned)
+    sched_setaffinity(0, sizeof (cpu_set_t), &saved);
+  if (i < nb_nodes) {
+    key_replicas_free(r);
+    return NULL;
+  }
+#endif
+
+  return r;
+}
+
+const unsigned char * key_local(key_replicas_t r)
+{
+#ifdef __linux__
+  int cpu;
+
+  if (r->nb_nodes > 1) {
+    cpu = sched_getcpu();
+    if ((cpu >= 0) && (cpu < r->nb_cpus))
+      return r->copy[r->cpu_node[cpu]];
+  }
+#endif
+  return r->copy[0];
+}
+
+void key_replicas_free(key_replicas_t r)
+{
+  int i;
+
+  if (r == NULL)
+    return;
+  if (r->copy != NULL)
+    for (i = 0; i < r->nb_nodes; ++i)
+      key_free(r->copy[i]);
+  free(r->copy);
+  free(r->cpu_node);
+  free(r);
+}
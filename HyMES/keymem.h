@@ -0,0 +1,55 @@
+/*
+* MCE, the real life implementation of McEliece encryption scheme.
+* Copyright Projet SECRET, INRIA, Rocquencourt and Bhaskar Biswas and 
+* Nicolas Sendrier (Bhaskar.Biswas@inria.fr, Nicolas.Sendrier@inria.fr).
+*
+* This is free software; you can redistribute it and/or modify it
+* under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 2.1 of
+* the License, or (at your option) any later version.
+*
+* This software is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with this software; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+* 02110-1301 USA, or see the FSF site: http://www.fsf.org.
+*/
+#ifndef KEYMEM_H
+#define KEYMEM_H
+
+#include <stddef.h>
+
+// Storage for key material. For large parameters (m >= 12) the
+// public key and the syndrome table of the secret key (coeffs) span
+// hundreds of 4KB pages and encrypt_block()/syndrome() access them
+// in a TLB unfriendly manner. key_alloc() places the key in 2MB huge
+// pages when the system allows it (explicit hugetlbfs pages first,
+// then transparent huge pages) and falls back to ordinary pages
+// otherwise. Compile with -DKEYMEM_NO_HUGEPAGES to disable.
+void * key_alloc(size_t size);
+void key_free(void * key);
+
+// Read-only replicas of a key, one per NUMA node, for programs
+// running worker threads on several sockets. Each replica is
+// allocated with key_alloc() and first touched by a CPU of its node,
+// so it is backed by node local memory. On single node machines
+// there is a single copy. key_replicate() returns NULL if memory is
+// exhausted.
+typedef struct key_replicas {
+  int nb_nodes;
+  size_t size;
+  unsigned char ** copy; // copy[i] is the replica on node i
+  int nb_cpus;
+  int * cpu_node; // cpu_node[c] is the node of cpu c
+} * key_replicas_t;
+
+key_replicas_t key_replicate(const unsigned char * key, size_t size);
+// the replica local to the calling thread
+const unsigned char * key_local(key_replicas_t r);
+void key_replicas_free(key_replicas_t r);
+
+#endif /* KEYMEM_H */
@@ -23,10 +23,12 @@
 #include <string.h>
 #include "sizes.h"
 #include "mceliece.h"
+#include "keymem.h"
 
 int main(int argc, char ** argv) {
   int m, t;
-  unsigned char sk[SECRETKEY_BYTES];
+  unsigned char * sk;
+  key_replicas_t sks;
   unsigned char message[MESSAGE_BYTES], ciphertext[CIPHERTEXT_BYTES];
   int n;
   int size_n, fail;
@@ -44,12 +46,23 @@ int main(int argc, char ** argv) {
     fprintf(stderr, "invalid secret key file (m,t)=(%d,%d) instead of (%d,%d)\n", m, t, EXT_DEGREE, NB_ERRORS);
     exit(0);
   }
+  sk = key_alloc(SECRETKEY_BYTES);
+  if (sk == NULL) {
+    fprintf(stderr, "cannot allocate the secret key\n");
+    exit(1);
+  }
   fread(sk, 1, SECRETKEY_BYTES, fichier);
   fclose(fichier);
+  sks = key_replicate(sk, SECRETKEY_BYTES);
+  key_free(sk);
+  if (sks == NULL) {
+    fprintf(stderr, "cannot allocate the secret key\n");
+    exit(1);
+  }
 
   fichier = fopen(argv[2], "r");
   fread(ciphertext, 1, CIPHERTEXT_BYTES, fichier);
-  if (decrypt_block_ss(message, ciphertext, sk) < 0) {
+  if (decrypt_block_ss(message, ciphertext, key_local(sks)) < 0) {
     fclose(fichier);
     fprintf(stderr, "not a valid encrypted file!\n");
     exit(0);
@@ -64,7 +77,7 @@ int main(int argc, char ** argv) {
 
     while (n > MESSAGE_BYTES) {
       fread(ciphertext, 1, CIPHERTEXT_BYTES, fichier);
-      if (decrypt_block_ss(message, ciphertext, sk) < 0) {
+      if (decrypt_block_ss(message, ciphertext, key_local(sks)) < 0) {
 	fail = 1;
 	break;
       }
@@ -75,7 +88,7 @@ int main(int argc, char ** argv) {
 
   if (!fail) {
     fread(ciphertext, 1, CIPHERTEXT_BYTES, fichier);
-    if (decrypt_block_ss(message, ciphertext, sk) < 0)
+    if (decrypt_block_ss(message, ciphertext, key_local(sks)) < 0)
       fail = 1;
     else
       fwrite(message, 1, n, output);
@@ -86,6 +99,7 @@ int main(int argc, char ** argv) {
 
   fclose(output);
   fclose(fichier);
+  key_replicas_free(sks);
 
   return 0;
 }
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include "sizes.h"
 #include "mceliece.h"
+#include "keymem.h"
 
 __inline unsigned long long rdtsc()
 {
@@ -36,7 +37,8 @@ __inline unsigned long long rdtsc()
 
 int main(int argc, char ** argv) {
   int m, t;
-  unsigned char pk[PUBLICKEY_BYTES];
+  unsigned char * pk;
+  key_replicas_t pks;
   unsigned char message[MESSAGE_BYTES], ciphertext[CIPHERTEXT_BYTES];
   int n;
   int size_n, data_bytes;
@@ -55,8 +57,19 @@ int main(int argc, char ** argv) {
     fprintf(stderr, "invalid public key file (m,t)=(%d,%d) instead of (%d,%d)\n", m, t, EXT_DEGREE, NB_ERRORS);
     exit(0);
   }
+  pk = key_alloc(PUBLICKEY_BYTES);
+  if (pk == NULL) {
+    fprintf(stderr, "cannot allocate the public key\n");
+    exit(1);
+  }
   fread(pk, 1, PUBLICKEY_BYTES, fichier);
   fclose(fichier);
+  pks = key_replicate(pk, PUBLICKEY_BYTES);
+  key_free(pk);
+  if (pks == NULL) {
+    fprintf(stderr, "cannot allocate the public key\n");
+    exit(1);
+  }
 
   fichier = fopen(argv[2], "r");
   output = fopen(argv[3], "w");
@@ -71,17 +84,18 @@ int main(int argc, char ** argv) {
   n -= MESSAGE_BYTES - size_n;
 
   while (n > 0) {
-    encrypt_block_ss(ciphertext, message, pk);
+    encrypt_block_ss(ciphertext, message, key_local(pks));
     fwrite(ciphertext, 1, CIPHERTEXT_BYTES, output);
     fread(message, 1, MESSAGE_BYTES, fichier);
     n -= MESSAGE_BYTES;
   }
 
-  encrypt_block_ss(ciphertext, message, pk);
+  encrypt_block_ss(ciphertext, message, key_local(pks));
   fwrite(ciphertext, 1, CIPHERTEXT_BYTES, output);
 
   fclose(fichier);
   fclose(output);
+  key_replicas_free(pks);
 
   return 0;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include "sizes.h"
 #include "mceliece.h"
+#include "keymem.h"
 
 __inline unsigned long long rdtsc()
 {
@@ -31,7 +32,7 @@ __inline unsigned long long rdtsc()
 }
 
 int main(int argc, char ** argv) {
-  unsigned char sk[SECRETKEY_BYTES], pk[PUBLICKEY_BYTES];
+  unsigned char * sk, * pk;
   FILE * fichier;
   char filename[16];
   unsigned r;
@@ -41,6 +42,12 @@ int main(int argc, char ** argv) {
   r = (argc > 1) ? atoi(argv[1]) : (((unsigned) rdtsc()) & 0x7fffffff);
 
   n = (argc > 2) ? atoi(argv[2]) : 0;
+  sk = key_alloc(SECRETKEY_BYTES);
+  pk = key_alloc(PUBLICKEY_BYTES);
+  if ((sk == NULL) || (pk == NULL)) {
+    fprintf(stderr, "cannot allocate the key pair\n");
+    exit(1);
+  }
   if (n == 0) {
     srandom(r);
     keypair(sk, pk);
@@ -76,6 +83,8 @@ int main(int argc, char ** argv) {
     fichier = fopen("plotkgendata", "a");
     fprintf(fichier, "%d\t %d\t %lld\n", LOG_LENGTH, ERROR_WEIGHT, total / atoi(argv[2]));
   }
+  key_free(sk);
+  key_free(pk);
   return 0;
 }
 
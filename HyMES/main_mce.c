@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include "sizes.h"
 #include "mceliece.h"
+#include "keymem.h"
 #include "params.h"
 #include "precomp.h"
 
@@ -61,7 +62,8 @@ int check(unsigned char * cleartext, unsigned char * plaintext, int r) {
 }
 
 int main(int argc, char ** argv) {
-  unsigned char sk[SECRETKEY_BYTES], pk[PUBLICKEY_BYTES];
+  unsigned char * sk, * pk;
+  key_replicas_t sks, pks;
   unsigned char cleartext[CLEARTEXT_BYTES], plaintext[CLEARTEXT_BYTES], ciphertext[CIPHERTEXT_BYTES];
   unsigned r, r1;
   int i, j, n;
@@ -77,8 +79,22 @@ int main(int argc, char ** argv) {
   printf("seed for key: %d\n", r1);
   printf("seed for message: %d\n", r);
 
+  sk = key_alloc(SECRETKEY_BYTES);
+  pk = key_alloc(PUBLICKEY_BYTES);
+  if ((sk == NULL) || (pk == NULL)) {
+    fprintf(stderr, "cannot allocate the key pair\n");
+    exit(1);
+  }
   srandom(r1);
   keypair(sk, pk);
+  sks = key_replicate(sk, SECRETKEY_BYTES);
+  pks = key_replicate(pk, PUBLICKEY_BYTES);
+  key_free(sk);
+  key_free(pk);
+  if ((sks == NULL) || (pks == NULL)) {
+    fprintf(stderr, "cannot allocate the key pair\n");
+    exit(1);
+  }
   total_enc = total_dec = 0;
 
   for (j = 0; j < n; ++j) {
@@ -86,14 +102,14 @@ int main(int argc, char ** argv) {
     for (i = 0; i < CLEARTEXT_BYTES; ++i)
       cleartext[i] = random() & 0xff;
     tmp_enc = rdtsc();
-    if (encrypt_block(ciphertext, cleartext, pk) < 0) {
+    if (encrypt_block(ciphertext, cleartext, key_local(pks)) < 0) {
       fprintf(stderr, "fail to encrypt in attempt %d of %d\n", j + 1, n);
       exit(0);
     }
     tmp_enc = rdtsc() - tmp_enc;
     total_enc += tmp_enc;
     tmp_dec = rdtsc();
-    if (decrypt_block(plaintext, ciphertext, sk) < 0) {
+    if (decrypt_block(plaintext, ciphertext, key_local(sks)) < 0) {
       fprintf(stderr, "fail to decrypt in attempt %d of %d\n", j + 1, n);
       exit(0);
     }
@@ -108,6 +124,8 @@ int main(int argc, char ** argv) {
   //  fprintf(fichier, "%d\t %d\t %d\t %d\t %lld\t %lld\n", LOG_LENGTH, ERROR_WEIGHT, LENGTH, CLEARTEXT_LENGTH, total_enc / n, total_dec / n);
   fprintf(fichier, "%d\t %d\t %lld\t %lld\n", LOG_LENGTH, ERROR_WEIGHT, 8 * total_enc / n / CLEARTEXT_LENGTH, 8 * total_dec / n / CLEARTEXT_LENGTH);
   fclose(fichier);
+  key_replicas_free(sks);
+  key_replicas_free(pks);
 
   return 0;
 }
@@ -140,6 +140,7 @@ release_armor_context (armor_filter_context_t *afx)
   assert (afx->refcount);
   if ( --afx->refcount )
     return;
+  gcry_md_close (afx->crc_md);
   xfree (afx);
 }
 
@@ -546,7 +547,7 @@ check_input( armor_filter_context_t *afx, IOBUF a )
 	afx->faked = 1;
     else {
 	afx->inp_checked = 1;
-	afx->crc = CRCINIT;
+	gcry_md_reset (afx->crc_md);
 	afx->idx = 0;
 	afx->radbuf[0] = 0;
     }
@@ -722,7 +723,7 @@ fake_packet( armor_filter_context_t *afx, IOBUF a,
 	    }
 	}
 	afx->inp_checked = 1;
-	afx->crc = CRCINIT;
+	gcry_md_reset (afx->crc_md);
 	afx->idx = 0;
 	afx->radbuf[0] = 0;
     }
@@ -732,6 +733,18 @@ fake_packet( armor_filter_context_t *afx, IOBUF a,
 }
 
 
+/* Return the CRC-24 of the data written to the armor context AFX
+   since the last reset.  */
+static u32
+get_afx_crc (armor_filter_context_t *afx)
+{
+  const byte *crc_buf;
+
+  crc_buf = gcry_md_read (afx->crc_md, GCRY_MD_CRC24_RFC2440);
+  return (crc_buf[0] << 16) | (crc_buf[1] << 8) | crc_buf[2];
+}
+
+
 static int
 invalid_crc(void)
 {
@@ -751,10 +764,8 @@ radix64_read( armor_filter_context_t *afx, IOBUF a, size_t *retn,
     int checkcrc=0;
     int rc = 0;
     size_t n = 0;
-    int  idx, i, onlypad=0;
-    u32 crc;
+    int  idx, onlypad=0;
 
-    crc = afx->crc;
     idx = afx->idx;
     val = afx->radbuf[0];
     for( n=0; n < size; ) {
@@ -817,10 +828,7 @@ radix64_read( armor_filter_context_t *afx, IOBUF a, size_t *retn,
 	idx = (idx+1) % 4;
     }
 
-    for(i=0; i < n; i++ )
-	crc = (crc << 8) ^ crc_table[((crc >> 16)&0xff) ^ buf[i]];
-    crc &= 0x00ffffff;
-    afx->crc = crc;
+    gcry_md_write (afx->crc_md, buf, n);
     afx->idx = idx;
     afx->radbuf[0] = val;
 
@@ -893,9 +901,9 @@ radix64_read( armor_filter_context_t *afx, IOBUF a, size_t *retn,
 		log_info(_("malformed CRC\n"));
 		rc = invalid_crc();
 	    }
-	    else if( mycrc != afx->crc ) {
+	    else if( mycrc != get_afx_crc (afx) ) {
                 log_info (_("CRC error; %06lX - %06lX\n"),
-				    (ulong)afx->crc, (ulong)mycrc);
+				    (ulong)get_afx_crc (afx), (ulong)mycrc);
                 rc = invalid_crc();
 	    }
 	    else {
@@ -1121,18 +1129,15 @@ armor_filter( void *opaque, int control,
 	    afx->status++;
 	    afx->idx = 0;
 	    afx->idx2 = 0;
-	    afx->crc = CRCINIT;
+	    gcry_md_reset (afx->crc_md);
 
 	}
-	crc = afx->crc;
 	idx = afx->idx;
 	idx2 = afx->idx2;
 	for(i=0; i < idx; i++ )
 	    radbuf[i] = afx->radbuf[i];
 
-	for(i=0; i < size; i++ )
-	    crc = (crc << 8) ^ crc_table[((crc >> 16)&0xff) ^ buf[i]];
-	crc &= 0x00ffffff;
+	gcry_md_write (afx->crc_md, buf, size);
 
 	for( ; size; buf++, size-- ) {
 	    radbuf[idx++] = *buf;
@@ -1157,13 +1162,19 @@ armor_filter( void *opaque, int control,
 	    afx->radbuf[i] = radbuf[i];
 	afx->idx = idx;
 	afx->idx2 = idx2;
-	afx->crc  = crc;
     }
     else if( control == IOBUFCTRL_INIT )
       {
 	if( !is_initialized )
 	  initialize();
 
+	if (!afx->crc_md)
+	  {
+	    rc = gcry_md_open (&afx->crc_md, GCRY_MD_CRC24_RFC2440, 0);
+	    if (rc)
+	      return rc;
+	  }
+
 	/* Figure out what we're using for line endings if the caller
 	   didn't specify. */
 	if(afx->eol[0]==0)
@@ -1183,7 +1194,7 @@ armor_filter( void *opaque, int control,
 	if( afx->cancel )
 	    ;
 	else if( afx->status ) { /* pad, write cecksum, and bottom line */
-	    crc = afx->crc;
+	    crc = get_afx_crc (afx);
 	    idx = afx->idx;
 	    idx2 = afx->idx2;
 	    if( idx ) {
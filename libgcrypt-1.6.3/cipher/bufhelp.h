@@ -323,52 +323,67 @@ static inline void buf_put_le64(void *_buf, u64 val)
 
 #else /*BUFHELP_FAST_UNALIGNED_ACCESS*/
 
+/* The buffers passed to these functions are usually byte arrays which
+   are later accessed with other types (e.g. by buf_xor), thus the
+   loads and stores need to be excluded from strict aliasing.  */
+#if __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 4 )
+typedef u32 __attribute__ ((__may_alias__)) bufhelp_u32_t;
+#else
+typedef u32 bufhelp_u32_t;
+#endif
+
 /* Functions for loading and storing unaligned u32 values of different
    endianness.  */
 static inline u32 buf_get_be32(const void *_buf)
 {
-  return be_bswap32(*(const u32 *)_buf);
+  return be_bswap32(*(const bufhelp_u32_t *)_buf);
 }
 
 static inline u32 buf_get_le32(const void *_buf)
 {
-  return le_bswap32(*(const u32 *)_buf);
+  return le_bswap32(*(const bufhelp_u32_t *)_buf);
 }
 
 static inline void buf_put_be32(void *_buf, u32 val)
 {
-  u32 *out = _buf;
+  bufhelp_u32_t *out = _buf;
   *out = be_bswap32(val);
 }
 
 static inline void buf_put_le32(void *_buf, u32 val)
 {
-  u32 *out = _buf;
+  bufhelp_u32_t *out = _buf;
   *out = le_bswap32(val);
 }
 
 #ifdef HAVE_U64_TYPEDEF
+#if __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 4 )
+typedef u64 __attribute__ ((__may_alias__)) bufhelp_u64_t;
+#else
+typedef u64 bufhelp_u64_t;
+#endif
+
 /* Functions for loading and storing unaligned u64 values of different
    endianness.  */
 static inline u64 buf_get_be64(const void *_buf)
 {
-  return be_bswap64(*(const u64 *)_buf);
+  return be_bswap64(*(const bufhelp_u64_t *)_buf);
 }
 
 static inline u64 buf_get_le64(const void *_buf)
 {
-  return le_bswap64(*(const u64 *)_buf);
+  return le_bswap64(*(const bufhelp_u64_t *)_buf);
 }
 
 static inline void buf_put_be64(void *_buf, u64 val)
 {
-  u64 *out = _buf;
+  bufhelp_u64_t *out = _buf;
   *out = be_bswap64(val);
 }
 
 static inline void buf_put_le64(void *_buf, u64 val)
 {
-  u64 *out = _buf;
+  bufhelp_u64_t *out = _buf;
   *out = le_bswap64(val);
 }
 #endif /*HAVE_U64_TYPEDEF*/
@@ -0,0 +1,467 @@
+/* chacha20.c  -  Bernstein's ChaCha20 cipher
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser general Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * For a description of the algorithm, see:
+ *   http://cr.yp.to/chacha/chacha-20080128.pdf
+ *   RFC 7539: ChaCha20 and Poly1305 for IETF Protocols
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "g10lib.h"
+#include "cipher.h"
+#include "bithelp.h"
+#include "bufhelp.h"
+
+
+/* USE_SSSE3 indicates whether to compile with the AMD64 SSSE3 code. */
+#undef USE_SSSE3
+#if defined(__x86_64__) && defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) \
+    && defined(HAVE_GCC_INLINE_ASM_SSSE3)
+# define USE_SSSE3 1
+#endif
+
+/* USE_AVX2 indicates whether to compile with the AMD64 AVX2 code. */
+#undef USE_AVX2
+#if defined(__x86_64__) && defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) \
+    && defined(ENABLE_AVX2_SUPPORT)
+# define USE_AVX2 1
+#endif
+
+
+#define CHACHA20_MIN_KEY_SIZE 16  /* Bytes.  */
+#define CHACHA20_MAX_KEY_SIZE 32  /* Bytes.  */
+#define CHACHA20_BLOCK_SIZE   64  /* Bytes.  */
+#define CHACHA20_INPUT_LENGTH 16  /* Words.  */
+
+/* Number of double rounds.  */
+#define CHACHA20_DOUBLE_ROUNDS 10
+
+
+typedef struct CHACHA20_context_s
+{
+  /* Indices 0-3 are the constant, 4-11 the key, 12 and 13 the block
+     counter and 14, 15 the nonce.  With a 96 bit nonce (RFC 7539)
+     the counter is only word 12 and the nonce uses words 13 to 15:
+
+     C C C C
+     K K K K
+     K K K K
+     B B I I
+  */
+  u32 input[CHACHA20_INPUT_LENGTH];
+  byte pad[CHACHA20_BLOCK_SIZE];
+  unsigned int unused; /* bytes in the pad.  */
+#ifdef USE_SSSE3
+  unsigned int use_ssse3:1;
+#endif
+#ifdef USE_AVX2
+  unsigned int use_avx2:1;
+#endif
+} CHACHA20_context_t;
+
+
+#ifdef USE_SSSE3
+/* Process NBLKS blocks, a multiple of 4, using SSSE3.  The caller
+   makes sure that the 32 bit block counter does not wrap.  */
+unsigned int _gcry_chacha20_amd64_ssse3_blocks4 (u32 *state, byte *dst,
+                                                 const byte *src,
+                                                 size_t nblks);
+#endif
+
+#ifdef USE_AVX2
+/* Process NBLKS blocks, a multiple of 8, using AVX2.  The caller
+   makes sure that the 32 bit block counter does not wrap.  */
+unsigned int _gcry_chacha20_amd64_avx2_blocks8 (u32 *state, byte *dst,
+                                                const byte *src,
+                                                size_t nblks);
+#endif
+
+
+static void chacha20_setiv (void *context, const byte *iv, size_t ivlen);
+static const char *selftest (void);
+
+
+
+#define QROUND(a,b,c,d)                 \
+  do {                                  \
+    a += b; d = rol (d ^ a, 16);        \
+    c += d; b = rol (b ^ c, 12);        \
+    a += b; d = rol (d ^ a, 8);         \
+    c += d; b = rol (b ^ c, 7);         \
+  } while (0)
+
+/* Create the next key stream block in PAD and bump the block
+   counter.  Returns the stack burn depth.  */
+static unsigned int
+chacha20_core (byte *pad, CHACHA20_context_t *ctx)
+{
+  u32 x[CHACHA20_INPUT_LENGTH];
+  int i;
+
+  memcpy (x, ctx->input, sizeof x);
+
+  for (i = 0; i < CHACHA20_DOUBLE_ROUNDS; i++)
+    {
+      QROUND (x[0], x[4], x[ 8], x[12]);
+      QROUND (x[1], x[5], x[ 9], x[13]);
+      QROUND (x[2], x[6], x[10], x[14]);
+      QROUND (x[3], x[7], x[11], x[15]);
+
+      QROUND (x[0], x[5], x[10], x[15]);
+      QROUND (x[1], x[6], x[11], x[12]);
+      QROUND (x[2], x[7], x[ 8], x[13]);
+      QROUND (x[3], x[4], x[ 9], x[14]);
+    }
+
+  for (i = 0; i < CHACHA20_INPUT_LENGTH; i++)
+    buf_put_le32 (pad + i * 4, x[i] + ctx->input[i]);
+
+  /* With a 96 bit nonce the 32 bit counter is exhausted after 2^32
+     blocks (256 GiB) and the carry below then changes the first word
+     of the nonce.  It is the user's duty to change to another nonce
+     before that; the Poly1305 AEAD mode enforces the limit.  */
+  ctx->input[12]++;
+  if (!ctx->input[12])
+    ctx->input[13]++;
+
+  return sizeof x + 3 * sizeof (void *);
+}
+#undef QROUND
+
+
+
+static void
+chacha20_keysetup (CHACHA20_context_t *ctx, const byte *key,
+                   unsigned int keylen)
+{
+  /* These constants are the little endian encoding of the string
+     "expand 32-byte k".  For the 128 bit key size the key is repeated
+     and the string "expand 16-byte k" is used.  */
+  static const u32 sigma32[4] =
+    { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+  static const u32 tau32[4] =
+    { 0x61707865, 0x3120646e, 0x79622d36, 0x6b206574 };
+  int i;
+
+  memcpy (ctx->input, keylen == CHACHA20_MAX_KEY_SIZE? sigma32 : tau32, 16);
+  for (i = 0; i < 4; i++)
+    ctx->input[4 + i] = buf_get_le32 (key + 4 * i);
+  if (keylen == CHACHA20_MAX_KEY_SIZE)
+    key += 16;
+  for (i = 0; i < 4; i++)
+    ctx->input[8 + i] = buf_get_le32 (key + 4 * i);
+}
+
+
+static gcry_err_code_t
+chacha20_do_setkey (CHACHA20_context_t *ctx,
+                    const byte *key, unsigned int keylen)
+{
+  static int initialized;
+  static const char *selftest_failed;
+
+  if (!initialized )
+    {
+      initialized = 1;
+      selftest_failed = selftest ();
+      if (selftest_failed)
+        log_error ("CHACHA20 selftest failed (%s)\n", selftest_failed );
+    }
+  if (selftest_failed)
+    return GPG_ERR_SELFTEST_FAILED;
+
+  if (keylen != CHACHA20_MIN_KEY_SIZE
+      && keylen != CHACHA20_MAX_KEY_SIZE)
+    return GPG_ERR_INV_KEYLEN;
+
+#ifdef USE_SSSE3
+  ctx->use_ssse3 = (_gcry_get_hw_features () & HWF_INTEL_SSSE3) != 0;
+#endif
+#ifdef USE_AVX2
+  ctx->use_avx2 = (_gcry_get_hw_features () & HWF_INTEL_AVX2) != 0;
+#endif
+
+  chacha20_keysetup (ctx, key, keylen);
+
+  /* We default to a zero nonce.  */
+  chacha20_setiv (ctx, NULL, 0);
+
+  return 0;
+}
+
+
+static gcry_err_code_t
+chacha20_setkey (void *context, const byte *key, unsigned int keylen)
+{
+  CHACHA20_context_t *ctx = (CHACHA20_context_t *)context;
+  gcry_err_code_t rc = chacha20_do_setkey (ctx, key, keylen);
+  _gcry_burn_stack (4 + sizeof (void *) + 4 * sizeof (void *));
+  return rc;
+}
+
+
+/* Set the nonce.  An IV of 8 bytes is the original 64 bit nonce with
+   a 64 bit block counter, an IV of 12 bytes is the 96 bit nonce of
+   RFC 7539 with a 32 bit block counter, and an IV of 16 bytes sets
+   the little endian block counter and the 96 bit nonce at once.  The
+   block counter starts at zero for the first two variants.  With a 96
+   bit nonce at most 2^32 blocks, that is 256 GiB, may be processed
+   before a new nonce is set.  */
+static void
+chacha20_setiv (void *context, const byte *iv, size_t ivlen)
+{
+  CHACHA20_context_t *ctx = (CHACHA20_context_t *)context;
+
+  if (iv && ivlen != 8 && ivlen != 12 && ivlen != 16)
+    log_info ("WARNING: chacha20_setiv: bad ivlen=%u\n", (u32)ivlen);
+
+  if (iv && ivlen == 8)
+    {
+      ctx->input[12] = 0;
+      ctx->input[13] = 0;
+      ctx->input[14] = buf_get_le32 (iv + 0);
+      ctx->input[15] = buf_get_le32 (iv + 4);
+    }
+  else if (iv && ivlen == 12)
+    {
+      ctx->input[12] = 0;
+      ctx->input[13] = buf_get_le32 (iv + 0);
+      ctx->input[14] = buf_get_le32 (iv + 4);
+      ctx->input[15] = buf_get_le32 (iv + 8);
+    }
+  else if (iv && ivlen == 16)
+    {
+      ctx->input[12] = buf_get_le32 (iv + 0);
+      ctx->input[13] = buf_get_le32 (iv + 4);
+      ctx->input[14] = buf_get_le32 (iv + 8);
+      ctx->input[15] = buf_get_le32 (iv + 12);
+    }
+  else
+    memset (ctx->input + 12, 0, 4 * sizeof (u32));
+
+  /* Reset the unused pad bytes counter.  */
+  ctx->unused = 0;
+}
+
+
+/* Return the number of blocks, rounded down to a multiple of
+   PARALLEL, which may be processed by the 32 bit counter of the
+   vector implementations without a carry into word 13.  */
+static inline size_t
+chacha20_simd_blocks (CHACHA20_context_t *ctx, size_t nblocks,
+                      size_t parallel)
+{
+  u32 room = ~ctx->input[12];
+
+  if (nblocks > room)
+    nblocks = room;
+  return nblocks - (nblocks % parallel);
+}
+
+
+/* Note: This function requires LENGTH > 0.  */
+static void
+chacha20_do_encrypt_stream (CHACHA20_context_t *ctx,
+                            byte *outbuf, const byte *inbuf, size_t length)
+{
+  unsigned int nburn, burn = 0;
+
+  if (ctx->unused)
+    {
+      unsigned char *p = ctx->pad;
+      size_t n;
+
+      gcry_assert (ctx->unused < CHACHA20_BLOCK_SIZE);
+
+      n = ctx->unused;
+      if (n > length)
+        n = length;
+      buf_xor (outbuf, inbuf, p + CHACHA20_BLOCK_SIZE - ctx->unused, n);
+      length -= n;
+      outbuf += n;
+      inbuf  += n;
+      ctx->unused -= n;
+      if (!length)
+        return;
+      gcry_assert (!ctx->unused);
+    }
+
+#ifdef USE_AVX2
+  if (ctx->use_avx2 && length >= CHACHA20_BLOCK_SIZE * 8)
+    {
+      size_t nblocks = chacha20_simd_blocks (ctx,
+                                             length / CHACHA20_BLOCK_SIZE, 8);
+      if (nblocks)
+        {
+          nburn = _gcry_chacha20_amd64_avx2_blocks8 (ctx->input, outbuf,
+                                                     inbuf, nblocks);
+          burn = nburn > burn ? nburn : burn;
+          length -= CHACHA20_BLOCK_SIZE * nblocks;
+          outbuf += CHACHA20_BLOCK_SIZE * nblocks;
+          inbuf  += CHACHA20_BLOCK_SIZE * nblocks;
+        }
+    }
+#endif
+
+#ifdef USE_SSSE3
+  if (ctx->use_ssse3 && length >= CHACHA20_BLOCK_SIZE * 4)
+    {
+      size_t nblocks = chacha20_simd_blocks (ctx,
+                                             length / CHACHA20_BLOCK_SIZE, 4);
+      if (nblocks)
+        {
+          nburn = _gcry_chacha20_amd64_ssse3_blocks4 (ctx->input, outbuf,
+                                                      inbuf, nblocks);
+          burn = nburn > burn ? nburn : burn;
+          length -= CHACHA20_BLOCK_SIZE * nblocks;
+          outbuf += CHACHA20_BLOCK_SIZE * nblocks;
+          inbuf  += CHACHA20_BLOCK_SIZE * nblocks;
+        }
+    }
+#endif
+
+  while (length > 0)
+    {
+      nburn = chacha20_core (ctx->pad, ctx);
+      burn = nburn > burn ? nburn : burn;
+
+      if (length <= CHACHA20_BLOCK_SIZE)
+	{
+	  buf_xor (outbuf, inbuf, ctx->pad, length);
+          ctx->unused = CHACHA20_BLOCK_SIZE - length;
+	  break;
+	}
+      buf_xor (outbuf, inbuf, ctx->pad, CHACHA20_BLOCK_SIZE);
+      length -= CHACHA20_BLOCK_SIZE;
+      outbuf += CHACHA20_BLOCK_SIZE;
+      inbuf  += CHACHA20_BLOCK_SIZE;
+    }
+
+  _gcry_burn_stack (burn);
+}
+
+
+static void
+chacha20_encrypt_stream (void *context,
+                         byte *outbuf, const byte *inbuf, size_t length)
+{
+  CHACHA20_context_t *ctx = (CHACHA20_context_t *)context;
+
+  if (length)
+    chacha20_do_encrypt_stream (ctx, outbuf, inbuf, length);
+}
+
+
+static const char*
+selftest (void)
+{
+  CHACHA20_context_t ctx;
+  byte scratch[114+1];
+  byte buf[1024+64+4];
+  int i;
+
+  /* From RFC 7539, section 2.4.2.  */
+  static byte key_1[] =
+    { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+      0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+      0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f };
+  /* Block counter 1 followed by the 96 bit nonce.  */
+  static const byte nonce_1[] =
+    { 0x01, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a,
+      0x00, 0x00, 0x00, 0x00 };
+  static const byte plaintext_1[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you "
+    "only one tip for the future, sunscreen would be it.";
+  static const byte ciphertext_1[] =
+    { 0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80,
+      0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+      0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2,
+      0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+      0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab,
+      0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+      0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab,
+      0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+      0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61,
+      0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+      0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06,
+      0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+      0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6,
+      0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+      0x87, 0x4d };
+
+  chacha20_setkey (&ctx, key_1, sizeof key_1);
+  chacha20_setiv  (&ctx, nonce_1, sizeof nonce_1);
+  scratch[sizeof ciphertext_1] = 0;
+  chacha20_encrypt_stream (&ctx, scratch, plaintext_1, sizeof ciphertext_1);
+  if (memcmp (scratch, ciphertext_1, sizeof ciphertext_1))
+    return "ChaCha20 encryption test 1 failed.";
+  if (scratch[sizeof ciphertext_1])
+    return "ChaCha20 wrote too much.";
+  chacha20_setkey (&ctx, key_1, sizeof key_1);
+  chacha20_setiv  (&ctx, nonce_1, sizeof nonce_1);
+  chacha20_encrypt_stream (&ctx, scratch, scratch, sizeof ciphertext_1);
+  if (memcmp (scratch, plaintext_1, sizeof ciphertext_1))
+    return "ChaCha20 decryption test 1 failed.";
+
+  /* The buffer is large enough for the vector implementations; the
+     split decryption checks them against the generic code.  */
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i;
+  chacha20_setkey (&ctx, key_1, sizeof key_1);
+  chacha20_setiv (&ctx, nonce_1, sizeof nonce_1);
+  /*encrypt*/
+  chacha20_encrypt_stream (&ctx, buf, buf, sizeof buf);
+  /*decrypt*/
+  chacha20_setkey (&ctx, key_1, sizeof key_1);
+  chacha20_setiv (&ctx, nonce_1, sizeof nonce_1);
+  chacha20_encrypt_stream (&ctx, buf, buf, 1);
+  chacha20_encrypt_stream (&ctx, buf+1, buf+1, (sizeof buf)-1-1);
+  chacha20_encrypt_stream (&ctx, buf+(sizeof buf)-1, buf+(sizeof buf)-1, 1);
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != (byte)i)
+      return "ChaCha20 encryption test 2 failed.";
+
+  return NULL;
+}
+
+
+gcry_cipher_spec_t _gcry_cipher_spec_chacha20 =
+  {
+    GCRY_CIPHER_CHACHA20,
+    {0, 0},     /* flags */
+    "CHACHA20", /* name */
+    NULL,       /* aliases */
+    NULL,       /* oids */
+    1,          /* blocksize in bytes. */
+    CHACHA20_MAX_KEY_SIZE*8,  /* standard key length in bits. */
+    sizeof (CHACHA20_context_t),
+    chacha20_setkey,
+    NULL,
+    NULL,
+    chacha20_encrypt_stream,
+    chacha20_encrypt_stream,
+    NULL,
+    NULL,
+    chacha20_setiv
+  };
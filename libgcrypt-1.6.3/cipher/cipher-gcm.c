@@ -554,6 +554,161 @@ static inline void gfmul_pclmul_aggr4(void)
 }
 #endif
 
+#ifdef GCM_USE_INTEL_VPCLMUL
+/* Multiply a ZMM register of data with a ZMM register of hash powers
+   and add the four partial products to the accumulators zmm8 (low),
+   zmm9 (high) and zmm10 (middle).  */
+#define vpclmul_mul(d, h, op)                                           \
+  "vpclmulqdq $0x00, " h ", " d ", %%zmm11\n\t"                         \
+  "vpclmulqdq $0x11, " h ", " d ", %%zmm12\n\t"                         \
+  "vpclmulqdq $0x01, " h ", " d ", %%zmm13\n\t"                         \
+  "vpclmulqdq $0x10, " h ", " d ", %%zmm14\n\t"                         \
+  op
+
+#define vpclmul_first                                                   \
+  "vmovdqa64 %%zmm11, %%zmm8\n\t"                                       \
+  "vmovdqa64 %%zmm12, %%zmm9\n\t"                                       \
+  "vpxorq %%zmm13, %%zmm14, %%zmm10\n\t"
+
+#define vpclmul_add                                                     \
+  "vpxorq %%zmm11, %%zmm8, %%zmm8\n\t"                                  \
+  "vpxorq %%zmm12, %%zmm9, %%zmm9\n\t"                                  \
+  "vpternlogq $0x96, %%zmm13, %%zmm14, %%zmm10\n\t"
+
+/* GHASH NBLOCKS blocks from BUF into HASH, NBLOCKS being a multiple of
+   sixteen.  The hash powers H¹ to H¹⁶ are held in zmm16 to zmm19 so
+   that the first block of a group is multiplied by H¹⁶ and the last
+   by H¹.  The sixteen unreduced products are summed up and reduced
+   once per group using the same shift and reduction as
+   gfmul_pclmul.  */
+static void
+ghash_vpclmul16 (gcry_cipher_hd_t c, byte *hash, const byte *buf,
+                 size_t nblocks)
+{
+  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+  const u64 *h_table = c->u_mode.gcm.gcm_table;
+
+  asm volatile (/* Load H¹⁶..H¹³, H¹²..H⁹, H⁸..H⁵ and H⁴..H¹.  The
+                   table holds H² to H¹⁶ at index 0 to 14.  */
+                "vmovdqu 14*16(%[h_table]), %%xmm11\n\t"
+                "vinserti32x4 $1, 13*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $2, 12*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $3, 11*16(%[h_table]), %%zmm11, %%zmm16\n\t"
+                "vmovdqu 10*16(%[h_table]), %%xmm11\n\t"
+                "vinserti32x4 $1, 9*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $2, 8*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $3, 7*16(%[h_table]), %%zmm11, %%zmm17\n\t"
+                "vmovdqu 6*16(%[h_table]), %%xmm11\n\t"
+                "vinserti32x4 $1, 5*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $2, 4*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $3, 3*16(%[h_table]), %%zmm11, %%zmm18\n\t"
+                "vmovdqu 2*16(%[h_table]), %%xmm11\n\t"
+                "vinserti32x4 $1, 1*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $2, 0*16(%[h_table]), %%zmm11, %%zmm11\n\t"
+                "vinserti32x4 $3, %[h_1], %%zmm11, %%zmm19\n\t"
+
+                "vbroadcasti32x4 %[be_mask], %%zmm15\n\t"
+                "vmovdqu %[hash], %%xmm0\n\t"
+                "vpshufb %%xmm15, %%xmm0, %%xmm0\n\t" /* be => le */
+
+                ".align 16\n"
+                ".Lloop%=:\n\t"
+                "vmovdqu64 0*64(%[buf]), %%zmm4\n\t"
+                "vmovdqu64 1*64(%[buf]), %%zmm5\n\t"
+                "vmovdqu64 2*64(%[buf]), %%zmm6\n\t"
+                "vmovdqu64 3*64(%[buf]), %%zmm7\n\t"
+                "vpshufb %%zmm15, %%zmm4, %%zmm4\n\t" /* be => le */
+                "vpshufb %%zmm15, %%zmm5, %%zmm5\n\t"
+                "vpshufb %%zmm15, %%zmm6, %%zmm6\n\t"
+                "vpshufb %%zmm15, %%zmm7, %%zmm7\n\t"
+                "vpxorq %%zmm0, %%zmm4, %%zmm4\n\t"   /* add hash to 1st */
+
+                vpclmul_mul("%%zmm4", "%%zmm16", vpclmul_first)
+                vpclmul_mul("%%zmm5", "%%zmm17", vpclmul_add)
+                vpclmul_mul("%%zmm6", "%%zmm18", vpclmul_add)
+                vpclmul_mul("%%zmm7", "%%zmm19", vpclmul_add)
+
+                /* Sum up the four lanes.  */
+                "vextracti64x4 $1, %%zmm8, %%ymm11\n\t"
+                "vextracti64x4 $1, %%zmm9, %%ymm12\n\t"
+                "vextracti64x4 $1, %%zmm10, %%ymm13\n\t"
+                "vpxor %%ymm11, %%ymm8, %%ymm8\n\t"
+                "vpxor %%ymm12, %%ymm9, %%ymm9\n\t"
+                "vpxor %%ymm13, %%ymm10, %%ymm10\n\t"
+                "vextracti128 $1, %%ymm8, %%xmm11\n\t"
+                "vextracti128 $1, %%ymm9, %%xmm12\n\t"
+                "vextracti128 $1, %%ymm10, %%xmm13\n\t"
+                "vpxor %%xmm11, %%xmm8, %%xmm8\n\t"
+                "vpxor %%xmm12, %%xmm9, %%xmm9\n\t"
+                "vpxor %%xmm13, %%xmm10, %%xmm10\n\t"
+
+                "vpslldq $8, %%xmm10, %%xmm11\n\t"
+                "vpsrldq $8, %%xmm10, %%xmm10\n\t"
+                "vpxor %%xmm11, %%xmm8, %%xmm8\n\t"
+                "vpxor %%xmm10, %%xmm9, %%xmm9\n\t" /* <xmm9:xmm8> holds the
+                                                       sum of the products */
+
+                /* shift the result by one bit position to the left cope for
+                   the fact that bits are reversed */
+                "vpsrld $31, %%xmm8, %%xmm11\n\t"
+                "vpsrld $31, %%xmm9, %%xmm12\n\t"
+                "vpslld $1, %%xmm8, %%xmm8\n\t"
+                "vpslld $1, %%xmm9, %%xmm9\n\t"
+                "vpsrldq $12, %%xmm11, %%xmm0\n\t"
+                "vpslldq $4, %%xmm12, %%xmm12\n\t"
+                "vpslldq $4, %%xmm11, %%xmm11\n\t"
+                "vpor %%xmm11, %%xmm8, %%xmm8\n\t"
+                "vpor %%xmm12, %%xmm9, %%xmm9\n\t"
+                "vpor %%xmm9, %%xmm0, %%xmm0\n\t"
+
+                /* first phase of the reduction */
+                "vpslld $31, %%xmm8, %%xmm11\n\t"
+                "vpslld $30, %%xmm8, %%xmm12\n\t"
+                "vpslld $25, %%xmm8, %%xmm13\n\t"
+                "vpxor %%xmm12, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm13, %%xmm11, %%xmm11\n\t"
+                "vpsrldq $4, %%xmm11, %%xmm12\n\t"
+                "vpslldq $12, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm11, %%xmm8, %%xmm8\n\t"
+
+                /* second phase of the reduction */
+                "vpsrld $1, %%xmm8, %%xmm11\n\t"
+                "vpsrld $2, %%xmm8, %%xmm13\n\t"
+                "vpsrld $7, %%xmm8, %%xmm14\n\t"
+                "vpxor %%xmm13, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm14, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm12, %%xmm11, %%xmm11\n\t"
+                "vpxor %%xmm11, %%xmm8, %%xmm8\n\t"
+                "vpxor %%xmm8, %%xmm0, %%xmm0\n\t" /* the result is in xmm0 */
+
+                "addq $256, %[buf]\n\t"
+                "subq $16, %[nblocks]\n\t"
+                "jnz .Lloop%=\n\t"
+
+                "vpshufb %%xmm15, %%xmm0, %%xmm0\n\t" /* le => be */
+                "vmovdqu %%xmm0, %[hash]\n\t"
+
+                /* Clear used registers. */
+                "vpxorq %%zmm16, %%zmm16, %%zmm16\n\t"
+                "vpxorq %%zmm17, %%zmm17, %%zmm17\n\t"
+                "vpxorq %%zmm18, %%zmm18, %%zmm18\n\t"
+                "vpxorq %%zmm19, %%zmm19, %%zmm19\n\t"
+                "vzeroall\n\t"
+                : [hash] "+m" (*hash),
+                  [buf] "+r" (buf),
+                  [nblocks] "+r" (nblocks)
+                : [h_table] "r" (h_table),
+                  [h_1] "m" (*c->u_mode.gcm.u_ghash_key.key),
+                  [be_mask] "m" (*be_mask)
+                : "cc", "memory");
+}
+
+#undef vpclmul_mul
+#undef vpclmul_first
+#undef vpclmul_add
+#endif /*GCM_USE_INTEL_VPCLMUL*/
+
 #endif /*GCM_USE_INTEL_PCLMUL*/
 
 
@@ -575,6 +730,19 @@ ghash (gcry_cipher_hd_t c, byte *result, const byte *buf,
       static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
         { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
 
+#ifdef GCM_USE_INTEL_VPCLMUL
+      if (c->u_mode.gcm.use_intel_vpclmul && nblocks >= 16)
+        {
+          size_t n = nblocks & ~(size_t)15;
+
+          ghash_vpclmul16 (c, result, buf, n);
+          buf += n * blocksize;
+          nblocks -= n;
+          if (!nblocks)
+            return 0;
+        }
+#endif
+
       /* Preload hash and H1. */
       asm volatile ("movdqu %[hash], %%xmm1\n\t"
                     "movdqa %[hsub], %%xmm0\n\t"
@@ -717,10 +885,81 @@ setupM (gcry_cipher_hd_t c, byte *h)
       gfmul_pclmul (); /* H²•H² => H⁴ */
 
       asm volatile ("movdqu %%xmm1, 2*16(%[h_234])\n\t"
+                    "movdqa %%xmm1, %%xmm0\n\t"
+                    "movdqu %[h_1], %%xmm1\n\t"
                     :
-                    : [h_234] "r" (c->u_mode.gcm.gcm_table)
+                    : [h_234] "r" (c->u_mode.gcm.gcm_table),
+                      [h_1] "m" (*tmp)
+                    : "memory");
+
+      /* H⁵ to H⁸ are used by the eight block bulk functions.  */
+      gfmul_pclmul (); /* H⁴•H => H⁵ */
+
+      asm volatile ("movdqu %%xmm1, 3*16(%[h_table])\n\t"
+                    "movdqu 0*16(%[h_table]), %%xmm1\n\t"
+                    :
+                    : [h_table] "r" (c->u_mode.gcm.gcm_table)
                     : "memory");
 
+      gfmul_pclmul (); /* H⁴•H² => H⁶ */
+
+      asm volatile ("movdqu %%xmm1, 4*16(%[h_table])\n\t"
+                    "movdqu 1*16(%[h_table]), %%xmm1\n\t"
+                    :
+                    : [h_table] "r" (c->u_mode.gcm.gcm_table)
+                    : "memory");
+
+      gfmul_pclmul (); /* H⁴•H³ => H⁷ */
+
+      asm volatile ("movdqu %%xmm1, 5*16(%[h_table])\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    :
+                    : [h_table] "r" (c->u_mode.gcm.gcm_table)
+                    : "memory");
+
+      gfmul_pclmul (); /* H⁴•H⁴ => H⁸ */
+
+      asm volatile ("movdqu %%xmm1, 6*16(%[h_table])\n\t"
+                    :
+                    : [h_table] "r" (c->u_mode.gcm.gcm_table)
+                    : "memory");
+
+#ifdef GCM_USE_INTEL_VPCLMUL
+      /* H⁹ to H¹⁶ are used by the sixteen block VPCLMUL function.  */
+      c->u_mode.gcm.use_intel_vpclmul =
+        ((_gcry_get_hw_features () & HWF_INTEL_AVX512)
+         && (_gcry_get_hw_features () & HWF_INTEL_VPCLMUL));
+      if (c->u_mode.gcm.use_intel_vpclmul)
+        {
+          int i;
+
+          asm volatile ("movdqu 6*16(%[h_table]), %%xmm0\n\t"
+                        :
+                        : [h_table] "r" (c->u_mode.gcm.gcm_table)
+                        : "memory");
+
+          for (i = 1; i <= 8; i++)
+            {
+              const byte *h_i = (i == 1 ? c->u_mode.gcm.u_ghash_key.key
+                                 : (const byte *)c->u_mode.gcm.gcm_table
+                                   + (i - 2) * 16);
+
+              asm volatile ("movdqu %[h_i], %%xmm1\n\t"
+                            :
+                            : [h_i] "m" (*h_i)
+                            : "memory");
+
+              gfmul_pclmul (); /* H⁸•Hⁱ => H⁸⁺ⁱ */
+
+              asm volatile ("movdqu %%xmm1, (%[h_out])\n\t"
+                            :
+                            : [h_out] "r" ((byte *)c->u_mode.gcm.gcm_table
+                                           + (i + 6) * 16)
+                            : "memory");
+            }
+        }
+#endif
+
       /* Clear used registers. */
       asm volatile( "pxor %%xmm0, %%xmm0\n\t"
                     "pxor %%xmm1, %%xmm1\n\t"
@@ -866,13 +1105,72 @@ do_ghash_buf(gcry_cipher_hd_t c, byte *hash, const byte *buf,
 }
 
 
+static gcry_err_code_t
+gcm_crypt_generic (gcry_cipher_hd_t c, byte *outbuf, size_t outbuflen,
+                   const byte *inbuf, size_t inbuflen, int encrypt)
+{
+  gcry_err_code_t err;
+
+  /* GHASH is always computed over the ciphertext.  */
+  if (!encrypt)
+    do_ghash_buf(c, c->u_mode.gcm.u_tag.tag, inbuf, inbuflen, 0);
+
+  err = _gcry_cipher_ctr_encrypt(c, outbuf, outbuflen, inbuf, inbuflen);
+  if (err != 0)
+    return err;
+
+  if (encrypt)
+    do_ghash_buf(c, c->u_mode.gcm.u_tag.tag, outbuf, inbuflen, 0);
+
+  return 0;
+}
+
+
+static gcry_err_code_t
+gcm_crypt_inner (gcry_cipher_hd_t c, byte *outbuf, size_t outbuflen,
+                 const byte *inbuf, size_t inbuflen, int encrypt)
+{
+  gcry_err_code_t err;
+  size_t n;
+
+  if (c->bulk.gcm_crypt)
+    {
+      /* The bulk function works on complete blocks only; first use up
+         the key stream left over from the previous call.  */
+      if (c->unused && inbuflen > c->unused)
+        {
+          n = c->unused;
+          err = gcm_crypt_generic (c, outbuf, outbuflen, inbuf, n, encrypt);
+          if (err != 0)
+            return err;
+          outbuf += n;
+          outbuflen -= n;
+          inbuf += n;
+          inbuflen -= n;
+        }
+
+      if (!c->unused && !c->u_mode.gcm.mac_unused)
+        {
+          n = c->bulk.gcm_crypt (c, outbuf, inbuf,
+                                 inbuflen / GCRY_GCM_BLOCK_LEN, encrypt);
+          n *= GCRY_GCM_BLOCK_LEN;
+          outbuf += n;
+          outbuflen -= n;
+          inbuf += n;
+          inbuflen -= n;
+        }
+    }
+
+  return gcm_crypt_generic (c, outbuf, outbuflen, inbuf, inbuflen, encrypt);
+}
+
+
 gcry_err_code_t
 _gcry_cipher_gcm_encrypt (gcry_cipher_hd_t c,
                           byte *outbuf, size_t outbuflen,
                           const byte *inbuf, size_t inbuflen)
 {
   static const unsigned char zerobuf[MAX_BLOCKSIZE];
-  gcry_err_code_t err;
 
   if (c->spec->blocksize != GCRY_GCM_BLOCK_LEN)
     return GPG_ERR_CIPHER_ALGO;
@@ -903,13 +1201,7 @@ _gcry_cipher_gcm_encrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
-  err = _gcry_cipher_ctr_encrypt(c, outbuf, outbuflen, inbuf, inbuflen);
-  if (err != 0)
-    return err;
-
-  do_ghash_buf(c, c->u_mode.gcm.u_tag.tag, outbuf, inbuflen, 0);
-
-  return 0;
+  return gcm_crypt_inner (c, outbuf, outbuflen, inbuf, inbuflen, 1);
 }
 
 
@@ -946,9 +1238,7 @@ _gcry_cipher_gcm_decrypt (gcry_cipher_hd_t c,
       return GPG_ERR_INV_LENGTH;
     }
 
-  do_ghash_buf(c, c->u_mode.gcm.u_tag.tag, inbuf, inbuflen, 0);
-
-  return _gcry_cipher_ctr_encrypt(c, outbuf, outbuflen, inbuf, inbuflen);
+  return gcm_crypt_inner (c, outbuf, outbuflen, inbuf, inbuflen, 0);
 }
 
 
@@ -20,6 +20,9 @@
 #ifndef G10_CIPHER_INTERNAL_H
 #define G10_CIPHER_INTERNAL_H
 
+#include "./poly1305-internal.h"
+#include "./bithelp.h"
+
 /* The maximum supported size of a block in bytes.  */
 #define MAX_BLOCKSIZE 16
 
@@ -38,6 +41,15 @@
 /* Undef this symbol to trade GCM speed for 256 bytes of memory per context */
 #define GCM_USE_TABLES 1
 
+/* The length for an OCB block.  OCB is only defined for ciphers with
+   a 128 bit block length.  */
+#define OCB_BLOCK_LEN  (128/8)
+
+/* The size of the pre-computed L table for OCB.  L values for block
+   numbers with more than OCB_L_TABLE_SIZE trailing zero bits are
+   computed on demand.  */
+#define OCB_L_TABLE_SIZE 16
+
 
 /* GCM_USE_INTEL_PCLMUL inidicates whether to compile GCM with Intel PCLMUL
    code.  */
@@ -50,6 +62,15 @@
 # endif
 #endif /* GCM_USE_INTEL_PCLMUL */
 
+/* GCM_USE_INTEL_VPCLMUL indicates whether to compile GCM with the
+   AVX-512 VPCLMULQDQ code.  */
+#undef GCM_USE_INTEL_VPCLMUL
+#if defined(GCM_USE_INTEL_PCLMUL) && defined(__x86_64__) \
+    && defined(ENABLE_AVX512_SUPPORT) \
+    && defined(HAVE_GCC_INLINE_ASM_VAES_VPCLMUL)
+# define GCM_USE_INTEL_VPCLMUL 1
+#endif /* GCM_USE_INTEL_VPCLMUL */
+
 
 /* A VIA processor with the Padlock engine as well as the Intel AES_NI
    instructions require an alignment of most data on a 16 byte
@@ -102,6 +123,12 @@ struct gcry_cipher_handle
     void (*ctr_enc)(void *context, unsigned char *iv,
                     void *outbuf_arg, const void *inbuf_arg,
                     size_t nblocks);
+    void (*ocb_crypt)(gcry_cipher_hd_t c, void *outbuf_arg,
+                      const void *inbuf_arg, size_t nblocks, int encrypt);
+    void (*ocb_auth)(gcry_cipher_hd_t c, const void *abuf_arg,
+                     size_t nblocks);
+    size_t (*gcm_crypt)(gcry_cipher_hd_t c, void *outbuf_arg,
+                        const void *inbuf_arg, size_t nblocks, int encrypt);
   } bulk;
 
 
@@ -112,19 +139,22 @@ struct gcry_cipher_handle
     unsigned int key:1; /* Set to 1 if a key has been set.  */
     unsigned int iv:1;  /* Set to 1 if a IV has been set.  */
     unsigned int tag:1; /* Set to 1 if a tag is finalized. */
+    unsigned int finalize:1; /* Next encrypt/decrypt has the final data.  */
   } marks;
 
   /* The initialization vector.  For best performance we make sure
      that it is properly aligned.  In particular some implementations
      of bulk operations expect an 16 byte aligned IV.  IV is also used
-     to store CBC-MAC in CCM mode; counter IV is stored in U_CTR.  */
+     to store CBC-MAC in CCM mode; counter IV is stored in U_CTR.  For
+     OCB mode it is used for the offset value.  */
   union {
     cipher_context_alignment_t iv_align;
     unsigned char iv[MAX_BLOCKSIZE];
   } u_iv;
 
   /* The counter for CTR mode.  This field is also used by AESWRAP and
-     thus we can't use the U_IV union.  */
+     thus we can't use the U_IV union.  For OCB mode it is used for
+     the checksum.  */
   union {
     cipher_context_alignment_t iv_align;
     unsigned char ctr[MAX_BLOCKSIZE];
@@ -199,6 +229,10 @@ struct gcry_cipher_handle
       /* Use Intel PCLMUL instructions for accelerated GHASH. */
       unsigned int use_intel_pclmul:1;
 #endif
+#ifdef GCM_USE_INTEL_VPCLMUL
+      /* Use VPCLMULQDQ on 512 bit registers for sixteen block GHASH. */
+      unsigned int use_intel_vpclmul:1;
+#endif
 
       /* Pre-calculated table for GCM. */
 #ifdef GCM_USE_TABLES
@@ -212,6 +246,50 @@ struct gcry_cipher_handle
  #endif
 #endif
     } gcm;
+
+    /* Mode specific storage for Poly1305 mode. */
+    struct {
+      /* byte counters for AAD and data */
+      u64 aadcount;
+      u64 datacount;
+
+      unsigned int aad_finalized:1;
+      unsigned int bytecount_over_limits:1;
+      unsigned int nonce96:1; /* Set to 1 for the 96 bit RFC 7539 nonce. */
+
+      poly1305_context_t ctx;
+    } poly1305;
+
+    /* Mode specific storage for OCB mode. */
+    struct {
+      /* The tag is valid if marks.tag has been set.  */
+      unsigned char tag[OCB_BLOCK_LEN];
+
+      /* The offset and the running sum of the AAD processing.  */
+      unsigned char aad_offset[OCB_BLOCK_LEN];
+      unsigned char aad_sum[OCB_BLOCK_LEN];
+
+      /* AAD bytes not yet processed and their number.  */
+      unsigned char aad_leftover[OCB_BLOCK_LEN];
+      unsigned char aad_nleftover;
+
+      /* Number of data and AAD blocks processed so far.  */
+      u64 data_nblocks;
+      u64 aad_nblocks;
+
+      /* Set to 1 once the final data block has been processed.  */
+      unsigned int data_finalized:1;
+
+      /* --- Following members are not cleared in gcry_cipher_reset --- */
+
+      /* The length of the tag in bytes.  */
+      unsigned char taglen;
+
+      /* Pre-computed L values from the key.  */
+      unsigned char L_star[OCB_BLOCK_LEN];
+      unsigned char L_dollar[OCB_BLOCK_LEN];
+      unsigned char L[OCB_L_TABLE_SIZE][OCB_BLOCK_LEN];
+    } ocb;
   } u_mode;
 
   /* What follows are two contexts of the cipher in use.  The first
@@ -319,4 +397,68 @@ void _gcry_cipher_gcm_setkey
 /*           */   (gcry_cipher_hd_t c);
 
 
+/*-- cipher-ocb.c --*/
+gcry_err_code_t _gcry_cipher_ocb_encrypt
+/*           */ (gcry_cipher_hd_t c,
+                 unsigned char *outbuf, size_t outbuflen,
+                 const unsigned char *inbuf, size_t inbuflen);
+gcry_err_code_t _gcry_cipher_ocb_decrypt
+/*           */ (gcry_cipher_hd_t c,
+                 unsigned char *outbuf, size_t outbuflen,
+                 const unsigned char *inbuf, size_t inbuflen);
+gcry_err_code_t _gcry_cipher_ocb_set_nonce
+/*           */ (gcry_cipher_hd_t c, const unsigned char *nonce,
+                 size_t noncelen);
+gcry_err_code_t _gcry_cipher_ocb_authenticate
+/*           */ (gcry_cipher_hd_t c, const unsigned char *abuf, size_t abuflen);
+gcry_err_code_t _gcry_cipher_ocb_get_tag
+/*           */ (gcry_cipher_hd_t c,
+                 unsigned char *outtag, size_t taglen);
+gcry_err_code_t _gcry_cipher_ocb_check_tag
+/*           */ (gcry_cipher_hd_t c,
+                 const unsigned char *intag, size_t taglen);
+void _gcry_cipher_ocb_setkey
+/*           */ (gcry_cipher_hd_t c);
+const unsigned char *_gcry_cipher_ocb_get_l
+/*           */ (gcry_cipher_hd_t c, unsigned char *l_tmp, u64 n);
+
+
+/*-- cipher-poly1305.c --*/
+gcry_err_code_t _gcry_cipher_poly1305_encrypt
+/*           */   (gcry_cipher_hd_t c,
+                   unsigned char *outbuf, size_t outbuflen,
+                   const unsigned char *inbuf, size_t inbuflen);
+gcry_err_code_t _gcry_cipher_poly1305_decrypt
+/*           */   (gcry_cipher_hd_t c,
+                   unsigned char *outbuf, size_t outbuflen,
+                   const unsigned char *inbuf, size_t inbuflen);
+gcry_err_code_t _gcry_cipher_poly1305_setiv
+/*           */   (gcry_cipher_hd_t c,
+                   const unsigned char *iv, size_t ivlen);
+gcry_err_code_t _gcry_cipher_poly1305_authenticate
+/*           */   (gcry_cipher_hd_t c,
+                   const unsigned char *aadbuf, size_t aadbuflen);
+gcry_err_code_t _gcry_cipher_poly1305_get_tag
+/*           */   (gcry_cipher_hd_t c,
+                   unsigned char *outtag, size_t taglen);
+gcry_err_code_t _gcry_cipher_poly1305_check_tag
+/*           */   (gcry_cipher_hd_t c,
+                   const unsigned char *intag, size_t taglen);
+
+
+/* Return the L value for block number N.  The common cases are taken
+   from the pre-computed table; for others the value is computed into
+   L_TMP, a buffer of OCB_BLOCK_LEN bytes.  */
+static inline const unsigned char *
+ocb_get_l (gcry_cipher_hd_t c, unsigned char *l_tmp, u64 n)
+{
+  int ntz = _gcry_ctz64 (n);
+
+  if (ntz < OCB_L_TABLE_SIZE)
+    return c->u_mode.ocb.L[ntz];
+  else
+    return _gcry_cipher_ocb_get_l (c, l_tmp, n);
+}
+
+
 #endif /*G10_CIPHER_INTERNAL_H*/
@@ -0,0 +1,314 @@
+/* cipher-poly1305.c  -  ChaCha20-Poly1305 AEAD mode (RFC 7539)
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser general Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "g10lib.h"
+#include "cipher.h"
+#include "bufhelp.h"
+#include "./cipher-internal.h"
+#include "./poly1305-internal.h"
+
+
+/* The data is encrypted and authenticated in chunks of this size so
+   that the MAC reads the ciphertext from the cache.  */
+#define POLY1305_CHUNK_SIZE (8 * 1024)
+
+/* With a 96 bit nonce the 32 bit block counter limits the data to
+   2^38 - 64 bytes; the first key stream block is used for the
+   Poly1305 key.  */
+#define POLY1305_MAX_DATALEN_96 ((((u64)1) << 38) - 64)
+
+
+/* Feed zero bytes to the MAC to pad a stream of LEN bytes to a
+   multiple of the Poly1305 block size.  */
+static void
+poly1305_pad (gcry_cipher_hd_t c, u64 len)
+{
+  static const byte zero[POLY1305_BLOCKSIZE];
+  unsigned int n = (unsigned int)len % POLY1305_BLOCKSIZE;
+
+  if (n)
+    _gcry_poly1305_update (&c->u_mode.poly1305.ctx, zero,
+                           POLY1305_BLOCKSIZE - n);
+}
+
+
+/* Add LEN to the byte counter CNT.  Returns false if the counter
+   overflows or exceeds LIMIT.  */
+static int
+poly1305_bytecounter_add (u64 *cnt, size_t len, u64 limit)
+{
+  if (len > limit || *cnt > limit - len)
+    return 0;
+  *cnt += len;
+  return 1;
+}
+
+
+static gcry_err_code_t
+poly1305_initiv (gcry_cipher_hd_t c, const byte *iv, size_t ivlen)
+{
+  byte tmpbuf[64]; /* One ChaCha20 block.  */
+  gcry_err_code_t err;
+
+  memset (&c->u_mode.poly1305, 0, sizeof c->u_mode.poly1305);
+  c->marks.iv = 0;
+  c->marks.tag = 0;
+
+  if (ivlen != 8 && ivlen != 12)
+    return GPG_ERR_INV_LENGTH;
+
+  c->spec->setiv (&c->context.c, iv, ivlen);
+  c->u_mode.poly1305.nonce96 = (ivlen == 12);
+
+  /* The Poly1305 key is made from the first 32 bytes of the first key
+     stream block; the data is encrypted starting with the second
+     block.  */
+  memset (tmpbuf, 0, sizeof tmpbuf);
+  c->spec->stencrypt (&c->context.c, tmpbuf, tmpbuf, sizeof tmpbuf);
+
+  err = _gcry_poly1305_init (&c->u_mode.poly1305.ctx, tmpbuf,
+                             POLY1305_KEYLEN);
+  wipememory (tmpbuf, sizeof tmpbuf);
+  if (err)
+    return err;
+
+  c->marks.iv = 1;
+  return 0;
+}
+
+
+static gcry_err_code_t
+poly1305_set_zeroiv (gcry_cipher_hd_t c)
+{
+  static const byte zero[12];
+
+  return poly1305_initiv (c, zero, sizeof zero);
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_setiv (gcry_cipher_hd_t c, const byte *iv, size_t ivlen)
+{
+  if (!iv && ivlen)
+    return GPG_ERR_INV_ARG;
+
+  return poly1305_initiv (c, iv, ivlen);
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_authenticate (gcry_cipher_hd_t c,
+                                    const byte *aadbuf, size_t aadbuflen)
+{
+  gcry_err_code_t err;
+
+  if (c->u_mode.poly1305.bytecount_over_limits)
+    return GPG_ERR_INV_LENGTH;
+  if (c->marks.tag || c->u_mode.poly1305.aad_finalized)
+    return GPG_ERR_INV_STATE;
+
+  if (!c->marks.iv)
+    {
+      err = poly1305_set_zeroiv (c);
+      if (err)
+        return err;
+    }
+
+  if (!poly1305_bytecounter_add (&c->u_mode.poly1305.aadcount, aadbuflen,
+                                 ~(u64)0))
+    {
+      c->u_mode.poly1305.bytecount_over_limits = 1;
+      return GPG_ERR_INV_LENGTH;
+    }
+
+  _gcry_poly1305_update (&c->u_mode.poly1305.ctx, aadbuf, aadbuflen);
+
+  return 0;
+}
+
+
+/* Common start of encryption and decryption.  */
+static gcry_err_code_t
+poly1305_start_data (gcry_cipher_hd_t c, size_t outbuflen, size_t inbuflen)
+{
+  gcry_err_code_t err;
+  u64 limit;
+
+  if (outbuflen < inbuflen)
+    return GPG_ERR_BUFFER_TOO_SHORT;
+  if (c->u_mode.poly1305.bytecount_over_limits)
+    return GPG_ERR_INV_LENGTH;
+  if (c->marks.tag)
+    return GPG_ERR_INV_STATE;
+
+  if (!c->marks.iv)
+    {
+      err = poly1305_set_zeroiv (c);
+      if (err)
+        return err;
+    }
+
+  if (!c->u_mode.poly1305.aad_finalized)
+    {
+      /* Start of the data marks the end of the AAD stream.  */
+      poly1305_pad (c, c->u_mode.poly1305.aadcount);
+      c->u_mode.poly1305.aad_finalized = 1;
+    }
+
+  limit = c->u_mode.poly1305.nonce96? POLY1305_MAX_DATALEN_96 : ~(u64)0;
+  if (!poly1305_bytecounter_add (&c->u_mode.poly1305.datacount, inbuflen,
+                                 limit))
+    {
+      c->u_mode.poly1305.bytecount_over_limits = 1;
+      return GPG_ERR_INV_LENGTH;
+    }
+
+  return 0;
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_encrypt (gcry_cipher_hd_t c,
+                               byte *outbuf, size_t outbuflen,
+                               const byte *inbuf, size_t inbuflen)
+{
+  gcry_err_code_t err;
+  size_t n;
+
+  err = poly1305_start_data (c, outbuflen, inbuflen);
+  if (err)
+    return err;
+
+  while (inbuflen)
+    {
+      n = inbuflen < POLY1305_CHUNK_SIZE? inbuflen : POLY1305_CHUNK_SIZE;
+
+      c->spec->stencrypt (&c->context.c, outbuf, (byte*)inbuf, n);
+      _gcry_poly1305_update (&c->u_mode.poly1305.ctx, outbuf, n);
+
+      outbuf += n;
+      inbuf += n;
+      inbuflen -= n;
+    }
+
+  return 0;
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_decrypt (gcry_cipher_hd_t c,
+                               byte *outbuf, size_t outbuflen,
+                               const byte *inbuf, size_t inbuflen)
+{
+  gcry_err_code_t err;
+  size_t n;
+
+  err = poly1305_start_data (c, outbuflen, inbuflen);
+  if (err)
+    return err;
+
+  while (inbuflen)
+    {
+      n = inbuflen < POLY1305_CHUNK_SIZE? inbuflen : POLY1305_CHUNK_SIZE;
+
+      _gcry_poly1305_update (&c->u_mode.poly1305.ctx, inbuf, n);
+      c->spec->stdecrypt (&c->context.c, outbuf, (byte*)inbuf, n);
+
+      outbuf += n;
+      inbuf += n;
+      inbuflen -= n;
+    }
+
+  return 0;
+}
+
+
+static gcry_err_code_t
+poly1305_tag (gcry_cipher_hd_t c, byte *outbuf, size_t outbuflen, int check)
+{
+  gcry_err_code_t err;
+
+  if (outbuflen < POLY1305_TAGLEN)
+    return GPG_ERR_BUFFER_TOO_SHORT;
+  if (c->u_mode.poly1305.bytecount_over_limits)
+    return GPG_ERR_INV_LENGTH;
+
+  if (!c->marks.iv)
+    {
+      err = poly1305_set_zeroiv (c);
+      if (err)
+        return err;
+    }
+
+  if (!c->marks.tag)
+    {
+      byte lenbuf[16];
+
+      if (!c->u_mode.poly1305.aad_finalized)
+        {
+          poly1305_pad (c, c->u_mode.poly1305.aadcount);
+          c->u_mode.poly1305.aad_finalized = 1;
+        }
+      poly1305_pad (c, c->u_mode.poly1305.datacount);
+
+      buf_put_le64 (lenbuf + 0, c->u_mode.poly1305.aadcount);
+      buf_put_le64 (lenbuf + 8, c->u_mode.poly1305.datacount);
+      _gcry_poly1305_update (&c->u_mode.poly1305.ctx, lenbuf, sizeof lenbuf);
+
+      /* The tag is kept in U_IV which is otherwise unused by this
+         mode.  */
+      _gcry_poly1305_finish (&c->u_mode.poly1305.ctx, c->u_iv.iv);
+      c->marks.tag = 1;
+
+      wipememory (lenbuf, sizeof lenbuf);
+    }
+
+  if (!check)
+    {
+      memcpy (outbuf, c->u_iv.iv, POLY1305_TAGLEN);
+      return GPG_ERR_NO_ERROR;
+    }
+  else
+    {
+      return buf_eq_const (outbuf, c->u_iv.iv, POLY1305_TAGLEN) ?
+               GPG_ERR_NO_ERROR : GPG_ERR_CHECKSUM;
+    }
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_get_tag (gcry_cipher_hd_t c,
+                               byte *outtag, size_t taglen)
+{
+  return poly1305_tag (c, outtag, taglen, 0);
+}
+
+
+gcry_err_code_t
+_gcry_cipher_poly1305_check_tag (gcry_cipher_hd_t c,
+                                 const byte *intag, size_t taglen)
+{
+  return poly1305_tag (c, (byte *)intag, taglen, 1);
+}
@@ -293,6 +293,9 @@ _gcry_dsa_gen_rfc6979_k (gcry_mpi_t *r_k,
   rc = _gcry_mpi_scan (&k, GCRYMPI_FMT_USG, t, (tbits+7)/8, NULL);
   if (rc)
     goto leave;
+  /* K is a secret; keep it in secure memory so that the EC code uses
+     its constant time path.  */
+  mpi_set_flag (k, GCRYMPI_FLAG_SECURE);
   if (tbits > qbits)
     mpi_rshift (k, k, tbits - qbits);
 
@@ -46,6 +46,7 @@ typedef struct
   gcry_mpi_t g;	    /* group generator */
   gcry_mpi_t y;	    /* g^x mod p */
   gcry_mpi_t x;	    /* secret exponent */
+  mpi_mont_t mont_p; /* Montgomery context for P or NULL.  */
 } DSA_secret_key;
 
 
@@ -607,7 +608,10 @@ sign (gcry_mpi_t r, gcry_mpi_t s, gcry_mpi_t input, DSA_secret_key *skey,
     }
 
   /* r = (a^k mod p) mod q */
-  mpi_powm( r, skey->g, k, skey->p );
+  if (skey->mont_p)
+    mpi_powm_mont (r, skey->g, k, skey->mont_p);
+  else
+    mpi_powm( r, skey->g, k, skey->p );
   mpi_fdiv_r( r, r, skey->q );
 
   /* kinv = k^(-1) mod q */
@@ -969,7 +973,7 @@ static gcry_err_code_t
 dsa_check_secret_key (gcry_sexp_t keyparms)
 {
   gcry_err_code_t rc;
-  DSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL};
+  DSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
 
   rc = _gcry_sexp_extract_param (keyparms, NULL, "pqgyx",
                                  &sk.p, &sk.q, &sk.g, &sk.y, &sk.x,
@@ -992,18 +996,19 @@ dsa_check_secret_key (gcry_sexp_t keyparms)
 }
 
 
+/* Sign S_DATA with the secret key SK and store the signature at
+   R_SIG.  */
 static gcry_err_code_t
-dsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+sign_with_key (gcry_sexp_t *r_sig, gcry_sexp_t s_data, DSA_secret_key *sk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  DSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL};
   gcry_mpi_t sig_r = NULL;
   gcry_mpi_t sig_s = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_SIGN,
-                                   dsa_get_nbits (keyparms));
+                                   mpi_get_nbits (sk->p));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1012,24 +1017,19 @@ dsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   if (DBG_CIPHER)
     log_mpidump ("dsa_sign   data", data);
 
-  /* Extract the key.  */
-  rc = _gcry_sexp_extract_param (keyparms, NULL, "pqgyx",
-                                 &sk.p, &sk.q, &sk.g, &sk.y, &sk.x, NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("dsa_sign      p", sk.p);
-      log_mpidump ("dsa_sign      q", sk.q);
-      log_mpidump ("dsa_sign      g", sk.g);
-      log_mpidump ("dsa_sign      y", sk.y);
+      log_mpidump ("dsa_sign      p", sk->p);
+      log_mpidump ("dsa_sign      q", sk->q);
+      log_mpidump ("dsa_sign      g", sk->g);
+      log_mpidump ("dsa_sign      y", sk->y);
       if (!fips_mode ())
-        log_mpidump ("dsa_sign      x", sk.x);
+        log_mpidump ("dsa_sign      x", sk->x);
     }
 
   sig_r = mpi_new (0);
   sig_s = mpi_new (0);
-  rc = sign (sig_r, sig_s, data, &sk, ctx.flags, ctx.hash_algo);
+  rc = sign (sig_r, sig_s, data, sk, ctx.flags, ctx.hash_algo);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
@@ -1042,21 +1042,38 @@ dsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
  leave:
   _gcry_mpi_release (sig_r);
   _gcry_mpi_release (sig_s);
+  _gcry_mpi_release (data);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  if (DBG_CIPHER)
+    log_debug ("dsa_sign      => %s\n", gpg_strerror (rc));
+  return rc;
+}
+
+
+static gcry_err_code_t
+dsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  DSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+
+  /* Extract the key.  */
+  rc = _gcry_sexp_extract_param (keyparms, NULL, "pqgyx",
+                                 &sk.p, &sk.q, &sk.g, &sk.y, &sk.x, NULL);
+  if (!rc)
+    rc = sign_with_key (r_sig, s_data, &sk);
+
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.g);
   _gcry_mpi_release (sk.y);
   _gcry_mpi_release (sk.x);
-  _gcry_mpi_release (data);
-  _gcry_pk_util_free_encoding_ctx (&ctx);
-  if (DBG_CIPHER)
-    log_debug ("dsa_sign      => %s\n", gpg_strerror (rc));
   return rc;
 }
 
 
+/* Check the signature S_SIG on S_DATA using the public key PK.  */
 static gcry_err_code_t
-dsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+verify_with_key (gcry_sexp_t s_sig, gcry_sexp_t s_data, DSA_public_key *pk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
@@ -1064,10 +1081,9 @@ dsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
   gcry_mpi_t sig_r = NULL;
   gcry_mpi_t sig_s = NULL;
   gcry_mpi_t data = NULL;
-  DSA_public_key pk = { NULL, NULL, NULL, NULL };
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
-                                   dsa_get_nbits (s_keyparms));
+                                   mpi_get_nbits (pk->p));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1089,27 +1105,18 @@ dsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
       log_mpidump ("dsa_verify  s_s", sig_s);
     }
 
-  /* Extract the key.  */
-  rc = _gcry_sexp_extract_param (s_keyparms, NULL, "pqgy",
-                                 &pk.p, &pk.q, &pk.g, &pk.y, NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("dsa_verify    p", pk.p);
-      log_mpidump ("dsa_verify    q", pk.q);
-      log_mpidump ("dsa_verify    g", pk.g);
-      log_mpidump ("dsa_verify    y", pk.y);
+      log_mpidump ("dsa_verify    p", pk->p);
+      log_mpidump ("dsa_verify    q", pk->q);
+      log_mpidump ("dsa_verify    g", pk->g);
+      log_mpidump ("dsa_verify    y", pk->y);
     }
 
   /* Verify the signature.  */
-  rc = verify (sig_r, sig_s, data, &pk);
+  rc = verify (sig_r, sig_s, data, pk);
 
  leave:
-  _gcry_mpi_release (pk.p);
-  _gcry_mpi_release (pk.q);
-  _gcry_mpi_release (pk.g);
-  _gcry_mpi_release (pk.y);
   _gcry_mpi_release (data);
   _gcry_mpi_release (sig_r);
   _gcry_mpi_release (sig_s);
@@ -1121,6 +1128,110 @@ dsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
 }
 
 
+static gcry_err_code_t
+dsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+{
+  gcry_err_code_t rc;
+  DSA_public_key pk = { NULL, NULL, NULL, NULL };
+
+  /* Extract the key.  */
+  rc = _gcry_sexp_extract_param (s_keyparms, NULL, "pqgy",
+                                 &pk.p, &pk.q, &pk.g, &pk.y, NULL);
+  if (!rc)
+    rc = verify_with_key (s_sig, s_data, &pk);
+
+  _gcry_mpi_release (pk.p);
+  _gcry_mpi_release (pk.q);
+  _gcry_mpi_release (pk.g);
+  _gcry_mpi_release (pk.y);
+  return rc;
+}
+
+
+/* The context of a key handle.  */
+typedef struct
+{
+  DSA_secret_key sk;       /* The key; X is NULL for a public key.  */
+} dsa_hd_ctx_t;
+
+
+static void
+dsa_close (void *ctx)
+{
+  dsa_hd_ctx_t *c = ctx;
+
+  if (!c)
+    return;
+
+  mpi_mont_free (c->sk.mont_p);
+  _gcry_mpi_release (c->sk.p);
+  _gcry_mpi_release (c->sk.q);
+  _gcry_mpi_release (c->sk.g);
+  _gcry_mpi_release (c->sk.y);
+  _gcry_mpi_release (c->sk.x);
+  xfree (c);
+}
+
+
+/* Extract the key from KEYPARMS and set up the Montgomery context for
+   P so that it does not need to be computed for each signature.  */
+static gcry_err_code_t
+dsa_open (gcry_sexp_t keyparms, int secret, void **r_ctx)
+{
+  gcry_err_code_t rc;
+  dsa_hd_ctx_t *c;
+
+  *r_ctx = NULL;
+
+  c = xtrycalloc_secure (1, sizeof *c);
+  if (!c)
+    return gpg_err_code_from_syserror ();
+
+  if (secret)
+    rc = _gcry_sexp_extract_param (keyparms, NULL, "pqgyx",
+                                   &c->sk.p, &c->sk.q, &c->sk.g, &c->sk.y,
+                                   &c->sk.x, NULL);
+  else
+    rc = _gcry_sexp_extract_param (keyparms, NULL, "pqgy",
+                                   &c->sk.p, &c->sk.q, &c->sk.g, &c->sk.y,
+                                   NULL);
+  if (rc)
+    {
+      dsa_close (c);
+      return rc;
+    }
+
+  if (!mpi_has_sign (c->sk.p) && mpi_test_bit (c->sk.p, 0))
+    c->sk.mont_p = mpi_mont_init (c->sk.p, 0);
+
+  *r_ctx = c;
+  return 0;
+}
+
+
+static gcry_err_code_t
+dsa_hd_sign (void *ctx, gcry_sexp_t *r_sig, gcry_sexp_t s_data)
+{
+  dsa_hd_ctx_t *c = ctx;
+
+  return sign_with_key (r_sig, s_data, &c->sk);
+}
+
+
+static gcry_err_code_t
+dsa_hd_verify (void *ctx, gcry_sexp_t s_sig, gcry_sexp_t s_data)
+{
+  dsa_hd_ctx_t *c = ctx;
+  DSA_public_key pk;
+
+  pk.p = c->sk.p;
+  pk.q = c->sk.q;
+  pk.g = c->sk.g;
+  pk.y = c->sk.y;
+  return verify_with_key (s_sig, s_data, &pk);
+}
+
+
 /* Return the number of bits for the key described by PARMS.  On error
  * 0 is returned.  The format of PARMS starts with the algorithm name;
  * for example:
@@ -1295,5 +1406,15 @@ gcry_pk_spec_t _gcry_pubkey_spec_dsa =
     dsa_sign,
     dsa_verify,
     dsa_get_nbits,
-    run_selftests
+    run_selftests,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    dsa_open,
+    dsa_close,
+    NULL,
+    NULL,
+    dsa_hd_sign,
+    dsa_hd_verify
   };
@@ -81,6 +81,8 @@ const char *_gcry_ecc_get_curve (gcry_sexp_t keyparms,
                                  int iterator,
                                  unsigned int *r_nbits);
 gcry_sexp_t _gcry_ecc_get_param_sexp (const char *name);
+void _gcry_ecc_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                         elliptic_curve_t *E, mpi_ec_t ec);
 
 /*-- ecc-misc.c --*/
 void _gcry_ecc_curve_free (elliptic_curve_t *E);
@@ -89,6 +91,9 @@ const char *_gcry_ecc_model2str (enum gcry_mpi_ec_models model);
 const char *_gcry_ecc_dialect2str (enum ecc_dialects dialect);
 gcry_mpi_t   _gcry_ecc_ec2os (gcry_mpi_t x, gcry_mpi_t y, gcry_mpi_t p);
 gcry_err_code_t _gcry_ecc_os2ec (mpi_point_t result, gcry_mpi_t value);
+gcry_mpi_t   _gcry_ecc_mont_encodepoint (gcry_mpi_t x, unsigned int nbits);
+gpg_err_code_t _gcry_ecc_mont_decodepoint (gcry_mpi_t pk, mpi_ec_t ctx,
+                                           mpi_point_t result);
 
 mpi_point_t  _gcry_ecc_compute_public (mpi_point_t Q, mpi_ec_t ec,
                                        mpi_point_t G, gcry_mpi_t d);
@@ -100,7 +105,8 @@ gpg_err_code_t _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
                                      gcry_mpi_t r, gcry_mpi_t s,
                                      int flags, int hashalgo);
 gpg_err_code_t _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
-                                       gcry_mpi_t r, gcry_mpi_t s);
+                                       gcry_mpi_t r, gcry_mpi_t s,
+                                       mpi_ec_base_table_t qtable);
 
 /*-- ecc-eddsa.c --*/
 gpg_err_code_t _gcry_ecc_eddsa_recover_x (gcry_mpi_t x, gcry_mpi_t y, int sign,
@@ -131,6 +137,13 @@ gpg_err_code_t _gcry_ecc_eddsa_verify (gcry_mpi_t input,
                                        ECC_public_key *pk,
                                        gcry_mpi_t r, gcry_mpi_t s,
                                        int hashalgo, gcry_mpi_t pkmpi);
+gpg_err_code_t _gcry_ecc_eddsa_verify_batch (unsigned int n,
+                                             gcry_mpi_t *inputs,
+                                             ECC_public_key *pk,
+                                             gcry_mpi_t *r_ins,
+                                             gcry_mpi_t *s_ins,
+                                             int hashalgo, gcry_mpi_t *pks,
+                                             gpg_err_code_t *r_results);
 
 /*-- ecc-gost.c --*/
 gpg_err_code_t _gcry_ecc_gost_sign (gcry_mpi_t input, ECC_secret_key *skey,
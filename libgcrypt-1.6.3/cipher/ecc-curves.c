@@ -27,6 +27,7 @@
 #include "g10lib.h"
 #include "mpi.h"
 #include "cipher.h"
+#include "ath.h"
 #include "context.h"
 #include "ec-context.h"
 #include "pubkey-internal.h"
@@ -40,7 +41,7 @@ static const struct
   const char *other; /* Other name. */
 } curve_aliases[] =
   {
-  /*{ "Curve25519", "1.3.6.1.4.1.3029.1.5.1" },*/
+    { "Curve25519", "1.3.6.1.4.1.3029.1.5.1" },
     { "Ed25519",    "1.3.6.1.4.1.11591.15.1" },
 
     { "NIST P-192", "1.2.840.10045.3.1.1" }, /* X9.62 OID  */
@@ -113,6 +114,18 @@ static const ecc_domain_parms_t domain_parms[] =
       "0x216936D3CD6E53FEC0A4E231FDD6DC5C692CC7609525A7B2C9562D608F25D51A",
       "0x6666666666666666666666666666666666666666666666666666666666666658"
     },
+    {
+      /* (y^2 = x^3 + 486662*x^2 + x).  For Montgomery curves a is
+         (A-2)/4 as used by the ladder and b is not used.  */
+      "Curve25519", 255, 0,
+      MPI_EC_MONTGOMERY, ECC_DIALECT_STANDARD,
+      "0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFED",
+      "0x01DB41",
+      "0x01",
+      "0x1000000000000000000000000000000014DEF9DEA2F79CD65812631A5CF5D3ED",
+      "0x0000000000000000000000000000000000000000000000000000000000000009",
+      "0x20AE19A1B8A086B4E01EDD2C7748D14C923D4D7E6D7C61B229E9C5A27ECED3D9"
+    },
     {
       "NIST P-192", 192, 1,
       MPI_EC_WEIERSTRASS, ECC_DIALECT_STANDARD,
@@ -301,6 +314,22 @@ static const ecc_domain_parms_t domain_parms[] =
   };
 
 
+/* Precomputed multiples of the base point for the curves in
+   DOMAIN_PARMS, used to speed up signing and key generation.  An
+   entry is created on first use of its curve and kept for the
+   lifetime of the process.  The curve parameters are stored along
+   with the table so that a lookup only needs to compare MPIs.  */
+static struct
+{
+  gcry_mpi_t p, a, b;
+  mpi_point_struct G;
+  mpi_ec_base_table_t table;
+} base_tables[DIM (domain_parms)];
+
+/* Mutex used to protect access to BASE_TABLES.  */
+static ath_mutex_t base_tables_lock;
+
+
 
 
 /* Return a copy of POINT.  */
@@ -364,6 +393,106 @@ find_domain_parms_idx (const char *name)
 }
 
 
+/* Explicitly initialize the curve module.  */
+gcry_err_code_t
+_gcry_ecc_curves_init (void)
+{
+  gcry_err_code_t ec;
+
+  ec = ath_mutex_init (&base_tables_lock);
+  if (ec)
+    return gpg_err_code_from_errno (ec);
+  return ec;
+}
+
+
+/* Return true if the parameters of curve E match the base table
+   entry IDX.  */
+static int
+base_table_match (int idx, elliptic_curve_t *E)
+{
+  return (!mpi_cmp (base_tables[idx].p, E->p)
+          && !mpi_cmp (base_tables[idx].G.x, E->G.x)
+          && !mpi_cmp (base_tables[idx].G.y, E->G.y)
+          && !mpi_cmp (base_tables[idx].a, E->a)
+          && !mpi_cmp (base_tables[idx].b, E->b));
+}
+
+
+/* Return the base point table for the curve E or NULL if E is not
+   one of our named curves.  The table is created if needed using the
+   context EC.  Needs to be called while BASE_TABLES_LOCK is held.  */
+static mpi_ec_base_table_t
+get_base_table (elliptic_curve_t *E, mpi_ec_t ec)
+{
+  int idx;
+  gcry_mpi_t tmp = NULL;
+
+  for (idx = 0; domain_parms[idx].desc; idx++)
+    if (base_tables[idx].table && base_table_match (idx, E))
+      return base_tables[idx].table;
+
+  /* Not yet cached; check whether this is a known curve.  Note that
+     several curves may use the same field.  */
+  for (idx = 0; domain_parms[idx].desc; idx++)
+    {
+      if (base_tables[idx].table || domain_parms[idx].model != E->model)
+        continue;
+      tmp = scanval (domain_parms[idx].p);
+      if (mpi_cmp (tmp, E->p))
+        {
+          mpi_free (tmp);
+          continue;
+        }
+      mpi_free (tmp);
+
+      base_tables[idx].p = scanval (domain_parms[idx].p);
+      base_tables[idx].a = scanval (domain_parms[idx].a);
+      base_tables[idx].b = scanval (domain_parms[idx].b);
+      base_tables[idx].G.x = scanval (domain_parms[idx].g_x);
+      base_tables[idx].G.y = scanval (domain_parms[idx].g_y);
+      base_tables[idx].G.z = mpi_alloc_set_ui (1);
+      if (base_table_match (idx, E))
+        base_tables[idx].table
+          = _gcry_mpi_ec_base_table_new (&base_tables[idx].G, ec);
+      if (base_tables[idx].table)
+        return base_tables[idx].table;
+
+      /* Different parameters or out of core.  */
+      mpi_free (base_tables[idx].p);
+      mpi_free (base_tables[idx].a);
+      mpi_free (base_tables[idx].b);
+      point_free (&base_tables[idx].G);
+      base_tables[idx].p = base_tables[idx].a = base_tables[idx].b = NULL;
+    }
+
+  return NULL;
+}
+
+
+/* Compute RESULT = SCALAR * G where G is the base point of the curve
+   E.  For the curves we know about a cached table of multiples of G
+   is used; other curves use the generic scalar multiplication.  */
+void
+_gcry_ecc_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                    elliptic_curve_t *E, mpi_ec_t ec)
+{
+  mpi_ec_base_table_t table = NULL;
+
+  /* The x-only ladder used for Montgomery curves is not able to use
+     a table.  */
+  if (E->model != MPI_EC_MONTGOMERY
+      && E->G.z && !mpi_cmp_ui (E->G.z, 1)
+      && !ath_mutex_lock (&base_tables_lock))
+    {
+      table = get_base_table (E, ec);
+      ath_mutex_unlock (&base_tables_lock);
+    }
+
+  _gcry_mpi_ec_mul_base (result, scalar, &E->G, table, ec);
+}
+
+
 /* Generate the crypto system setup.  This function takes the NAME of
    a curve or the desired number of bits and stores at R_CURVE the
    parameters of the named curve or those of a suitable curve.  If
@@ -404,10 +533,9 @@ _gcry_ecc_fill_in_curve (unsigned int nbits, const char *name,
   switch (domain_parms[idx].model)
     {
     case MPI_EC_WEIERSTRASS:
+    case MPI_EC_MONTGOMERY:
     case MPI_EC_TWISTEDEDWARDS:
       break;
-    case MPI_EC_MONTGOMERY:
-      return GPG_ERR_NOT_SUPPORTED;
     default:
       return GPG_ERR_BUG;
     }
@@ -672,6 +800,8 @@ point_from_keyparam (gcry_mpi_point_t *r_a,
       point = mpi_point_new (0);
       if (ec && ec->dialect == ECC_DIALECT_ED25519)
         rc = _gcry_ecc_eddsa_decodepoint (a, ec, point, NULL, NULL);
+      else if (ec && ec->model == MPI_EC_MONTGOMERY && *name == 'q')
+        rc = _gcry_ecc_mont_decodepoint (a, ec, point);
       else
         rc = _gcry_ecc_os2ec (point, a);
       mpi_free (a);
@@ -1022,7 +1152,13 @@ _gcry_ecc_get_mpi (const char *name, mpi_ec_t ec, int copy)
   /* If the base point has been requested, return it in standard
      encoding.  */
   if (!strcmp (name, "g") && ec->G)
-    return _gcry_mpi_ec_ec2os (ec->G, ec);
+    {
+      /* The base point of a Montgomery curve is kept in affine
+         coordinates including Y, which the x-only encoding drops.  */
+      if (ec->model == MPI_EC_MONTGOMERY)
+        return _gcry_ecc_ec2os (ec->G->x, ec->G->y, ec->p);
+      return _gcry_mpi_ec_ec2os (ec->G, ec);
+    }
 
   /* If the public key has been requested, return it by default in
      standard uncompressed encoding or if requested in other
@@ -1112,6 +1248,8 @@ _gcry_ecc_set_mpi (const char *name, gcry_mpi_t newvalue, mpi_ec_t ec)
             ec->Q = mpi_point_new (0);
           if (ec->dialect == ECC_DIALECT_ED25519)
             rc = _gcry_ecc_eddsa_decodepoint (newvalue, ec, ec->Q, NULL, NULL);
+          else if (ec->model == MPI_EC_MONTGOMERY)
+            rc = _gcry_ecc_mont_decodepoint (newvalue, ec, ec->Q);
           else
             rc = _gcry_ecc_os2ec (ec->Q, newvalue);
         }
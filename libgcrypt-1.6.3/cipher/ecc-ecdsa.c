@@ -103,7 +103,7 @@ _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
           else
             k = _gcry_dsa_gen_k (skey->E.n, GCRY_STRONG_RANDOM);
 
-          _gcry_mpi_ec_mul_point (&I, k, &skey->E.G, ctx);
+          _gcry_ecc_mul_base (&I, k, &skey->E, ctx);
           if (_gcry_mpi_ec_get_affine (x, NULL, &I, ctx))
             {
               if (DBG_CIPHER)
@@ -145,15 +145,18 @@ _gcry_ecc_ecdsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
 
 
 /* Verify an ECDSA signature.
- * Check if R and S verifies INPUT.
+ * Check if R and S verifies INPUT.  If QTABLE is not NULL it is a
+ * table of multiples of the public key as created by
+ * _gcry_mpi_ec_base_table_new.
  */
 gpg_err_code_t
 _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
-                        gcry_mpi_t r, gcry_mpi_t s)
+                        gcry_mpi_t r, gcry_mpi_t s,
+                        mpi_ec_base_table_t qtable)
 {
   gpg_err_code_t err = 0;
   gcry_mpi_t hash, h, h1, h2, x;
-  mpi_point_struct Q, Q1, Q2;
+  mpi_point_struct Q;
   mpi_ec_t ctx;
   unsigned int nbits;
 
@@ -172,8 +175,6 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
   h2 = mpi_alloc (0);
   x = mpi_alloc (0);
   point_init (&Q);
-  point_init (&Q1);
-  point_init (&Q2);
 
   ctx = _gcry_mpi_ec_p_internal_new (pkey->E.model, pkey->E.dialect, 0,
                                      pkey->E.p, pkey->E.a, pkey->E.b);
@@ -182,14 +183,22 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
   mpi_invm (h, s, pkey->E.n);
   /* h1 = hash * s^(-1) (mod n) */
   mpi_mulm (h1, hash, h, pkey->E.n);
-  /* Q1 = [ hash * s^(-1) ]G  */
-  _gcry_mpi_ec_mul_point (&Q1, h1, &pkey->E.G, ctx);
   /* h2 = r * s^(-1) (mod n) */
   mpi_mulm (h2, r, h, pkey->E.n);
-  /* Q2 = [ r * s^(-1) ]Q */
-  _gcry_mpi_ec_mul_point (&Q2, h2, &pkey->Q, ctx);
   /* Q  = ([hash * s^(-1)]G) + ([r * s^(-1)]Q) */
-  _gcry_mpi_ec_add_points (&Q, &Q1, &Q2, ctx);
+  if (qtable)
+    {
+      /* With tables for G and Q no doublings are required.  */
+      mpi_point_struct Q2;
+
+      point_init (&Q2);
+      _gcry_ecc_mul_base (&Q, h1, &pkey->E, ctx);
+      _gcry_mpi_ec_mul_base (&Q2, h2, &pkey->Q, qtable, ctx);
+      _gcry_mpi_ec_add_points (&Q, &Q, &Q2, ctx);
+      point_free (&Q2);
+    }
+  else
+    _gcry_mpi_ec_mul_add_points (&Q, h1, &pkey->E.G, h2, &pkey->Q, ctx);
 
   if (!mpi_cmp_ui (Q.z, 0))
     {
@@ -220,8 +229,6 @@ _gcry_ecc_ecdsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
 
  leave:
   _gcry_mpi_ec_free (ctx);
-  point_free (&Q2);
-  point_free (&Q1);
   point_free (&Q);
   mpi_free (x);
   mpi_free (h2);
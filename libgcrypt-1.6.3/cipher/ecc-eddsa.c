@@ -512,7 +512,7 @@ _gcry_ecc_eddsa_genkey (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
   /* log_printmpi ("ecgen         a", a); */
 
   /* Compute Q.  */
-  _gcry_mpi_ec_mul_point (&Q, a, &E->G, ctx);
+  _gcry_ecc_mul_base (&Q, a, E, ctx);
   if (DBG_CIPHER)
     log_printpnt ("ecgen      pk", &Q, ctx);
 
@@ -584,7 +584,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   a = mpi_snew (0);
   x = mpi_new (0);
   y = mpi_new (0);
-  r = mpi_new (0);
+  r = mpi_snew (0);
   ctx = _gcry_mpi_ec_p_internal_new (skey->E.model, skey->E.dialect, 0,
                                      skey->E.p, skey->E.a, skey->E.b);
   b = (ctx->nbits+7)/8;
@@ -613,7 +613,7 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
     }
   else
     {
-      _gcry_mpi_ec_mul_point (&Q, a, &skey->E.G, ctx);
+      _gcry_ecc_mul_base (&Q, a, &skey->E, ctx);
       rc = _gcry_ecc_eddsa_encodepoint (&Q, ctx, x, y, 0, &encpk, &encpklen);
       if (rc)
         goto leave;
@@ -639,7 +639,10 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
   if (DBG_CIPHER)
     log_printhex ("     r", digest, 64);
   _gcry_mpi_set_buffer (r, digest, 64, 0);
-  _gcry_mpi_ec_mul_point (&I, r, &skey->E.G, ctx);
+  /* R is only used modulo n; reducing it allows the use of the base
+     point table.  */
+  mpi_mod (r, r, skey->E.n);
+  _gcry_ecc_mul_base (&I, r, &skey->E, ctx);
   if (DBG_CIPHER)
     log_printpnt ("   r", &I, ctx);
 
@@ -699,6 +702,92 @@ _gcry_ecc_eddsa_sign (gcry_mpi_t input, ECC_secret_key *skey,
 }
 
 
+/* Compute h = H(encodepoint(R) + encodepoint(pk) + m) mod N as used
+   by the verification equation.  */
+static gpg_err_code_t
+eddsa_hash_ram (gcry_mpi_t h, int hashalgo,
+                const void *rbuf, size_t rlen,
+                const void *encpk, size_t encpklen,
+                const void *mbuf, size_t mlen, gcry_mpi_t n)
+{
+  gpg_err_code_t rc;
+  unsigned char digest[64];
+  gcry_buffer_t hvec[3];
+
+  hvec[0].data = (char*)rbuf;
+  hvec[0].off  = 0;
+  hvec[0].len  = rlen;
+  hvec[1].data = (char*)encpk;
+  hvec[1].off  = 0;
+  hvec[1].len  = encpklen;
+  hvec[2].data = (char*)mbuf;
+  hvec[2].off  = 0;
+  hvec[2].len  = mlen;
+  rc = _gcry_md_hash_buffers (hashalgo, 0, digest, hvec, 3);
+  if (rc)
+    return rc;
+  reverse_buffer (digest, 64);
+  if (DBG_CIPHER)
+    log_printhex (" H(R+)", digest, 64);
+  _gcry_mpi_set_buffer (h, digest, 64, 0);
+  mpi_mod (h, h, n);
+  return 0;
+}
+
+
+/* Decode the EdDSA encoded point R_IN of B bytes into RESULT.  Only a
+   curve point given in its canonical encoding is accepted.  */
+static gpg_err_code_t
+eddsa_decode_r (gcry_mpi_t r_in, unsigned int b, mpi_point_t result,
+                mpi_ec_t ctx)
+{
+  gpg_err_code_t rc;
+  const void *rbuf;
+  unsigned int rlen;
+  unsigned char *tbuf = NULL;
+  unsigned int tlen;
+  gcry_mpi_t x, y;
+
+  rbuf = mpi_get_opaque (r_in, &rlen);
+  rlen = (rlen +7)/8;
+  if (rlen != b)
+    return GPG_ERR_INV_LENGTH;
+  if (_gcry_ecc_eddsa_decodepoint (r_in, ctx, result, NULL, NULL)
+      || !_gcry_mpi_ec_curve_point (result, ctx))
+    return GPG_ERR_BAD_SIGNATURE;
+
+  x = mpi_new (0);
+  y = mpi_new (0);
+  rc = _gcry_ecc_eddsa_encodepoint (result, ctx, x, y, 0, &tbuf, &tlen);
+  if (!rc && (tlen != rlen || memcmp (tbuf, rbuf, tlen)))
+    rc = GPG_ERR_BAD_SIGNATURE;
+  xfree (tbuf);
+  _gcry_mpi_release (y);
+  _gcry_mpi_release (x);
+  return rc;
+}
+
+
+/* Return true if [8]POINT is the neutral element; 8 is the cofactor
+   of Ed25519.  POINT is clobbered.  */
+static int
+eddsa_cofactor_neutral (mpi_point_t point, mpi_ec_t ctx)
+{
+  gcry_mpi_t x, y;
+  int i, okay;
+
+  for (i=0; i < 3; i++)
+    _gcry_mpi_ec_dup_point (point, point, ctx);
+  x = mpi_new (0);
+  y = mpi_new (0);
+  okay = (!_gcry_mpi_ec_get_affine (x, y, point, ctx)
+          && !mpi_cmp_ui (x, 0) && !mpi_cmp_ui (y, 1));
+  _gcry_mpi_release (y);
+  _gcry_mpi_release (x);
+  return okay;
+}
+
+
 /* Verify an EdDSA signature.  See sign_eddsa for the reference.
  * Check if R_IN and S_IN verifies INPUT.  PKEY has the curve
  * parameters and PK is the EdDSA style encoded public key.
@@ -716,13 +805,10 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
   unsigned char *encpk = NULL; /* Encoded public key.  */
   unsigned int encpklen;
   const void *mbuf, *rbuf;
-  unsigned char *tbuf = NULL;
   size_t mlen, rlen;
-  unsigned int tlen;
-  unsigned char digest[64];
-  gcry_buffer_t hvec[3];
   gcry_mpi_t h, s;
-  mpi_point_struct Ia, Ib;
+  mpi_point_struct R;
+  mpi_point_struct Ia;
 
   if (!mpi_is_opaque (input) || !mpi_is_opaque (r_in) || !mpi_is_opaque (s_in))
     return GPG_ERR_INV_DATA;
@@ -730,8 +816,8 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
     return GPG_ERR_DIGEST_ALGO;
 
   point_init (&Q);
+  point_init (&R);
   point_init (&Ia);
-  point_init (&Ib);
   h = mpi_new (0);
   s = mpi_new (0);
 
@@ -773,27 +859,14 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
       goto leave;
     }
 
-  /* h = H(encodepoint(R) + encodepoint(pk) + m)  */
-  hvec[0].data = (char*)rbuf;
-  hvec[0].off  = 0;
-  hvec[0].len  = rlen;
-  hvec[1].data = encpk;
-  hvec[1].off  = 0;
-  hvec[1].len  = encpklen;
-  hvec[2].data = (char*)mbuf;
-  hvec[2].off  = 0;
-  hvec[2].len  = mlen;
-  rc = _gcry_md_hash_buffers (hashalgo, 0, digest, hvec, 3);
+  rc = eddsa_hash_ram (h, hashalgo, rbuf, rlen, encpk, encpklen,
+                       mbuf, mlen, pkey->E.n);
   if (rc)
     goto leave;
-  reverse_buffer (digest, 64);
-  if (DBG_CIPHER)
-    log_printhex (" H(R+)", digest, 64);
-  _gcry_mpi_set_buffer (h, digest, 64, 0);
 
-  /* According to the paper the best way for verification is:
-         encodepoint(sG - h·Q) = encodepoint(r)
-     because we don't need to decode R. */
+  /* We check the cofactored equation [8](sG - h·Q - R) = 0 which
+     allows the same check for a batch of signatures; see
+     _gcry_ecc_eddsa_verify_batch.  This requires decoding R. */
   {
     void *sbuf;
     unsigned int slen;
@@ -812,14 +885,16 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
       }
   }
 
-  _gcry_mpi_ec_mul_point (&Ia, s, &pkey->E.G, ctx);
-  _gcry_mpi_ec_mul_point (&Ib, h, &Q, ctx);
-  _gcry_mpi_neg (Ib.x, Ib.x);
-  _gcry_mpi_ec_add_points (&Ia, &Ia, &Ib, ctx);
-  rc = _gcry_ecc_eddsa_encodepoint (&Ia, ctx, s, h, 0, &tbuf, &tlen);
+  rc = eddsa_decode_r (r_in, b, &R, ctx);
   if (rc)
     goto leave;
-  if (tlen != rlen || memcmp (tbuf, rbuf, tlen))
+
+  /* Ia = sG + h(-Q) computed with shared doublings.  */
+  _gcry_mpi_neg (Q.x, Q.x);
+  _gcry_mpi_ec_mul_add_points (&Ia, s, &pkey->E.G, h, &Q, ctx);
+  _gcry_mpi_neg (R.x, R.x);
+  _gcry_mpi_ec_add_points (&Ia, &Ia, &R, ctx);
+  if (!eddsa_cofactor_neutral (&Ia, ctx))
     {
       rc = GPG_ERR_BAD_SIGNATURE;
       goto leave;
@@ -829,12 +904,275 @@ _gcry_ecc_eddsa_verify (gcry_mpi_t input, ECC_public_key *pkey,
 
  leave:
   xfree (encpk);
-  xfree (tbuf);
   _gcry_mpi_ec_free (ctx);
   _gcry_mpi_release (s);
   _gcry_mpi_release (h);
   point_free (&Ia);
-  point_free (&Ib);
+  point_free (&R);
   point_free (&Q);
   return rc;
 }
+
+
+/* Maximum number of signatures combined into one multi-scalar
+   multiplication by _gcry_ecc_eddsa_verify_batch.  If the combined
+   check fails all signatures of the batch are verified again one by
+   one; thus much larger batches do not pay off.  */
+#define EDDSA_BATCH_MAX 128
+
+
+/* A public key used in a batch.  Signatures made with the same key
+   share its point and thus its decoding.  */
+struct eddsa_batch_key
+{
+  const void *raw;         /* The key as given or NULL.  */
+  unsigned int rawlen;
+  unsigned char *encpk;    /* The encoded key.  */
+  unsigned int encpklen;
+  gcry_mpi_t scalar;       /* Sum of z_i*h_i for this key.  */
+};
+
+/* The state of a batch.  POINTS[0] is the base point and SCALARS[0]
+   accumulates the sum of z_i*s_i.  */
+struct eddsa_batch
+{
+  mpi_ec_t ctx;
+  ECC_public_key *pkey;
+  unsigned int npoints;
+  mpi_point_struct points[2*EDDSA_BATCH_MAX+1];
+  gcry_mpi_t scalars[2*EDDSA_BATCH_MAX+1];
+  unsigned int nkeys;
+  struct eddsa_batch_key keys[EDDSA_BATCH_MAX];
+};
+
+
+/* Find or add the public key PK to BATCH.  Returns NULL on error.  */
+static struct eddsa_batch_key *
+eddsa_batch_key (struct eddsa_batch *batch, gcry_mpi_t pk)
+{
+  struct eddsa_batch_key *key;
+  mpi_point_t point;
+  const void *raw = NULL;
+  unsigned int i, rawlen = 0;
+
+  if (mpi_is_opaque (pk))
+    {
+      raw = mpi_get_opaque (pk, &rawlen);
+      for (i=0; raw && i < batch->nkeys; i++)
+        {
+          key = &batch->keys[i];
+          if (key->raw && key->rawlen == rawlen
+              && !memcmp (key->raw, raw, (rawlen + 7)/8))
+            return key;
+        }
+    }
+
+  key = &batch->keys[batch->nkeys];
+  point = &batch->points[batch->npoints];
+  if (_gcry_ecc_eddsa_decodepoint (pk, batch->ctx, point,
+                                   &key->encpk, &key->encpklen))
+    return NULL;
+  if (key->encpklen != batch->ctx->nbits/8
+      || !_gcry_mpi_ec_curve_point (point, batch->ctx))
+    {
+      xfree (key->encpk);
+      key->encpk = NULL;
+      return NULL;
+    }
+  key->raw = raw;
+  key->rawlen = rawlen;
+  key->scalar = batch->scalars[batch->npoints];
+  batch->nkeys++;
+  batch->npoints++;
+  return key;
+}
+
+
+/* Add one signature to BATCH.  On error the signature needs to be
+   checked with _gcry_ecc_eddsa_verify.  */
+static gpg_err_code_t
+eddsa_batch_add (struct eddsa_batch *batch, gcry_mpi_t input,
+                 gcry_mpi_t r_in, gcry_mpi_t s_in, int hashalgo,
+                 gcry_mpi_t pk)
+{
+  gpg_err_code_t rc;
+  gcry_mpi_t n = batch->pkey->E.n;
+  int b = batch->ctx->nbits/8;
+  struct eddsa_batch_key *key;
+  gcry_mpi_t z;
+  unsigned int tmp;
+  const void *mbuf, *rbuf;
+  size_t mlen, rlen;
+  void *sbuf;
+  unsigned int slen;
+  unsigned char zbuf[16];
+  gcry_mpi_t h, s;
+
+  if (!mpi_is_opaque (input) || !mpi_is_opaque (r_in) || !mpi_is_opaque (s_in))
+    return GPG_ERR_INV_DATA;
+  if (hashalgo != GCRY_MD_SHA512 || b != 256/8)
+    return GPG_ERR_NOT_SUPPORTED;
+
+  key = eddsa_batch_key (batch, pk);
+  if (!key)
+    return GPG_ERR_BROKEN_PUBKEY;
+
+  h = mpi_new (0);
+  s = mpi_new (0);
+
+  rbuf = mpi_get_opaque (r_in, &tmp);
+  rlen = (tmp +7)/8;
+  rc = eddsa_decode_r (r_in, b, &batch->points[batch->npoints], batch->ctx);
+  if (rc)
+    goto leave;
+
+  mbuf = mpi_get_opaque (input, &tmp);
+  mlen = (tmp +7)/8;
+  rc = eddsa_hash_ram (h, hashalgo, rbuf, rlen, key->encpk, key->encpklen,
+                       mbuf, mlen, n);
+  if (rc)
+    goto leave;
+
+  sbuf = _gcry_mpi_get_opaque_copy (s_in, &tmp);
+  slen = (tmp +7)/8;
+  reverse_buffer (sbuf, slen);
+  _gcry_mpi_set_buffer (s, sbuf, slen, 0);
+  xfree (sbuf);
+  if (slen != b)
+    {
+      rc = GPG_ERR_INV_LENGTH;
+      goto leave;
+    }
+
+  /* The random factor only needs to be unpredictable to the signer;
+     128 bits are sufficient.  */
+  z = batch->scalars[batch->npoints++];
+  _gcry_create_nonce (zbuf, sizeof zbuf);
+  _gcry_mpi_set_buffer (z, zbuf, sizeof zbuf, 0);
+  mpi_mulm (h, h, z, n);
+  mpi_addm (key->scalar, key->scalar, h, n);
+  mpi_mulm (s, s, z, n);
+  mpi_addm (batch->scalars[0], batch->scalars[0], s, n);
+
+ leave:
+  _gcry_mpi_release (s);
+  _gcry_mpi_release (h);
+  return rc;
+}
+
+
+/* Verify up to EDDSA_BATCH_MAX signatures with one combined check
+ *
+ *   [8](sum z_i*R_i + sum (z_i*h_i)*A_i - (sum z_i*s_i)*G) = 0
+ *
+ * with random z_i.  If that holds 0 is stored for all of them at
+ * R_RESULTS.  Otherwise, and for signatures which can't be
+ * decoded, the result of _gcry_ecc_eddsa_verify is stored.  */
+static void
+eddsa_verify_chunk (unsigned int n, gcry_mpi_t *inputs, ECC_public_key *pkey,
+                    gcry_mpi_t *r_ins, gcry_mpi_t *s_ins, int hashalgo,
+                    gcry_mpi_t *pks, gpg_err_code_t *r_results)
+{
+  struct eddsa_batch *batch;
+  unsigned char batched[EDDSA_BATCH_MAX];
+  mpi_point_struct sum;
+  unsigned int i, nsigs;
+  int okay = 0;
+
+  gcry_assert (n <= EDDSA_BATCH_MAX);
+
+  batch = xtrycalloc (1, sizeof *batch);
+  if (!batch)
+    {
+      for (i=0; i < n; i++)
+        r_results[i] = _gcry_ecc_eddsa_verify (inputs[i], pkey,
+                                               r_ins[i], s_ins[i],
+                                               hashalgo, pks[i]);
+      return;
+    }
+  batch->ctx = _gcry_mpi_ec_p_internal_new (pkey->E.model, pkey->E.dialect, 0,
+                                            pkey->E.p, pkey->E.a, pkey->E.b);
+  batch->pkey = pkey;
+  for (i=0; i < 2*n+1; i++)
+    {
+      point_init (&batch->points[i]);
+      batch->scalars[i] = mpi_new (0);
+    }
+  point_init (&sum);
+
+  point_set (&batch->points[0], &pkey->E.G);
+  batch->npoints = 1;
+  for (i=nsigs=0; i < n; i++)
+    {
+      batched[i] = !eddsa_batch_add (batch, inputs[i], r_ins[i], s_ins[i],
+                                     hashalgo, pks[i]);
+      if (batched[i])
+        nsigs++;
+    }
+
+  if (nsigs)
+    {
+      mpi_sub (batch->scalars[0], pkey->E.n, batch->scalars[0]);
+      _gcry_mpi_ec_mul_multi (&sum, batch->npoints, batch->scalars,
+                              batch->points, batch->ctx);
+      okay = eddsa_cofactor_neutral (&sum, batch->ctx);
+      if (DBG_CIPHER)
+        log_debug ("eddsa batch of %u: %s\n", nsigs, okay? "Good" : "Bad");
+    }
+
+  for (i=0; i < n; i++)
+    {
+      if (batched[i] && okay)
+        r_results[i] = 0;
+      else
+        r_results[i] = _gcry_ecc_eddsa_verify (inputs[i], pkey,
+                                               r_ins[i], s_ins[i],
+                                               hashalgo, pks[i]);
+    }
+
+  point_free (&sum);
+  for (i=0; i < batch->nkeys; i++)
+    xfree (batch->keys[i].encpk);
+  for (i=0; i < 2*n+1; i++)
+    {
+      point_free (&batch->points[i]);
+      _gcry_mpi_release (batch->scalars[i]);
+    }
+  _gcry_mpi_ec_free (batch->ctx);
+  xfree (batch);
+}
+
+
+/* Verify N EdDSA signatures at once.  The signature (R_INS[i],
+ * S_INS[i]) is checked against INPUTS[i] and the EdDSA style encoded
+ * public key PKS[i]; all keys use the curve described by PKEY.  The
+ * result for each signature is stored at R_RESULTS and the first
+ * error is returned.
+ *
+ * Signatures are combined into randomized batches which are checked
+ * with one multi-scalar multiplication.  The batch equation is the
+ * cofactored equation of _gcry_ecc_eddsa_verify; with random z_i a
+ * batch holds only if every signature in it holds.  A batch which
+ * does not hold is rechecked signature by signature.
+ */
+gpg_err_code_t
+_gcry_ecc_eddsa_verify_batch (unsigned int n, gcry_mpi_t *inputs,
+                              ECC_public_key *pkey,
+                              gcry_mpi_t *r_ins, gcry_mpi_t *s_ins,
+                              int hashalgo, gcry_mpi_t *pks,
+                              gpg_err_code_t *r_results)
+{
+  unsigned int i, count;
+
+  for (i=0; i < n; i += count)
+    {
+      count = n - i > EDDSA_BATCH_MAX? EDDSA_BATCH_MAX : n - i;
+      eddsa_verify_chunk (count, inputs + i, pkey, r_ins + i, s_ins + i,
+                          hashalgo, pks + i, r_results + i);
+    }
+
+  for (i=0; i < n; i++)
+    if (r_results[i])
+      return r_results[i];
+  return 0;
+}
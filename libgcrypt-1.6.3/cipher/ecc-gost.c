@@ -94,7 +94,7 @@ _gcry_ecc_gost_sign (gcry_mpi_t input, ECC_secret_key *skey,
           mpi_free (k);
           k = _gcry_dsa_gen_k (skey->E.n, GCRY_STRONG_RANDOM);
 
-          _gcry_mpi_ec_mul_point (&I, k, &skey->E.G, ctx);
+          _gcry_ecc_mul_base (&I, k, &skey->E, ctx);
           if (_gcry_mpi_ec_get_affine (x, NULL, &I, ctx))
             {
               if (DBG_CIPHER)
@@ -143,7 +143,7 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, ECC_public_key *pkey,
 {
   gpg_err_code_t err = 0;
   gcry_mpi_t e, x, z1, z2, v, rv, zero;
-  mpi_point_struct Q, Q1, Q2;
+  mpi_point_struct Q;
   mpi_ec_t ctx;
 
   if( !(mpi_cmp_ui (r, 0) > 0 && mpi_cmp (r, pkey->E.n) < 0) )
@@ -160,8 +160,6 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, ECC_public_key *pkey,
   zero = mpi_alloc (0);
 
   point_init (&Q);
-  point_init (&Q1);
-  point_init (&Q2);
 
   ctx = _gcry_mpi_ec_p_internal_new (pkey->E.model, pkey->E.dialect, 0,
                                      pkey->E.p, pkey->E.a, pkey->E.b);
@@ -174,15 +172,8 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, ECC_public_key *pkey,
   mpi_mulm (rv, r, v, pkey->E.n); /* rv = s*v (mod n) */
   mpi_subm (z2, zero, rv, pkey->E.n); /* z2 = -r*v (mod n) */
 
-  _gcry_mpi_ec_mul_point (&Q1, z1, &pkey->E.G, ctx);
-/*   log_mpidump ("Q1.x", Q1.x); */
-/*   log_mpidump ("Q1.y", Q1.y); */
-/*   log_mpidump ("Q1.z", Q1.z); */
-  _gcry_mpi_ec_mul_point (&Q2, z2, &pkey->Q, ctx);
-/*   log_mpidump ("Q2.x", Q2.x); */
-/*   log_mpidump ("Q2.y", Q2.y); */
-/*   log_mpidump ("Q2.z", Q2.z); */
-  _gcry_mpi_ec_add_points (&Q, &Q1, &Q2, ctx);
+  /* Q = [z1]G + [z2]Q */
+  _gcry_mpi_ec_mul_add_points (&Q, z1, &pkey->E.G, z2, &pkey->Q, ctx);
 /*   log_mpidump (" Q.x", Q.x); */
 /*   log_mpidump (" Q.y", Q.y); */
 /*   log_mpidump (" Q.z", Q.z); */
@@ -219,8 +210,6 @@ _gcry_ecc_gost_verify (gcry_mpi_t input, ECC_public_key *pkey,
 
  leave:
   _gcry_mpi_ec_free (ctx);
-  point_free (&Q2);
-  point_free (&Q1);
   point_free (&Q);
   mpi_free (zero);
   mpi_free (rv);
@@ -150,7 +150,14 @@ _gcry_mpi_ec_ec2os (gcry_mpi_point_t point, mpi_ec_t ectx)
 
   g_x = mpi_new (0);
   g_y = mpi_new (0);
-  if (_gcry_mpi_ec_get_affine (g_x, g_y, point, ectx))
+  if (ectx->model == MPI_EC_MONTGOMERY)
+    {
+      if (_gcry_mpi_ec_get_affine (g_x, NULL, point, ectx))
+        result = NULL;
+      else
+        result = _gcry_ecc_mont_encodepoint (g_x, ectx->nbits);
+    }
+  else if (_gcry_mpi_ec_get_affine (g_x, g_y, point, ectx))
     result = NULL;
   else
     result = _gcry_ecc_ec2os (g_x, g_y, ectx->p);
@@ -236,6 +243,107 @@ _gcry_ecc_os2ec (mpi_point_t result, gcry_mpi_t value)
 }
 
 
+
+/* Encode the x-coordinate X of a point on a Montgomery curve with a
+   field size of NBITS the way RFC 7748 does it: little endian and
+   prefixed by the octet 0x40 to make it unambiguous.  Returns a new
+   opaque MPI or NULL on memory failure.  */
+gcry_mpi_t
+_gcry_ecc_mont_encodepoint (gcry_mpi_t x, unsigned int nbits)
+{
+  unsigned char *rawmpi, *buf;
+  unsigned int rawmpilen;
+  size_t nbytes = (nbits + 7)/8;
+
+  /* Get X in little endian, padded to at least NBYTES.  */
+  rawmpi = _gcry_mpi_get_buffer (x, nbytes, &rawmpilen, NULL);
+  if (!rawmpi)
+    return NULL;
+
+  buf = xtrymalloc (nbytes + 1);
+  if (!buf)
+    {
+      xfree (rawmpi);
+      return NULL;
+    }
+  buf[0] = 0x40;
+  memcpy (buf + 1, rawmpi, nbytes);
+  xfree (rawmpi);
+
+  return mpi_set_opaque (NULL, buf, (nbytes + 1)*8);
+}
+
+
+/* Decode the x-only point PK for the Montgomery curve described by
+   CTX and store it in RESULT.  PK may be given with the 0x40 prefix
+   or, if it is an opaque MPI, as the plain little endian string.  As
+   required by RFC 7748 the unused most significant bits are
+   ignored.  Y is not known and set to zero.  */
+gpg_err_code_t
+_gcry_ecc_mont_decodepoint (gcry_mpi_t pk, mpi_ec_t ctx, mpi_point_t result)
+{
+  unsigned char *rawmpi;
+  unsigned int rawmpilen;
+  size_t nbytes = (ctx->nbits + 7)/8;
+  unsigned int i;
+  unsigned char tmp;
+
+  if (pk && mpi_is_opaque (pk))
+    {
+      const unsigned char *buf;
+      unsigned int nbits;
+
+      buf = mpi_get_opaque (pk, &nbits);
+      if (!buf)
+        return GPG_ERR_INV_OBJ;
+      rawmpilen = (nbits + 7)/8;
+      if (rawmpilen == nbytes + 1 && *buf == 0x40)
+        {
+          buf++;
+          rawmpilen--;
+        }
+      else if (rawmpilen != nbytes)
+        return GPG_ERR_INV_OBJ;
+
+      rawmpi = xtrymalloc (rawmpilen);
+      if (!rawmpi)
+        return gpg_err_code_from_syserror ();
+      memcpy (rawmpi, buf, rawmpilen);
+    }
+  else
+    {
+      /* A plain MPI has lost its leading zero octets and thus only
+         the prefixed format can be used.  */
+      rawmpi = _gcry_mpi_get_buffer (pk, 0, &rawmpilen, NULL);
+      if (!rawmpi)
+        return gpg_err_code_from_syserror ();
+      if (rawmpilen != nbytes + 1 || *rawmpi != 0x40)
+        {
+          xfree (rawmpi);
+          return GPG_ERR_INV_OBJ;
+        }
+      rawmpilen--;
+      memmove (rawmpi, rawmpi + 1, rawmpilen);
+    }
+
+  /* Convert to big endian and mask the unused bits.  */
+  for (i = 0; i < rawmpilen/2; i++)
+    {
+      tmp = rawmpi[i];
+      rawmpi[i] = rawmpi[rawmpilen - 1 - i];
+      rawmpi[rawmpilen - 1 - i] = tmp;
+    }
+  if ((ctx->nbits % 8))
+    rawmpi[0] &= (1 << (ctx->nbits % 8)) - 1;
+
+  _gcry_mpi_set_buffer (result->x, rawmpi, rawmpilen, 0);
+  xfree (rawmpi);
+  mpi_clear (result->y);
+  mpi_set_ui (result->z, 1);
+
+  return 0;
+}
+
 /* Compute the public key from the the context EC.  Obviously a
    requirement is that the secret key is available in EC.  On success
    Q is returned; on error NULL.  If Q is NULL a newly allocated point
@@ -56,6 +56,7 @@
 #include "g10lib.h"
 #include "mpi.h"
 #include "cipher.h"
+#include "ath.h"
 #include "context.h"
 #include "ec-context.h"
 #include "pubkey-internal.h"
@@ -81,6 +82,7 @@ static void *progress_cb_data;
 
 /* Local prototypes. */
 static void test_keys (ECC_secret_key * sk, unsigned int nbits);
+static void test_ecdh_only_keys (ECC_secret_key * sk, unsigned int nbits);
 static unsigned int ecc_get_nbits (gcry_sexp_t parms);
 
 
@@ -113,8 +115,9 @@ nist_generate_key (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
 
   point_init (&Q);
 
-  /* Generate a secret.  */
-  if (ctx->dialect == ECC_DIALECT_ED25519)
+  /* Generate a secret.  For Curve25519 this is the same clamping
+     as used by X25519.  */
+  if (ctx->dialect == ECC_DIALECT_ED25519 || E->model == MPI_EC_MONTGOMERY)
     {
       char *rndbuf;
 
@@ -131,7 +134,7 @@ nist_generate_key (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
 
 
   /* Compute Q.  */
-  _gcry_mpi_ec_mul_point (&Q, sk->d, &E->G, ctx);
+  _gcry_ecc_mul_base (&Q, sk->d, E, ctx);
 
   /* Copy the stuff to the key structures. */
   sk->E.model = E->model;
@@ -152,8 +155,9 @@ nist_generate_key (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
    * dropped because we know that it's a minimum of the two
    * possibilities without any loss of security.  Note that we don't
    * do that for Ed25519 so that we do not violate the special
-   * construction of the secret key.  */
-  if (E->dialect == ECC_DIALECT_ED25519)
+   * construction of the secret key.  Montgomery curves use only the
+   * x-coordinate and thus there is nothing to choose.  */
+  if (E->dialect == ECC_DIALECT_ED25519 || E->model == MPI_EC_MONTGOMERY)
     point_set (&sk->Q, &Q);
   else
     {
@@ -208,7 +212,10 @@ nist_generate_key (ECC_secret_key *sk, elliptic_curve_t *E, mpi_ec_t ctx,
 
   point_free (&Q);
   /* Now we can test our keys (this should never fail!).  */
-  test_keys (sk, nbits - 64);
+  if (E->model == MPI_EC_MONTGOMERY)
+    test_ecdh_only_keys (sk, nbits - 64);
+  else
+    test_keys (sk, nbits - 64);
 
   return 0;
 }
@@ -245,7 +252,7 @@ test_keys (ECC_secret_key *sk, unsigned int nbits)
   if (_gcry_ecc_ecdsa_sign (test, sk, r, s, 0, 0) )
     log_fatal ("ECDSA operation: sign failed\n");
 
-  if (_gcry_ecc_ecdsa_verify (test, &pk, r, s))
+  if (_gcry_ecc_ecdsa_verify (test, &pk, r, s, NULL))
     {
       log_fatal ("ECDSA operation: sign, verify failed\n");
     }
@@ -265,6 +272,57 @@ test_keys (ECC_secret_key *sk, unsigned int nbits)
 }
 
 
+/*
+ * Test a key on a curve which can only be used for ECDH: The shared
+ * point computed from a random K and Q must match the one computed
+ * from K*G and the secret D.
+ */
+static void
+test_ecdh_only_keys (ECC_secret_key *sk, unsigned int nbits)
+{
+  gcry_mpi_t test;
+  mpi_point_struct R_;
+  gcry_mpi_t x0, x1;
+  mpi_ec_t ec;
+
+  if (DBG_CIPHER)
+    log_debug ("Testing key.\n");
+
+  point_init (&R_);
+
+  ec = _gcry_mpi_ec_p_internal_new (sk->E.model, sk->E.dialect, 0,
+                                    sk->E.p, sk->E.a, sk->E.b);
+
+  test = mpi_new (nbits);
+  _gcry_mpi_randomize (test, nbits, GCRY_WEAK_RANDOM);
+
+  x0 = mpi_new (0);
+  x1 = mpi_new (0);
+
+  /* R_ = kQ  <=>  R_ = kdG  */
+  _gcry_mpi_ec_mul_point (&R_, test, &sk->Q, ec);
+  if (_gcry_mpi_ec_get_affine (x0, NULL, &R_, ec))
+    log_fatal ("ecdh: Failed to get affine coordinates for kQ\n");
+
+  _gcry_mpi_ec_mul_point (&R_, test, &sk->E.G, ec);
+  _gcry_mpi_ec_mul_point (&R_, sk->d, &R_, ec);
+  if (_gcry_mpi_ec_get_affine (x1, NULL, &R_, ec))
+    log_fatal ("ecdh: Failed to get affine coordinates for kdG\n");
+
+  if (mpi_cmp (x0, x1))
+    log_fatal ("ECDH test failed.\n");
+
+  if (DBG_CIPHER)
+    log_debug ("ECDH test ok.\n");
+
+  mpi_free (x0);
+  mpi_free (x1);
+  _gcry_mpi_ec_free (ec);
+  point_free (&R_);
+  mpi_free (test);
+}
+
+
 /*
  * To check the validity of the value, recalculate the correspondence
  * between the public value and the secret one.
@@ -277,6 +335,7 @@ check_secret_key (ECC_secret_key *sk, mpi_ec_t ec, int flags)
   gcry_mpi_t x1, y1;
   gcry_mpi_t x2 = NULL;
   gcry_mpi_t y2 = NULL;
+  int xonly = (ec->model == MPI_EC_MONTGOMERY);
 
   point_init (&Q);
   x1 = mpi_new (0);
@@ -325,7 +384,7 @@ check_secret_key (ECC_secret_key *sk, mpi_ec_t ec, int flags)
         log_debug ("Bad check: computation of dG failed\n");
       goto leave;
     }
-  if (_gcry_mpi_ec_get_affine (x1, y1, &Q, ec))
+  if (_gcry_mpi_ec_get_affine (x1, xonly? NULL : y1, &Q, ec))
     {
       if (DBG_CIPHER)
         log_debug ("Bad check: Q can not be a Point at Infinity!\n");
@@ -337,7 +396,7 @@ check_secret_key (ECC_secret_key *sk, mpi_ec_t ec, int flags)
   else if (!mpi_cmp_ui (sk->Q.z, 1))
     {
       /* Fast path if Q is already in affine coordinates.  */
-      if (mpi_cmp (x1, sk->Q.x) || mpi_cmp (y1, sk->Q.y))
+      if (mpi_cmp (x1, sk->Q.x) || (!xonly && mpi_cmp (y1, sk->Q.y)))
         {
           if (DBG_CIPHER)
             log_debug
@@ -349,14 +408,14 @@ check_secret_key (ECC_secret_key *sk, mpi_ec_t ec, int flags)
     {
       x2 = mpi_new (0);
       y2 = mpi_new (0);
-      if (_gcry_mpi_ec_get_affine (x2, y2, &sk->Q, ec))
+      if (_gcry_mpi_ec_get_affine (x2, xonly? NULL : y2, &sk->Q, ec))
         {
           if (DBG_CIPHER)
             log_debug ("Bad check: Q can not be a Point at Infinity!\n");
           goto leave;
         }
 
-      if (mpi_cmp (x1, x2) || mpi_cmp (y1, y2))
+      if (mpi_cmp (x1, x2) || (!xonly && mpi_cmp (y1, y2)))
         {
           if (DBG_CIPHER)
             log_debug
@@ -468,17 +527,26 @@ ecc_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   x = mpi_new (0);
   y = mpi_new (0);
 
-  if ((flags & PUBKEY_FLAG_EDDSA))
+  if ((flags & PUBKEY_FLAG_EDDSA) && E.model == MPI_EC_MONTGOMERY)
+    rc = GPG_ERR_INV_FLAG;  /* Montgomery curves are only for ECDH.  */
+  else if ((flags & PUBKEY_FLAG_EDDSA))
     rc = _gcry_ecc_eddsa_genkey (&sk, &E, ctx, random_level);
   else
     rc = nist_generate_key (&sk, &E, ctx, random_level, nbits);
   if (rc)
     goto leave;
 
-  /* Copy data to the result.  */
-  if (_gcry_mpi_ec_get_affine (x, y, &sk.E.G, ctx))
-    log_fatal ("ecgen: Failed to get affine coordinates for %s\n", "G");
-  base = _gcry_ecc_ec2os (x, y, sk.E.p);
+  /* Copy data to the result.  The base point of a Montgomery curve
+     is given in affine coordinates but the ladder can't recover Y,
+     thus we use it directly.  */
+  if (sk.E.model == MPI_EC_MONTGOMERY)
+    base = _gcry_ecc_ec2os (sk.E.G.x, sk.E.G.y, sk.E.p);
+  else
+    {
+      if (_gcry_mpi_ec_get_affine (x, y, &sk.E.G, ctx))
+        log_fatal ("ecgen: Failed to get affine coordinates for %s\n", "G");
+      base = _gcry_ecc_ec2os (x, y, sk.E.p);
+    }
   if (sk.E.dialect == ECC_DIALECT_ED25519 && !(flags & PUBKEY_FLAG_NOCOMP))
     {
       unsigned char *encpk;
@@ -493,6 +561,17 @@ ecc_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
       mpi_set_opaque (public, encpk, encpklen*8);
       encpk = NULL;
     }
+  else if (sk.E.model == MPI_EC_MONTGOMERY)
+    {
+      if (_gcry_mpi_ec_get_affine (x, NULL, &sk.Q, ctx))
+        log_fatal ("ecgen: Failed to get affine coordinates for %s\n", "Q");
+      public = _gcry_ecc_mont_encodepoint (x, ctx->nbits);
+      if (!public)
+        {
+          rc = gpg_err_code_from_syserror ();
+          goto leave;
+        }
+    }
   else
     {
       if (_gcry_mpi_ec_get_affine (x, y, &sk.Q, ctx))
@@ -678,6 +757,8 @@ ecc_check_secret_key (gcry_sexp_t keyparms)
       point_init (&sk.Q);
       if (ec->dialect == ECC_DIALECT_ED25519)
         rc = _gcry_ecc_eddsa_decodepoint (mpi_q, ec, &sk.Q, NULL, NULL);
+      else if (ec->model == MPI_EC_MONTGOMERY)
+        rc = _gcry_ecc_mont_decodepoint (mpi_q, ec, &sk.Q);
       else
         rc = _gcry_ecc_os2ec (&sk.Q, mpi_q);
       if (rc)
@@ -712,6 +793,49 @@ ecc_check_secret_key (gcry_sexp_t keyparms)
 }
 
 
+/* Sign DATA, which has been parsed using CTX, with the secret key SK
+   and store the signature at R_SIG.  MPI_Q is the public key as
+   given with the secret key or NULL.  */
+static gcry_err_code_t
+sign_with_key (gcry_sexp_t *r_sig, gcry_mpi_t data,
+               struct pk_encoding_ctx *ctx, ECC_secret_key *sk,
+               gcry_mpi_t mpi_q)
+{
+  gcry_err_code_t rc;
+  gcry_mpi_t sig_r, sig_s;
+
+  sig_r = mpi_new (0);
+  sig_s = mpi_new (0);
+  if ((ctx->flags & PUBKEY_FLAG_EDDSA))
+    {
+      /* EdDSA requires the public key.  */
+      rc = _gcry_ecc_eddsa_sign (data, sk, sig_r, sig_s, ctx->hash_algo, mpi_q);
+      if (!rc)
+        rc = sexp_build (r_sig, NULL,
+                         "(sig-val(eddsa(r%M)(s%M)))", sig_r, sig_s);
+    }
+  else if ((ctx->flags & PUBKEY_FLAG_GOST))
+    {
+      rc = _gcry_ecc_gost_sign (data, sk, sig_r, sig_s);
+      if (!rc)
+        rc = sexp_build (r_sig, NULL,
+                         "(sig-val(gost(r%M)(s%M)))", sig_r, sig_s);
+    }
+  else
+    {
+      rc = _gcry_ecc_ecdsa_sign (data, sk, sig_r, sig_s,
+                                 ctx->flags, ctx->hash_algo);
+      if (!rc)
+        rc = sexp_build (r_sig, NULL,
+                         "(sig-val(ecdsa(r%M)(s%M)))", sig_r, sig_s);
+    }
+
+  _gcry_mpi_release (sig_r);
+  _gcry_mpi_release (sig_s);
+  return rc;
+}
+
+
 static gcry_err_code_t
 ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 {
@@ -723,8 +847,6 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   gcry_mpi_t mpi_g = NULL;
   gcry_mpi_t mpi_q = NULL;
   ECC_secret_key sk;
-  gcry_mpi_t sig_r = NULL;
-  gcry_mpi_t sig_s = NULL;
 
   memset (&sk, 0, sizeof sk);
 
@@ -803,32 +925,7 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       goto leave;
     }
 
-
-  sig_r = mpi_new (0);
-  sig_s = mpi_new (0);
-  if ((ctx.flags & PUBKEY_FLAG_EDDSA))
-    {
-      /* EdDSA requires the public key.  */
-      rc = _gcry_ecc_eddsa_sign (data, &sk, sig_r, sig_s, ctx.hash_algo, mpi_q);
-      if (!rc)
-        rc = sexp_build (r_sig, NULL,
-                         "(sig-val(eddsa(r%M)(s%M)))", sig_r, sig_s);
-    }
-  else if ((ctx.flags & PUBKEY_FLAG_GOST))
-    {
-      rc = _gcry_ecc_gost_sign (data, &sk, sig_r, sig_s);
-      if (!rc)
-        rc = sexp_build (r_sig, NULL,
-                         "(sig-val(gost(r%M)(s%M)))", sig_r, sig_s);
-    }
-  else
-    {
-      rc = _gcry_ecc_ecdsa_sign (data, &sk, sig_r, sig_s,
-                                 ctx.flags, ctx.hash_algo);
-      if (!rc)
-        rc = sexp_build (r_sig, NULL,
-                         "(sig-val(ecdsa(r%M)(s%M)))", sig_r, sig_s);
-    }
+  rc = sign_with_key (r_sig, data, &ctx, &sk, mpi_q);
 
 
  leave:
@@ -841,8 +938,6 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   _gcry_mpi_release (mpi_q);
   point_free (&sk.Q);
   _gcry_mpi_release (sk.d);
-  _gcry_mpi_release (sig_r);
-  _gcry_mpi_release (sig_s);
   xfree (curvename);
   _gcry_mpi_release (data);
   sexp_release (l1);
@@ -853,52 +948,140 @@ ecc_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 }
 
 
+/* Decode the public key MPI_Q for the curve E into Q.  */
 static gcry_err_code_t
-ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+decode_q (elliptic_curve_t *E, mpi_point_t Q, gcry_mpi_t mpi_q)
 {
   gcry_err_code_t rc;
-  struct pk_encoding_ctx ctx;
-  gcry_sexp_t l1 = NULL;
-  char *curvename = NULL;
-  gcry_mpi_t mpi_g = NULL;
-  gcry_mpi_t mpi_q = NULL;
-  gcry_mpi_t sig_r = NULL;
-  gcry_mpi_t sig_s = NULL;
-  gcry_mpi_t data = NULL;
-  ECC_public_key pk;
-  int sigflags;
 
-  memset (&pk, 0, sizeof pk);
-  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
-                                   ecc_get_nbits (s_keyparms));
+  if (E->dialect == ECC_DIALECT_ED25519)
+    {
+      mpi_ec_t ec;
+
+      ec = _gcry_mpi_ec_p_internal_new (E->model, E->dialect, 0,
+                                        E->p, E->a, E->b);
+      rc = _gcry_ecc_eddsa_decodepoint (mpi_q, ec, Q, NULL, NULL);
+      _gcry_mpi_ec_free (ec);
+    }
+  else
+    rc = _gcry_ecc_os2ec (Q, mpi_q);
+
+  return rc;
+}
+
+
+/* Extract the data and the signature value for a verify operation.
+   CTX needs to be initialized by the caller.  */
+static gcry_err_code_t
+verify_parse (gcry_sexp_t s_sig, gcry_sexp_t s_data,
+              struct pk_encoding_ctx *ctx, gcry_mpi_t *r_data,
+              gcry_mpi_t *r_sig_r, gcry_mpi_t *r_sig_s, int *r_sigflags)
+{
+  gcry_err_code_t rc;
+  gcry_sexp_t l1 = NULL;
 
   /* Extract the data.  */
-  rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
+  rc = _gcry_pk_util_data_to_mpi (s_data, r_data, ctx);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
-    log_mpidump ("ecc_verify data", data);
+    log_mpidump ("ecc_verify data", *r_data);
 
   /*
    * Extract the signature value.
    */
-  rc = _gcry_pk_util_preparse_sigval (s_sig, ecc_names, &l1, &sigflags);
+  rc = _gcry_pk_util_preparse_sigval (s_sig, ecc_names, &l1, r_sigflags);
   if (rc)
     goto leave;
-  rc = sexp_extract_param (l1, NULL, (sigflags & PUBKEY_FLAG_EDDSA)? "/rs":"rs",
-                           &sig_r, &sig_s, NULL);
+  rc = sexp_extract_param (l1, NULL,
+                           (*r_sigflags & PUBKEY_FLAG_EDDSA)? "/rs":"rs",
+                           r_sig_r, r_sig_s, NULL);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("ecc_verify  s_r", sig_r);
-      log_mpidump ("ecc_verify  s_s", sig_s);
+      log_mpidump ("ecc_verify  s_r", *r_sig_r);
+      log_mpidump ("ecc_verify  s_s", *r_sig_s);
+    }
+  if ((ctx->flags & PUBKEY_FLAG_EDDSA) ^ (*r_sigflags & PUBKEY_FLAG_EDDSA))
+    rc = GPG_ERR_CONFLICT; /* Inconsistent use of flag/algoname.  */
+
+ leave:
+  sexp_release (l1);
+  return rc;
+}
+
+
+/* Check the signature SIG_R,SIG_S on DATA using the public key PK.
+   PK->Q needs to be set unless this is an EdDSA signature, for which
+   MPI_Q is used.  QTABLE is an optional table of multiples of PK->Q
+   used for ECDSA.  */
+static gcry_err_code_t
+verify_with_key (gcry_mpi_t data, struct pk_encoding_ctx *ctx, int sigflags,
+                 ECC_public_key *pk, gcry_mpi_t mpi_q,
+                 gcry_mpi_t sig_r, gcry_mpi_t sig_s,
+                 mpi_ec_base_table_t qtable)
+{
+  gcry_err_code_t rc;
+
+  if ((sigflags & PUBKEY_FLAG_EDDSA))
+    {
+      rc = _gcry_ecc_eddsa_verify (data, pk, sig_r, sig_s,
+                                   ctx->hash_algo, mpi_q);
+    }
+  else if ((sigflags & PUBKEY_FLAG_GOST))
+    {
+      rc = _gcry_ecc_gost_verify (data, pk, sig_r, sig_s);
     }
-  if ((ctx.flags & PUBKEY_FLAG_EDDSA) ^ (sigflags & PUBKEY_FLAG_EDDSA))
+  else if (mpi_is_opaque (data))
     {
-      rc = GPG_ERR_CONFLICT; /* Inconsistent use of flag/algoname.  */
-      goto leave;
+      const void *abuf;
+      unsigned int abits, qbits;
+      gcry_mpi_t a;
+
+      qbits = mpi_get_nbits (pk->E.n);
+
+      abuf = mpi_get_opaque (data, &abits);
+      rc = _gcry_mpi_scan (&a, GCRYMPI_FMT_USG, abuf, (abits+7)/8, NULL);
+      if (!rc)
+        {
+          if (abits > qbits)
+            mpi_rshift (a, a, abits - qbits);
+
+          rc = _gcry_ecc_ecdsa_verify (a, pk, sig_r, sig_s, qtable);
+          _gcry_mpi_release (a);
+        }
     }
+  else
+    rc = _gcry_ecc_ecdsa_verify (data, pk, sig_r, sig_s, qtable);
+
+  return rc;
+}
+
+
+static gcry_err_code_t
+ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
+{
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx ctx;
+  gcry_sexp_t l1 = NULL;
+  char *curvename = NULL;
+  gcry_mpi_t mpi_g = NULL;
+  gcry_mpi_t mpi_q = NULL;
+  gcry_mpi_t sig_r = NULL;
+  gcry_mpi_t sig_s = NULL;
+  gcry_mpi_t data = NULL;
+  ECC_public_key pk;
+  int sigflags;
+
+  memset (&pk, 0, sizeof pk);
+  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
+                                   ecc_get_nbits (s_keyparms));
+
+  /* Extract the data and the signature value.  */
+  rc = verify_parse (s_sig, s_data, &ctx, &data, &sig_r, &sig_s, &sigflags);
+  if (rc)
+    goto leave;
 
 
   /*
@@ -921,7 +1104,6 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
         goto leave;
     }
   /* Add missing parameters using the optional curve parameter.  */
-  sexp_release (l1);
   l1 = sexp_find_token (s_keyparms, "curve", 5);
   if (l1)
     {
@@ -970,64 +1152,14 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
   /*
    * Verify the signature.
    */
-  if ((sigflags & PUBKEY_FLAG_EDDSA))
-    {
-      rc = _gcry_ecc_eddsa_verify (data, &pk, sig_r, sig_s,
-                                   ctx.hash_algo, mpi_q);
-    }
-  else if ((sigflags & PUBKEY_FLAG_GOST))
+  if (!(sigflags & PUBKEY_FLAG_EDDSA))
     {
       point_init (&pk.Q);
-      rc = _gcry_ecc_os2ec (&pk.Q, mpi_q);
+      rc = decode_q (&pk.E, &pk.Q, mpi_q);
       if (rc)
         goto leave;
-
-      rc = _gcry_ecc_gost_verify (data, &pk, sig_r, sig_s);
-    }
-  else
-    {
-      point_init (&pk.Q);
-      if (pk.E.dialect == ECC_DIALECT_ED25519)
-        {
-          mpi_ec_t ec;
-
-          /* Fixme: Factor the curve context setup out of eddsa_verify
-             and ecdsa_verify. So that we don't do it twice.  */
-          ec = _gcry_mpi_ec_p_internal_new (pk.E.model, pk.E.dialect, 0,
-                                            pk.E.p, pk.E.a, pk.E.b);
-
-          rc = _gcry_ecc_eddsa_decodepoint (mpi_q, ec, &pk.Q, NULL, NULL);
-          _gcry_mpi_ec_free (ec);
-        }
-      else
-        {
-          rc = _gcry_ecc_os2ec (&pk.Q, mpi_q);
-        }
-      if (rc)
-        goto leave;
-
-      if (mpi_is_opaque (data))
-        {
-          const void *abuf;
-          unsigned int abits, qbits;
-          gcry_mpi_t a;
-
-          qbits = mpi_get_nbits (pk.E.n);
-
-          abuf = mpi_get_opaque (data, &abits);
-          rc = _gcry_mpi_scan (&a, GCRYMPI_FMT_USG, abuf, (abits+7)/8, NULL);
-          if (!rc)
-            {
-              if (abits > qbits)
-                mpi_rshift (a, a, abits - qbits);
-
-              rc = _gcry_ecc_ecdsa_verify (a, &pk, sig_r, sig_s);
-              _gcry_mpi_release (a);
-            }
-        }
-      else
-        rc = _gcry_ecc_ecdsa_verify (data, &pk, sig_r, sig_s);
     }
+  rc = verify_with_key (data, &ctx, sigflags, &pk, mpi_q, sig_r, sig_s, NULL);
 
  leave:
   _gcry_mpi_release (pk.E.p);
@@ -1050,6 +1182,162 @@ ecc_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t s_keyparms)
 }
 
 
+/* Extract the parts of an Ed25519 signature verification request
+   needed by _gcry_ecc_eddsa_verify_batch.  Any error indicates that
+   the request needs to be handled by ecc_verify.  */
+static gcry_err_code_t
+eddsa_batch_parse (gcry_sexp_t s_sig, gcry_sexp_t s_data,
+                   gcry_sexp_t s_keyparms, gcry_mpi_t *r_data,
+                   gcry_mpi_t *r_sig_r, gcry_mpi_t *r_sig_s,
+                   gcry_mpi_t *r_q)
+{
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx ctx;
+  gcry_sexp_t l1 = NULL;
+  char *curvename = NULL;
+  elliptic_curve_t E;
+  int sigflags;
+
+  memset (&E, 0, sizeof E);
+  *r_data = *r_sig_r = *r_sig_s = *r_q = NULL;
+  _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
+                                   ecc_get_nbits (s_keyparms));
+
+  rc = _gcry_pk_util_data_to_mpi (s_data, r_data, &ctx);
+  if (rc)
+    goto leave;
+  if (!(ctx.flags & PUBKEY_FLAG_EDDSA) || (ctx.flags & PUBKEY_FLAG_PARAM)
+      || ctx.hash_algo != GCRY_MD_SHA512)
+    {
+      rc = GPG_ERR_NOT_SUPPORTED;
+      goto leave;
+    }
+
+  rc = _gcry_pk_util_preparse_sigval (s_sig, ecc_names, &l1, &sigflags);
+  if (rc)
+    goto leave;
+  if (!(sigflags & PUBKEY_FLAG_EDDSA))
+    {
+      rc = GPG_ERR_NOT_SUPPORTED;
+      goto leave;
+    }
+  rc = sexp_extract_param (l1, NULL, "/rs", r_sig_r, r_sig_s, NULL);
+  if (rc)
+    goto leave;
+
+  rc = sexp_extract_param (s_keyparms, NULL, "/q", r_q, NULL);
+  if (rc)
+    goto leave;
+  sexp_release (l1);
+  l1 = sexp_find_token (s_keyparms, "curve", 5);
+  if (l1)
+    curvename = sexp_nth_string (l1, 1);
+  if (!curvename)
+    {
+      rc = GPG_ERR_NOT_SUPPORTED;
+      goto leave;
+    }
+  rc = _gcry_ecc_fill_in_curve (0, curvename, &E, NULL);
+  if (rc)
+    goto leave;
+  if (E.model != MPI_EC_TWISTEDEDWARDS || E.dialect != ECC_DIALECT_ED25519)
+    rc = GPG_ERR_NOT_SUPPORTED;
+
+ leave:
+  if (rc)
+    {
+      _gcry_mpi_release (*r_data);
+      _gcry_mpi_release (*r_sig_r);
+      _gcry_mpi_release (*r_sig_s);
+      _gcry_mpi_release (*r_q);
+      *r_data = *r_sig_r = *r_sig_s = *r_q = NULL;
+    }
+  _gcry_mpi_release (E.p);
+  _gcry_mpi_release (E.a);
+  _gcry_mpi_release (E.b);
+  point_free (&E.G);
+  _gcry_mpi_release (E.n);
+  xfree (curvename);
+  sexp_release (l1);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  return rc;
+}
+
+
+/* Verify the N signatures S_SIGS[i] over S_DATA[i] with the keys
+   S_KEYPARMS[i].  Ed25519 signatures are checked together using
+   _gcry_ecc_eddsa_verify_batch; all others are passed to ecc_verify.
+   The result for each signature is stored at R_RESULTS.  */
+static gcry_err_code_t
+ecc_verify_batch (gcry_sexp_t *s_sigs, gcry_sexp_t *s_data,
+                  gcry_sexp_t *s_keyparms, unsigned int n,
+                  gcry_err_code_t *r_results)
+{
+  gcry_err_code_t rc = 0;
+  gcry_mpi_t *data, *sig_r, *sig_s, *q;
+  gpg_err_code_t *results = NULL;
+  unsigned int *idx = NULL;
+  unsigned int i, m;
+  ECC_public_key pk;
+
+  memset (&pk, 0, sizeof pk);
+  data = xtrycalloc (4*n, sizeof *data);
+  idx = xtrycalloc (n, sizeof *idx);
+  results = xtrycalloc (n, sizeof *results);
+  if (!data || !idx || !results)
+    {
+      rc = gpg_err_code_from_syserror ();
+      xfree (results);
+      xfree (idx);
+      xfree (data);
+      return rc;
+    }
+  sig_r = data + n;
+  sig_s = data + 2*n;
+  q = data + 3*n;
+
+  for (i=m=0; i < n; i++)
+    {
+      if (!eddsa_batch_parse (s_sigs[i], s_data[i], s_keyparms[i],
+                              &data[m], &sig_r[m], &sig_s[m], &q[m]))
+        idx[m++] = i;
+      else
+        r_results[i] = ecc_verify (s_sigs[i], s_data[i], s_keyparms[i]);
+    }
+
+  if (m)
+    {
+      rc = _gcry_ecc_fill_in_curve (0, "Ed25519", &pk.E, NULL);
+      if (!rc)
+        _gcry_ecc_eddsa_verify_batch (m, data, &pk, sig_r, sig_s,
+                                      GCRY_MD_SHA512, q, results);
+      for (i=0; i < m; i++)
+        r_results[idx[i]] = rc? rc : results[i];
+    }
+
+  for (i=0; i < m; i++)
+    {
+      _gcry_mpi_release (data[i]);
+      _gcry_mpi_release (sig_r[i]);
+      _gcry_mpi_release (sig_s[i]);
+      _gcry_mpi_release (q[i]);
+    }
+  _gcry_mpi_release (pk.E.p);
+  _gcry_mpi_release (pk.E.a);
+  _gcry_mpi_release (pk.E.b);
+  point_free (&pk.E.G);
+  _gcry_mpi_release (pk.E.n);
+  xfree (results);
+  xfree (idx);
+  xfree (data);
+
+  for (i=0; i < n; i++)
+    if (r_results[i])
+      return r_results[i];
+  return 0;
+}
+
+
 /* ecdh raw is classic 2-round DH protocol published in 1976.
  *
  * Overview of ecc_encrypt_raw and ecc_decrypt_raw.
@@ -1115,7 +1403,7 @@ ecc_encrypt_raw (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   /*
    * Extract the key.
    */
-  rc = sexp_extract_param (keyparms, NULL, "-p?a?b?g?n?+q",
+  rc = sexp_extract_param (keyparms, NULL, "-p?a?b?g?n?/q",
                            &pk.E.p, &pk.E.a, &pk.E.b, &mpi_g, &pk.E.n,
                            &mpi_q, NULL);
   if (rc)
@@ -1167,45 +1455,42 @@ ecc_encrypt_raw (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       goto leave;
     }
 
+  ec = _gcry_mpi_ec_p_internal_new (pk.E.model, pk.E.dialect, 0,
+                                    pk.E.p, pk.E.a, pk.E.b);
+
   /* Convert the public key.  */
   if (mpi_q)
     {
       point_init (&pk.Q);
-      rc = _gcry_ecc_os2ec (&pk.Q, mpi_q);
+      if (ec->model == MPI_EC_MONTGOMERY)
+        rc = _gcry_ecc_mont_decodepoint (mpi_q, ec, &pk.Q);
+      else
+        rc = _gcry_ecc_os2ec (&pk.Q, mpi_q);
       if (rc)
         goto leave;
     }
 
   /* Compute the encrypted value.  */
-  ec = _gcry_mpi_ec_p_internal_new (pk.E.model, pk.E.dialect, 0,
-                                    pk.E.p, pk.E.a, pk.E.b);
 
   /* The following is false: assert( mpi_cmp_ui( R.x, 1 )==0 );, so */
   {
     mpi_point_struct R;  /* Result that we return.  */
-    gcry_mpi_t x, y;
-
-    x = mpi_new (0);
-    y = mpi_new (0);
 
     point_init (&R);
 
     /* R = kQ  <=>  R = kdG  */
     _gcry_mpi_ec_mul_point (&R, data, &pk.Q, ec);
 
-    if (_gcry_mpi_ec_get_affine (x, y, &R, ec))
+    mpi_s = _gcry_mpi_ec_ec2os (&R, ec);
+    if (!mpi_s)
       log_fatal ("ecdh: Failed to get affine coordinates for kdG\n");
-    mpi_s = _gcry_ecc_ec2os (x, y, pk.E.p);
 
     /* R = kG */
-    _gcry_mpi_ec_mul_point (&R, data, &pk.E.G, ec);
+    _gcry_ecc_mul_base (&R, data, &pk.E, ec);
 
-    if (_gcry_mpi_ec_get_affine (x, y, &R, ec))
+    mpi_e = _gcry_mpi_ec_ec2os (&R, ec);
+    if (!mpi_e)
       log_fatal ("ecdh: Failed to get affine coordinates for kG\n");
-    mpi_e = _gcry_ecc_ec2os (x, y, pk.E.p);
-
-    mpi_free (x);
-    mpi_free (y);
 
     point_free (&R);
   }
@@ -1338,37 +1623,58 @@ ecc_decrypt_raw (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   /*
    * Compute the plaintext.
    */
-  rc = _gcry_ecc_os2ec (&kG, data_e);
-  if (rc)
-    {
-      point_free (&kG);
-      return rc;
-    }
-
   ec = _gcry_mpi_ec_p_internal_new (sk.E.model, sk.E.dialect, 0,
                                     sk.E.p, sk.E.a, sk.E.b);
 
+  if (ec->model == MPI_EC_MONTGOMERY)
+    rc = _gcry_ecc_mont_decodepoint (data_e, ec, &kG);
+  else
+    rc = _gcry_ecc_os2ec (&kG, data_e);
+  if (rc)
+    goto leave;
+
   /* R = dkG */
   _gcry_mpi_ec_mul_point (&R, sk.d, &kG, ec);
 
   /* The following is false: assert( mpi_cmp_ui( R.x, 1 )==0 );, so:  */
-  {
-    gcry_mpi_t x, y;
+  if (ec->model == MPI_EC_MONTGOMERY)
+    {
+      gcry_mpi_t x = mpi_new (0);
 
-    x = mpi_new (0);
-    y = mpi_new (0);
+      /* A point of small order as ephemeral key leads to the point
+         at infinity or to an all-zero shared secret.  Reject it.  */
+      if (_gcry_mpi_ec_get_affine (x, NULL, &R, ec) || !mpi_cmp_ui (x, 0))
+        {
+          mpi_free (x);
+          rc = GPG_ERR_INV_DATA;
+          goto leave;
+        }
 
-    if (_gcry_mpi_ec_get_affine (x, y, &R, ec))
-      log_fatal ("ecdh: Failed to get affine coordinates\n");
+      r = _gcry_ecc_mont_encodepoint (x, ec->nbits);
+      if (!r)
+        rc = gpg_err_code_from_syserror ();
+      else
+        rc = 0;
+      mpi_free (x);
+    }
+  else
+    {
+      gcry_mpi_t x, y;
 
-    r = _gcry_ecc_ec2os (x, y, sk.E.p);
-    if (!r)
-      rc = gpg_err_code_from_syserror ();
-    else
-      rc = 0;
-    mpi_free (x);
-    mpi_free (y);
-  }
+      x = mpi_new (0);
+      y = mpi_new (0);
+
+      if (_gcry_mpi_ec_get_affine (x, y, &R, ec))
+        log_fatal ("ecdh: Failed to get affine coordinates\n");
+
+      r = _gcry_ecc_ec2os (x, y, sk.E.p);
+      if (!r)
+        rc = gpg_err_code_from_syserror ();
+      else
+        rc = 0;
+      mpi_free (x);
+      mpi_free (y);
+    }
   if (DBG_CIPHER)
     log_printmpi ("ecc_decrypt  res", r);
 
@@ -1397,6 +1703,199 @@ ecc_decrypt_raw (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 }
 
 
+/* The number of ECDSA verifications done through a key handle after
+   which a table of multiples of the public key is created.  Building
+   the table costs about as much as five verifications; thus it is
+   not done for handles used only a few times.  */
+#ifndef ECC_QTABLE_MIN_VERIFY
+# define ECC_QTABLE_MIN_VERIFY 8
+#endif
+
+/* The context of an ECC key handle.  */
+typedef struct
+{
+  gcry_sexp_t keyparms;  /* The parameter list of the key.  */
+  unsigned int nbits;    /* The size of the key as by ecc_get_nbits.  */
+  ECC_secret_key sk;     /* The curve, the decoded Q and the optional D.  */
+  gcry_mpi_t mpi_q;      /* Q as given by the key or NULL.  */
+  ath_mutex_t lock;      /* Protects QTABLE and NVERIFY.  */
+  mpi_ec_base_table_t qtable;  /* Multiples of Q or NULL.  */
+  unsigned int nverify;  /* Number of ECDSA verifications so far.  */
+} ecc_hd_ctx_t;
+
+
+static void
+ecc_close (void *ctx)
+{
+  ecc_hd_ctx_t *c = ctx;
+
+  if (!c)
+    return;
+
+  ath_mutex_destroy (&c->lock);
+  _gcry_mpi_ec_base_table_free (c->qtable);
+  _gcry_ecc_curve_free (&c->sk.E);
+  point_free (&c->sk.Q);
+  _gcry_mpi_release (c->sk.d);
+  _gcry_mpi_release (c->mpi_q);
+  xfree (c);
+}
+
+
+/* Prepare a key given by a curve name for use with a key handle:
+   The curve parameters are looked up and Q is decoded once.  Keys
+   using explicit parameters or a public key which can't be decoded
+   are not prepared; the handle then uses the standard functions,
+   which also take care of reporting errors in the key.  */
+static gcry_err_code_t
+ecc_open (gcry_sexp_t keyparms, int secret, void **r_ctx)
+{
+  gcry_err_code_t rc;
+  ecc_hd_ctx_t *c;
+  gcry_sexp_t l1;
+  char *curvename;
+
+  *r_ctx = NULL;
+
+  l1 = sexp_find_token (keyparms, "curve", 5);
+  if (!l1)
+    return 0;
+  curvename = sexp_nth_string (l1, 1);
+  sexp_release (l1);
+  if (!curvename)
+    return 0;
+
+  c = xtrycalloc_secure (1, sizeof *c);
+  if (!c)
+    {
+      rc = gpg_err_code_from_syserror ();
+      xfree (curvename);
+      return rc;
+    }
+  c->keyparms = keyparms;
+  c->nbits = ecc_get_nbits (keyparms);
+  point_init (&c->sk.Q);
+  rc = ath_mutex_init (&c->lock);
+  if (rc)
+    {
+      rc = gpg_err_code_from_errno (rc);
+      ecc_close (c);
+      xfree (curvename);
+      return rc;
+    }
+
+  if (secret)
+    rc = sexp_extract_param (keyparms, NULL, "/q?+d",
+                             &c->mpi_q, &c->sk.d, NULL);
+  else
+    rc = sexp_extract_param (keyparms, NULL, "/q", &c->mpi_q, NULL);
+  if (!rc)
+    rc = _gcry_ecc_fill_in_curve (0, curvename, &c->sk.E, NULL);
+  if (!rc && c->sk.E.model == MPI_EC_MONTGOMERY)
+    rc = GPG_ERR_NOT_SUPPORTED;
+  if (!rc && c->mpi_q)
+    rc = decode_q (&c->sk.E, &c->sk.Q, c->mpi_q);
+  xfree (curvename);
+
+  if (rc)
+    ecc_close (c);
+  else
+    *r_ctx = c;
+  return 0;
+}
+
+
+static gcry_err_code_t
+ecc_hd_sign (void *ctx, gcry_sexp_t *r_sig, gcry_sexp_t s_data)
+{
+  ecc_hd_ctx_t *c = ctx;
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx enc;
+  gcry_mpi_t data = NULL;
+
+  _gcry_pk_util_init_encoding_ctx (&enc, PUBKEY_OP_SIGN, 0);
+
+  rc = _gcry_pk_util_data_to_mpi (s_data, &data, &enc);
+  if (rc)
+    goto leave;
+  if (DBG_CIPHER)
+    log_mpidump ("ecc_sign   data", data);
+
+  /* Explicit parameters in the key take precedence over the curve,
+     thus we need to parse the key again.  */
+  if ((enc.flags & PUBKEY_FLAG_PARAM))
+    rc = ecc_sign (r_sig, s_data, c->keyparms);
+  else
+    rc = sign_with_key (r_sig, data, &enc, &c->sk, c->mpi_q);
+
+ leave:
+  _gcry_mpi_release (data);
+  _gcry_pk_util_free_encoding_ctx (&enc);
+  if (DBG_CIPHER)
+    log_debug ("ecc_sign      => %s\n", gpg_strerror (rc));
+  return rc;
+}
+
+
+static gcry_err_code_t
+ecc_hd_verify (void *ctx, gcry_sexp_t s_sig, gcry_sexp_t s_data)
+{
+  ecc_hd_ctx_t *c = ctx;
+  gcry_err_code_t rc;
+  struct pk_encoding_ctx enc;
+  gcry_mpi_t sig_r = NULL;
+  gcry_mpi_t sig_s = NULL;
+  gcry_mpi_t data = NULL;
+  ECC_public_key pk;
+  mpi_ec_base_table_t qtable = NULL;
+  int sigflags;
+
+  _gcry_pk_util_init_encoding_ctx (&enc, PUBKEY_OP_VERIFY, c->nbits);
+
+  rc = verify_parse (s_sig, s_data, &enc, &data, &sig_r, &sig_s, &sigflags);
+  if (rc)
+    goto leave;
+
+  if ((enc.flags & PUBKEY_FLAG_PARAM))
+    rc = ecc_verify (s_sig, s_data, c->keyparms);
+  else
+    {
+      /* The handle may be used by several threads; the table is
+         created only once and not changed afterwards.  */
+      if (!(sigflags & (PUBKEY_FLAG_EDDSA | PUBKEY_FLAG_GOST))
+          && !ath_mutex_lock (&c->lock))
+        {
+          if (!c->qtable && ++c->nverify == ECC_QTABLE_MIN_VERIFY)
+            {
+              mpi_ec_t ec;
+
+              ec = _gcry_mpi_ec_p_internal_new (c->sk.E.model,
+                                                c->sk.E.dialect, 0,
+                                                c->sk.E.p, c->sk.E.a,
+                                                c->sk.E.b);
+              c->qtable = _gcry_mpi_ec_base_table_new (&c->sk.Q, ec);
+              _gcry_mpi_ec_free (ec);
+            }
+          qtable = c->qtable;
+          ath_mutex_unlock (&c->lock);
+        }
+      pk.E = c->sk.E;
+      pk.Q = c->sk.Q;
+      rc = verify_with_key (data, &enc, sigflags, &pk, c->mpi_q, sig_r, sig_s,
+                            qtable);
+    }
+
+ leave:
+  _gcry_mpi_release (data);
+  _gcry_mpi_release (sig_r);
+  _gcry_mpi_release (sig_s);
+  _gcry_pk_util_free_encoding_ctx (&enc);
+  if (DBG_CIPHER)
+    log_debug ("ecc_verify    => %s\n", rc?gpg_strerror (rc):"Good");
+  return rc;
+}
+
+
 /* Return the number of bits for the key described by PARMS.  On error
  * 0 is returned.  The format of PARMS starts with the algorithm name;
  * for example:
@@ -1635,7 +2134,10 @@ _gcry_pk_ecc_get_sexp (gcry_sexp_t *r_sexp, int mode, mpi_ec_t ec)
     ec->Q = _gcry_ecc_compute_public (NULL, ec, NULL, NULL);
 
   /* Encode G and Q.  */
-  mpi_G = _gcry_mpi_ec_ec2os (ec->G, ec);
+  if (ec->model == MPI_EC_MONTGOMERY)
+    mpi_G = _gcry_ecc_ec2os (ec->G->x, ec->G->y, ec->p);
+  else
+    mpi_G = _gcry_mpi_ec_ec2os (ec->G, ec);
   if (!mpi_G)
     {
       rc = GPG_ERR_BROKEN_PUBKEY;
@@ -1755,5 +2257,12 @@ gcry_pk_spec_t _gcry_pubkey_spec_ecc =
     run_selftests,
     compute_keygrip,
     _gcry_ecc_get_curve,
-    _gcry_ecc_get_param_sexp
+    _gcry_ecc_get_param_sexp,
+    ecc_verify_batch,
+    ecc_open,
+    ecc_close,
+    NULL,
+    NULL,
+    ecc_hd_sign,
+    ecc_hd_verify
   };
@@ -41,7 +41,7 @@ typedef struct {
 } GOSTR3411_CONTEXT;
 
 static unsigned int
-transform (void *c, const unsigned char *data);
+transform (void *c, const unsigned char *data, size_t nblks);
 
 static void
 gost3411_init (void *context, unsigned int flags)
@@ -213,7 +213,7 @@ do_hash_step (GOST28147_context *hd, unsigned char *h, unsigned char *m)
 
 
 static unsigned int
-transform (void *ctx, const unsigned char *data)
+transform_blk (void *ctx, const unsigned char *data)
 {
   GOSTR3411_CONTEXT *hd = ctx;
   byte m[32];
@@ -226,6 +226,22 @@ transform (void *ctx, const unsigned char *data)
   return /* burn_stack */ burn + 3 * sizeof(void*) + 32 + 2 * sizeof(void*);
 }
 
+
+static unsigned int
+transform (void *c, const unsigned char *data, size_t nblks)
+{
+  unsigned int burn;
+
+  do
+    {
+      burn = transform_blk (c, data);
+      data += 32;
+    }
+  while (--nblks);
+
+  return burn;
+}
+
 /*
    The routine finally terminates the computation and returns the
    digest.  The handle is prepared for a new cycle, but adding bytes
@@ -26,6 +26,7 @@
 #endif
 
 #include "g10lib.h"
+#include "bufhelp.h"
 #include "hash-common.h"
 
 
@@ -39,6 +40,8 @@
      0 - Hash the supplied DATA of DATALEN.
      1 - Hash one million times a 'a'.  DATA and DATALEN are ignored.
 
+   For an extendable-output function the first EXPECTLEN bytes of the
+   output are compared.
 */
 const char *
 _gcry_hash_selftest_check_one (int algo,
@@ -49,8 +52,11 @@ _gcry_hash_selftest_check_one (int algo,
   gcry_error_t err = 0;
   gcry_md_hd_t hd;
   unsigned char *digest;
+  unsigned char xofbuf[64];
+  unsigned int dlen;
 
-  if (_gcry_md_get_algo_dlen (algo) != expectlen)
+  dlen = _gcry_md_get_algo_dlen (algo);
+  if (dlen ? dlen != expectlen : expectlen > sizeof xofbuf)
     return "digest size does not match expected size";
 
   err = _gcry_md_open (&hd, algo, 0);
@@ -81,9 +87,16 @@ _gcry_hash_selftest_check_one (int algo,
 
   if (!result)
     {
-      digest = _gcry_md_read (hd, algo);
+      if (dlen)
+        digest = _gcry_md_read (hd, algo);
+      else if (_gcry_md_extract (hd, algo, xofbuf, expectlen))
+        digest = NULL;
+      else
+        digest = xofbuf;
 
-      if ( memcmp (digest, expect, expectlen) )
+      if (!digest)
+        result = "gcry_md_extract failed";
+      else if ( memcmp (digest, expect, expectlen) )
         result = "digest mismatch";
     }
 
@@ -111,7 +124,7 @@ _gcry_md_block_write (void *context, const void *inbuf_arg, size_t inlen)
 
   if (hd->count == hd->blocksize)  /* Flush the buffer. */
     {
-      stack_burn = hd->bwrite (hd, hd->buf);
+      stack_burn = hd->bwrite (hd, hd->buf, 1);
       _gcry_burn_stack (stack_burn);
       stack_burn = 0;
       hd->count = 0;
@@ -132,14 +145,145 @@ _gcry_md_block_write (void *context, const void *inbuf_arg, size_t inlen)
 
   while (inlen >= hd->blocksize)
     {
-      stack_burn = hd->bwrite (hd, inbuf);
+      size_t nblks = inlen / hd->blocksize;
+      MD_NBLOCKS_TYPE old_nblocks = hd->nblocks;
+
+      /* The full blocks are passed at once so that the transform can
+         keep its state in registers across them.  Their number is
+         limited so that the block counter wraps at most once.  */
+      if (nblks > 0x40000000)
+        nblks = 0x40000000;
+      stack_burn = hd->bwrite (hd, inbuf, nblks);
       hd->count = 0;
-      if (!++hd->nblocks)
+      hd->nblocks += nblks;
+      if (hd->nblocks < old_nblocks)
         hd->nblocks_high++;
-      inlen -= hd->blocksize;
-      inbuf += hd->blocksize;
+      inlen -= nblks * hd->blocksize;
+      inbuf += nblks * hd->blocksize;
     }
   _gcry_burn_stack (stack_burn);
   for (; inlen && hd->count < hd->blocksize; inlen--)
     hd->buf[hd->count++] = *inbuf++;
 }
+
+
+/* Hash the IOVCNT independent messages described by IOV using a
+   multi-buffer TRANSFORM with NLANES lanes and store the DIGESTLEN
+   byte digest of message I at DIGESTS + I * DIGESTLEN.  This is for
+   the MD4 style hash functions with 64 byte blocks and big endian
+   words and bit counter, i.e. SHA-1 and SHA-256.  IV has the NWORDS
+   initial chaining values.  A lane which finished its message is
+   refilled with the next one so that messages of different lengths
+   keep all lanes busy.
+
+   If PERIOD is not 0 a message may be longer than its buffer, which
+   has IOV[I].SIZE bytes: past the end of the buffer the message
+   repeats itself with the given PERIOD.  The last PERIOD + 64 bytes
+   of the buffer must already be periodic.  This allows to hash long
+   messages built from a repeated pattern without expanding them.  */
+void
+_gcry_md_block_hash_multi (void *digests, size_t digestlen,
+                           const gcry_buffer_t *iov, int iovcnt,
+                           size_t period, const u32 *iv, unsigned int nwords,
+                           unsigned int nlanes,
+                           _gcry_md_multi_transform_t transform)
+{
+  static const unsigned char zero_block[64];
+  struct
+  {
+    int idx;                    /* Index of the message or -1.  */
+    const unsigned char *data;  /* The buffer of the message.  */
+    size_t pos;                 /* Offset of the next full block.  */
+    size_t size;                /* Size of the buffer if PERIOD is set.  */
+    size_t nblocks;             /* Number of full blocks left.  */
+    unsigned int ntail;         /* Number of blocks left in TAIL.  */
+    unsigned char *tailp;       /* Next block in TAIL.  */
+    unsigned char tail[128];    /* The padded last one or two blocks.  */
+  } lane[MD_MULTI_MAX_LANES];
+  u32 state[8 * MD_MULTI_MAX_LANES];
+  const unsigned char *blocks[MD_MULTI_MAX_LANES];
+  unsigned char *out = digests;
+  unsigned int i, j, nactive;
+  int next = 0;
+
+  gcry_assert (nlanes <= MD_MULTI_MAX_LANES && nwords <= 8);
+
+  for (j = 0; j < nlanes; j++)
+    lane[j].idx = -1;
+
+  for (;;)
+    {
+      nactive = 0;
+      for (j = 0; j < nlanes; j++)
+        {
+          if (lane[j].idx < 0 && next < iovcnt)
+            {
+              size_t len = iov[next].len;
+              size_t rem = len % 64;
+              size_t pos;
+
+              lane[j].idx = next;
+              lane[j].data = iov[next].data;
+              lane[j].pos = iov[next].off;
+              lane[j].size = iov[next].size;
+              lane[j].nblocks = len / 64;
+              lane[j].ntail = rem < 56 ? 1 : 2;
+              lane[j].tailp = lane[j].tail;
+              pos = lane[j].pos + len - rem;
+              if (period && pos + rem > lane[j].size)
+                pos -= (pos + rem - lane[j].size + period - 1) / period * period;
+              if (rem)
+                memcpy (lane[j].tail, lane[j].data + pos, rem);
+              lane[j].tail[rem] = 0x80;
+              memset (lane[j].tail + rem + 1, 0, lane[j].ntail * 64 - rem - 9);
+              buf_put_be32 (lane[j].tail + lane[j].ntail * 64 - 8,
+                            (u32)(len >> 29));
+              buf_put_be32 (lane[j].tail + lane[j].ntail * 64 - 4,
+                            (u32)(len << 3));
+              for (i = 0; i < nwords; i++)
+                state[i * nlanes + j] = iv[i];
+              next++;
+            }
+
+          if (lane[j].idx < 0)
+            {
+              blocks[j] = zero_block;
+              continue;
+            }
+
+          nactive++;
+          if (lane[j].nblocks)
+            {
+              if (period && lane[j].pos + 64 > lane[j].size)
+                lane[j].pos -= ((lane[j].pos + 64 - lane[j].size + period - 1)
+                                / period * period);
+              blocks[j] = lane[j].data + lane[j].pos;
+              lane[j].pos += 64;
+              lane[j].nblocks--;
+            }
+          else
+            {
+              blocks[j] = lane[j].tailp;
+              lane[j].tailp += 64;
+              lane[j].ntail--;
+            }
+        }
+
+      if (!nactive)
+        break;
+
+      transform (state, blocks);
+
+      for (j = 0; j < nlanes; j++)
+        if (lane[j].idx >= 0 && !lane[j].nblocks && !lane[j].ntail)
+          {
+            for (i = 0; i < digestlen / 4; i++)
+              buf_put_be32 (out + lane[j].idx * digestlen + i * 4,
+                            state[i * nlanes + j]);
+            lane[j].idx = -1;
+          }
+    }
+
+  wipememory (lane, sizeof lane);
+  wipememory (state, sizeof state);
+}
@@ -28,9 +28,11 @@ const char * _gcry_hash_selftest_check_one
               int datamode, const void *data, size_t datalen,
               const void *expect, size_t expectlen);
 
-/* Type for the md_write helper function.  */
+/* Type for the md_write helper function.  It processes the NBLKS
+   blocks at BLKS; NBLKS is at least 1.  */
 typedef unsigned int (*_gcry_md_block_write_t) (void *c,
-						const unsigned char *buf);
+						const unsigned char *blks,
+						size_t nblks);
 
 #if defined(HAVE_U64_TYPEDEF) && (defined(USE_SHA512) || defined(USE_WHIRLPOOL))
 /* SHA-512 needs u64 and larger buffer. Whirlpool needs u64. */
@@ -55,4 +57,22 @@ typedef struct gcry_md_block_ctx
 void
 _gcry_md_block_write( void *context, const void *inbuf_arg, size_t inlen);
 
+
+/* The maximum number of lanes of a multi-buffer transform.  */
+#define MD_MULTI_MAX_LANES 8
+
+/* Type for a transform function processing one 64 byte block of each
+   of several independent messages.  BLOCKS has one pointer per lane.
+   STATE holds the chaining values of all lanes interleaved, that is
+   word I of lane J is at STATE[I * NLANES + J].  */
+typedef void (*_gcry_md_multi_transform_t) (u32 *state,
+                                            const unsigned char **blocks);
+
+void
+_gcry_md_block_hash_multi (void *digests, size_t digestlen,
+                           const gcry_buffer_t *iov, int iovcnt,
+                           size_t period, const u32 *iv, unsigned int nwords,
+                           unsigned int nlanes,
+                           _gcry_md_multi_transform_t transform);
+
 #endif /*GCRY_HASH_COMMON_H*/
@@ -48,6 +48,8 @@
 #include "types.h"  /* for byte and u32 typedefs */
 #include "g10lib.h"
 #include "cipher.h"
+#include "bufhelp.h"
+#include "cipher-selftest.h"
 
 
 #define IDEA_KEYSIZE 16
@@ -55,6 +57,13 @@
 #define IDEA_ROUNDS 8
 #define IDEA_KEYLEN (6*IDEA_ROUNDS+4)
 
+
+/* USE_SSE2 indicates whether to compile with AMD64 SSE2 code. */
+#undef USE_SSE2
+#if defined(__x86_64__) && defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS)
+# define USE_SSE2 1
+#endif
+
 typedef struct {
     u16 ek[IDEA_KEYLEN];
     u16 dk[IDEA_KEYLEN];
@@ -299,6 +308,209 @@ idea_decrypt (void *context, byte *out, const byte *in)
 }
 
 
+#ifdef USE_SSE2
+/* Assembler implementations of IDEA using SSE2.  Process 8 block in
+   parallel.
+ */
+extern void _gcry_idea_sse2_amd64_ctr_enc(const u16 *ek, byte *out,
+					  const byte *in, byte *ctr);
+
+extern void _gcry_idea_sse2_amd64_cbc_dec(const u16 *dk, byte *out,
+					  const byte *in, byte *iv);
+
+extern void _gcry_idea_sse2_amd64_cfb_dec(const u16 *ek, byte *out,
+					  const byte *in, byte *iv);
+#endif
+
+
+/* Bulk encryption of complete blocks in CTR mode.  This function is only
+   intended for the bulk encryption feature of cipher.c.  CTR is expected to be
+   of size IDEA_BLOCKSIZE. */
+void
+_gcry_idea_ctr_enc(void *context, unsigned char *ctr,
+                   void *outbuf_arg, const void *inbuf_arg,
+                   size_t nblocks)
+{
+  IDEA_context *ctx = context;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned char tmpbuf[IDEA_BLOCKSIZE];
+  int burn_stack_depth = 24 + 3 * sizeof (void*);
+  int i;
+
+#ifdef USE_SSE2
+  {
+    /* Process data in 8 block chunks. */
+    while (nblocks >= 8)
+      {
+        _gcry_idea_sse2_amd64_ctr_enc(ctx->ek, outbuf, inbuf, ctr);
+
+        nblocks -= 8;
+        outbuf += 8 * IDEA_BLOCKSIZE;
+        inbuf  += 8 * IDEA_BLOCKSIZE;
+      }
+
+    /* Use generic code to handle smaller chunks... */
+  }
+#endif
+
+  for ( ;nblocks; nblocks-- )
+    {
+      /* Encrypt the counter. */
+      encrypt_block(ctx, tmpbuf, ctr);
+      /* XOR the input with the encrypted counter and store in output.  */
+      buf_xor(outbuf, tmpbuf, inbuf, IDEA_BLOCKSIZE);
+      outbuf += IDEA_BLOCKSIZE;
+      inbuf  += IDEA_BLOCKSIZE;
+      /* Increment the counter.  */
+      for (i = IDEA_BLOCKSIZE; i > 0; i--)
+        {
+          ctr[i-1]++;
+          if (ctr[i-1])
+            break;
+        }
+    }
+
+  wipememory(tmpbuf, sizeof(tmpbuf));
+  _gcry_burn_stack(burn_stack_depth);
+}
+
+
+/* Bulk decryption of complete blocks in CBC mode.  This function is only
+   intended for the bulk encryption feature of cipher.c. */
+void
+_gcry_idea_cbc_dec(void *context, unsigned char *iv,
+                   void *outbuf_arg, const void *inbuf_arg,
+                   size_t nblocks)
+{
+  IDEA_context *ctx = context;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned char savebuf[IDEA_BLOCKSIZE];
+  int burn_stack_depth = 24 + 3 * sizeof (void*);
+
+  if( !ctx->have_dk ) {
+     ctx->have_dk = 1;
+     invert_key( ctx->ek, ctx->dk );
+  }
+
+#ifdef USE_SSE2
+  {
+    /* Process data in 8 block chunks. */
+    while (nblocks >= 8)
+      {
+        _gcry_idea_sse2_amd64_cbc_dec(ctx->dk, outbuf, inbuf, iv);
+
+        nblocks -= 8;
+        outbuf += 8 * IDEA_BLOCKSIZE;
+        inbuf  += 8 * IDEA_BLOCKSIZE;
+      }
+
+    /* Use generic code to handle smaller chunks... */
+  }
+#endif
+
+  for ( ;nblocks; nblocks-- )
+    {
+      /* INBUF is needed later and it may be identical to OUTBUF, so store
+         the intermediate result to SAVEBUF.  */
+      cipher (savebuf, inbuf, ctx->dk);
+
+      buf_xor_n_copy_2(outbuf, savebuf, iv, inbuf, IDEA_BLOCKSIZE);
+      inbuf += IDEA_BLOCKSIZE;
+      outbuf += IDEA_BLOCKSIZE;
+    }
+
+  wipememory(savebuf, sizeof(savebuf));
+  _gcry_burn_stack(burn_stack_depth);
+}
+
+
+/* Bulk decryption of complete blocks in CFB mode.  This function is only
+   intended for the bulk encryption feature of cipher.c. */
+void
+_gcry_idea_cfb_dec(void *context, unsigned char *iv,
+                   void *outbuf_arg, const void *inbuf_arg,
+                   size_t nblocks)
+{
+  IDEA_context *ctx = context;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  int burn_stack_depth = 24 + 3 * sizeof (void*);
+
+#ifdef USE_SSE2
+  {
+    /* Process data in 8 block chunks. */
+    while (nblocks >= 8)
+      {
+        _gcry_idea_sse2_amd64_cfb_dec(ctx->ek, outbuf, inbuf, iv);
+
+        nblocks -= 8;
+        outbuf += 8 * IDEA_BLOCKSIZE;
+        inbuf  += 8 * IDEA_BLOCKSIZE;
+      }
+
+    /* Use generic code to handle smaller chunks... */
+  }
+#endif
+
+  for ( ;nblocks; nblocks-- )
+    {
+      encrypt_block(ctx, iv, iv);
+      buf_xor_n_copy(outbuf, iv, inbuf, IDEA_BLOCKSIZE);
+      outbuf += IDEA_BLOCKSIZE;
+      inbuf  += IDEA_BLOCKSIZE;
+    }
+
+  _gcry_burn_stack(burn_stack_depth);
+}
+
+
+/* Run the self-tests for IDEA-CTR, tests IV increment of bulk CTR
+   encryption.  Returns NULL on success. */
+static const char *
+selftest_ctr (void)
+{
+  const int nblocks = 8+1;
+  const int blocksize = IDEA_BLOCKSIZE;
+  const int context_size = sizeof(IDEA_context);
+
+  return _gcry_selftest_helper_ctr("IDEA", &idea_setkey,
+           &idea_encrypt, &_gcry_idea_ctr_enc, nblocks, blocksize,
+	   context_size);
+}
+
+
+/* Run the self-tests for IDEA-CBC, tests bulk CBC decryption.
+   Returns NULL on success. */
+static const char *
+selftest_cbc (void)
+{
+  const int nblocks = 8+2;
+  const int blocksize = IDEA_BLOCKSIZE;
+  const int context_size = sizeof(IDEA_context);
+
+  return _gcry_selftest_helper_cbc("IDEA", &idea_setkey,
+           &idea_encrypt, &_gcry_idea_cbc_dec, nblocks, blocksize,
+	   context_size);
+}
+
+
+/* Run the self-tests for IDEA-CFB, tests bulk CFB decryption.
+   Returns NULL on success. */
+static const char *
+selftest_cfb (void)
+{
+  const int nblocks = 8+2;
+  const int blocksize = IDEA_BLOCKSIZE;
+  const int context_size = sizeof(IDEA_context);
+
+  return _gcry_selftest_helper_cfb("IDEA", &idea_setkey,
+           &idea_encrypt, &_gcry_idea_cfb_dec, nblocks, blocksize,
+	   context_size);
+}
+
+
 static const char *
 selftest( void )
 {
@@ -354,6 +566,7 @@ static struct {
 };
     IDEA_context c;
     byte buffer[8];
+    const char *r;
     int i;
 
     for(i=0; i < DIM(test_vectors); i++ ) {
@@ -366,6 +579,15 @@ static struct {
 	    return "IDEA test decryption failed.";
     }
 
+    if ( (r = selftest_cbc ()) )
+      return r;
+
+    if ( (r = selftest_cfb ()) )
+      return r;
+
+    if ( (r = selftest_ctr ()) )
+      return r;
+
     return NULL;
 }
 
@@ -27,14 +27,25 @@
 #include "g10lib.h"
 #include "cipher.h"
 #include "ath.h"
+#include "bufhelp.h"
 #include "kdf-internal.h"
 
 
+/* The salted S2K hashes the salt and passphrase repeated to COUNT
+   bytes.  They are written in chunks of at least this size taken from
+   a buffer with the pre-replicated salt and passphrase.  */
+#define S2K_CHUNKSIZE 1024
+
 /* Transform a passphrase into a suitable key of length KEYSIZE and
    store this key in the caller provided buffer KEYBUFFER.  The caller
    must provide an HASHALGO, a valid ALGO and depending on that algo a
    SALT of 8 bytes and the number of ITERATIONS.  Code taken from
-   gnupg/agent/protect.c:hash_passphrase.  */
+   gnupg/agent/protect.c:hash_passphrase.
+
+   If the key is longer than the digest, several passes with a
+   different number of zero bytes prepended to the input are required.
+   For the salted variants these are computed in parallel with the
+   multi-buffer code if that is available and faster.  */
 static gpg_err_code_t
 openpgp_s2k (const void *passphrase, size_t passphraselen,
              int algo, int hashalgo,
@@ -48,6 +59,17 @@ openpgp_s2k (const void *passphrase, size_t passphraselen,
   int pass, i;
   int used = 0;
   int secmode;
+  unsigned int dlen;
+  int npasses;
+  unsigned char *buffer = NULL; /* Zero bytes for the passes and the
+                                   replicated salt and passphrase.  */
+  unsigned char *chunk = NULL;  /* The first replica in BUFFER.  */
+  size_t buflen = 0;
+  size_t len2 = 0;              /* Length of salt and passphrase.  */
+  size_t chunklen = 0;          /* Multiple of LEN2 used for writing.  */
+  unsigned long count = 0;
+  unsigned long n;
+  size_t k;
 
   if ((algo == GCRY_KDF_SALTED_S2K || algo == GCRY_KDF_ITERSALTED_S2K)
       && (!salt || saltlen != 8))
@@ -55,9 +77,80 @@ openpgp_s2k (const void *passphrase, size_t passphraselen,
 
   secmode = _gcry_is_secure (passphrase) || _gcry_is_secure (keybuffer);
 
+  dlen = _gcry_md_get_algo_dlen (hashalgo);
+  if (!dlen)
+    return GPG_ERR_DIGEST_ALGO;
+  npasses = (keysize + dlen - 1) / dlen;
+
+  if (algo == GCRY_KDF_SALTED_S2K || algo == GCRY_KDF_ITERSALTED_S2K)
+    {
+      len2 = passphraselen + 8;
+      count = len2;
+      if (algo == GCRY_KDF_ITERSALTED_S2K)
+        {
+          count = iterations;
+          if (count < len2)
+            count = len2;
+        }
+
+      /* The replicas are followed by one more and 64 bytes so that
+         the multi-buffer code can wrap around with a period of LEN2.  */
+      chunklen = (S2K_CHUNKSIZE / len2 + 1) * len2;
+      buflen = (npasses - 1) + chunklen + len2 + 64;
+      buffer = secmode? xtrymalloc_secure (buflen) : xtrymalloc (buflen);
+      if (!buffer)
+        return gpg_err_code_from_syserror ();
+      memset (buffer, 0, npasses - 1);
+      chunk = buffer + npasses - 1;
+      memcpy (chunk, salt, saltlen);
+      memcpy (chunk + saltlen, passphrase, passphraselen);
+      for (k = len2; k < chunklen + len2 + 64; k++)
+        chunk[k] = chunk[k - len2];
+    }
+
+  if (buffer && npasses > 1)
+    {
+      gcry_buffer_t *iov;
+      unsigned char *digests;
+
+      iov = xtrycalloc (npasses, sizeof *iov);
+      if (!iov)
+        {
+          ec = gpg_err_code_from_syserror ();
+          goto leave;
+        }
+      digests = (secmode
+                 ? xtrymalloc_secure (npasses * dlen)
+                 : xtrymalloc (npasses * dlen));
+      if (!digests)
+        {
+          ec = gpg_err_code_from_syserror ();
+          xfree (iov);
+          goto leave;
+        }
+
+      /* Pass I is the same as the first one but starts at I zero
+         bytes before the salt.  */
+      for (pass = 0; pass < npasses; pass++)
+        {
+          iov[pass].data = buffer;
+          iov[pass].size = buflen;
+          iov[pass].off = npasses - 1 - pass;
+          iov[pass].len = pass + count;
+        }
+      ec = _gcry_md_hash_periodic_multi (hashalgo, digests, iov, npasses, len2);
+      if (!ec)
+        memcpy (key, digests, keysize);
+      wipememory (digests, npasses * dlen);
+      xfree (digests);
+      xfree (iov);
+      if (ec != GPG_ERR_NOT_SUPPORTED)
+        goto leave;
+    }
+
   ec = _gcry_md_open (&md, hashalgo, secmode? GCRY_MD_FLAG_SECURE : 0);
   if (ec)
-    return ec;
+    goto leave;
 
   for (pass=0; used < keysize; pass++)
     {
@@ -68,45 +161,31 @@ openpgp_s2k (const void *passphrase, size_t passphraselen,
             _gcry_md_putc (md, 0);
 	}
 
-      if (algo == GCRY_KDF_SALTED_S2K || algo == GCRY_KDF_ITERSALTED_S2K)
+      if (buffer)
         {
-          int len2 = passphraselen + 8;
-          unsigned long count = len2;
-
-          if (algo == GCRY_KDF_ITERSALTED_S2K)
-            {
-              count = iterations;
-              if (count < len2)
-                count = len2;
-            }
-
-          while (count > len2)
-            {
-              _gcry_md_write (md, salt, saltlen);
-              _gcry_md_write (md, passphrase, passphraselen);
-              count -= len2;
-            }
-          if (count < saltlen)
-            _gcry_md_write (md, salt, count);
-          else
-            {
-              _gcry_md_write (md, salt, saltlen);
-              count -= saltlen;
-              _gcry_md_write (md, passphrase, count);
-            }
+          for (n = count; n > chunklen; n -= chunklen)
+            _gcry_md_write (md, chunk, chunklen);
+          _gcry_md_write (md, chunk, n);
         }
       else
         _gcry_md_write (md, passphrase, passphraselen);
 
       _gcry_md_final (md);
-      i = _gcry_md_get_algo_dlen (hashalgo);
+      i = dlen;
       if (i > keysize - used)
         i = keysize - used;
       memcpy (key+used, _gcry_md_read (md, hashalgo), i);
       used += i;
     }
   _gcry_md_close (md);
-  return 0;
+
+ leave:
+  if (buffer)
+    {
+      wipememory (buffer, buflen);
+      xfree (buffer);
+    }
+  return ec;
 }
 
 
@@ -223,6 +302,638 @@ _gcry_kdf_pkdf2 (const void *passphrase, size_t passphraselen,
 }
 
 
+/*
+ * Argon2id as specified by RFC 9106 (version 0x13).
+ *
+ * Argon2 is built on BLAKE2b which is not otherwise available in
+ * Libgcrypt; thus a minimal unkeyed implementation is included here.
+ */
+
+#ifdef HAVE_U64_TYPEDEF
+
+static inline u64
+ror64 (u64 x, int n)
+{
+  return (x >> n) | (x << (64 - n));
+}
+
+#define BLAKE2B_BLOCKSIZE 128
+#define BLAKE2B_OUTLEN    64
+
+typedef struct
+{
+  u64 h[8];
+  u64 t[2];
+  byte buf[BLAKE2B_BLOCKSIZE];
+  size_t buflen;
+  size_t outlen;
+} blake2b_ctx_t;
+
+static const u64 blake2b_iv[8] =
+  {
+    U64_C(0x6a09e667f3bcc908), U64_C(0xbb67ae8584caa73b),
+    U64_C(0x3c6ef372fe94f82b), U64_C(0xa54ff53a5f1d36f1),
+    U64_C(0x510e527fade682d1), U64_C(0x9b05688c2b3e6c1f),
+    U64_C(0x1f83d9abfb41bd6b), U64_C(0x5be0cd19137e2179)
+  };
+
+static const byte blake2b_sigma[12][16] =
+  {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+  };
+
+#define BLAKE2B_G(a, b, c, d, x, y) do {        \
+    a = a + b + (x); d = ror64 (d ^ a, 32);     \
+    c = c + d;       b = ror64 (b ^ c, 24);     \
+    a = a + b + (y); d = ror64 (d ^ a, 16);     \
+    c = c + d;       b = ror64 (b ^ c, 63);     \
+  } while (0)
+
+static void
+blake2b_compress (blake2b_ctx_t *ctx, const byte *block, int last)
+{
+  u64 m[16], v[16];
+  int i;
+
+  for (i = 0; i < 16; i++)
+    m[i] = buf_get_le64 (block + 8 * i);
+  for (i = 0; i < 8; i++)
+    {
+      v[i] = ctx->h[i];
+      v[i + 8] = blake2b_iv[i];
+    }
+  v[12] ^= ctx->t[0];
+  v[13] ^= ctx->t[1];
+  if (last)
+    v[14] = ~v[14];
+
+  for (i = 0; i < 12; i++)
+    {
+      const byte *s = blake2b_sigma[i];
+
+      BLAKE2B_G (v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]);
+      BLAKE2B_G (v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]);
+      BLAKE2B_G (v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]);
+      BLAKE2B_G (v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]);
+      BLAKE2B_G (v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]);
+      BLAKE2B_G (v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+      BLAKE2B_G (v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]);
+      BLAKE2B_G (v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]);
+    }
+
+  for (i = 0; i < 8; i++)
+    ctx->h[i] ^= v[i] ^ v[i + 8];
+
+  wipememory (m, sizeof m);
+  wipememory (v, sizeof v);
+}
+
+static void
+blake2b_init (blake2b_ctx_t *ctx, size_t outlen)
+{
+  memset (ctx, 0, sizeof *ctx);
+  memcpy (ctx->h, blake2b_iv, sizeof ctx->h);
+  ctx->h[0] ^= 0x01010000 ^ outlen;
+  ctx->outlen = outlen;
+}
+
+static void
+blake2b_write (blake2b_ctx_t *ctx, const void *buffer, size_t length)
+{
+  const byte *p = buffer;
+  size_t n;
+
+  while (length)
+    {
+      /* The last block must be processed by blake2b_final.  */
+      if (ctx->buflen == BLAKE2B_BLOCKSIZE)
+        {
+          ctx->t[0] += BLAKE2B_BLOCKSIZE;
+          if (ctx->t[0] < BLAKE2B_BLOCKSIZE)
+            ctx->t[1]++;
+          blake2b_compress (ctx, ctx->buf, 0);
+          ctx->buflen = 0;
+        }
+      n = BLAKE2B_BLOCKSIZE - ctx->buflen;
+      if (n > length)
+        n = length;
+      memcpy (ctx->buf + ctx->buflen, p, n);
+      ctx->buflen += n;
+      p += n;
+      length -= n;
+    }
+}
+
+static void
+blake2b_write_le32 (blake2b_ctx_t *ctx, u32 value)
+{
+  byte tmp[4];
+
+  buf_put_le32 (tmp, value);
+  blake2b_write (ctx, tmp, 4);
+}
+
+static void
+blake2b_final (blake2b_ctx_t *ctx, void *out)
+{
+  byte tmp[BLAKE2B_OUTLEN];
+  int i;
+
+  ctx->t[0] += ctx->buflen;
+  if (ctx->t[0] < ctx->buflen)
+    ctx->t[1]++;
+  memset (ctx->buf + ctx->buflen, 0, BLAKE2B_BLOCKSIZE - ctx->buflen);
+  blake2b_compress (ctx, ctx->buf, 1);
+
+  for (i = 0; i < 8; i++)
+    buf_put_le64 (tmp + 8 * i, ctx->h[i]);
+  memcpy (out, tmp, ctx->outlen);
+  wipememory (tmp, sizeof tmp);
+  wipememory (ctx, sizeof *ctx);
+}
+
+
+#define ARGON2_VERSION         0x13
+#define ARGON2_BLOCK_WORDS     128
+#define ARGON2_BLOCK_SIZE      (8 * ARGON2_BLOCK_WORDS)
+#define ARGON2_SYNC_POINTS     4
+
+typedef struct
+{
+  u64 v[ARGON2_BLOCK_WORDS];
+} argon2_block_t;
+
+/* The variable length hash function H' of Argon2.  Write OUTLEN
+   bytes of the hash of (IN,INLEN) to OUT.  */
+static void
+argon2_hprime (void *out, size_t outlen, const void *in, size_t inlen)
+{
+  blake2b_ctx_t ctx;
+  byte v[BLAKE2B_OUTLEN];
+  byte *dst = out;
+
+  blake2b_init (&ctx, outlen <= BLAKE2B_OUTLEN ? outlen : BLAKE2B_OUTLEN);
+  blake2b_write_le32 (&ctx, outlen);
+  blake2b_write (&ctx, in, inlen);
+  if (outlen <= BLAKE2B_OUTLEN)
+    {
+      blake2b_final (&ctx, dst);
+      return;
+    }
+  blake2b_final (&ctx, v);
+
+  /* Emit the first half of each V_i until the rest fits into the
+     output of a single final hash.  */
+  for (;;)
+    {
+      memcpy (dst, v, BLAKE2B_OUTLEN / 2);
+      dst += BLAKE2B_OUTLEN / 2;
+      outlen -= BLAKE2B_OUTLEN / 2;
+      if (outlen <= BLAKE2B_OUTLEN)
+        break;
+      blake2b_init (&ctx, BLAKE2B_OUTLEN);
+      blake2b_write (&ctx, v, BLAKE2B_OUTLEN);
+      blake2b_final (&ctx, v);
+    }
+  blake2b_init (&ctx, outlen);
+  blake2b_write (&ctx, v, BLAKE2B_OUTLEN);
+  blake2b_final (&ctx, dst);
+  wipememory (v, sizeof v);
+}
+
+/* The BlaMka variant of the BLAKE2b G function used by the
+   compression function of Argon2.  */
+#define ARGON2_FBLAMKA(x, y) \
+  ((x) + (y) + 2 * ((x) & 0xffffffff) * ((y) & 0xffffffff))
+
+#define ARGON2_G(a, b, c, d) do {                       \
+    a = ARGON2_FBLAMKA (a, b); d = ror64 (d ^ a, 32);   \
+    c = ARGON2_FBLAMKA (c, d); b = ror64 (b ^ c, 24);   \
+    a = ARGON2_FBLAMKA (a, b); d = ror64 (d ^ a, 16);   \
+    c = ARGON2_FBLAMKA (c, d); b = ror64 (b ^ c, 63);   \
+  } while (0)
+
+#define ARGON2_P(v0, v1, v2, v3, v4, v5, v6, v7,                        \
+                 v8, v9, v10, v11, v12, v13, v14, v15) do {             \
+    ARGON2_G (v0, v4, v8, v12);  ARGON2_G (v1, v5, v9, v13);            \
+    ARGON2_G (v2, v6, v10, v14); ARGON2_G (v3, v7, v11, v15);           \
+    ARGON2_G (v0, v5, v10, v15); ARGON2_G (v1, v6, v11, v12);           \
+    ARGON2_G (v2, v7, v8, v13);  ARGON2_G (v3, v4, v9, v14);            \
+  } while (0)
+
+/* Compute the compression function G (PREV, REF) and store the
+   result at NEXT; if WITH_XOR is set the result is xored to the
+   block already at NEXT.  NEXT may be the same as REF.  */
+static void
+argon2_fill_block (const argon2_block_t *prev, const argon2_block_t *ref,
+                   argon2_block_t *next, int with_xor)
+{
+  argon2_block_t r, z;
+  u64 *v = z.v;
+  int i;
+
+  for (i = 0; i < ARGON2_BLOCK_WORDS; i++)
+    r.v[i] = z.v[i] = prev->v[i] ^ ref->v[i];
+  if (with_xor)
+    for (i = 0; i < ARGON2_BLOCK_WORDS; i++)
+      r.v[i] ^= next->v[i];
+
+  /* Apply P to the rows of 16 words and then to the columns of 2
+     words of the block viewed as an 8x8 matrix of 16 byte
+     registers.  */
+  for (i = 0; i < 8; i++)
+    ARGON2_P (v[16*i],      v[16*i + 1],  v[16*i + 2],  v[16*i + 3],
+              v[16*i + 4],  v[16*i + 5],  v[16*i + 6],  v[16*i + 7],
+              v[16*i + 8],  v[16*i + 9],  v[16*i + 10], v[16*i + 11],
+              v[16*i + 12], v[16*i + 13], v[16*i + 14], v[16*i + 15]);
+  for (i = 0; i < 8; i++)
+    ARGON2_P (v[2*i],       v[2*i + 1],   v[2*i + 16],  v[2*i + 17],
+              v[2*i + 32],  v[2*i + 33],  v[2*i + 48],  v[2*i + 49],
+              v[2*i + 64],  v[2*i + 65],  v[2*i + 80],  v[2*i + 81],
+              v[2*i + 96],  v[2*i + 97],  v[2*i + 112], v[2*i + 113]);
+
+  for (i = 0; i < ARGON2_BLOCK_WORDS; i++)
+    next->v[i] = z.v[i] ^ r.v[i];
+}
+
+/* The state shared by the threads filling the lanes of a segment.
+   Thread IDX fills the lanes IDX, IDX + NTHREADS, ...  */
+struct argon2_parm_s
+{
+  argon2_block_t *memory;
+  int type;             /* GCRY_KDF_ARGON2D, _ARGON2I or _ARGON2ID.  */
+  u32 passes;
+  u32 lanes;
+  u32 memory_blocks;
+  u32 segment_length;
+  u32 lane_length;
+  u32 pass;
+  u32 slice;
+  int nthreads;
+};
+
+/* Generate the next block of pseudo-random indices for the data
+   independent addressing.  */
+static void
+argon2_next_addresses (argon2_block_t *address, argon2_block_t *input)
+{
+  static const argon2_block_t zero;
+
+  input->v[6]++;
+  argon2_fill_block (&zero, input, address, 0);
+  argon2_fill_block (&zero, address, address, 0);
+}
+
+static void
+argon2_fill_segment (struct argon2_parm_s *parm, u32 lane)
+{
+  argon2_block_t address, input;
+  argon2_block_t *memory = parm->memory;
+  u32 pass = parm->pass;
+  u32 slice = parm->slice;
+  u32 lane_length = parm->lane_length;
+  u32 segment_length = parm->segment_length;
+  int data_independent = (parm->type == GCRY_KDF_ARGON2I
+                          || (parm->type == GCRY_KDF_ARGON2ID && pass == 0
+                              && slice < ARGON2_SYNC_POINTS / 2));
+  u32 start = 0;
+  u32 curr, prev, i, ref_lane, ref_index, area, start_pos;
+  u64 pseudo_rand, rel;
+
+  if (data_independent)
+    {
+      memset (&input, 0, sizeof input);
+      input.v[0] = pass;
+      input.v[1] = lane;
+      input.v[2] = slice;
+      input.v[3] = parm->memory_blocks;
+      input.v[4] = parm->passes;
+      input.v[5] = parm->type;
+    }
+
+  /* The first two blocks of each lane have already been computed.  */
+  if (pass == 0 && slice == 0)
+    {
+      start = 2;
+      if (data_independent)
+        argon2_next_addresses (&address, &input);
+    }
+
+  curr = lane * lane_length + slice * segment_length + start;
+  if (curr % lane_length == 0)
+    prev = curr + lane_length - 1;
+  else
+    prev = curr - 1;
+
+  for (i = start; i < segment_length; i++, curr++, prev++)
+    {
+      if (curr % lane_length == 1)
+        prev = curr - 1;
+
+      if (data_independent)
+        {
+          if (i % ARGON2_BLOCK_WORDS == 0)
+            argon2_next_addresses (&address, &input);
+          pseudo_rand = address.v[i % ARGON2_BLOCK_WORDS];
+        }
+      else
+        pseudo_rand = memory[prev].v[0];
+
+      ref_lane = (pseudo_rand >> 32) % parm->lanes;
+      if (pass == 0 && slice == 0)
+        ref_lane = lane;
+
+      /* Compute the size of the reference area and map the low 32
+         bits of PSEUDO_RAND non-uniformly into it.  */
+      if (pass == 0)
+        area = slice * segment_length;
+      else
+        area = lane_length - segment_length;
+      if (ref_lane == lane)
+        area += i - 1;
+      else if (i == 0)
+        area -= 1;
+
+      rel = pseudo_rand & 0xffffffff;
+      rel = (rel * rel) >> 32;
+      rel = area - 1 - ((area * rel) >> 32);
+
+      start_pos = 0;
+      if (pass && slice != ARGON2_SYNC_POINTS - 1)
+        start_pos = (slice + 1) * segment_length;
+      ref_index = (start_pos + rel) % lane_length;
+
+      argon2_fill_block (&memory[prev],
+                         &memory[ref_lane * lane_length + ref_index],
+                         &memory[curr], pass != 0);
+    }
+
+  if (data_independent)
+    {
+      wipememory (&address, sizeof address);
+      wipememory (&input, sizeof input);
+    }
+}
+
+static void
+argon2_worker (void *arg, int idx)
+{
+  struct argon2_parm_s *parm = arg;
+  u32 lane;
+
+  for (lane = idx; lane < parm->lanes; lane += parm->nthreads)
+    argon2_fill_segment (parm, lane);
+}
+
+
+/* A job filling one lane of a segment for the thread functions
+   passed to gcry_kdf_compute.  */
+struct argon2_job_s
+{
+  struct argon2_parm_s *parm;
+  u32 lane;
+};
+
+static void
+argon2_job (void *priv)
+{
+  struct argon2_job_s *job = priv;
+
+  argon2_fill_segment (job->parm, job->lane);
+}
+
+
+/* The state of an Argon2 computation.  */
+typedef struct argon2_ctx_s
+{
+  struct argon2_parm_s parm;
+  struct argon2_job_s *jobs;    /* One for each lane.  */
+  u32 outlen;
+  byte h0[BLAKE2B_OUTLEN + 8];
+  int computed;
+} *argon2_ctx_t;
+
+
+static void
+argon2_close (argon2_ctx_t a)
+{
+  if (!a)
+    return;
+  if (a->parm.memory)
+    {
+      wipememory (a->parm.memory,
+                  (size_t)a->parm.memory_blocks * ARGON2_BLOCK_SIZE);
+      xfree (a->parm.memory);
+    }
+  xfree (a->jobs);
+  wipememory (a, sizeof *a);
+  xfree (a);
+}
+
+
+/* Set up the Argon2 variant SUBALGO.  PARAM has the tag length, the
+   number of passes T, the memory size M in KiB and optionally the
+   number of lanes P, which defaults to 1.  The SECRET and the
+   associated data AD are optional.  */
+static gpg_err_code_t
+argon2_open (argon2_ctx_t *r_a, int subalgo,
+             const unsigned long *param, unsigned int paramlen,
+             const void *passphrase, size_t passphraselen,
+             const void *salt, size_t saltlen,
+             const void *secret, size_t secretlen,
+             const void *ad, size_t adlen)
+{
+  argon2_ctx_t a;
+  blake2b_ctx_t ctx;
+  unsigned long outlen, t_cost, m_cost, parallelism;
+  u32 lane;
+
+  if (subalgo != GCRY_KDF_ARGON2D && subalgo != GCRY_KDF_ARGON2I
+      && subalgo != GCRY_KDF_ARGON2ID)
+    return GPG_ERR_UNKNOWN_ALGORITHM;
+  if (!param || (paramlen != 3 && paramlen != 4))
+    return GPG_ERR_INV_VALUE;
+
+  outlen = param[0];
+  t_cost = param[1];
+  m_cost = param[2];
+  parallelism = paramlen == 4? param[3] : 1;
+
+  if ((!passphrase && passphraselen) || !salt || saltlen < 8
+      || (!secret && secretlen) || (!ad && adlen)
+      || outlen < 4 || outlen > 0xffffffff
+      || !t_cost || t_cost > 0xffffffff
+      || !parallelism || parallelism > 0xffffff
+      || m_cost < 8 * parallelism || m_cost > 0xffffffff
+      || passphraselen > 0xffffffff || saltlen > 0xffffffff
+      || secretlen > 0xffffffff || adlen > 0xffffffff)
+    return GPG_ERR_INV_VALUE;
+
+  a = xtrycalloc (1, sizeof *a);
+  if (!a)
+    return gpg_err_code_from_syserror ();
+
+  a->outlen = outlen;
+  a->parm.type = subalgo;
+  a->parm.passes = t_cost;
+  a->parm.lanes = parallelism;
+  a->parm.segment_length = m_cost / (parallelism * ARGON2_SYNC_POINTS);
+  a->parm.lane_length = a->parm.segment_length * ARGON2_SYNC_POINTS;
+  a->parm.memory_blocks = a->parm.lane_length * parallelism;
+
+  if ((size_t)a->parm.memory_blocks * ARGON2_BLOCK_SIZE / ARGON2_BLOCK_SIZE
+      != a->parm.memory_blocks)
+    {
+      xfree (a);
+      return GPG_ERR_ENOMEM;
+    }
+  a->parm.memory = xtrymalloc ((size_t)a->parm.memory_blocks
+                               * ARGON2_BLOCK_SIZE);
+  a->jobs = a->parm.memory? xtrycalloc (a->parm.lanes, sizeof *a->jobs) : NULL;
+  if (!a->jobs)
+    {
+      gpg_err_code_t ec = gpg_err_code_from_syserror ();
+      argon2_close (a);
+      return ec;
+    }
+  for (lane = 0; lane < a->parm.lanes; lane++)
+    {
+      a->jobs[lane].parm = &a->parm;
+      a->jobs[lane].lane = lane;
+    }
+
+  /* H0 = H^(64)(p, T, m, t, v, y, |P|, P, |S|, S, |K|, K, |X|, X) */
+  blake2b_init (&ctx, BLAKE2B_OUTLEN);
+  blake2b_write_le32 (&ctx, parallelism);
+  blake2b_write_le32 (&ctx, outlen);
+  blake2b_write_le32 (&ctx, m_cost);
+  blake2b_write_le32 (&ctx, t_cost);
+  blake2b_write_le32 (&ctx, ARGON2_VERSION);
+  blake2b_write_le32 (&ctx, subalgo);
+  blake2b_write_le32 (&ctx, passphraselen);
+  blake2b_write (&ctx, passphrase, passphraselen);
+  blake2b_write_le32 (&ctx, saltlen);
+  blake2b_write (&ctx, salt, saltlen);
+  blake2b_write_le32 (&ctx, secretlen);
+  blake2b_write (&ctx, secret, secretlen);
+  blake2b_write_le32 (&ctx, adlen);
+  blake2b_write (&ctx, ad, adlen);
+  blake2b_final (&ctx, a->h0);
+
+  *r_a = a;
+  return 0;
+}
+
+
+/* Fill the memory of A.  The lanes of each segment are filled by the
+   thread functions in OPS if given, or else by the worker threads if
+   these have been enabled.  */
+static gpg_err_code_t
+argon2_compute (argon2_ctx_t a, const struct gcry_kdf_thread_ops *ops)
+{
+  struct argon2_parm_s *parm = &a->parm;
+  byte tmp[ARGON2_BLOCK_SIZE];
+  gpg_err_code_t ec = 0;
+  u32 lane;
+  int i;
+
+  a->computed = 0;
+
+  /* B[i][0] = H'(H0 || LE32(0) || LE32(i)), B[i][1] likewise.  */
+  for (lane = 0; lane < parm->lanes; lane++)
+    for (i = 0; i < 2; i++)
+      {
+        argon2_block_t *b = &parm->memory[lane * parm->lane_length + i];
+        int k;
+
+        buf_put_le32 (a->h0 + BLAKE2B_OUTLEN, i);
+        buf_put_le32 (a->h0 + BLAKE2B_OUTLEN + 4, lane);
+        argon2_hprime (tmp, sizeof tmp, a->h0, sizeof a->h0);
+        for (k = 0; k < ARGON2_BLOCK_WORDS; k++)
+          b->v[k] = buf_get_le64 (tmp + 8 * k);
+      }
+  wipememory (tmp, sizeof tmp);
+
+  parm->nthreads = _gcry_get_worker_threads ();
+  if (parm->nthreads > parm->lanes)
+    parm->nthreads = parm->lanes;
+
+  /* All lanes must have finished a slice before the next one may
+     reference its blocks.  */
+  for (parm->pass = 0; !ec && parm->pass < parm->passes; parm->pass++)
+    for (parm->slice = 0; !ec && parm->slice < ARGON2_SYNC_POINTS;
+         parm->slice++)
+      {
+        if (ops)
+          {
+            for (lane = 0; lane < parm->lanes; lane++)
+              if (ops->dispatch_job (ops->jobs_context, argon2_job,
+                                     &a->jobs[lane]) < 0)
+                {
+                  ec = GPG_ERR_CANCELED;
+                  break;
+                }
+            if (ops->wait_all_jobs (ops->jobs_context) < 0)
+              ec = GPG_ERR_CANCELED;
+          }
+        else if (parm->nthreads > 1)
+          ath_run_parallel (argon2_worker, parm, parm->nthreads);
+        else
+          argon2_worker (parm, 0);
+      }
+
+  if (!ec)
+    a->computed = 1;
+  return ec;
+}
+
+
+/* Store the tag of the computed memory of A in the RESULTLEN bytes
+   at RESULT.  RESULTLEN must be the tag length passed to
+   argon2_open.  */
+static gpg_err_code_t
+argon2_final (argon2_ctx_t a, size_t resultlen, void *result)
+{
+  struct argon2_parm_s *parm = &a->parm;
+  byte tmp[ARGON2_BLOCK_SIZE];
+  u64 w;
+  u32 lane;
+  int i;
+
+  if (!a->computed)
+    return GPG_ERR_INV_STATE;
+  if (!result || resultlen != a->outlen)
+    return GPG_ERR_INV_VALUE;
+
+  /* The tag is H'(T) of the xor of the last blocks of all lanes.  */
+  for (i = 0; i < ARGON2_BLOCK_WORDS; i++)
+    {
+      w = 0;
+      for (lane = 0; lane < parm->lanes; lane++)
+        w ^= parm->memory[lane * parm->lane_length
+                          + parm->lane_length - 1].v[i];
+      buf_put_le64 (tmp + 8 * i, w);
+    }
+  argon2_hprime (result, resultlen, tmp, sizeof tmp);
+
+  wipememory (tmp, sizeof tmp);
+  return 0;
+}
+
+#endif /*HAVE_U64_TYPEDEF*/
+
+
 /* Derive a key from a passphrase.  KEYSIZE gives the requested size
    of the keys in octets.  KEYBUFFER is a caller provided buffer
    filled on success with the derived key.  The input passphrase is
@@ -298,3 +1009,130 @@ _gcry_kdf_derive (const void *passphrase, size_t passphraselen,
  leave:
   return ec;
 }
+
+
+/* The handle of a KDF which takes more parameters than
+   _gcry_kdf_derive.  */
+struct gcry_kdf_handle
+{
+  int algo;
+  union
+  {
+#ifdef HAVE_U64_TYPEDEF
+    argon2_ctx_t argon2;
+#endif
+    void *dummy;
+  } u;
+};
+
+
+/* Create a handle for the KDF ALGO with the variant SUBALGO and store
+   it at R_HD.  PARAM has PARAMLEN algorithm specific parameters.  The
+   KEY and the associated data AD are optional for some algorithms.
+   The input is processed by _gcry_kdf_compute and the derived key is
+   retrieved with _gcry_kdf_final.  */
+gpg_err_code_t
+_gcry_kdf_open (gcry_kdf_hd_t *r_hd, int algo, int subalgo,
+                const unsigned long *param, unsigned int paramlen,
+                const void *passphrase, size_t passphraselen,
+                const void *salt, size_t saltlen,
+                const void *key, size_t keylen,
+                const void *ad, size_t adlen)
+{
+  gcry_kdf_hd_t hd;
+  gpg_err_code_t ec;
+
+  if (!r_hd)
+    return GPG_ERR_INV_ARG;
+  *r_hd = NULL;
+
+  hd = xtrycalloc (1, sizeof *hd);
+  if (!hd)
+    return gpg_err_code_from_syserror ();
+  hd->algo = algo;
+
+  switch (algo)
+    {
+    case GCRY_KDF_ARGON2:
+#ifdef HAVE_U64_TYPEDEF
+      ec = argon2_open (&hd->u.argon2, subalgo, param, paramlen,
+                        passphrase, passphraselen, salt, saltlen,
+                        key, keylen, ad, adlen);
+#else
+      ec = GPG_ERR_NOT_SUPPORTED;
+#endif
+      break;
+
+    default:
+      ec = GPG_ERR_UNKNOWN_ALGORITHM;
+      break;
+    }
+
+  if (ec)
+    xfree (hd);
+  else
+    *r_hd = hd;
+  return ec;
+}
+
+
+/* Run the KDF of HD.  OPS may provide functions to run parts of the
+   computation concurrently.  */
+gpg_err_code_t
+_gcry_kdf_compute (gcry_kdf_hd_t hd, const struct gcry_kdf_thread_ops *ops)
+{
+  if (!hd)
+    return GPG_ERR_INV_ARG;
+  if (ops && (!ops->dispatch_job || !ops->wait_all_jobs))
+    return GPG_ERR_INV_ARG;
+
+  switch (hd->algo)
+    {
+#ifdef HAVE_U64_TYPEDEF
+    case GCRY_KDF_ARGON2:
+      return argon2_compute (hd->u.argon2, ops);
+#endif
+    default:
+      return GPG_ERR_UNKNOWN_ALGORITHM;
+    }
+}
+
+
+/* Store the RESULTLEN bytes of the derived key of HD at RESULT.  */
+gpg_err_code_t
+_gcry_kdf_final (gcry_kdf_hd_t hd, size_t resultlen, void *result)
+{
+  if (!hd)
+    return GPG_ERR_INV_ARG;
+
+  switch (hd->algo)
+    {
+#ifdef HAVE_U64_TYPEDEF
+    case GCRY_KDF_ARGON2:
+      return argon2_final (hd->u.argon2, resultlen, result);
+#endif
+    default:
+      return GPG_ERR_UNKNOWN_ALGORITHM;
+    }
+}
+
+
+/* Release HD and wipe its memory.  */
+void
+_gcry_kdf_close (gcry_kdf_hd_t hd)
+{
+  if (!hd)
+    return;
+
+  switch (hd->algo)
+    {
+#ifdef HAVE_U64_TYPEDEF
+    case GCRY_KDF_ARGON2:
+      argon2_close (hd->u.argon2);
+      break;
+#endif
+    default:
+      break;
+    }
+  xfree (hd);
+}
@@ -0,0 +1,156 @@
+/* keccak-avx2-4way.c - Four-way Keccak-f[1600] permutation using AVX2
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This applies the permutation to four independent states at once
+   with each 64 bit lane of the state in one quarter of a YMM register.
+   It is used by _gcry_sha3_hash_buffers_multi to hash many messages.
+   The lane complementing transform of the scalar code does not pay
+   off here because VPANDN computes the NOT of chi for free.  */
+
+#include <config.h>
+
+#include "types.h"
+#include "g10lib.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+
+/* Theta: compute the column parities of SRC into ymm10..ymm14 and the
+   values D[x] = C[x-1] ^ ROL(C[x+1], 1) into ymm0..ymm4.  */
+#define COLUMN(src, x)                                                  \
+  "vmovdqa (" #x "+0)*32(" src "), %%ymm1" #x "\n\t"                    \
+  "vpxor (" #x "+5)*32(" src "), %%ymm1" #x ", %%ymm1" #x "\n\t"        \
+  "vpxor (" #x "+10)*32(" src "), %%ymm1" #x ", %%ymm1" #x "\n\t"       \
+  "vpxor (" #x "+15)*32(" src "), %%ymm1" #x ", %%ymm1" #x "\n\t"       \
+  "vpxor (" #x "+20)*32(" src "), %%ymm1" #x ", %%ymm1" #x "\n\t"
+
+#define DVAL(x, cm1, cp1)                                               \
+  "vpsrlq $63, %%ymm1" #cp1 ", %%ymm15\n\t"                             \
+  "vpaddq %%ymm1" #cp1 ", %%ymm1" #cp1 ", %%ymm" #x "\n\t"              \
+  "vpor %%ymm15, %%ymm" #x ", %%ymm" #x "\n\t"                          \
+  "vpxor %%ymm1" #cm1 ", %%ymm" #x ", %%ymm" #x "\n\t"
+
+#define THETA(src)                                                      \
+  COLUMN(src, 0) COLUMN(src, 1) COLUMN(src, 2)                          \
+  COLUMN(src, 3) COLUMN(src, 4)                                         \
+  DVAL(0, 4, 1) DVAL(1, 0, 2) DVAL(2, 1, 3)                             \
+  DVAL(3, 2, 4) DVAL(4, 3, 0)
+
+/* Rho and pi: load lane I of SRC, add D[X] and rotate it by R into
+   register B.  */
+#define LANE(src, i, x, r, b)                                           \
+  "vpxor " #i "*32(" src "), %%ymm" #x ", %%ymm" #b "\n\t"              \
+  "vpsllq $" #r ", %%ymm" #b ", %%ymm15\n\t"                            \
+  "vpsrlq $64-" #r ", %%ymm" #b ", %%ymm" #b "\n\t"                     \
+  "vpor %%ymm15, %%ymm" #b ", %%ymm" #b "\n\t"
+
+/* Chi: store B[X] ^ (~B[X+1] & B[X+2]) at lane X of row Y of DST.  */
+#define CHI(dst, y, x, b0, b1, b2)                                      \
+  "vpandn %%ymm" #b2 ", %%ymm" #b1 ", %%ymm10\n\t"                      \
+  "vpxor %%ymm" #b0 ", %%ymm10, %%ymm10\n\t"                            \
+  "vmovdqa %%ymm10, (" #x "+5*" #y ")*32(" dst ")\n\t"
+
+#define CHI_ROW(dst, y)                                                 \
+  CHI(dst, y, 0, 5, 6, 7) CHI(dst, y, 1, 6, 7, 8)                       \
+  CHI(dst, y, 2, 7, 8, 9) CHI(dst, y, 3, 8, 9, 5)                       \
+  CHI(dst, y, 4, 9, 5, 6)
+
+/* Output row Y takes lane X from column (X + 3Y) mod 5 of input row X;
+   the rotation counts are those of the input lanes.  Row 0 also adds
+   the round constant at RC to lane (0,0).  */
+#define ROUND(src, dst, rc)                                             \
+  THETA(src)                                                            \
+  "vpxor 0*32(" src "), %%ymm0, %%ymm5\n\t"                             \
+  LANE(src,  6, 1, 44, 6) LANE(src, 12, 2, 43, 7)                       \
+  LANE(src, 18, 3, 21, 8) LANE(src, 24, 4, 14, 9)                       \
+  "vpandn %%ymm7, %%ymm6, %%ymm10\n\t"                                  \
+  "vpbroadcastq " rc ", %%ymm11\n\t"                                    \
+  "vpxor %%ymm5, %%ymm10, %%ymm10\n\t"                                  \
+  "vpxor %%ymm11, %%ymm10, %%ymm10\n\t"                                 \
+  "vmovdqa %%ymm10, 0*32(" dst ")\n\t"                                  \
+  CHI(dst, 0, 1, 6, 7, 8) CHI(dst, 0, 2, 7, 8, 9)                       \
+  CHI(dst, 0, 3, 8, 9, 5) CHI(dst, 0, 4, 9, 5, 6)                       \
+                                                                        \
+  LANE(src,  3, 3, 28, 5) LANE(src,  9, 4, 20, 6)                       \
+  LANE(src, 10, 0,  3, 7) LANE(src, 16, 1, 45, 8)                       \
+  LANE(src, 22, 2, 61, 9)                                               \
+  CHI_ROW(dst, 1)                                                       \
+                                                                        \
+  LANE(src,  1, 1,  1, 5) LANE(src,  7, 2,  6, 6)                       \
+  LANE(src, 13, 3, 25, 7) LANE(src, 19, 4,  8, 8)                       \
+  LANE(src, 20, 0, 18, 9)                                               \
+  CHI_ROW(dst, 2)                                                       \
+                                                                        \
+  LANE(src,  4, 4, 27, 5) LANE(src,  5, 0, 36, 6)                       \
+  LANE(src, 11, 1, 10, 7) LANE(src, 17, 2, 15, 8)                       \
+  LANE(src, 23, 3, 56, 9)                                               \
+  CHI_ROW(dst, 3)                                                       \
+                                                                        \
+  LANE(src,  2, 2, 62, 5) LANE(src,  8, 3, 55, 6)                       \
+  LANE(src, 14, 4, 39, 7) LANE(src, 15, 0, 41, 8)                       \
+  LANE(src, 21, 1,  2, 9)                                               \
+  CHI_ROW(dst, 4)
+
+static const u64 RC[24] __attribute__ ((aligned (64))) =
+  {
+    U64_C(0x0000000000000001), U64_C(0x0000000000008082),
+    U64_C(0x800000000000808A), U64_C(0x8000000080008000),
+    U64_C(0x000000000000808B), U64_C(0x0000000080000001),
+    U64_C(0x8000000080008081), U64_C(0x8000000000008009),
+    U64_C(0x000000000000008A), U64_C(0x0000000000000088),
+    U64_C(0x0000000080008009), U64_C(0x000000008000000A),
+    U64_C(0x000000008000808B), U64_C(0x800000000000008B),
+    U64_C(0x8000000000008089), U64_C(0x8000000000008003),
+    U64_C(0x8000000000008002), U64_C(0x8000000000000080),
+    U64_C(0x000000000000800A), U64_C(0x800000008000000A),
+    U64_C(0x8000000080008081), U64_C(0x8000000000008080),
+    U64_C(0x0000000080000001), U64_C(0x8000000080008008)
+  };
+
+/* Apply Keccak-f[1600] to four interleaved states.  Lane I of state J
+   is at STATE[I * 4 + J]; STATE must be aligned to 32 bytes.  */
+void
+_gcry_keccak_f1600_avx2_4way (u64 *state)
+{
+  u64 tmp[25 * 4] __attribute__ ((aligned (32)));
+  const u64 *rc = RC;
+
+  asm volatile ("movl $12, %%eax\n\t"
+                ".Lround%=:\n\t"
+                ROUND("%[s]", "%[t]", "0(%[rc])")
+                ROUND("%[t]", "%[s]", "8(%[rc])")
+                "addq $16, %[rc]\n\t"
+                "decl %%eax\n\t"
+                "jnz .Lround%=\n\t"
+
+                /* Clear the registers and the temporary state.  */
+                "vzeroall\n\t"
+                "xorl %%eax, %%eax\n\t"
+                ".Lwipe%=:\n\t"
+                "vmovdqa %%ymm0, (%[t],%%rax)\n\t"
+                "addq $32, %%rax\n\t"
+                "cmpq $25*32, %%rax\n\t"
+                "jb .Lwipe%=\n\t"
+                : [rc] "+r" (rc)
+                : [s] "r" (state),
+                  [t] "r" (tmp)
+                : "rax", "cc", "memory");
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_AVX2 */
@@ -0,0 +1,816 @@
+/* keccak.c - SHA-3 hash functions and the SHAKE extendable-output functions
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  Implemented from FIPS 202, "SHA-3 Standard: Permutation-Based Hash
+    and Extendable-Output Functions".
+
+    The Keccak-f[1600] permutation uses the lane complementing
+    transform described in the Keccak implementation overview: six of
+    the 25 lanes are kept inverted while the permutation runs, which
+    reduces the number of NOT operations in the chi step from 25 to 5
+    per round.
+
+    Test vectors:
+
+    "abc"
+    SHA3-224: e642824c 3f8cf24a d09234ee 7d3c766f c9a3a516 8d0c94ad
+              73b46fdf
+    SHA3-256: 3a985da7 4fe225b2 045c172d 6bd390bd 855f086e 3e9d525b
+              46bfe245 11431532
+
+    "a" one million times
+    SHA3-224: d69335b9 3325192e 516a912e 6d19a15c b51c6ed5 c15243e7
+              a7fd653c
+    SHA3-256: 5c8875ae 474a3634 ba4fd55e c85bffd6 61f32aca 75c6d699
+              d0cdcb6c 115891c1
+ */
+
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "g10lib.h"
+#include "bithelp.h"
+#include "bufhelp.h"
+#include "cipher.h"
+#include "hash-common.h"
+
+
+/* USE_AVX2_MULTI indicates whether to compile with the four-way AVX2
+   code for hashing independent messages.  */
+#undef USE_AVX2_MULTI
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+# define USE_AVX2_MULTI 1
+#endif
+
+
+typedef struct
+{
+  u64 state[25];          /* Lane (x,y) is stored at index x + 5*y.  */
+  unsigned int blocksize; /* The rate in bytes.  */
+  unsigned int count;     /* Bytes absorbed into or squeezed out of the
+                             current block.  */
+  unsigned int outlen;    /* Digest length in bytes; 0 for SHAKE.  */
+  byte suffix;            /* Domain separation bits and first padding
+                             bit.  */
+} KECCAK_CONTEXT;
+
+
+static const u64 round_consts[24] =
+  {
+    U64_C(0x0000000000000001), U64_C(0x0000000000008082),
+    U64_C(0x800000000000808A), U64_C(0x8000000080008000),
+    U64_C(0x000000000000808B), U64_C(0x0000000080000001),
+    U64_C(0x8000000080008081), U64_C(0x8000000000008009),
+    U64_C(0x000000000000008A), U64_C(0x0000000000000088),
+    U64_C(0x0000000080008009), U64_C(0x000000008000000A),
+    U64_C(0x000000008000808B), U64_C(0x800000000000008B),
+    U64_C(0x8000000000008089), U64_C(0x8000000000008003),
+    U64_C(0x8000000000008002), U64_C(0x8000000000000080),
+    U64_C(0x000000000000800A), U64_C(0x800000008000000A),
+    U64_C(0x8000000080008081), U64_C(0x8000000000008080),
+    U64_C(0x0000000080000001), U64_C(0x8000000080008008)
+  };
+
+
+#define ROL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+/* One round of Keccak-f[1600] from the lanes A to the lanes E.  The
+   lanes are named after their position: the first letter gives the
+   row (b, g, k, m, s for y = 0..4) and the second the column (a, e, i,
+   o, u for x = 0..4).  The lanes Abe, Abi, Ago, Aki, Ami and Asa are
+   complemented on input and the lanes Ebe, Ebi, Ego, Eki, Emi and Esa
+   are complemented on output.  */
+#define KECCAK_ROUND(A, E, rc)                                          \
+  do                                                                    \
+    {                                                                   \
+      Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa;                       \
+      Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se;                       \
+      Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si;                       \
+      Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so;                       \
+      Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su;                       \
+      Da = Cu ^ ROL64 (Ce, 1);                                          \
+      De = Ca ^ ROL64 (Ci, 1);                                          \
+      Di = Ce ^ ROL64 (Co, 1);                                          \
+      Do = Ci ^ ROL64 (Cu, 1);                                          \
+      Du = Co ^ ROL64 (Ca, 1);                                          \
+                                                                        \
+      B0 = A##ba ^ Da;                                                  \
+      B1 = A##ge ^ De; B1 = ROL64 (B1, 44);                             \
+      B2 = A##ki ^ Di; B2 = ROL64 (B2, 43);                             \
+      B3 = A##mo ^ Do; B3 = ROL64 (B3, 21);                             \
+      B4 = A##su ^ Du; B4 = ROL64 (B4, 14);                             \
+      E##ba = B0 ^ (B1 | B2) ^ (rc);                                    \
+      E##be = B1 ^ (~B2 | B3);                                          \
+      E##bi = B2 ^ (B3 & B4);                                           \
+      E##bo = B3 ^ (B4 | B0);                                           \
+      E##bu = B4 ^ (B0 & B1);                                           \
+                                                                        \
+      B0 = A##bo ^ Do; B0 = ROL64 (B0, 28);                             \
+      B1 = A##gu ^ Du; B1 = ROL64 (B1, 20);                             \
+      B2 = A##ka ^ Da; B2 = ROL64 (B2, 3);                              \
+      B3 = A##me ^ De; B3 = ROL64 (B3, 45);                             \
+      B4 = A##si ^ Di; B4 = ROL64 (B4, 61);                             \
+      E##ga = B0 ^ (B1 | B2);                                           \
+      E##ge = B1 ^ (B2 & B3);                                           \
+      E##gi = B2 ^ (B3 | ~B4);                                          \
+      E##go = B3 ^ (B4 | B0);                                           \
+      E##gu = B4 ^ (B0 & B1);                                           \
+                                                                        \
+      B0 = A##be ^ De; B0 = ROL64 (B0, 1);                              \
+      B1 = A##gi ^ Di; B1 = ROL64 (B1, 6);                              \
+      B2 = A##ko ^ Do; B2 = ROL64 (B2, 25);                             \
+      B3 = A##mu ^ Du; B3 = ROL64 (B3, 8);                              \
+      B4 = A##sa ^ Da; B4 = ROL64 (B4, 18);                             \
+      E##ka = B0 ^ (B1 | B2);                                           \
+      E##ke = B1 ^ (B2 & B3);                                           \
+      E##ki = B2 ^ (~B3 & B4);                                          \
+      E##ko = ~B3 ^ (B4 | B0);                                          \
+      E##ku = B4 ^ (B0 & B1);                                           \
+                                                                        \
+      B0 = A##bu ^ Du; B0 = ROL64 (B0, 27);                             \
+      B1 = A##ga ^ Da; B1 = ROL64 (B1, 36);                             \
+      B2 = A##ke ^ De; B2 = ROL64 (B2, 10);                             \
+      B3 = A##mi ^ Di; B3 = ROL64 (B3, 15);                             \
+      B4 = A##so ^ Do; B4 = ROL64 (B4, 56);                             \
+      E##ma = B0 ^ (B1 & B2);                                           \
+      E##me = B1 ^ (B2 | B3);                                           \
+      E##mi = B2 ^ (~B3 | B4);                                          \
+      E##mo = ~B3 ^ (B4 & B0);                                          \
+      E##mu = B4 ^ (B0 | B1);                                           \
+                                                                        \
+      B0 = A##bi ^ Di; B0 = ROL64 (B0, 62);                             \
+      B1 = A##go ^ Do; B1 = ROL64 (B1, 55);                             \
+      B2 = A##ku ^ Du; B2 = ROL64 (B2, 39);                             \
+      B3 = A##ma ^ Da; B3 = ROL64 (B3, 41);                             \
+      B4 = A##se ^ De; B4 = ROL64 (B4, 2);                              \
+      E##sa = B0 ^ (~B1 & B2);                                          \
+      E##se = ~B1 ^ (B2 | B3);                                          \
+      E##si = B2 ^ (B3 & B4);                                           \
+      E##so = B3 ^ (B4 | B0);                                           \
+      E##su = B4 ^ (B0 & B1);                                           \
+    }                                                                   \
+  while (0)
+
+
+/* Apply Keccak-f[1600] to the 25 lanes at STATE.  Returns the number
+   of stack bytes to burn.  */
+static unsigned int
+keccak_f1600 (u64 *state)
+{
+  u64 Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu;
+  u64 Aka, Ake, Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu;
+  u64 Asa, Ase, Asi, Aso, Asu;
+  u64 Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu;
+  u64 Eka, Eke, Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu;
+  u64 Esa, Ese, Esi, Eso, Esu;
+  u64 Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+  u64 B0, B1, B2, B3, B4;
+  int round;
+
+  Aba =  state[0];  Abe = ~state[1];  Abi = ~state[2];
+  Abo =  state[3];  Abu =  state[4];  Aga =  state[5];
+  Age =  state[6];  Agi =  state[7];  Ago = ~state[8];
+  Agu =  state[9];  Aka =  state[10]; Ake =  state[11];
+  Aki = ~state[12]; Ako =  state[13]; Aku =  state[14];
+  Ama =  state[15]; Ame =  state[16]; Ami = ~state[17];
+  Amo =  state[18]; Amu =  state[19]; Asa = ~state[20];
+  Ase =  state[21]; Asi =  state[22]; Aso =  state[23];
+  Asu =  state[24];
+
+  for (round = 0; round < 24; round += 2)
+    {
+      KECCAK_ROUND (A, E, round_consts[round]);
+      KECCAK_ROUND (E, A, round_consts[round + 1]);
+    }
+
+  state[0]  =  Aba; state[1]  = ~Abe; state[2]  = ~Abi;
+  state[3]  =  Abo; state[4]  =  Abu; state[5]  =  Aga;
+  state[6]  =  Age; state[7]  =  Agi; state[8]  = ~Ago;
+  state[9]  =  Agu; state[10] =  Aka; state[11] =  Ake;
+  state[12] = ~Aki; state[13] =  Ako; state[14] =  Aku;
+  state[15] =  Ama; state[16] =  Ame; state[17] = ~Ami;
+  state[18] =  Amo; state[19] =  Amu; state[20] = ~Asa;
+  state[21] =  Ase; state[22] =  Asi; state[23] =  Aso;
+  state[24] =  Asu;
+
+  return 70 * sizeof (u64) + 4 * sizeof (void *);
+}
+
+
+static void
+keccak_init (int algo, void *context, unsigned int flags)
+{
+  KECCAK_CONTEXT *ctx = context;
+
+  (void)flags;
+
+  memset (ctx, 0, sizeof *ctx);
+
+  switch (algo)
+    {
+    case GCRY_MD_SHA3_224:
+      ctx->blocksize = 1152 / 8;
+      ctx->outlen = 224 / 8;
+      break;
+    case GCRY_MD_SHA3_256:
+      ctx->blocksize = 1088 / 8;
+      ctx->outlen = 256 / 8;
+      break;
+    case GCRY_MD_SHA3_384:
+      ctx->blocksize = 832 / 8;
+      ctx->outlen = 384 / 8;
+      break;
+    case GCRY_MD_SHA3_512:
+      ctx->blocksize = 576 / 8;
+      ctx->outlen = 512 / 8;
+      break;
+    case GCRY_MD_SHAKE128:
+      ctx->blocksize = 1344 / 8;
+      break;
+    case GCRY_MD_SHAKE256:
+      ctx->blocksize = 1088 / 8;
+      break;
+    default:
+      BUG ();
+    }
+
+  /* SHA-3 appends the bits 01 to the message, SHAKE the bits 1111;
+     both are followed by the first bit of the pad10*1 padding.  */
+  ctx->suffix = ctx->outlen ? 0x06 : 0x1f;
+}
+
+static void
+sha3_224_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHA3_224, context, flags);
+}
+
+static void
+sha3_256_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHA3_256, context, flags);
+}
+
+static void
+sha3_384_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHA3_384, context, flags);
+}
+
+static void
+sha3_512_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHA3_512, context, flags);
+}
+
+static void
+shake128_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHAKE128, context, flags);
+}
+
+static void
+shake256_init (void *context, unsigned int flags)
+{
+  keccak_init (GCRY_MD_SHAKE256, context, flags);
+}
+
+
+/* Absorb INLEN bytes from INBUF into the state.  */
+static void
+keccak_write (void *context, const void *inbuf_arg, size_t inlen)
+{
+  KECCAK_CONTEXT *ctx = context;
+  const byte *inbuf = inbuf_arg;
+  unsigned int bsize = ctx->blocksize;
+  unsigned int pos = ctx->count;
+  unsigned int nburn = 0;
+
+  /* Fill up a partial lane.  */
+  for (; inlen && (pos % 8); inlen--)
+    {
+      ctx->state[pos / 8] ^= (u64)*inbuf++ << (8 * (pos % 8));
+      if (++pos == bsize)
+        {
+          nburn = keccak_f1600 (ctx->state);
+          pos = 0;
+        }
+    }
+
+  /* Absorb complete lanes.  */
+  for (; inlen >= 8; inlen -= 8, inbuf += 8)
+    {
+      ctx->state[pos / 8] ^= buf_get_le64 (inbuf);
+      pos += 8;
+      if (pos == bsize)
+        {
+          nburn = keccak_f1600 (ctx->state);
+          pos = 0;
+        }
+    }
+
+  /* Absorb the remaining bytes; they do not fill a lane.  */
+  for (; inlen; inlen--, pos++)
+    ctx->state[pos / 8] ^= (u64)*inbuf++ << (8 * (pos % 8));
+
+  ctx->count = pos;
+
+  if (nburn)
+    _gcry_burn_stack (nburn);
+}
+
+
+/* Pad the message and run the permutation for the last time.  For
+   SHA-3 the state is converted to little endian byte order so that
+   keccak_read can return it as the digest; for SHAKE the output is
+   squeezed out by keccak_extract.  */
+static void
+keccak_final (void *context)
+{
+  KECCAK_CONTEXT *ctx = context;
+  unsigned int pos = ctx->count;
+  unsigned int nburn;
+  unsigned int i;
+
+  ctx->state[pos / 8] ^= (u64)ctx->suffix << (8 * (pos % 8));
+  ctx->state[ctx->blocksize / 8 - 1] ^= U64_C(0x8000000000000000);
+
+  nburn = keccak_f1600 (ctx->state);
+  ctx->count = 0;
+
+  for (i = 0; i < (ctx->outlen + 7) / 8; i++)
+    buf_put_le64 (&ctx->state[i], ctx->state[i]);
+
+  _gcry_burn_stack (nburn);
+}
+
+
+static byte *
+keccak_read (void *context)
+{
+  KECCAK_CONTEXT *ctx = context;
+
+  return (byte *)ctx->state;
+}
+
+
+/* Squeeze OUTLEN bytes out of the finalized state of a SHAKE context.
+   Consecutive calls continue the output stream.  */
+static void
+keccak_extract (void *context, void *out_arg, size_t outlen)
+{
+  KECCAK_CONTEXT *ctx = context;
+  byte *out = out_arg;
+  unsigned int bsize = ctx->blocksize;
+  unsigned int pos = ctx->count;
+  unsigned int nburn = 0;
+
+  while (outlen)
+    {
+      if (pos == bsize)
+        {
+          nburn = keccak_f1600 (ctx->state);
+          pos = 0;
+        }
+
+      if (!(pos % 8) && outlen >= 8)
+        {
+          buf_put_le64 (out, ctx->state[pos / 8]);
+          out += 8;
+          outlen -= 8;
+          pos += 8;
+        }
+      else
+        {
+          *out++ = ctx->state[pos / 8] >> (8 * (pos % 8));
+          outlen--;
+          pos++;
+        }
+    }
+
+  ctx->count = pos;
+
+  if (nburn)
+    _gcry_burn_stack (nburn);
+}
+
+
+
+#ifdef USE_AVX2_MULTI
+void _gcry_keccak_f1600_avx2_4way (u64 *state);
+
+/* Hash the IOVCNT messages in IOV four at a time with the AVX2
+   permutation.  Lane I of message J is kept at STATE[I * 4 + J].  A
+   slot which finished its message is refilled with the next one so
+   that messages of different lengths keep all four slots busy.  */
+static void
+keccak_hash_buffers_avx2 (byte *out, KECCAK_CONTEXT *proto,
+                          const gcry_buffer_t *iov, int iovcnt)
+{
+  u64 state[25 * 4] __attribute__ ((aligned (32)));
+  struct
+  {
+    int idx;            /* Index of the message or -1.  */
+    const byte *data;   /* Data not yet absorbed.  */
+    size_t len;         /* Length of DATA.  */
+  } slot[4];
+  byte tail[168];
+  unsigned int bsize = proto->blocksize;
+  unsigned int outlen = proto->outlen;
+  unsigned int i, j, nactive;
+  int next = 0;
+
+  for (j = 0; j < 4; j++)
+    slot[j].idx = -1;
+
+  for (;;)
+    {
+      nactive = 0;
+      for (j = 0; j < 4; j++)
+        {
+          if (slot[j].idx < 0 && next < iovcnt)
+            {
+              slot[j].idx = next;
+              slot[j].data = (const byte *)iov[next].data + iov[next].off;
+              slot[j].len = iov[next].len;
+              for (i = 0; i < 25; i++)
+                state[i * 4 + j] = 0;
+              next++;
+            }
+
+          if (slot[j].idx < 0)
+            continue;
+
+          nactive++;
+          if (slot[j].len >= bsize)
+            {
+              for (i = 0; i < bsize / 8; i++)
+                state[i * 4 + j] ^= buf_get_le64 (slot[j].data + i * 8);
+              slot[j].data += bsize;
+              slot[j].len -= bsize;
+            }
+          else
+            {
+              /* Absorb the padded last block.  */
+              memcpy (tail, slot[j].data, slot[j].len);
+              memset (tail + slot[j].len, 0, bsize - slot[j].len);
+              tail[slot[j].len] = proto->suffix;
+              tail[bsize - 1] |= 0x80;
+              for (i = 0; i < bsize / 8; i++)
+                state[i * 4 + j] ^= buf_get_le64 (tail + i * 8);
+              slot[j].len = (size_t)-1;
+            }
+        }
+
+      if (!nactive)
+        break;
+
+      _gcry_keccak_f1600_avx2_4way (state);
+
+      for (j = 0; j < 4; j++)
+        if (slot[j].idx >= 0 && slot[j].len == (size_t)-1)
+          {
+            for (i = 0; i < outlen / 8; i++)
+              buf_put_le64 (out + slot[j].idx * outlen + i * 8,
+                            state[i * 4 + j]);
+            if (outlen % 8)
+              buf_put_le32 (out + slot[j].idx * outlen + i * 8,
+                            (u32)state[i * 4 + j]);
+            slot[j].idx = -1;
+          }
+    }
+
+  wipememory (state, sizeof state);
+  wipememory (tail, sizeof tail);
+}
+#endif /*USE_AVX2_MULTI*/
+
+
+/* Shortcut function to hash the IOVCNT independent messages in IOV
+   with the SHA-3 variant ALGO.  The digest of message I is stored at
+   OUTBUF + I * the digest length.  */
+void
+_gcry_sha3_hash_buffers_multi (int algo, void *outbuf,
+                               const gcry_buffer_t *iov, int iovcnt)
+{
+  unsigned char *out = outbuf;
+  KECCAK_CONTEXT hd;
+
+  keccak_init (algo, &hd, 0);
+
+#ifdef USE_AVX2_MULTI
+  if (iovcnt > 1 && (_gcry_get_hw_features () & HWF_INTEL_AVX2))
+    {
+      keccak_hash_buffers_avx2 (out, &hd, iov, iovcnt);
+      return;
+    }
+#endif
+
+  for (; iovcnt > 0; iov++, iovcnt--, out += hd.outlen)
+    {
+      keccak_init (algo, &hd, 0);
+      keccak_write (&hd, (const char*)iov[0].data + iov[0].off, iov[0].len);
+      keccak_final (&hd);
+      memcpy (out, hd.state, hd.outlen);
+    }
+  wipememory (&hd, sizeof hd);
+}
+
+
+
+/*
+     Self-test section.
+ */
+
+
+static gpg_err_code_t
+selftests_keccak (int algo, int extended, selftest_report_func_t report)
+{
+  const char *what;
+  const char *errtxt;
+  const char *short_hash;
+  const char *long_hash;
+  const char *one_million_a_hash;
+  int hash_len;
+
+  switch (algo)
+    {
+    case GCRY_MD_SHA3_224:
+      short_hash =
+        "\xe6\x42\x82\x4c\x3f\x8c\xf2\x4a\xd0\x92\x34\xee\x7d\x3c\x76\x6f"
+        "\xc9\xa3\xa5\x16\x8d\x0c\x94\xad\x73\xb4\x6f\xdf";
+      long_hash =
+        "\x8a\x24\x10\x8b\x15\x4a\xda\x21\xc9\xfd\x55\x74\x49\x44\x79\xba"
+        "\x5c\x7e\x7a\xb7\x6e\xf2\x64\xea\xd0\xfc\xce\x33";
+      one_million_a_hash =
+        "\xd6\x93\x35\xb9\x33\x25\x19\x2e\x51\x6a\x91\x2e\x6d\x19\xa1\x5c"
+        "\xb5\x1c\x6e\xd5\xc1\x52\x43\xe7\xa7\xfd\x65\x3c";
+      hash_len = 28;
+      break;
+
+    case GCRY_MD_SHA3_256:
+      short_hash =
+        "\x3a\x98\x5d\xa7\x4f\xe2\x25\xb2\x04\x5c\x17\x2d\x6b\xd3\x90\xbd"
+        "\x85\x5f\x08\x6e\x3e\x9d\x52\x5b\x46\xbf\xe2\x45\x11\x43\x15\x32";
+      long_hash =
+        "\x41\xc0\xdb\xa2\xa9\xd6\x24\x08\x49\x10\x03\x76\xa8\x23\x5e\x2c"
+        "\x82\xe1\xb9\x99\x8a\x99\x9e\x21\xdb\x32\xdd\x97\x49\x6d\x33\x76";
+      one_million_a_hash =
+        "\x5c\x88\x75\xae\x47\x4a\x36\x34\xba\x4f\xd5\x5e\xc8\x5b\xff\xd6"
+        "\x61\xf3\x2a\xca\x75\xc6\xd6\x99\xd0\xcd\xcb\x6c\x11\x58\x91\xc1";
+      hash_len = 32;
+      break;
+
+    case GCRY_MD_SHA3_384:
+      short_hash =
+        "\xec\x01\x49\x82\x88\x51\x6f\xc9\x26\x45\x9f\x58\xe2\xc6\xad\x8d"
+        "\xf9\xb4\x73\xcb\x0f\xc0\x8c\x25\x96\xda\x7c\xf0\xe4\x9b\xe4\xb2"
+        "\x98\xd8\x8c\xea\x92\x7a\xc7\xf5\x39\xf1\xed\xf2\x28\x37\x6d\x25";
+      long_hash =
+        "\x99\x1c\x66\x57\x55\xeb\x3a\x4b\x6b\xbd\xfb\x75\xc7\x8a\x49\x2e"
+        "\x8c\x56\xa2\x2c\x5c\x4d\x7e\x42\x9b\xfd\xbc\x32\xb9\xd4\xad\x5a"
+        "\xa0\x4a\x1f\x07\x6e\x62\xfe\xa1\x9e\xef\x51\xac\xd0\x65\x7c\x22";
+      one_million_a_hash =
+        "\xee\xe9\xe2\x4d\x78\xc1\x85\x53\x37\x98\x34\x51\xdf\x97\xc8\xad"
+        "\x9e\xed\xf2\x56\xc6\x33\x4f\x8e\x94\x8d\x25\x2d\x5e\x0e\x76\x84"
+        "\x7a\xa0\x77\x4d\xdb\x90\xa8\x42\x19\x0d\x2c\x55\x8b\x4b\x83\x40";
+      hash_len = 48;
+      break;
+
+    case GCRY_MD_SHA3_512:
+      short_hash =
+        "\xb7\x51\x85\x0b\x1a\x57\x16\x8a\x56\x93\xcd\x92\x4b\x6b\x09\x6e"
+        "\x08\xf6\x21\x82\x74\x44\xf7\x0d\x88\x4f\x5d\x02\x40\xd2\x71\x2e"
+        "\x10\xe1\x16\xe9\x19\x2a\xf3\xc9\x1a\x7e\xc5\x76\x47\xe3\x93\x40"
+        "\x57\x34\x0b\x4c\xf4\x08\xd5\xa5\x65\x92\xf8\x27\x4e\xec\x53\xf0";
+      long_hash =
+        "\x04\xa3\x71\xe8\x4e\xcf\xb5\xb8\xb7\x7c\xb4\x86\x10\xfc\xa8\x18"
+        "\x2d\xd4\x57\xce\x6f\x32\x6a\x0f\xd3\xd7\xec\x2f\x1e\x91\x63\x6d"
+        "\xee\x69\x1f\xbe\x0c\x98\x53\x02\xba\x1b\x0d\x8d\xc7\x8c\x08\x63"
+        "\x46\xb5\x33\xb4\x9c\x03\x0d\x99\xa2\x7d\xaf\x11\x39\xd6\xe7\x5e";
+      one_million_a_hash =
+        "\x3c\x3a\x87\x6d\xa1\x40\x34\xab\x60\x62\x7c\x07\x7b\xb9\x8f\x7e"
+        "\x12\x0a\x2a\x53\x70\x21\x2d\xff\xb3\x38\x5a\x18\xd4\xf3\x88\x59"
+        "\xed\x31\x1d\x0a\x9d\x51\x41\xce\x9c\xc5\xc6\x6e\xe6\x89\xb2\x66"
+        "\xa8\xaa\x18\xac\xe8\x28\x2a\x0e\x0d\xb5\x96\xc9\x0b\x0a\x7b\x87";
+      hash_len = 64;
+      break;
+
+    case GCRY_MD_SHAKE128:
+      short_hash =
+        "\x58\x81\x09\x2d\xd8\x18\xbf\x5c\xf8\xa3\xdd\xb7\x93\xfb\xcb\xa7"
+        "\x40\x97\xd5\xc5\x26\xa6\xd3\x5f\x97\xb8\x33\x51\x94\x0f\x2c\xc8";
+      long_hash =
+        "\x1a\x96\x18\x2b\x50\xfb\x8c\x7e\x74\xe0\xa7\x07\x78\x8f\x55\xe9"
+        "\x82\x09\xb8\xd9\x1f\xad\xe8\xf3\x2f\x8d\xd5\xcf\xf7\xbf\x21\xf5";
+      one_million_a_hash =
+        "\x9d\x22\x2c\x79\xc4\xff\x9d\x09\x2c\xf6\xca\x86\x14\x3a\xa4\x11"
+        "\xe3\x69\x97\x38\x08\xef\x97\x09\x32\x55\x82\x6c\x55\x72\xef\x58";
+      hash_len = 32;
+      break;
+
+    case GCRY_MD_SHAKE256:
+      short_hash =
+        "\x48\x33\x66\x60\x13\x60\xa8\x77\x1c\x68\x63\x08\x0c\xc4\x11\x4d"
+        "\x8d\xb4\x45\x30\xf8\xf1\xe1\xee\x4f\x94\xea\x37\xe7\x8b\x57\x39"
+        "\xd5\xa1\x5b\xef\x18\x6a\x53\x86\xc7\x57\x44\xc0\x52\x7e\x1f\xaa"
+        "\x9f\x87\x26\xe4\x62\xa1\x2a\x4f\xeb\x06\xbd\x88\x01\xe7\x51\xe4";
+      long_hash =
+        "\x4d\x8c\x2d\xd2\x43\x5a\x01\x28\xee\xfb\xb8\xc3\x6f\x6f\x87\x13"
+        "\x3a\x79\x11\xe1\x8d\x97\x9e\xe1\xae\x6b\xe5\xd4\xfd\x2e\x33\x29"
+        "\x40\xd8\x68\x8a\x4e\x6a\x59\xaa\x80\x60\xf1\xf9\xbc\x99\x6c\x05"
+        "\xac\xa3\xc6\x96\xa8\xb6\x62\x79\xdc\x67\x2c\x74\x0b\xb2\x24\xec";
+      one_million_a_hash =
+        "\x35\x78\xa7\xa4\xca\x91\x37\x56\x9c\xdf\x76\xed\x61\x7d\x31\xbb"
+        "\x99\x4f\xca\x9c\x1b\xbf\x8b\x18\x40\x13\xde\x82\x34\xdf\xd1\x3a"
+        "\x3f\xd1\x24\xd4\xdf\x76\xc0\xa5\x39\xee\x7d\xd2\xf6\xe1\xec\x34"
+        "\x61\x24\xc8\x15\xd9\x41\x0e\x14\x5e\xb5\x61\xbc\xd9\x7b\x18\xab";
+      hash_len = 64;
+      break;
+
+    default:
+      return GPG_ERR_DIGEST_ALGO;
+    }
+
+  what = "short string";
+  errtxt = _gcry_hash_selftest_check_one (algo, 0, "abc", 3, short_hash,
+                                          hash_len);
+  if (errtxt)
+    goto failed;
+
+  if (extended)
+    {
+      what = "long string";
+      errtxt = _gcry_hash_selftest_check_one
+        (algo, 0,
+         "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+         long_hash, hash_len);
+      if (errtxt)
+        goto failed;
+
+      what = "one million \"a\"";
+      errtxt = _gcry_hash_selftest_check_one (algo, 1, NULL, 0,
+                                              one_million_a_hash, hash_len);
+      if (errtxt)
+        goto failed;
+    }
+
+  return 0; /* Succeeded. */
+
+ failed:
+  if (report)
+    report ("digest", algo, what, errtxt);
+  return GPG_ERR_SELFTEST_FAILED;
+}
+
+
+/* Run a full self-test for ALGO and return 0 on success.  */
+static gpg_err_code_t
+run_selftests (int algo, int extended, selftest_report_func_t report)
+{
+  return selftests_keccak (algo, extended, report);
+}
+
+
+
+
+static byte sha3_224_asn[] = /* Object ID is 2.16.840.1.101.3.4.2.7 */
+  { 0x30, 0x2d, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48,
+    0x01, 0x65, 0x03, 0x04, 0x02, 0x07, 0x05, 0x00, 0x04,
+    0x1c };
+
+static gcry_md_oid_spec_t oid_spec_sha3_224[] =
+  {
+    { "2.16.840.1.101.3.4.2.7" },
+    /* PKCS#1 id-rsassa-pkcs1-v1_5-with-sha3-224 */
+    { "2.16.840.1.101.3.4.3.13" },
+    { NULL }
+  };
+
+static byte sha3_256_asn[] = /* Object ID is 2.16.840.1.101.3.4.2.8 */
+  { 0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48,
+    0x01, 0x65, 0x03, 0x04, 0x02, 0x08, 0x05, 0x00, 0x04,
+    0x20 };
+
+static gcry_md_oid_spec_t oid_spec_sha3_256[] =
+  {
+    { "2.16.840.1.101.3.4.2.8" },
+    /* PKCS#1 id-rsassa-pkcs1-v1_5-with-sha3-256 */
+    { "2.16.840.1.101.3.4.3.14" },
+    { NULL }
+  };
+
+static byte sha3_384_asn[] = /* Object ID is 2.16.840.1.101.3.4.2.9 */
+  { 0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48,
+    0x01, 0x65, 0x03, 0x04, 0x02, 0x09, 0x05, 0x00, 0x04,
+    0x30 };
+
+static gcry_md_oid_spec_t oid_spec_sha3_384[] =
+  {
+    { "2.16.840.1.101.3.4.2.9" },
+    /* PKCS#1 id-rsassa-pkcs1-v1_5-with-sha3-384 */
+    { "2.16.840.1.101.3.4.3.15" },
+    { NULL }
+  };
+
+static byte sha3_512_asn[] = /* Object ID is 2.16.840.1.101.3.4.2.10 */
+  { 0x30, 0x51, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48,
+    0x01, 0x65, 0x03, 0x04, 0x02, 0x0a, 0x05, 0x00, 0x04,
+    0x40 };
+
+static gcry_md_oid_spec_t oid_spec_sha3_512[] =
+  {
+    { "2.16.840.1.101.3.4.2.10" },
+    /* PKCS#1 id-rsassa-pkcs1-v1_5-with-sha3-512 */
+    { "2.16.840.1.101.3.4.3.16" },
+    { NULL }
+  };
+
+static gcry_md_oid_spec_t oid_spec_shake128[] =
+  {
+    { "2.16.840.1.101.3.4.2.11" },
+    { NULL }
+  };
+
+static gcry_md_oid_spec_t oid_spec_shake256[] =
+  {
+    { "2.16.840.1.101.3.4.2.12" },
+    { NULL }
+  };
+
+
+gcry_md_spec_t _gcry_digest_spec_sha3_224 =
+  {
+    GCRY_MD_SHA3_224, {0, 0},
+    "SHA3-224", sha3_224_asn, DIM (sha3_224_asn), oid_spec_sha3_224, 28,
+    sha3_224_init, keccak_write, keccak_final, keccak_read,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests
+  };
+
+gcry_md_spec_t _gcry_digest_spec_sha3_256 =
+  {
+    GCRY_MD_SHA3_256, {0, 0},
+    "SHA3-256", sha3_256_asn, DIM (sha3_256_asn), oid_spec_sha3_256, 32,
+    sha3_256_init, keccak_write, keccak_final, keccak_read,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests
+  };
+
+gcry_md_spec_t _gcry_digest_spec_sha3_384 =
+  {
+    GCRY_MD_SHA3_384, {0, 0},
+    "SHA3-384", sha3_384_asn, DIM (sha3_384_asn), oid_spec_sha3_384, 48,
+    sha3_384_init, keccak_write, keccak_final, keccak_read,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests
+  };
+
+gcry_md_spec_t _gcry_digest_spec_sha3_512 =
+  {
+    GCRY_MD_SHA3_512, {0, 0},
+    "SHA3-512", sha3_512_asn, DIM (sha3_512_asn), oid_spec_sha3_512, 64,
+    sha3_512_init, keccak_write, keccak_final, keccak_read,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests
+  };
+
+gcry_md_spec_t _gcry_digest_spec_shake128 =
+  {
+    GCRY_MD_SHAKE128, {0, 0},
+    "SHAKE128", NULL, 0, oid_spec_shake128, 0,
+    shake128_init, keccak_write, keccak_final, NULL,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests,
+    keccak_extract
+  };
+
+gcry_md_spec_t _gcry_digest_spec_shake256 =
+  {
+    GCRY_MD_SHAKE256, {0, 0},
+    "SHAKE256", NULL, 0, oid_spec_shake256, 0,
+    shake256_init, keccak_write, keccak_final, NULL,
+    sizeof (KECCAK_CONTEXT),
+    run_selftests,
+    keccak_extract
+  };
@@ -20,6 +20,9 @@
 /* The data object used to hold a handle to an encryption object.  */
 struct gcry_mac_handle;
 
+/* The Poly1305 context of a MAC handle (mac-poly1305.c).  */
+struct poly1305mac_context_s;
+
 
 /*
  *
@@ -106,6 +109,9 @@ struct gcry_mac_handle
       gcry_cipher_hd_t ctx;
       int cipher_algo;
     } gmac;
+    struct {
+      struct poly1305mac_context_s *ctx;
+    } poly1305mac;
   } u;
 };
 
@@ -202,3 +208,8 @@ extern gcry_mac_spec_t _gcry_mac_type_spec_gmac_seed;
 #if USE_CAMELLIA
 extern gcry_mac_spec_t _gcry_mac_type_spec_gmac_camellia;
 #endif
+
+/*
+ * The Poly1305 MAC algorithm specifications (mac-poly1305.c).
+ */
+extern gcry_mac_spec_t _gcry_mac_type_spec_poly1305mac;
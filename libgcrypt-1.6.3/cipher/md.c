@@ -52,6 +52,14 @@ static gcry_md_spec_t *digest_list[] =
      &_gcry_digest_spec_sha512,
      &_gcry_digest_spec_sha384,
 #endif
+#if USE_SHA3
+     &_gcry_digest_spec_sha3_224,
+     &_gcry_digest_spec_sha3_256,
+     &_gcry_digest_spec_sha3_384,
+     &_gcry_digest_spec_sha3_512,
+     &_gcry_digest_spec_shake128,
+     &_gcry_digest_spec_shake256,
+#endif
 #ifdef USE_GOST_R_3411_94
      &_gcry_digest_spec_gost3411_94,
 #endif
@@ -335,6 +343,18 @@ md_open (gcry_md_hd_t *h, int algo, unsigned int flags)
               case GCRY_MD_GOSTR3411_94:
                 ctx->macpads_Bsize = 32;
                 break;
+              case GCRY_MD_SHA3_224:
+                ctx->macpads_Bsize = 144;
+                break;
+              case GCRY_MD_SHA3_256:
+                ctx->macpads_Bsize = 136;
+                break;
+              case GCRY_MD_SHA3_384:
+                ctx->macpads_Bsize = 104;
+                break;
+              case GCRY_MD_SHA3_512:
+                ctx->macpads_Bsize = 72;
+                break;
               default:
                 ctx->macpads_Bsize = 64;
                 break;
@@ -410,6 +430,10 @@ md_enable (gcry_md_hd_t hd, int algorithm)
       err = GPG_ERR_DIGEST_ALGO;
     }
 
+  /* An extendable-output function has no fixed size digest which
+     could be used for HMAC.  */
+  if (!err && h->macpads && !spec->mdlen)
+    err = GPG_ERR_DIGEST_ALGO;
 
   if (!err && algorithm == GCRY_MD_MD5 && fips_mode ())
     {
@@ -783,7 +807,7 @@ _gcry_md_debug (gcry_md_hd_t hd, const char *suffix)
 
 /****************
  * If ALGO is null get the digest for the used algo (which should be
- * only one)
+ * only one).  Returns NULL for an extendable-output function.
  */
 static byte *
 md_read( gcry_md_hd_t a, int algo )
@@ -797,14 +821,14 @@ md_read( gcry_md_hd_t a, int algo )
         {
           if (r->next)
             log_debug ("more than one algorithm in md_read(0)\n");
-          return r->spec->read (&r->context.c);
+          return r->spec->read? r->spec->read (&r->context.c) : NULL;
         }
     }
   else
     {
       for (r = a->ctx->list; r; r = r->next)
 	if (r->spec->algo == algo)
-	  return r->spec->read (&r->context.c);
+	  return r->spec->read? r->spec->read (&r->context.c) : NULL;
     }
   BUG();
   return NULL;
@@ -826,6 +850,39 @@ _gcry_md_read (gcry_md_hd_t hd, int algo)
 }
 
 
+/*
+ * Read LENGTH bytes of output of the extendable-output function ALGO
+ * into BUFFER.  This implicitly finalizes the hash; further calls
+ * return the subsequent bytes of the output.  If ALGO is 0 the only
+ * enabled algorithm is used.
+ */
+gcry_err_code_t
+_gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer, size_t length)
+{
+  GcryDigestEntry *r;
+
+  if (!algo)
+    {
+      r = hd->ctx->list;
+      if (r && r->next)
+        return GPG_ERR_DIGEST_ALGO;
+    }
+  else
+    {
+      for (r = hd->ctx->list; r; r = r->next)
+        if (r->spec->algo == algo)
+          break;
+    }
+
+  if (!r || !r->spec->extract)
+    return GPG_ERR_DIGEST_ALGO;
+
+  md_final (hd);
+  r->spec->extract (&r->context.c, buffer, length);
+  return 0;
+}
+
+
 /*
  * Read out an intermediate digest.  Not yet functional.
  */
@@ -848,7 +905,7 @@ _gcry_md_get (gcry_md_hd_t hd, int algo, byte *buffer, int buflen)
  * guaranteed supported algorithms are RIPE-MD160 and SHA-1. The
  * supplied digest buffer must be large enough to store the resulting
  * hash.  No error is returned, the function will abort on an invalid
- * algo.  DISABLED_ALGOS are ignored here.  */
+ * algo or an XOF algo.  DISABLED_ALGOS are ignored here.  */
 void
 _gcry_md_hash_buffer (int algo, void *digest,
                       const void *buffer, size_t length)
@@ -879,6 +936,8 @@ _gcry_md_hash_buffer (int algo, void *digest,
       if (err)
 	log_bug ("gcry_md_open failed for algo %d: %s",
                  algo, gpg_strerror (gcry_error(err)));
+      if (!md_digest_length (algo))
+        log_bug ("gcry_md_hash_buffer used with XOF algo %d\n", algo);
       md_write (h, (byte *) buffer, length);
       md_final (h);
       memcpy (digest, md_read (h, algo), md_digest_length (algo));
@@ -916,6 +975,9 @@ _gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
   if (hmac && iovcnt < 1)
     return GPG_ERR_INV_ARG;
 
+  if (!md_digest_length (algo))
+    return GPG_ERR_DIGEST_ALGO;
+
   if (algo == GCRY_MD_SHA1 && !hmac)
     _gcry_sha1_hash_buffers (digest, iov, iovcnt);
   else
@@ -963,6 +1025,87 @@ _gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
 }
 
 
+/* Shortcut function to hash IOVCNT independent messages with a given
+   algo.  Each item of IOV is a complete message; its digest is stored
+   at DIGESTS + I * gcry_md_get_algo_dlen (ALGO) for item I.  DIGESTS
+   must have been provided by the caller with an appropriate length.
+   No flags are currently defined and FLAGS must be 0.
+
+   For SHA-1, SHA-224, SHA-256 and the SHA-3 functions the messages
+   are hashed in parallel using SIMD code if available.  For other
+   algorithms this is the same as calling gcry_md_hash_buffers for
+   each item.  */
+gpg_err_code_t
+_gcry_md_hash_buffers_multi (int algo, unsigned int flags, void *digests,
+                             const gcry_buffer_t *iov, int iovcnt)
+{
+  unsigned char *out = digests;
+  size_t dlen;
+  gpg_err_code_t rc;
+
+  if (!iov || iovcnt < 0)
+    return GPG_ERR_INV_ARG;
+  if (flags)
+    return GPG_ERR_INV_ARG;
+
+  dlen = md_digest_length (algo);
+  if (!dlen)
+    return GPG_ERR_DIGEST_ALGO;
+
+  if (algo == GCRY_MD_SHA1)
+    _gcry_sha1_hash_buffers_multi (digests, iov, iovcnt);
+#if USE_SHA256
+  else if (algo == GCRY_MD_SHA256)
+    _gcry_sha256_hash_buffers_multi (digests, iov, iovcnt);
+  else if (algo == GCRY_MD_SHA224)
+    _gcry_sha224_hash_buffers_multi (digests, iov, iovcnt);
+#endif
+#if USE_SHA3
+  else if (algo == GCRY_MD_SHA3_224 || algo == GCRY_MD_SHA3_256
+           || algo == GCRY_MD_SHA3_384 || algo == GCRY_MD_SHA3_512)
+    _gcry_sha3_hash_buffers_multi (algo, digests, iov, iovcnt);
+#endif
+  else
+    {
+      for (; iovcnt; iov++, iovcnt--, out += dlen)
+        {
+          rc = _gcry_md_hash_buffers (algo, 0, out, iov, 1);
+          if (rc)
+            return rc;
+        }
+    }
+
+  return 0;
+}
+
+
+/* Internal variant of _gcry_md_hash_buffers_multi for messages which
+   repeat themselves with PERIOD past the end of their buffers of
+   IOV[I].SIZE bytes; the last PERIOD + 64 bytes of each buffer must
+   already be periodic.  Returns GPG_ERR_NOT_SUPPORTED if there is no
+   multi-buffer code for ALGO which beats hashing the messages one
+   after the other; the caller then needs to do that itself.  */
+gpg_err_code_t
+_gcry_md_hash_periodic_multi (int algo, void *digests,
+                              const gcry_buffer_t *iov, int iovcnt,
+                              size_t period)
+{
+  if (!iov || iovcnt < 0 || !period)
+    return GPG_ERR_INV_ARG;
+
+  if (algo == GCRY_MD_SHA1)
+    return _gcry_sha1_hash_periodic_multi (digests, iov, iovcnt, period);
+#if USE_SHA256
+  else if (algo == GCRY_MD_SHA256)
+    return _gcry_sha256_hash_periodic_multi (digests, iov, iovcnt, period);
+  else if (algo == GCRY_MD_SHA224)
+    return _gcry_sha224_hash_periodic_multi (digests, iov, iovcnt, period);
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
 static int
 md_get_algo (gcry_md_hd_t a)
 {
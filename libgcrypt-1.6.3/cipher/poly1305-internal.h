@@ -0,0 +1,75 @@
+/* poly1305-internal.h  -  Poly1305 internals
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser general Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef G10_POLY1305_INTERNAL_H
+#define G10_POLY1305_INTERNAL_H
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "g10lib.h"
+#include "cipher.h"
+#include "bufhelp.h"
+
+
+#define POLY1305_TAGLEN 16
+#define POLY1305_KEYLEN 32
+#define POLY1305_BLOCKSIZE 16
+
+
+/* POLY1305_USE_64BIT indicates whether to use the implementation
+   with three 44 bit limbs; it requires a 128 bit integer type.  */
+#undef POLY1305_USE_64BIT
+#if defined(HAVE_U64_TYPEDEF) && defined(__SIZEOF_INT128__)
+# define POLY1305_USE_64BIT 1
+#endif
+
+
+typedef struct poly1305_context_s
+{
+#ifdef POLY1305_USE_64BIT
+  u64 r[3];
+  u64 h[3];
+  u64 pad[2];
+#else
+  u32 r[5];
+  u32 h[5];
+  u32 pad[4];
+#endif
+  byte buffer[POLY1305_BLOCKSIZE];
+  unsigned int leftover;
+} poly1305_context_t;
+
+
+/* Initialize CTX with the one-time KEY of POLY1305_KEYLEN bytes.  */
+gcry_err_code_t _gcry_poly1305_init (poly1305_context_t *ctx,
+                                     const byte *key, size_t keylen);
+
+/* Process BYTES bytes of message M.  */
+void _gcry_poly1305_update (poly1305_context_t *ctx, const byte *m,
+                            size_t bytes);
+
+/* Store the POLY1305_TAGLEN byte authenticator in MAC.  */
+void _gcry_poly1305_finish (poly1305_context_t *ctx,
+                            byte mac[POLY1305_TAGLEN]);
+
+
+#endif /* G10_POLY1305_INTERNAL_H */
@@ -0,0 +1,465 @@
+/* poly1305.c  -  Poly1305 one-time authenticator
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser general Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * For a description of the algorithm, see:
+ *   http://cr.yp.to/mac/poly1305-20050329.pdf
+ *   RFC 7539: ChaCha20 and Poly1305 for IETF Protocols
+ */
+
+/* The arithmetic follows the public domain poly1305-donna code by
+   Andrew Moon.  */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "g10lib.h"
+#include "cipher.h"
+#include "bufhelp.h"
+#include "poly1305-internal.h"
+
+
+static const char *selftest (void);
+
+
+
+#ifdef POLY1305_USE_64BIT
+
+typedef unsigned __int128 u128;
+
+static void
+poly1305_setkey (poly1305_context_t *ctx, const byte *key)
+{
+  u64 t0, t1;
+
+  /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+  t0 = buf_get_le64 (key + 0);
+  t1 = buf_get_le64 (key + 8);
+  ctx->r[0] = t0 & 0xffc0fffffffULL;
+  ctx->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+  ctx->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+  ctx->h[0] = ctx->h[1] = ctx->h[2] = 0;
+
+  ctx->pad[0] = buf_get_le64 (key + 16);
+  ctx->pad[1] = buf_get_le64 (key + 24);
+}
+
+
+/* Process the full blocks of M.  HIBIT is the 2^128 bit of each
+   block which is zero only for a padded final block.  Returns the
+   stack burn depth.  */
+static unsigned int
+poly1305_blocks (poly1305_context_t *ctx, const byte *m, size_t bytes,
+                 int hibit)
+{
+  const u64 hi = hibit ? (1ULL << 40) : 0;
+  u64 r0, r1, r2, s1, s2, h0, h1, h2, c, t0, t1;
+  u128 d0, d1, d2;
+
+  r0 = ctx->r[0];
+  r1 = ctx->r[1];
+  r2 = ctx->r[2];
+  h0 = ctx->h[0];
+  h1 = ctx->h[1];
+  h2 = ctx->h[2];
+
+  s1 = r1 * (5 << 2);
+  s2 = r2 * (5 << 2);
+
+  while (bytes >= POLY1305_BLOCKSIZE)
+    {
+      /* h += m[i] */
+      t0 = buf_get_le64 (m + 0);
+      t1 = buf_get_le64 (m + 8);
+      h0 += t0 & 0xfffffffffffULL;
+      h1 += ((t0 >> 44) | (t1 << 20)) & 0xfffffffffffULL;
+      h2 += (((t1 >> 24)) & 0x3ffffffffffULL) | hi;
+
+      /* h *= r */
+      d0 = (u128)h0 * r0 + (u128)h1 * s2 + (u128)h2 * s1;
+      d1 = (u128)h0 * r1 + (u128)h1 * r0 + (u128)h2 * s2;
+      d2 = (u128)h0 * r2 + (u128)h1 * r1 + (u128)h2 * r0;
+
+      /* (partial) h %= p */
+      c = (u64)(d0 >> 44); h0 = (u64)d0 & 0xfffffffffffULL;
+      d1 += c;
+      c = (u64)(d1 >> 44); h1 = (u64)d1 & 0xfffffffffffULL;
+      d2 += c;
+      c = (u64)(d2 >> 42); h2 = (u64)d2 & 0x3ffffffffffULL;
+      h0 += c * 5;
+      c = h0 >> 44; h0 &= 0xfffffffffffULL;
+      h1 += c;
+
+      m += POLY1305_BLOCKSIZE;
+      bytes -= POLY1305_BLOCKSIZE;
+    }
+
+  ctx->h[0] = h0;
+  ctx->h[1] = h1;
+  ctx->h[2] = h2;
+
+  return 12 * sizeof (u64) + 3 * sizeof (u128) + 4 * sizeof (void *);
+}
+
+
+static void
+poly1305_tag (poly1305_context_t *ctx, byte *mac)
+{
+  u64 h0, h1, h2, c, g0, g1, g2, t0, t1;
+
+  /* fully carry h */
+  h0 = ctx->h[0];
+  h1 = ctx->h[1];
+  h2 = ctx->h[2];
+
+  c = (h1 >> 44); h1 &= 0xfffffffffffULL;
+  h2 += c; c = (h2 >> 42); h2 &= 0x3ffffffffffULL;
+  h0 += c * 5; c = (h0 >> 44); h0 &= 0xfffffffffffULL;
+  h1 += c; c = (h1 >> 44); h1 &= 0xfffffffffffULL;
+  h2 += c; c = (h2 >> 42); h2 &= 0x3ffffffffffULL;
+  h0 += c * 5; c = (h0 >> 44); h0 &= 0xfffffffffffULL;
+  h1 += c;
+
+  /* compute h + -p */
+  g0 = h0 + 5; c = (g0 >> 44); g0 &= 0xfffffffffffULL;
+  g1 = h1 + c; c = (g1 >> 44); g1 &= 0xfffffffffffULL;
+  g2 = h2 + c - (1ULL << 42);
+
+  /* select h if h < p, or h + -p if h >= p */
+  c = (g2 >> 63) - 1;
+  g0 &= c;
+  g1 &= c;
+  g2 &= c;
+  c = ~c;
+  h0 = (h0 & c) | g0;
+  h1 = (h1 & c) | g1;
+  h2 = (h2 & c) | g2;
+
+  /* h = (h + pad) */
+  t0 = ctx->pad[0];
+  t1 = ctx->pad[1];
+
+  h0 += (t0 & 0xfffffffffffULL);
+  c = (h0 >> 44); h0 &= 0xfffffffffffULL;
+  h1 += (((t0 >> 44) | (t1 << 20)) & 0xfffffffffffULL) + c;
+  c = (h1 >> 44); h1 &= 0xfffffffffffULL;
+  h2 += (((t1 >> 24)) & 0x3ffffffffffULL) + c;
+  h2 &= 0x3ffffffffffULL;
+
+  /* mac = h % (2^128) */
+  h0 = ((h0) | (h1 << 44));
+  h1 = ((h1 >> 20) | (h2 << 24));
+
+  buf_put_le64 (mac + 0, h0);
+  buf_put_le64 (mac + 8, h1);
+}
+
+#else /*!POLY1305_USE_64BIT*/
+
+static void
+poly1305_setkey (poly1305_context_t *ctx, const byte *key)
+{
+  /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+  ctx->r[0] = (buf_get_le32 (key +  0)     ) & 0x3ffffff;
+  ctx->r[1] = (buf_get_le32 (key +  3) >> 2) & 0x3ffff03;
+  ctx->r[2] = (buf_get_le32 (key +  6) >> 4) & 0x3ffc0ff;
+  ctx->r[3] = (buf_get_le32 (key +  9) >> 6) & 0x3f03fff;
+  ctx->r[4] = (buf_get_le32 (key + 12) >> 8) & 0x00fffff;
+
+  memset (ctx->h, 0, sizeof ctx->h);
+
+  ctx->pad[0] = buf_get_le32 (key + 16);
+  ctx->pad[1] = buf_get_le32 (key + 20);
+  ctx->pad[2] = buf_get_le32 (key + 24);
+  ctx->pad[3] = buf_get_le32 (key + 28);
+}
+
+
+/* Process the full blocks of M.  HIBIT is the 2^128 bit of each
+   block which is zero only for a padded final block.  Returns the
+   stack burn depth.  */
+static unsigned int
+poly1305_blocks (poly1305_context_t *ctx, const byte *m, size_t bytes,
+                 int hibit)
+{
+  const u32 hi = hibit ? (1UL << 24) : 0;
+  u32 r0, r1, r2, r3, r4, s1, s2, s3, s4;
+  u32 h0, h1, h2, h3, h4, c;
+  u64 d0, d1, d2, d3, d4;
+
+  r0 = ctx->r[0];
+  r1 = ctx->r[1];
+  r2 = ctx->r[2];
+  r3 = ctx->r[3];
+  r4 = ctx->r[4];
+
+  s1 = r1 * 5;
+  s2 = r2 * 5;
+  s3 = r3 * 5;
+  s4 = r4 * 5;
+
+  h0 = ctx->h[0];
+  h1 = ctx->h[1];
+  h2 = ctx->h[2];
+  h3 = ctx->h[3];
+  h4 = ctx->h[4];
+
+  while (bytes >= POLY1305_BLOCKSIZE)
+    {
+      /* h += m[i] */
+      h0 += (buf_get_le32 (m +  0)     ) & 0x3ffffff;
+      h1 += (buf_get_le32 (m +  3) >> 2) & 0x3ffffff;
+      h2 += (buf_get_le32 (m +  6) >> 4) & 0x3ffffff;
+      h3 += (buf_get_le32 (m +  9) >> 6) & 0x3ffffff;
+      h4 += (buf_get_le32 (m + 12) >> 8) | hi;
+
+      /* h *= r */
+      d0 = ((u64)h0 * r0) + ((u64)h1 * s4) + ((u64)h2 * s3)
+           + ((u64)h3 * s2) + ((u64)h4 * s1);
+      d1 = ((u64)h0 * r1) + ((u64)h1 * r0) + ((u64)h2 * s4)
+           + ((u64)h3 * s3) + ((u64)h4 * s2);
+      d2 = ((u64)h0 * r2) + ((u64)h1 * r1) + ((u64)h2 * r0)
+           + ((u64)h3 * s4) + ((u64)h4 * s3);
+      d3 = ((u64)h0 * r3) + ((u64)h1 * r2) + ((u64)h2 * r1)
+           + ((u64)h3 * r0) + ((u64)h4 * s4);
+      d4 = ((u64)h0 * r4) + ((u64)h1 * r3) + ((u64)h2 * r2)
+           + ((u64)h3 * r1) + ((u64)h4 * r0);
+
+      /* (partial) h %= p */
+      c = (u32)(d0 >> 26); h0 = (u32)d0 & 0x3ffffff;
+      d1 += c; c = (u32)(d1 >> 26); h1 = (u32)d1 & 0x3ffffff;
+      d2 += c; c = (u32)(d2 >> 26); h2 = (u32)d2 & 0x3ffffff;
+      d3 += c; c = (u32)(d3 >> 26); h3 = (u32)d3 & 0x3ffffff;
+      d4 += c; c = (u32)(d4 >> 26); h4 = (u32)d4 & 0x3ffffff;
+      h0 += c * 5; c = (h0 >> 26); h0 &= 0x3ffffff;
+      h1 += c;
+
+      m += POLY1305_BLOCKSIZE;
+      bytes -= POLY1305_BLOCKSIZE;
+    }
+
+  ctx->h[0] = h0;
+  ctx->h[1] = h1;
+  ctx->h[2] = h2;
+  ctx->h[3] = h3;
+  ctx->h[4] = h4;
+
+  return 20 * sizeof (u32) + 5 * sizeof (u64) + 4 * sizeof (void *);
+}
+
+
+static void
+poly1305_tag (poly1305_context_t *ctx, byte *mac)
+{
+  u32 h0, h1, h2, h3, h4, c;
+  u32 g0, g1, g2, g3, g4;
+  u64 f;
+  u32 mask;
+
+  /* fully carry h */
+  h0 = ctx->h[0];
+  h1 = ctx->h[1];
+  h2 = ctx->h[2];
+  h3 = ctx->h[3];
+  h4 = ctx->h[4];
+
+  c = h1 >> 26; h1 &= 0x3ffffff;
+  h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+  h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+  h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+  h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+  h1 += c;
+
+  /* compute h + -p */
+  g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+  g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+  g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+  g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+  g4 = h4 + c - (1UL << 26);
+
+  /* select h if h < p, or h + -p if h >= p */
+  mask = (g4 >> ((sizeof (u32) * 8) - 1)) - 1;
+  g0 &= mask;
+  g1 &= mask;
+  g2 &= mask;
+  g3 &= mask;
+  g4 &= mask;
+  mask = ~mask;
+  h0 = (h0 & mask) | g0;
+  h1 = (h1 & mask) | g1;
+  h2 = (h2 & mask) | g2;
+  h3 = (h3 & mask) | g3;
+  h4 = (h4 & mask) | g4;
+
+  /* h = h % (2^128) */
+  h0 = ((h0      ) | (h1 << 26)) & 0xffffffff;
+  h1 = ((h1 >>  6) | (h2 << 20)) & 0xffffffff;
+  h2 = ((h2 >> 12) | (h3 << 14)) & 0xffffffff;
+  h3 = ((h3 >> 18) | (h4 <<  8)) & 0xffffffff;
+
+  /* mac = (h + pad) % (2^128) */
+  f = (u64)h0 + ctx->pad[0]            ; h0 = (u32)f;
+  f = (u64)h1 + ctx->pad[1] + (f >> 32); h1 = (u32)f;
+  f = (u64)h2 + ctx->pad[2] + (f >> 32); h2 = (u32)f;
+  f = (u64)h3 + ctx->pad[3] + (f >> 32); h3 = (u32)f;
+
+  buf_put_le32 (mac +  0, h0);
+  buf_put_le32 (mac +  4, h1);
+  buf_put_le32 (mac +  8, h2);
+  buf_put_le32 (mac + 12, h3);
+}
+
+#endif /*!POLY1305_USE_64BIT*/
+
+
+
+gcry_err_code_t
+_gcry_poly1305_init (poly1305_context_t *ctx, const byte *key,
+                     size_t keylen)
+{
+  static int initialized;
+  static const char *selftest_failed;
+
+  if (!initialized)
+    {
+      initialized = 1;
+      selftest_failed = selftest ();
+      if (selftest_failed)
+        log_error ("Poly1305 selftest failed (%s)\n", selftest_failed);
+    }
+  if (selftest_failed)
+    return GPG_ERR_SELFTEST_FAILED;
+
+  if (keylen != POLY1305_KEYLEN)
+    return GPG_ERR_INV_KEYLEN;
+
+  poly1305_setkey (ctx, key);
+  ctx->leftover = 0;
+
+  return 0;
+}
+
+
+void
+_gcry_poly1305_update (poly1305_context_t *ctx, const byte *m, size_t bytes)
+{
+  unsigned int burn = 0;
+
+  /* handle leftover */
+  if (ctx->leftover)
+    {
+      size_t want = (POLY1305_BLOCKSIZE - ctx->leftover);
+
+      if (want > bytes)
+        want = bytes;
+      buf_cpy (ctx->buffer + ctx->leftover, m, want);
+      bytes -= want;
+      m += want;
+      ctx->leftover += want;
+      if (ctx->leftover < POLY1305_BLOCKSIZE)
+        return;
+      burn = poly1305_blocks (ctx, ctx->buffer, POLY1305_BLOCKSIZE, 1);
+      ctx->leftover = 0;
+    }
+
+  /* process full blocks */
+  if (bytes >= POLY1305_BLOCKSIZE)
+    {
+      size_t want = (bytes & ~(POLY1305_BLOCKSIZE - 1));
+
+      burn = poly1305_blocks (ctx, m, want, 1);
+      m += want;
+      bytes -= want;
+    }
+
+  /* store leftover */
+  if (bytes)
+    {
+      buf_cpy (ctx->buffer + ctx->leftover, m, bytes);
+      ctx->leftover += bytes;
+    }
+
+  if (burn)
+    _gcry_burn_stack (burn);
+}
+
+
+void
+_gcry_poly1305_finish (poly1305_context_t *ctx, byte mac[POLY1305_TAGLEN])
+{
+  unsigned int burn = 0;
+
+  /* process the remaining block */
+  if (ctx->leftover)
+    {
+      size_t i = ctx->leftover;
+
+      ctx->buffer[i++] = 1;
+      for (; i < POLY1305_BLOCKSIZE; i++)
+        ctx->buffer[i] = 0;
+      burn = poly1305_blocks (ctx, ctx->buffer, POLY1305_BLOCKSIZE, 0);
+    }
+
+  poly1305_tag (ctx, mac);
+
+  /* The key is a one-time key; clear it together with the state.  */
+  wipememory (ctx, sizeof *ctx);
+
+  _gcry_burn_stack (burn + 16 * sizeof (void *));
+}
+
+
+static const char *
+selftest (void)
+{
+  poly1305_context_t ctx;
+  byte tag[POLY1305_TAGLEN];
+  int i;
+
+  /* From RFC 7539, section 2.5.2.  */
+  static const byte key[POLY1305_KEYLEN] =
+    { 0x85, 0xd6, 0xbe, 0x78, 0x57, 0x55, 0x6d, 0x33,
+      0x7f, 0x44, 0x52, 0xfe, 0x42, 0xd5, 0x06, 0xa8,
+      0x01, 0x03, 0x80, 0x8a, 0xfb, 0x0d, 0xb2, 0xfd,
+      0x4a, 0xbf, 0xf6, 0xaf, 0x41, 0x49, 0xf5, 0x1b };
+  static const char msg[] = "Cryptographic Forum Research Group";
+  static const byte expected[POLY1305_TAGLEN] =
+    { 0xa8, 0x06, 0x1d, 0xc1, 0x30, 0x51, 0x36, 0xc6,
+      0xc2, 0x2b, 0x8b, 0xaf, 0x0c, 0x01, 0x27, 0xa9 };
+
+  poly1305_setkey (&ctx, key);
+  ctx.leftover = 0;
+  _gcry_poly1305_update (&ctx, (const byte *)msg, sizeof msg - 1);
+  _gcry_poly1305_finish (&ctx, tag);
+  if (memcmp (tag, expected, sizeof expected))
+    return "Poly1305 test 1 failed.";
+
+  /* The same with the message fed byte by byte.  */
+  poly1305_setkey (&ctx, key);
+  ctx.leftover = 0;
+  for (i = 0; i < sizeof msg - 1; i++)
+    _gcry_poly1305_update (&ctx, (const byte *)msg + i, 1);
+  _gcry_poly1305_finish (&ctx, tag);
+  if (memcmp (tag, expected, sizeof expected))
+    return "Poly1305 test 2 failed.";
+
+  return NULL;
+}
@@ -36,7 +36,8 @@ static gcry_mpi_t gen_prime (unsigned int nbits, int secret, int randomlevel,
                              void *extra_check_arg);
 static int check_prime( gcry_mpi_t prime, gcry_mpi_t val_2, int rm_rounds,
                         gcry_prime_check_func_t cb_func, void *cb_arg );
-static int is_prime (gcry_mpi_t n, int steps, unsigned int *count);
+static int is_prime (gcry_mpi_t n, int steps, unsigned int *count,
+                     int nthreads);
 static void m_out_of_n( char *array, int m, int n );
 
 static void (*progress_cb) (void *,const char*,int,int, int );
@@ -126,7 +127,20 @@ static ushort small_prime_numbers[] = {
     4957, 4967, 4969, 4973, 4987, 4993, 4999,
     0
 };
-static int no_of_small_prime_numbers = DIM (small_prime_numbers) - 1;
+
+
+/* The sieve used by gen_prime covers SIEVE_SIZE odd candidates.  The
+   multiples of the primes 3 to 13 are not marked one by one but
+   copied from the periodic pattern in WHEEL, which gives for the odd
+   number 2t+1 whether it is divisible by one of these primes at
+   index t mod WHEEL_SIZE.  SIEVE_PRIMES holds the primes from 17 up
+   to 2^16 which are then marked in the sieve.  */
+#define SIEVE_SIZE        16384
+#define WHEEL_SIZE        (3*5*7*11*13)
+#define SIEVE_PRIMES_MAX  6600
+static unsigned char wheel[WHEEL_SIZE];
+static unsigned short sieve_primes[SIEVE_PRIMES_MAX];
+static unsigned int no_of_sieve_primes;
 
 
 
@@ -144,6 +158,35 @@ struct primepool_s *primepool;
 static ath_mutex_t primepool_lock;
 
 
+/* Fill the tables used by the sieve of gen_prime.  */
+static gcry_err_code_t
+init_sieve (void)
+{
+  unsigned char *composite; /* Index i stands for 2i+1.  */
+  unsigned int i, j, n;
+
+  composite = xtrycalloc (1, 32768);
+  if (!composite)
+    return gpg_err_code_from_syserror ();
+  for (i=1; i < 128; i++)
+    if (!composite[i])
+      for (j = 2*i*(i+1); j < 32768; j += 2*i+1)
+        composite[j] = 1;
+  for (n=0, i=8; i < 32768 && n < SIEVE_PRIMES_MAX; i++)
+    if (!composite[i])
+      sieve_primes[n++] = 2*i+1;
+  no_of_sieve_primes = n;
+  xfree (composite);
+
+  for (i=0; i < WHEEL_SIZE; i++)
+    {
+      j = (2*i+1) % WHEEL_SIZE;
+      wheel[i] = (!(j % 3) || !(j % 5) || !(j % 7) || !(j % 11) || !(j % 13));
+    }
+  return 0;
+}
+
+
 gcry_err_code_t
 _gcry_primegen_init (void)
 {
@@ -152,7 +195,7 @@ _gcry_primegen_init (void)
   ec = ath_mutex_init (&primepool_lock);
   if (ec)
     return gpg_err_code_from_errno (ec);
-  return ec;
+  return init_sieve ();
 }
 
 
@@ -759,37 +802,140 @@ _gcry_generate_elg_prime (int mode, unsigned pbits, unsigned qbits,
 }
 
 
-static gcry_mpi_t
-gen_prime (unsigned int nbits, int secret, int randomlevel,
-           int (*extra_check)(void *, gcry_mpi_t), void *extra_check_arg)
+/* A flag shared by the threads of ath_run_parallel.  It is only
+   accessed with LOCK held.  */
+struct parallel_flag_s
 {
-  gcry_mpi_t prime, ptest, pminus1, val_2, val_3, result;
-  int i;
-  unsigned int x, step;
-  unsigned int count1, count2;
-  int *mods;
+  ath_mutex_t lock;
+  int value;
+};
 
-/*   if (  DBG_CIPHER ) */
-/*     log_debug ("generate a prime of %u bits ", nbits ); */
+static void
+parallel_flag_init (struct parallel_flag_s *flag)
+{
+  int err;
 
-  if (nbits < 16)
-    log_fatal ("can't generate a prime with less than %d bits\n", 16);
+  flag->value = 0;
+  err = ath_mutex_init (&flag->lock);
+  if (err)
+    log_fatal ("failed to create the prime search lock: %s\n",
+               strerror (err));
+}
+
+static void
+parallel_flag_release (struct parallel_flag_s *flag)
+{
+  ath_mutex_destroy (&flag->lock);
+}
+
+static void
+parallel_flag_set (struct parallel_flag_s *flag)
+{
+  int err;
+
+  err = ath_mutex_lock (&flag->lock);
+  if (err)
+    log_fatal ("failed to acquire the prime search lock: %s\n",
+               strerror (err));
+  flag->value = 1;
+  err = ath_mutex_unlock (&flag->lock);
+  if (err)
+    log_fatal ("failed to release the prime search lock: %s\n",
+               strerror (err));
+}
+
+static int
+parallel_flag_get (struct parallel_flag_s *flag)
+{
+  int err, value;
+
+  err = ath_mutex_lock (&flag->lock);
+  if (err)
+    log_fatal ("failed to acquire the prime search lock: %s\n",
+               strerror (err));
+  value = flag->value;
+  err = ath_mutex_unlock (&flag->lock);
+  if (err)
+    log_fatal ("failed to release the prime search lock: %s\n",
+               strerror (err));
+  return value;
+}
+
+
+/* The state shared by the threads of gen_prime.  */
+struct gen_prime_parm_s
+{
+  unsigned int nbits;
+  int secret;
+  int randomlevel;
+  int (*extra_check)(void *, gcry_mpi_t);
+  void *extra_check_arg;
+  unsigned int nsieve;        /* Number of SIEVE_PRIMES to use.  */
+  struct parallel_flag_s done; /* Set as soon as a prime has been found.  */
+  gcry_mpi_t result[ATH_MAX_PARALLEL];
+};
+
+
+/* Mark all odd candidates PRIME + 2k, 0 <= k < SIEVE_SIZE, in SIEVE
+   which have a factor below 2^16.  The first NSIEVE entries of
+   SIEVE_PRIMES are used for this in addition to the wheel.  */
+static void
+fill_sieve (unsigned char *sieve, gcry_mpi_t prime, unsigned int nsieve)
+{
+  unsigned int i, k, n, x, r;
+
+  /* Copy the wheel; PRIME is odd and thus starts at T = (PRIME-1)/2.  */
+  r = (mpi_fdiv_r_ui (NULL, prime, 2*WHEEL_SIZE) - 1) / 2;
+  for (k=0; k < SIEVE_SIZE; k += n)
+    {
+      n = WHEEL_SIZE - r;
+      if (n > SIEVE_SIZE - k)
+        n = SIEVE_SIZE - k;
+      memcpy (sieve + k, wheel + r, n);
+      r = 0;
+    }
+
+  for (i=0; i < nsieve; i++)
+    {
+      x = sieve_primes[i];
+      r = mpi_fdiv_r_ui (NULL, prime, x);
+      /* The first k with 2k = -r (mod x).  */
+      k = r? ((x - r) & 1? (2*x - r)/2 : (x - r)/2) : 0;
+      for (; k < SIEVE_SIZE; k += x)
+        sieve[k] = 1;
+    }
+}
 
-  mods = xmalloc (no_of_small_prime_numbers * sizeof *mods);
-  /* Make nbits fit into gcry_mpi_t implementation. */
+
+/* The search for a prime as run by each thread of gen_prime.  All
+   threads test independent random candidates; the first thread which
+   finds a prime stores it at PARM->RESULT[IDX] and tells the others
+   to stop.  Only the calling thread (IDX 0) reports progress.  */
+static void
+gen_prime_worker (void *arg, int idx)
+{
+  struct gen_prime_parm_s *parm = arg;
+  unsigned int nbits = parm->nbits;
+  int secret = parm->secret;
+  gcry_mpi_t prime, ptest, pminus1, val_2, result;
+  unsigned char *sieve;
+  unsigned int step;
+  unsigned int count2;
+  int dotcount;
+
+  sieve = xmalloc (SIEVE_SIZE);
   val_2  = mpi_alloc_set_ui( 2 );
-  val_3 = mpi_alloc_set_ui( 3);
   prime  = secret? mpi_snew (nbits): mpi_new (nbits);
   result = mpi_alloc_like( prime );
   pminus1= mpi_alloc_like( prime );
   ptest  = mpi_alloc_like( prime );
-  count1 = count2 = 0;
-  for (;;)
-    {  /* try forvever */
-      int dotcount=0;
+  count2 = 0;
+  while (!parallel_flag_get (&parm->done))
+    {
+      dotcount = 0;
 
       /* generate a random number */
-      _gcry_mpi_randomize( prime, nbits, randomlevel );
+      _gcry_mpi_randomize( prime, nbits, parm->randomlevel );
 
       /* Set high order bit to 1, set low order bit to 1.  If we are
          generating a secret prime we are most probably doing that
@@ -800,26 +946,18 @@ gen_prime (unsigned int nbits, int secret, int randomlevel,
         mpi_set_bit (prime, nbits-2);
       mpi_set_bit(prime, 0);
 
-      /* Calculate all remainders. */
-      for (i=0; (x = small_prime_numbers[i]); i++ )
-        mods[i] = mpi_fdiv_r_ui(NULL, prime, x);
+      /* Sieve out the candidates with small factors. */
+      fill_sieve (sieve, prime, parm->nsieve);
 
-      /* Now try some primes starting with prime. */
-      for(step=0; step < 20000; step += 2 )
+      /* Now try the remaining candidates starting with prime. */
+      for (step=0; step < SIEVE_SIZE; step++)
         {
-          /* Check against all the small primes we have in mods. */
-          count1++;
-          for (i=0; (x = small_prime_numbers[i]); i++ )
-            {
-              while ( mods[i] + step >= x )
-                mods[i] -= x;
-              if ( !(mods[i] + step) )
-                break;
-	    }
-          if ( x )
+          if (sieve[step])
             continue;   /* Found a multiple of an already known prime. */
+          if (parallel_flag_get (&parm->done))
+            break;
 
-          mpi_add_ui( ptest, prime, step );
+          mpi_add_ui( ptest, prime, 2*step );
 
           /* Do a fast Fermat test now. */
           count2++;
@@ -828,42 +966,108 @@ gen_prime (unsigned int nbits, int secret, int randomlevel,
           if ( !mpi_cmp_ui( result, 1 ) )
             {
               /* Not composite, perform stronger tests */
-              if (is_prime(ptest, 5, &count2 ))
+              if (is_prime(ptest, 5, &count2, 1))
                 {
                   if (!mpi_test_bit( ptest, nbits-1-secret ))
                     {
-                      progress('\n');
+                      if (!idx)
+                        progress('\n');
                       log_debug ("overflow in prime generation\n");
                       break; /* Stop loop, continue with a new prime. */
                     }
 
-                  if (extra_check && extra_check (extra_check_arg, ptest))
+                  if (parm->extra_check
+                      && parm->extra_check (parm->extra_check_arg, ptest))
                     {
                       /* The extra check told us that this prime is
                          not of the caller's taste. */
-                      progress ('/');
+                      if (!idx)
+                        progress ('/');
                     }
                   else
                     {
                       /* Got it. */
-                      mpi_free(val_2);
-                      mpi_free(val_3);
-                      mpi_free(result);
-                      mpi_free(pminus1);
-                      mpi_free(prime);
-                      xfree(mods);
-                      return ptest;
+                      parm->result[idx] = ptest;
+                      ptest = NULL;
+                      parallel_flag_set (&parm->done);
+                      break;
                     }
                 }
 	    }
           if (++dotcount == 10 )
             {
-              progress('.');
+              if (!idx)
+                progress('.');
               dotcount = 0;
 	    }
 	}
-      progress(':'); /* restart with a new random value */
+      if (!idx && !parallel_flag_get (&parm->done))
+        progress(':'); /* restart with a new random value */
     }
+
+  mpi_free(val_2);
+  mpi_free(result);
+  mpi_free(pminus1);
+  mpi_free(prime);
+  mpi_free(ptest);
+  xfree(sieve);
+}
+
+
+/* Generate a random prime of NBITS.  If the application allowed for
+   more than one worker thread, independent candidates are tested
+   concurrently.  Note that EXTRA_CHECK may then be called by any of
+   these threads.  */
+static gcry_mpi_t
+gen_prime (unsigned int nbits, int secret, int randomlevel,
+           int (*extra_check)(void *, gcry_mpi_t), void *extra_check_arg)
+{
+  struct gen_prime_parm_s parm;
+  gcry_mpi_t prime = NULL;
+  int i, nthreads;
+
+/*   if (  DBG_CIPHER ) */
+/*     log_debug ("generate a prime of %u bits ", nbits ); */
+
+  if (nbits < 16)
+    log_fatal ("can't generate a prime with less than %d bits\n", 16);
+
+  memset (&parm, 0, sizeof parm);
+  parm.nbits = nbits;
+  parm.secret = secret;
+  parm.randomlevel = randomlevel;
+  parm.extra_check = extra_check;
+  parm.extra_check_arg = extra_check_arg;
+  parallel_flag_init (&parm.done);
+
+  /* The number of sieve primes is a trade-off between the time to
+     compute the remainders and the saved Fermat tests; this grows
+     with the size of the prime.  A sieve prime must never be a
+     candidate itself.  */
+  parm.nsieve = nbits * 4;
+  if (parm.nsieve > no_of_sieve_primes)
+    parm.nsieve = no_of_sieve_primes;
+  while (parm.nsieve && nbits <= 17
+         && sieve_primes[parm.nsieve-1] >= (1u << (nbits-1)))
+    parm.nsieve--;
+
+  nthreads = _gcry_get_worker_threads ();
+  if (nthreads > 1)
+    ath_run_parallel (gen_prime_worker, &parm, nthreads);
+  else
+    gen_prime_worker (&parm, 0);
+
+  /* More than one thread may have found a prime; take the first.  */
+  for (i=0; i < ATH_MAX_PARALLEL; i++)
+    {
+      if (!prime)
+        prime = parm.result[i];
+      else
+        mpi_free (parm.result[i]);
+    }
+  parallel_flag_release (&parm.done);
+  gcry_assert (prime);
+  return prime;
 }
 
 /****************
@@ -905,7 +1109,8 @@ check_prime( gcry_mpi_t prime, gcry_mpi_t val_2, int rm_rounds,
   if (!cb_func || cb_func (cb_arg, GCRY_PRIME_CHECK_AT_MAYBE_PRIME, prime))
     {
       /* Perform stronger tests. */
-      if ( is_prime( prime, rm_rounds, &count ) )
+      if ( is_prime( prime, rm_rounds, &count,
+                     _gcry_get_worker_threads () ) )
         {
           if (!cb_func
               || cb_func (cb_arg, GCRY_PRIME_CHECK_AT_GOT_PRIME, prime))
@@ -917,35 +1122,40 @@ check_prime( gcry_mpi_t prime, gcry_mpi_t val_2, int rm_rounds,
 }
 
 
-/*
- * Return true if n is probably a prime
- */
-static int
-is_prime (gcry_mpi_t n, int steps, unsigned int *count)
+/* The state shared by the threads of is_prime.  */
+struct is_prime_parm_s
 {
+  gcry_mpi_t n;
+  gcry_mpi_t nminus1;
+  gcry_mpi_t q;             /* n = 1 + 2^k * q  */
+  unsigned int k;
+  int steps;
+  int nthreads;
+  struct parallel_flag_s composite; /* Set as soon as a witness has
+                                       been found.  */
+  unsigned int count[ATH_MAX_PARALLEL];
+};
+
+
+/* Run the rounds IDX, IDX + NTHREADS, ... of the Miller-Rabin test
+   described by ARG.  */
+static void
+is_prime_worker (void *arg, int idx)
+{
+  struct is_prime_parm_s *parm = arg;
+  gcry_mpi_t n = parm->n;
+  gcry_mpi_t nminus1 = parm->nminus1;
   gcry_mpi_t x = mpi_alloc( mpi_get_nlimbs( n ) );
   gcry_mpi_t y = mpi_alloc( mpi_get_nlimbs( n ) );
-  gcry_mpi_t z = mpi_alloc( mpi_get_nlimbs( n ) );
-  gcry_mpi_t nminus1 = mpi_alloc( mpi_get_nlimbs( n ) );
   gcry_mpi_t a2 = mpi_alloc_set_ui( 2 );
-  gcry_mpi_t q;
-  unsigned i, j, k;
-  int rc = 0;
-  unsigned nbits = mpi_get_nbits( n );
-
-  if (steps < 5) /* Make sure that we do at least 5 rounds. */
-    steps = 5;
-
-  mpi_sub_ui( nminus1, n, 1 );
-
-  /* Find q and k, so that n = 1 + 2^k * q . */
-  q = mpi_copy ( nminus1 );
-  k = mpi_trailing_zeros ( q );
-  mpi_tdiv_q_2exp (q, q, k);
+  unsigned int nbits = mpi_get_nbits( n );
+  unsigned int j;
+  int i;
 
-  for (i=0 ; i < steps; i++ )
+  for (i=idx; i < parm->steps && !parallel_flag_get (&parm->composite);
+       i += parm->nthreads)
     {
-      ++*count;
+      parm->count[idx]++;
       if( !i )
         {
           mpi_set_ui( x, 2 );
@@ -967,31 +1177,82 @@ is_prime (gcry_mpi_t n, int steps, unsigned int *count)
             }
           gcry_assert (mpi_cmp (x, nminus1) < 0 && mpi_cmp_ui (x, 1) > 0);
 	}
-      mpi_powm ( y, x, q, n);
+      mpi_powm ( y, x, parm->q, n);
       if ( mpi_cmp_ui(y, 1) && mpi_cmp( y, nminus1 ) )
         {
-          for ( j=1; j < k && mpi_cmp( y, nminus1 ); j++ )
+          for ( j=1; j < parm->k && mpi_cmp( y, nminus1 ); j++ )
             {
               mpi_powm(y, y, a2, n);
               if( !mpi_cmp_ui( y, 1 ) )
-                goto leave; /* Not a prime. */
+                break;
             }
           if (mpi_cmp( y, nminus1 ) )
-            goto leave; /* Not a prime. */
+            {
+              parallel_flag_set (&parm->composite); /* Not a prime. */
+              break;
+            }
 	}
-      progress('+');
+      if (parm->nthreads == 1)
+        progress('+');
     }
-  rc = 1; /* May be a prime. */
 
- leave:
   mpi_free( x );
   mpi_free( y );
-  mpi_free( z );
-  mpi_free( nminus1 );
-  mpi_free( q );
   mpi_free( a2 );
+}
 
-  return rc;
+
+/*
+ * Return true if n is probably a prime.  The rounds of the test are
+ * distributed over up to NTHREADS threads.
+ */
+static int
+is_prime (gcry_mpi_t n, int steps, unsigned int *count, int nthreads)
+{
+  struct is_prime_parm_s parm;
+  int i, composite;
+
+  if (steps < 5) /* Make sure that we do at least 5 rounds. */
+    steps = 5;
+  if (nthreads > steps)
+    nthreads = steps;
+  if (nthreads > ATH_MAX_PARALLEL)
+    nthreads = ATH_MAX_PARALLEL;
+  if (nthreads < 1)
+    nthreads = 1;
+
+  memset (&parm, 0, sizeof parm);
+  parm.n = n;
+  parm.steps = steps;
+  parm.nthreads = nthreads;
+  parallel_flag_init (&parm.composite);
+  parm.nminus1 = mpi_alloc( mpi_get_nlimbs( n ) );
+  mpi_sub_ui( parm.nminus1, n, 1 );
+
+  /* Find q and k, so that n = 1 + 2^k * q . */
+  parm.q = mpi_copy ( parm.nminus1 );
+  parm.k = mpi_trailing_zeros ( parm.q );
+  mpi_tdiv_q_2exp (parm.q, parm.q, parm.k);
+
+  if (nthreads > 1)
+    {
+      ath_run_parallel (is_prime_worker, &parm, nthreads);
+      if (!parallel_flag_get (&parm.composite))
+        for (i=0; i < steps; i++)
+          progress('+');
+    }
+  else
+    is_prime_worker (&parm, 0);
+
+  for (i=0; i < nthreads; i++)
+    *count += parm.count[i];
+
+  mpi_free( parm.nminus1 );
+  mpi_free( parm.q );
+
+  composite = parallel_flag_get (&parm.composite);
+  parallel_flag_release (&parm.composite);
+  return !composite; /* May be a prime. */
 }
 
 
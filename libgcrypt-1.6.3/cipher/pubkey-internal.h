@@ -28,6 +28,8 @@ gpg_err_code_t _gcry_pk_util_get_nbits (gcry_sexp_t list,
                                         unsigned int *r_nbits);
 gpg_err_code_t _gcry_pk_util_get_rsa_use_e (gcry_sexp_t list,
                                             unsigned long *r_e);
+gpg_err_code_t _gcry_pk_util_get_rsa_use_primes (gcry_sexp_t list,
+                                                 unsigned int *r_nprimes);
 gpg_err_code_t _gcry_pk_util_preparse_sigval (gcry_sexp_t s_sig,
                                               const char **algo_names,
                                               gcry_sexp_t *r_parms,
@@ -92,6 +94,9 @@ gpg_err_code_t _gcry_dsa_normalize_hash (gcry_mpi_t input,
                                          gcry_mpi_t *out,
                                          unsigned int qbits);
 
+/*-- ecc-curves.c --*/
+gcry_err_code_t _gcry_ecc_curves_init (void);
+
 /*-- ecc.c --*/
 gpg_err_code_t _gcry_pk_ecc_get_sexp (gcry_sexp_t *r_sexp, int mode,
                                       mpi_ec_t ec);
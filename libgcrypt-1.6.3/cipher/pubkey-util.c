@@ -328,6 +328,40 @@ _gcry_pk_util_get_rsa_use_e (gcry_sexp_t list, unsigned long *r_e)
 }
 
 
+/* Parse a "rsa-use-primes" parameter from LIST and store it at
+   R_NPRIMES.  If the parameter is not given 2 is stored.  The range
+   of the value is not checked here.  */
+gpg_err_code_t
+_gcry_pk_util_get_rsa_use_primes (gcry_sexp_t list, unsigned int *r_nprimes)
+{
+  char buf[50];
+  const char *s;
+  size_t n;
+
+  *r_nprimes = 0;
+
+  list = sexp_find_token (list, "rsa-use-primes", 0);
+  if (!list)
+    {
+      *r_nprimes = 2; /* Not given, use the standard two prime RSA.  */
+      return 0;
+    }
+
+  s = sexp_nth_data (list, 1, &n);
+  if (!s || n >= DIM (buf) - 1 )
+    {
+      /* No value or value too large.  */
+      sexp_release (list);
+      return GPG_ERR_INV_OBJ;
+    }
+  memcpy (buf, s, n);
+  buf[n] = 0;
+  *r_nprimes = (unsigned int)strtoul (buf, NULL, 0);
+  sexp_release (list);
+  return 0;
+}
+
+
 /* Parse a "sig-val" s-expression and store the inner parameter list at
    R_PARMS.  ALGO_NAMES is used to verify that the algorithm in
    "sig-val" is valid.  Returns 0 on success and stores a new list at
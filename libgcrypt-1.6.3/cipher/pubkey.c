@@ -33,6 +33,16 @@
 #include "pubkey-internal.h"
 
 
+/* A key handle as returned by _gcry_pk_open.  */
+struct gcry_pk_handle
+{
+  gcry_pk_spec_t *spec;  /* The algorithm of the key.  */
+  int secret;            /* The key is a private key.  */
+  gcry_sexp_t keyparms;  /* The parameter list of the key.  */
+  void *ctx;             /* Context of the algorithm or NULL.  */
+};
+
+
 /* This is the list of the public-key algorithms included in
    Libgcrypt.  */
 static gcry_pk_spec_t *pubkey_list[] =
@@ -467,6 +477,231 @@ _gcry_pk_verify (gcry_sexp_t s_sig, gcry_sexp_t s_hash, gcry_sexp_t s_pkey)
 }
 
 
+/*
+   Verify N signatures at once.
+
+   S_SIGS, S_HASHES and S_PKEYS are arrays with N elements each,
+   describing the signatures as for _gcry_pk_verify.  Algorithms
+   providing a batch verification function are given all their
+   signatures at once; the others are verified one by one.  If
+   R_ERRORS is not NULL, the result for each signature is stored
+   there.  Returns 0 if all signatures are good or the error of the
+   first bad one.  */
+gcry_err_code_t
+_gcry_pk_verify_batch (gcry_sexp_t *s_sigs, gcry_sexp_t *s_hashes,
+                       gcry_sexp_t *s_pkeys, unsigned int n,
+                       gcry_error_t *r_errors)
+{
+  gcry_err_code_t rc = 0;
+  gcry_pk_spec_t **specs;
+  gcry_sexp_t *keyparms, *g_sigs, *g_hashes, *g_keyparms;
+  gcry_err_code_t *results, *g_results;
+  unsigned int *g_idx;
+  unsigned int i, j, m;
+
+  if (!n)
+    return 0;
+
+  specs = xtrycalloc (n, sizeof *specs);
+  keyparms = xtrycalloc (4*n, sizeof *keyparms);
+  results = xtrycalloc (2*n, sizeof *results);
+  g_idx = xtrycalloc (n, sizeof *g_idx);
+  if (!specs || !keyparms || !results || !g_idx)
+    {
+      rc = gpg_err_code_from_syserror ();
+      goto leave;
+    }
+  g_sigs = keyparms + n;
+  g_hashes = keyparms + 2*n;
+  g_keyparms = keyparms + 3*n;
+  g_results = results + n;
+
+  for (i=0; i < n; i++)
+    results[i] = spec_from_sexp (s_pkeys[i], 0, &specs[i], &keyparms[i]);
+
+  for (i=0; i < n; i++)
+    {
+      if (results[i] || !specs[i])
+        continue;
+      if (!specs[i]->verify_batch)
+        {
+          if (specs[i]->verify)
+            results[i] = specs[i]->verify (s_sigs[i], s_hashes[i],
+                                           keyparms[i]);
+          else
+            results[i] = GPG_ERR_NOT_IMPLEMENTED;
+          continue;
+        }
+
+      /* Collect all remaining signatures for this algorithm.  */
+      for (j=i, m=0; j < n; j++)
+        if (!results[j] && specs[j] == specs[i])
+          {
+            g_idx[m] = j;
+            g_sigs[m] = s_sigs[j];
+            g_hashes[m] = s_hashes[j];
+            g_keyparms[m] = keyparms[j];
+            m++;
+          }
+      specs[i]->verify_batch (g_sigs, g_hashes, g_keyparms, m, g_results);
+      for (j=0; j < m; j++)
+        {
+          results[g_idx[j]] = g_results[j];
+          specs[g_idx[j]] = NULL;
+        }
+    }
+
+  for (i=0; i < n; i++)
+    {
+      if (r_errors)
+        r_errors[i] = gpg_error (results[i]);
+      if (results[i] && !rc)
+        rc = results[i];
+    }
+
+ leave:
+  if (keyparms)
+    for (i=0; i < n; i++)
+      sexp_release (keyparms[i]);
+  xfree (g_idx);
+  xfree (results);
+  xfree (keyparms);
+  xfree (specs);
+  return rc;
+}
+
+
+/*
+   Prepare a key for repeated use.
+
+   KEY is either a public or a private key as used with the other
+   functions of this module.  A handle which keeps the parsed key
+   around is stored at R_HD; algorithms providing an open function
+   also set up their precomputed values for the key.  The handle
+   needs to be released with _gcry_pk_close.  */
+gcry_err_code_t
+_gcry_pk_open (gcry_pk_hd_t *r_hd, gcry_sexp_t key)
+{
+  gcry_err_code_t rc;
+  gcry_pk_hd_t hd;
+  gcry_pk_spec_t *spec;
+  gcry_sexp_t keyparms;
+  int secret = 1;
+
+  *r_hd = NULL;
+
+  rc = spec_from_sexp (key, 1, &spec, &keyparms);
+  if (rc == GPG_ERR_INV_OBJ)
+    {
+      secret = 0;
+      rc = spec_from_sexp (key, 0, &spec, &keyparms);
+    }
+  if (rc)
+    return rc;
+
+  hd = xtrycalloc (1, sizeof *hd);
+  if (!hd)
+    {
+      rc = gpg_err_code_from_syserror ();
+      sexp_release (keyparms);
+      return rc;
+    }
+  hd->spec = spec;
+  hd->secret = secret;
+  hd->keyparms = keyparms;
+
+  if (spec->open)
+    {
+      rc = spec->open (keyparms, secret, &hd->ctx);
+      if (rc)
+        {
+          sexp_release (keyparms);
+          xfree (hd);
+          return rc;
+        }
+    }
+
+  *r_hd = hd;
+  return 0;
+}
+
+
+/* Release the key handle HD.  */
+void
+_gcry_pk_close (gcry_pk_hd_t hd)
+{
+  if (!hd)
+    return;
+
+  if (hd->ctx && hd->spec->close)
+    hd->spec->close (hd->ctx);
+  sexp_release (hd->keyparms);
+  xfree (hd);
+}
+
+
+/* Same as _gcry_pk_encrypt but using the key of the handle HD.  */
+gcry_err_code_t
+_gcry_pk_hd_encrypt (gcry_pk_hd_t hd, gcry_sexp_t *r_ciph, gcry_sexp_t s_data)
+{
+  *r_ciph = NULL;
+
+  if (hd->ctx && hd->spec->hd_encrypt)
+    return hd->spec->hd_encrypt (hd->ctx, r_ciph, s_data);
+  else if (hd->spec->encrypt)
+    return hd->spec->encrypt (r_ciph, s_data, hd->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_decrypt but using the key of the handle HD.  */
+gcry_err_code_t
+_gcry_pk_hd_decrypt (gcry_pk_hd_t hd, gcry_sexp_t *r_plain, gcry_sexp_t s_data)
+{
+  *r_plain = NULL;
+
+  if (!hd->secret)
+    return GPG_ERR_NO_SECKEY;
+  if (hd->ctx && hd->spec->hd_decrypt)
+    return hd->spec->hd_decrypt (hd->ctx, r_plain, s_data);
+  else if (hd->spec->decrypt)
+    return hd->spec->decrypt (r_plain, s_data, hd->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_sign but using the key of the handle HD.  */
+gcry_err_code_t
+_gcry_pk_hd_sign (gcry_pk_hd_t hd, gcry_sexp_t *r_sig, gcry_sexp_t s_hash)
+{
+  *r_sig = NULL;
+
+  if (!hd->secret)
+    return GPG_ERR_NO_SECKEY;
+  if (hd->ctx && hd->spec->hd_sign)
+    return hd->spec->hd_sign (hd->ctx, r_sig, s_hash);
+  else if (hd->spec->sign)
+    return hd->spec->sign (r_sig, s_hash, hd->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
+/* Same as _gcry_pk_verify but using the key of the handle HD.  */
+gcry_err_code_t
+_gcry_pk_hd_verify (gcry_pk_hd_t hd, gcry_sexp_t s_sig, gcry_sexp_t s_hash)
+{
+  if (hd->ctx && hd->spec->hd_verify)
+    return hd->spec->hd_verify (hd->ctx, s_sig, s_hash);
+  else if (hd->spec->verify)
+    return hd->spec->verify (s_sig, s_hash, hd->keyparms);
+  else
+    return GPG_ERR_NOT_IMPLEMENTED;
+}
+
+
 /*
    Test a key.
 
@@ -927,7 +1162,11 @@ _gcry_pubkey_get_sexp (gcry_sexp_t *r_sexp, int mode, gcry_ctx_t ctx)
 gcry_err_code_t
 _gcry_pk_init (void)
 {
+#if USE_ECC
+  return _gcry_ecc_curves_init ();
+#else
   return 0;
+#endif
 }
 
 
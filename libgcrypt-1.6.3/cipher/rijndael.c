@@ -47,6 +47,7 @@
 #include "cipher.h"
 #include "bufhelp.h"
 #include "cipher-selftest.h"
+#include "./cipher-internal.h"
 
 #define MAXKC			(256/32)
 #define MAXROUNDS		14
@@ -98,6 +99,15 @@
 # endif
 #endif /* ENABLE_AESNI_SUPPORT */
 
+/* USE_VAES indicates whether to compile the AVX-512 code using the
+   VAES instructions on 512 bit registers.  */
+#undef USE_VAES
+#if defined(USE_AESNI) && defined(__x86_64__) \
+    && defined(ENABLE_AVX512_SUPPORT) \
+    && defined(HAVE_GCC_INLINE_ASM_VAES_VPCLMUL)
+# define USE_VAES 1
+#endif
+
 #ifdef USE_AESNI
   typedef struct u128_s { u32 a, b, c, d; } u128_t;
 #endif /*USE_AESNI*/
@@ -171,6 +181,9 @@ typedef struct
 #ifdef USE_AESNI
   unsigned int use_aesni:1;           /* AES-NI shall be used.  */
 #endif /*USE_AESNI*/
+#ifdef USE_VAES
+  unsigned int use_vaes:1;            /* VAES/AVX-512 shall be used.  */
+#endif /*USE_VAES*/
 } RIJNDAEL_context ATTR_ALIGNED_16;
 
 /* Macros defining alias for the keyschedules.  */
@@ -556,6 +569,14 @@ do_setkey (RIJNDAEL_context *ctx, const byte *key, const unsigned keylen)
   else
     return GPG_ERR_INV_KEYLEN;
 
+#ifdef USE_VAES
+  /* The VAES code is used for the bulk functions in addition to the
+     AES-NI code.  */
+  ctx->use_vaes = (ctx->use_aesni
+                   && (hwfeatures & HWF_INTEL_AVX512)
+                   && (hwfeatures & HWF_INTEL_VAES));
+#endif
+
   ctx->rounds = rounds;
 
   /* NB: We don't yet support Padlock hardware key generation.  */
@@ -1297,6 +1318,160 @@ do_aesni_dec_vec4 (const RIJNDAEL_context *ctx)
 }
 
 
+#ifdef __x86_64__
+/* Encrypt eight blocks using the Intel AES-NI instructions.  Blocks
+ * are input and output through SSE registers xmm1 to xmm4 and xmm8 to
+ * xmm11.  The extra registers are only available on AMD64.  */
+static void
+do_aesni_enc_vec8 (const RIJNDAEL_context *ctx)
+{
+#define aesenc_vec8                                          \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd8\n\t" /* xmm11 */
+#define aesenclast_vec8                                      \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd8\n\t" /* xmm11 */
+  asm volatile ("movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"  /* xmm1 ^= key[0] */
+                "pxor   %%xmm0, %%xmm2\n\t"  /* xmm2 ^= key[0] */
+                "pxor   %%xmm0, %%xmm3\n\t"  /* xmm3 ^= key[0] */
+                "pxor   %%xmm0, %%xmm4\n\t"  /* xmm4 ^= key[0] */
+                "pxor   %%xmm0, %%xmm8\n\t"  /* xmm8 ^= key[0] */
+                "pxor   %%xmm0, %%xmm9\n\t"  /* xmm9 ^= key[0] */
+                "pxor   %%xmm0, %%xmm10\n\t" /* xmm10 ^= key[0] */
+                "pxor   %%xmm0, %%xmm11\n\t" /* xmm11 ^= key[0] */
+                "movdqa 0x10(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x20(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x30(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x40(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x50(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x60(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x70(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x80(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0x90(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_vec8
+                "movdqa 0xb0(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_vec8
+                "movdqa 0xd0(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Lenclast%=:\n\t"
+                aesenclast_vec8
+                : /* no output */
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds)
+                : "cc", "memory");
+#undef aesenc_vec8
+#undef aesenclast_vec8
+}
+
+
+/* Decrypt eight blocks using the Intel AES-NI instructions.  Blocks
+ * are input and output through SSE registers xmm1 to xmm4 and xmm8 to
+ * xmm11.  */
+static void
+do_aesni_dec_vec8 (const RIJNDAEL_context *ctx)
+{
+#define aesdec_vec8                                          \
+  ".byte 0x66, 0x0f, 0x38, 0xde, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xde, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xde, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xde, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xde, 0xd8\n\t" /* xmm11 */
+#define aesdeclast_vec8                                      \
+  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdf, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdf, 0xd8\n\t" /* xmm11 */
+  asm volatile ("movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"  /* xmm1 ^= key[0] */
+                "pxor   %%xmm0, %%xmm2\n\t"  /* xmm2 ^= key[0] */
+                "pxor   %%xmm0, %%xmm3\n\t"  /* xmm3 ^= key[0] */
+                "pxor   %%xmm0, %%xmm4\n\t"  /* xmm4 ^= key[0] */
+                "pxor   %%xmm0, %%xmm8\n\t"  /* xmm8 ^= key[0] */
+                "pxor   %%xmm0, %%xmm9\n\t"  /* xmm9 ^= key[0] */
+                "pxor   %%xmm0, %%xmm10\n\t" /* xmm10 ^= key[0] */
+                "pxor   %%xmm0, %%xmm11\n\t" /* xmm11 ^= key[0] */
+                "movdqa 0x10(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x20(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x30(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x40(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x50(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x60(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x70(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x80(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0x90(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Ldeclast%=\n\t"
+                aesdec_vec8
+                "movdqa 0xb0(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Ldeclast%=\n\t"
+                aesdec_vec8
+                "movdqa 0xd0(%[key]), %%xmm0\n\t"
+                aesdec_vec8
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Ldeclast%=:\n\t"
+                aesdeclast_vec8
+                : /* no output */
+                : [key] "r" (ctx->keyschdec),
+                  [rounds] "r" (ctx->rounds)
+                : "cc", "memory");
+#undef aesdec_vec8
+#undef aesdeclast_vec8
+}
+#endif /*__x86_64__*/
+
+
 /* Perform a CFB encryption or decryption round using the
    initialization vector IV and the input block A.  Write the result
    to the output block B and update IV.  IV needs to be 16 byte
@@ -1632,6 +1807,181 @@ do_aesni_ctr_4 (const RIJNDAEL_context *ctx,
 #undef aesenclast_xmm1_xmm4
 }
 
+
+#ifdef USE_VAES
+/* The VAES functions process sixteen blocks at a time in the four ZMM
+   registers zmm0 to zmm3.  The round keys are broadcast to all four
+   lanes of zmm4.  All used registers are cleared with vzeroall, which
+   also avoids the AVX-SSE transition penalty of the following AES-NI
+   code.  */
+#define vaes_round(op)                                       \
+  op " %%zmm4, %%zmm0, %%zmm0\n\t"                           \
+  op " %%zmm4, %%zmm1, %%zmm1\n\t"                           \
+  op " %%zmm4, %%zmm2, %%zmm2\n\t"                           \
+  op " %%zmm4, %%zmm3, %%zmm3\n\t"
+#define vaes_key(off)                                        \
+  "vbroadcasti32x4 " #off "(%[key]), %%zmm4\n\t"
+#define vaes_rounds(op, oplast)                              \
+  vaes_key(0x00)                                             \
+  "vpxord %%zmm4, %%zmm0, %%zmm0\n\t"                        \
+  "vpxord %%zmm4, %%zmm1, %%zmm1\n\t"                        \
+  "vpxord %%zmm4, %%zmm2, %%zmm2\n\t"                        \
+  "vpxord %%zmm4, %%zmm3, %%zmm3\n\t"                        \
+  vaes_key(0x10) vaes_round(op)                              \
+  vaes_key(0x20) vaes_round(op)                              \
+  vaes_key(0x30) vaes_round(op)                              \
+  vaes_key(0x40) vaes_round(op)                              \
+  vaes_key(0x50) vaes_round(op)                              \
+  vaes_key(0x60) vaes_round(op)                              \
+  vaes_key(0x70) vaes_round(op)                              \
+  vaes_key(0x80) vaes_round(op)                              \
+  vaes_key(0x90) vaes_round(op)                              \
+  vaes_key(0xa0)                                             \
+  "cmpl $10, %[rounds]\n\t"                                  \
+  "jz .Lvaeslast%=\n\t"                                      \
+  vaes_round(op)                                             \
+  vaes_key(0xb0) vaes_round(op)                              \
+  vaes_key(0xc0)                                             \
+  "cmpl $12, %[rounds]\n\t"                                  \
+  "jz .Lvaeslast%=\n\t"                                      \
+  vaes_round(op)                                             \
+  vaes_key(0xd0) vaes_round(op)                              \
+  vaes_key(0xe0)                                             \
+  ".Lvaeslast%=:\n\t"                                        \
+  vaes_round(oplast)
+
+static const u64 vaes_ctr_add[2][8] __attribute__ ((aligned (64))) =
+  {
+    { 0, 0, 1, 0, 2, 0, 3, 0 },
+    { 4, 0, 4, 0, 4, 0, 4, 0 }
+  };
+
+/* CTR encrypt sixteen blocks.  The caller must make sure that the low
+   64 bits of the counter do not overflow.  */
+static void
+do_vaes_ctr_enc16 (const RIJNDAEL_context *ctx, unsigned char *ctr,
+                   unsigned char *outbuf, const unsigned char *inbuf)
+{
+  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  asm volatile ("vbroadcasti32x4 %[mask], %%zmm5\n\t"
+                "vbroadcasti32x4 %[ctr], %%zmm6\n\t"
+                "vmovdqa64 %[add4], %%zmm7\n\t"
+                "vpshufb %%zmm5, %%zmm6, %%zmm6\n\t"  /* be => le */
+                "vpaddq %[add0], %%zmm6, %%zmm0\n\t"  /* CTR+0..3 */
+                "vpaddq %%zmm7, %%zmm0, %%zmm1\n\t"   /* CTR+4..7 */
+                "vpaddq %%zmm7, %%zmm1, %%zmm2\n\t"   /* CTR+8..11 */
+                "vpaddq %%zmm7, %%zmm2, %%zmm3\n\t"   /* CTR+12..15 */
+                "vpaddq %%zmm7, %%zmm3, %%zmm6\n\t"   /* CTR+16 in lane 0 */
+                "vpshufb %%zmm5, %%zmm6, %%zmm6\n\t"  /* le => be */
+                "vmovdqu %%xmm6, %[ctr]\n\t"
+                "vpshufb %%zmm5, %%zmm0, %%zmm0\n\t"
+                "vpshufb %%zmm5, %%zmm1, %%zmm1\n\t"
+                "vpshufb %%zmm5, %%zmm2, %%zmm2\n\t"
+                "vpshufb %%zmm5, %%zmm3, %%zmm3\n\t"
+                vaes_rounds("vaesenc", "vaesenclast")
+                "vpxord 0*64(%[inbuf]), %%zmm0, %%zmm0\n\t"
+                "vpxord 1*64(%[inbuf]), %%zmm1, %%zmm1\n\t"
+                "vpxord 2*64(%[inbuf]), %%zmm2, %%zmm2\n\t"
+                "vpxord 3*64(%[inbuf]), %%zmm3, %%zmm3\n\t"
+                "vmovdqu64 %%zmm0, 0*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm1, 1*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm2, 2*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm3, 3*64(%[outbuf])\n\t"
+                "vzeroall\n\t"
+                : [ctr] "+m" (*ctr)
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds),
+                  [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf),
+                  [mask] "m" (*be_mask),
+                  [add0] "m" (*vaes_ctr_add[0]),
+                  [add4] "m" (*vaes_ctr_add[1])
+                : "cc", "memory");
+}
+
+
+/* CBC decrypt sixteen blocks.  The ciphertext is kept in zmm8 to
+   zmm11; the blocks to be added to the decrypted data, that is the
+   IV and the first fifteen ciphertext blocks, are shifted into place
+   with valignq.  */
+static void
+do_vaes_cbc_dec16 (const RIJNDAEL_context *ctx, unsigned char *iv,
+                   unsigned char *outbuf, const unsigned char *inbuf)
+{
+  asm volatile ("vmovdqu64 0*64(%[inbuf]), %%zmm8\n\t"
+                "vmovdqu64 1*64(%[inbuf]), %%zmm9\n\t"
+                "vmovdqu64 2*64(%[inbuf]), %%zmm10\n\t"
+                "vmovdqu64 3*64(%[inbuf]), %%zmm11\n\t"
+                "vmovdqa64 %%zmm8, %%zmm0\n\t"
+                "vmovdqa64 %%zmm9, %%zmm1\n\t"
+                "vmovdqa64 %%zmm10, %%zmm2\n\t"
+                "vmovdqa64 %%zmm11, %%zmm3\n\t"
+                vaes_rounds("vaesdec", "vaesdeclast")
+                "vbroadcasti32x4 %[iv], %%zmm12\n\t"
+                "valignq $6, %%zmm12, %%zmm8, %%zmm12\n\t"  /* IV,C0,C1,C2 */
+                "valignq $6, %%zmm8, %%zmm9, %%zmm13\n\t"   /* C3..C6 */
+                "valignq $6, %%zmm9, %%zmm10, %%zmm14\n\t"  /* C7..C10 */
+                "valignq $6, %%zmm10, %%zmm11, %%zmm15\n\t" /* C11..C14 */
+                "vextracti32x4 $3, %%zmm11, %[iv]\n\t"      /* C15 */
+                "vpxord %%zmm12, %%zmm0, %%zmm0\n\t"
+                "vpxord %%zmm13, %%zmm1, %%zmm1\n\t"
+                "vpxord %%zmm14, %%zmm2, %%zmm2\n\t"
+                "vpxord %%zmm15, %%zmm3, %%zmm3\n\t"
+                "vmovdqu64 %%zmm0, 0*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm1, 1*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm2, 2*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm3, 3*64(%[outbuf])\n\t"
+                "vzeroall\n\t"
+                : [iv] "+m" (*iv)
+                : [key] "r" (ctx->keyschdec),
+                  [rounds] "r" (ctx->rounds),
+                  [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf)
+                : "cc", "memory");
+}
+
+
+/* CFB decrypt sixteen blocks.  The IV and the first fifteen
+   ciphertext blocks are encrypted and added to the ciphertext.  */
+static void
+do_vaes_cfb_dec16 (const RIJNDAEL_context *ctx, unsigned char *iv,
+                   unsigned char *outbuf, const unsigned char *inbuf)
+{
+  asm volatile ("vmovdqu64 0*64(%[inbuf]), %%zmm8\n\t"
+                "vmovdqu64 1*64(%[inbuf]), %%zmm9\n\t"
+                "vmovdqu64 2*64(%[inbuf]), %%zmm10\n\t"
+                "vmovdqu64 3*64(%[inbuf]), %%zmm11\n\t"
+                "vbroadcasti32x4 %[iv], %%zmm0\n\t"
+                "valignq $6, %%zmm0, %%zmm8, %%zmm0\n\t"    /* IV,C0,C1,C2 */
+                "valignq $6, %%zmm8, %%zmm9, %%zmm1\n\t"    /* C3..C6 */
+                "valignq $6, %%zmm9, %%zmm10, %%zmm2\n\t"   /* C7..C10 */
+                "valignq $6, %%zmm10, %%zmm11, %%zmm3\n\t"  /* C11..C14 */
+                "vextracti32x4 $3, %%zmm11, %[iv]\n\t"      /* C15 */
+                vaes_rounds("vaesenc", "vaesenclast")
+                "vpxord %%zmm8, %%zmm0, %%zmm0\n\t"
+                "vpxord %%zmm9, %%zmm1, %%zmm1\n\t"
+                "vpxord %%zmm10, %%zmm2, %%zmm2\n\t"
+                "vpxord %%zmm11, %%zmm3, %%zmm3\n\t"
+                "vmovdqu64 %%zmm0, 0*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm1, 1*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm2, 2*64(%[outbuf])\n\t"
+                "vmovdqu64 %%zmm3, 3*64(%[outbuf])\n\t"
+                "vzeroall\n\t"
+                : [iv] "+m" (*iv)
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds),
+                  [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf)
+                : "cc", "memory");
+}
+
+#undef vaes_round
+#undef vaes_key
+#undef vaes_rounds
+#endif /*USE_VAES*/
+
 #endif /*USE_AESNI*/
 
 
@@ -1856,6 +2206,20 @@ _gcry_aes_ctr_enc (void *context, unsigned char *ctr,
 
       aesni_prepare ();
 
+#ifdef USE_VAES
+      /* The VAES code does not handle a carry out of the low 64 bits
+         of the counter; these rare cases are left to the AES-NI
+         code.  */
+      if (ctx->use_vaes)
+        for ( ;nblocks >= 16
+                && buf_get_be64 (ctr + 8) <= (u64)0 - 17; nblocks -= 16 )
+          {
+            do_vaes_ctr_enc16 (ctx, ctr, outbuf, inbuf);
+            outbuf += 16*BLOCKSIZE;
+            inbuf  += 16*BLOCKSIZE;
+          }
+#endif /*USE_VAES*/
+
       asm volatile ("movdqa %[mask], %%xmm6\n\t" /* Preload mask */
                     "movdqa %[ctr], %%xmm5\n\t"  /* Preload CTR */
                     : /* No output */
@@ -2126,6 +2490,16 @@ _gcry_aes_cfb_dec (void *context, unsigned char *iv,
     {
       aesni_prepare ();
 
+#ifdef USE_VAES
+      if (ctx->use_vaes)
+        for ( ;nblocks >= 16; nblocks -= 16)
+          {
+            do_vaes_cfb_dec16 (ctx, iv, outbuf, inbuf);
+            outbuf += 16*BLOCKSIZE;
+            inbuf  += 16*BLOCKSIZE;
+          }
+#endif /*USE_VAES*/
+
       /* CFB decryption can be parallelized */
       for ( ;nblocks >= 4; nblocks -= 4)
         {
@@ -2220,6 +2594,16 @@ _gcry_aes_cbc_dec (void *context, unsigned char *iv,
     {
       aesni_prepare ();
 
+#ifdef USE_VAES
+      if (ctx->use_vaes)
+        for ( ;nblocks >= 16; nblocks -= 16)
+          {
+            do_vaes_cbc_dec16 (ctx, iv, outbuf, inbuf);
+            outbuf += 16*BLOCKSIZE;
+            inbuf  += 16*BLOCKSIZE;
+          }
+#endif /*USE_VAES*/
+
       asm volatile
         ("movdqu %[iv], %%xmm5\n\t"	/* use xmm5 as fast IV storage */
          : /* No output */
@@ -2332,6 +2716,700 @@ _gcry_aes_cbc_dec (void *context, unsigned char *iv,
 }
 
 
+#ifdef USE_AESNI
+/* Process one OCB data block from INBUF to OUTBUF using the single
+   block AES-NI functions.  The OCB state is kept in the handle C;
+   L_TMP is a scratch buffer for ocb_get_l.  */
+static inline void
+do_aesni_ocb_block (gcry_cipher_hd_t c, RIJNDAEL_context *ctx,
+                    unsigned char *outbuf, const unsigned char *inbuf,
+                    unsigned char *l_tmp, int encrypt)
+{
+  const unsigned char *l;
+
+  l = ocb_get_l (c, l_tmp, ++c->u_mode.ocb.data_nblocks);
+
+  /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+  buf_xor (c->u_iv.iv, c->u_iv.iv, l, BLOCKSIZE);
+  /* Checksum_i = Checksum_{i-1} xor P_i  */
+  if (encrypt)
+    buf_xor (c->u_ctr.ctr, c->u_ctr.ctr, inbuf, BLOCKSIZE);
+  /* C_i = Offset_i xor ENCIPHER(K, P_i xor Offset_i)  */
+  buf_xor (outbuf, c->u_iv.iv, inbuf, BLOCKSIZE);
+  if (encrypt)
+    do_aesni_enc (ctx, outbuf, outbuf);
+  else
+    do_aesni_dec (ctx, outbuf, outbuf);
+  buf_xor (outbuf, c->u_iv.iv, outbuf, BLOCKSIZE);
+  if (!encrypt)
+    buf_xor (c->u_ctr.ctr, c->u_ctr.ctr, outbuf, BLOCKSIZE);
+}
+
+
+#ifdef __x86_64__
+/* Process eight OCB data blocks from INBUF to OUTBUF.  The block
+   counter must be a multiple of eight so that the L values of the
+   first seven blocks are L_0, L_1, L_0, L_2, L_0, L_1, L_0; L8 is the
+   L value of the last block.  The offsets are parked in OUTBUF while
+   the blocks are en- or decrypted.  */
+static void
+do_aesni_ocb_vec8 (gcry_cipher_hd_t c, RIJNDAEL_context *ctx,
+                   unsigned char *outbuf, const unsigned char *inbuf,
+                   const unsigned char *l8, int encrypt)
+{
+#define ocb_input_xor(j, lref, xreg)                                \
+  "movdqu " lref ", %%xmm0\n\t"                                     \
+  "pxor   %%xmm0, %%xmm5\n\t"             /* xmm5 ^= L */           \
+  "movdqu " #j "*16(%[inbuf]), %%" xreg "\n\t"                      \
+  "movdqu %%xmm5, " #j "*16(%[outbuf])\n\t"                         \
+  "pxor   %%" xreg ", %%xmm6\n\t"         /* xmm6 ^= input */       \
+  "pxor   %%xmm5, %%" xreg "\n\t"         /* xreg ^= offset */
+#define ocb_output_xor(j, xreg)                                     \
+  "movdqu " #j "*16(%[outbuf]), %%xmm0\n\t"                         \
+  "pxor   %%xmm0, %%" xreg "\n\t"         /* xreg ^= offset */      \
+  "movdqu %%" xreg ", " #j "*16(%[outbuf])\n\t"                     \
+  "pxor   %%" xreg ", %%xmm7\n\t"         /* xmm7 ^= output */
+
+  /* Both the input and the output blocks are summed up; the
+     plaintext sum is then added to the checksum.  */
+  asm volatile ("movdqu %[offset], %%xmm5\n\t"
+                "pxor   %%xmm6, %%xmm6\n\t"
+                "pxor   %%xmm7, %%xmm7\n\t"
+                ocb_input_xor(0, "0*16(%[l])", "xmm1")
+                ocb_input_xor(1, "1*16(%[l])", "xmm2")
+                ocb_input_xor(2, "0*16(%[l])", "xmm3")
+                ocb_input_xor(3, "2*16(%[l])", "xmm4")
+                ocb_input_xor(4, "0*16(%[l])", "xmm8")
+                ocb_input_xor(5, "1*16(%[l])", "xmm9")
+                ocb_input_xor(6, "0*16(%[l])", "xmm10")
+                ocb_input_xor(7, "(%[l8])", "xmm11")
+                "movdqu %%xmm5, %[offset]\n\t"
+                : [offset] "+m" (*c->u_iv.iv)
+                : [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf),
+                  [l] "r" (c->u_mode.ocb.L[0]),
+                  [l8] "r" (l8)
+                : "memory");
+
+  if (encrypt)
+    do_aesni_enc_vec8 (ctx);
+  else
+    do_aesni_dec_vec8 (ctx);
+
+  asm volatile (ocb_output_xor(0, "xmm1")
+                ocb_output_xor(1, "xmm2")
+                ocb_output_xor(2, "xmm3")
+                ocb_output_xor(3, "xmm4")
+                ocb_output_xor(4, "xmm8")
+                ocb_output_xor(5, "xmm9")
+                ocb_output_xor(6, "xmm10")
+                ocb_output_xor(7, "xmm11")
+                : /* No output */
+                : [outbuf] "r" (outbuf)
+                : "memory");
+
+  if (encrypt)
+    asm volatile ("movdqu %[ctr], %%xmm0\n\t"
+                  "pxor   %%xmm6, %%xmm0\n\t"
+                  "movdqu %%xmm0, %[ctr]\n\t"
+                  : [ctr] "+m" (*c->u_ctr.ctr)
+                  :
+                  : "memory");
+  else
+    asm volatile ("movdqu %[ctr], %%xmm0\n\t"
+                  "pxor   %%xmm7, %%xmm0\n\t"
+                  "movdqu %%xmm0, %[ctr]\n\t"
+                  : [ctr] "+m" (*c->u_ctr.ctr)
+                  :
+                  : "memory");
+
+#undef ocb_input_xor
+#undef ocb_output_xor
+}
+
+
+/* Process eight OCB blocks of additional data from ABUF.  The block
+   counter must be a multiple of eight; L8 is the L value of the last
+   block.  */
+static void
+do_aesni_ocb_auth_vec8 (gcry_cipher_hd_t c, RIJNDAEL_context *ctx,
+                        const unsigned char *abuf, const unsigned char *l8)
+{
+#define ocb_input_xor(j, lref, xreg)                                \
+  "movdqu " lref ", %%xmm0\n\t"                                     \
+  "pxor   %%xmm0, %%xmm5\n\t"             /* xmm5 ^= L */           \
+  "movdqu " #j "*16(%[abuf]), %%" xreg "\n\t"                       \
+  "pxor   %%xmm5, %%" xreg "\n\t"         /* xreg ^= offset */
+
+  asm volatile ("movdqu %[offset], %%xmm5\n\t"
+                ocb_input_xor(0, "0*16(%[l])", "xmm1")
+                ocb_input_xor(1, "1*16(%[l])", "xmm2")
+                ocb_input_xor(2, "0*16(%[l])", "xmm3")
+                ocb_input_xor(3, "2*16(%[l])", "xmm4")
+                ocb_input_xor(4, "0*16(%[l])", "xmm8")
+                ocb_input_xor(5, "1*16(%[l])", "xmm9")
+                ocb_input_xor(6, "0*16(%[l])", "xmm10")
+                ocb_input_xor(7, "(%[l8])", "xmm11")
+                "movdqu %%xmm5, %[offset]\n\t"
+                : [offset] "+m" (*c->u_mode.ocb.aad_offset)
+                : [abuf] "r" (abuf),
+                  [l] "r" (c->u_mode.ocb.L[0]),
+                  [l8] "r" (l8)
+                : "memory");
+
+  do_aesni_enc_vec8 (ctx);
+
+  asm volatile ("movdqu %[sum], %%xmm6\n\t"
+                "pxor   %%xmm1, %%xmm6\n\t"
+                "pxor   %%xmm2, %%xmm6\n\t"
+                "pxor   %%xmm3, %%xmm6\n\t"
+                "pxor   %%xmm4, %%xmm6\n\t"
+                "pxor   %%xmm8, %%xmm6\n\t"
+                "pxor   %%xmm9, %%xmm6\n\t"
+                "pxor   %%xmm10, %%xmm6\n\t"
+                "pxor   %%xmm11, %%xmm6\n\t"
+                "movdqu %%xmm6, %[sum]\n\t"
+                : [sum] "+m" (*c->u_mode.ocb.aad_sum)
+                :
+                : "memory");
+
+#undef ocb_input_xor
+}
+
+/* Clear the extra SSE registers used by the eight block functions.  */
+# define aesni_cleanup_7_11()                                           \
+  do { asm volatile ("pxor %%xmm7, %%xmm7\n\t"                          \
+                     "pxor %%xmm8, %%xmm8\n\t"                          \
+                     "pxor %%xmm9, %%xmm9\n\t"                          \
+                     "pxor %%xmm10, %%xmm10\n\t"                        \
+                     "pxor %%xmm11, %%xmm11\n" :: );                    \
+  } while (0)
+#endif /*__x86_64__*/
+#endif /*USE_AESNI*/
+
+
+/* Bulk encryption or decryption of complete blocks in OCB mode.  The
+   offset, the checksum and the block counter are taken from and
+   stored back to the cipher handle C.  This function is only intended
+   for the bulk encryption feature of cipher.c. */
+void
+_gcry_aes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                     const void *inbuf_arg, size_t nblocks, int encrypt)
+{
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  unsigned char l_tmp[BLOCKSIZE];
+  unsigned int burn_depth = 0;
+  unsigned int nburn;
+
+  if (!encrypt)
+    check_decryption_preparation (ctx);
+
+  if (0)
+    ;
+#ifdef USE_AESNI
+  else if (ctx->use_aesni)
+    {
+      aesni_prepare ();
+
+#ifdef __x86_64__
+      /* Process single blocks until the block counter is a multiple
+         of eight; from there on the L values of a group of eight
+         blocks are known except for the last one.  */
+      for ( ;nblocks > 7 && (c->u_mode.ocb.data_nblocks % 8); nblocks-- )
+        {
+          do_aesni_ocb_block (c, ctx, outbuf, inbuf, l_tmp, encrypt);
+          outbuf += BLOCKSIZE;
+          inbuf  += BLOCKSIZE;
+        }
+
+      for ( ;nblocks > 7 ; nblocks -= 8 )
+        {
+          const unsigned char *l8;
+
+          /* ocb_get_l may need to call a function and thus must be
+             used before the SSE registers are loaded.  */
+          l8 = ocb_get_l (c, l_tmp, c->u_mode.ocb.data_nblocks + 8);
+          do_aesni_ocb_vec8 (c, ctx, outbuf, inbuf, l8, encrypt);
+          c->u_mode.ocb.data_nblocks += 8;
+          outbuf += 8*BLOCKSIZE;
+          inbuf  += 8*BLOCKSIZE;
+        }
+
+      aesni_cleanup_7_11 ();
+#endif /*__x86_64__*/
+
+      for ( ;nblocks; nblocks-- )
+        {
+          do_aesni_ocb_block (c, ctx, outbuf, inbuf, l_tmp, encrypt);
+          outbuf += BLOCKSIZE;
+          inbuf  += BLOCKSIZE;
+        }
+
+      aesni_cleanup ();
+      aesni_cleanup_2_6 ();
+    }
+#endif /*USE_AESNI*/
+  else
+    {
+      for ( ;nblocks; nblocks-- )
+        {
+          const unsigned char *l;
+
+          l = ocb_get_l (c, l_tmp, ++c->u_mode.ocb.data_nblocks);
+
+          /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+          buf_xor (c->u_iv.iv, c->u_iv.iv, l, BLOCKSIZE);
+          /* Checksum_i = Checksum_{i-1} xor P_i  */
+          if (encrypt)
+            buf_xor (c->u_ctr.ctr, c->u_ctr.ctr, inbuf, BLOCKSIZE);
+          /* C_i = Offset_i xor ENCIPHER(K, P_i xor Offset_i)  */
+          buf_xor (outbuf, c->u_iv.iv, inbuf, BLOCKSIZE);
+          if (encrypt)
+            nburn = rijndael_encrypt (ctx, outbuf, outbuf);
+          else
+            nburn = rijndael_decrypt (ctx, outbuf, outbuf);
+          burn_depth = nburn > burn_depth ? nburn : burn_depth;
+          buf_xor (outbuf, c->u_iv.iv, outbuf, BLOCKSIZE);
+          if (!encrypt)
+            buf_xor (c->u_ctr.ctr, c->u_ctr.ctr, outbuf, BLOCKSIZE);
+
+          outbuf += BLOCKSIZE;
+          inbuf  += BLOCKSIZE;
+        }
+    }
+
+  wipememory (l_tmp, sizeof l_tmp);
+
+  if (burn_depth)
+    _gcry_burn_stack (burn_depth + 4 * sizeof(void *));
+}
+
+
+/* Bulk authentication of complete blocks of additional data in OCB
+   mode.  This function is only intended for the bulk encryption
+   feature of cipher.c. */
+void
+_gcry_aes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg, size_t nblocks)
+{
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  const unsigned char *abuf = abuf_arg;
+  unsigned char l_tmp[BLOCKSIZE];
+  unsigned char tmp[BLOCKSIZE];
+  unsigned int burn_depth = 0;
+  unsigned int nburn;
+  const unsigned char *l;
+
+#if defined(USE_AESNI) && defined(__x86_64__)
+  if (ctx->use_aesni && nblocks > 7)
+    {
+      aesni_prepare ();
+
+      for ( ;nblocks > 7 && (c->u_mode.ocb.aad_nblocks % 8); nblocks-- )
+        {
+          l = ocb_get_l (c, l_tmp, ++c->u_mode.ocb.aad_nblocks);
+          buf_xor (c->u_mode.ocb.aad_offset, c->u_mode.ocb.aad_offset, l,
+                   BLOCKSIZE);
+          buf_xor (tmp, c->u_mode.ocb.aad_offset, abuf, BLOCKSIZE);
+          do_aesni_enc (ctx, tmp, tmp);
+          buf_xor (c->u_mode.ocb.aad_sum, c->u_mode.ocb.aad_sum, tmp,
+                   BLOCKSIZE);
+          abuf += BLOCKSIZE;
+        }
+
+      for ( ;nblocks > 7 ; nblocks -= 8 )
+        {
+          l = ocb_get_l (c, l_tmp, c->u_mode.ocb.aad_nblocks + 8);
+          do_aesni_ocb_auth_vec8 (c, ctx, abuf, l);
+          c->u_mode.ocb.aad_nblocks += 8;
+          abuf += 8*BLOCKSIZE;
+        }
+
+      aesni_cleanup_7_11 ();
+      aesni_cleanup ();
+      aesni_cleanup_2_6 ();
+    }
+#endif /*USE_AESNI && __x86_64__*/
+
+  /* The remaining blocks or all blocks if there is no fast path.  */
+  for ( ;nblocks; nblocks-- )
+    {
+      l = ocb_get_l (c, l_tmp, ++c->u_mode.ocb.aad_nblocks);
+
+      /* Offset_i = Offset_{i-1} xor L_{ntz(i)} */
+      buf_xor (c->u_mode.ocb.aad_offset, c->u_mode.ocb.aad_offset, l,
+               BLOCKSIZE);
+      /* Sum_i = Sum_{i-1} xor ENCIPHER(K, A_i xor Offset_i)  */
+      buf_xor (tmp, c->u_mode.ocb.aad_offset, abuf, BLOCKSIZE);
+      nburn = rijndael_encrypt (ctx, tmp, tmp);
+      burn_depth = nburn > burn_depth ? nburn : burn_depth;
+      buf_xor (c->u_mode.ocb.aad_sum, c->u_mode.ocb.aad_sum, tmp, BLOCKSIZE);
+
+      abuf += BLOCKSIZE;
+    }
+
+  wipememory (l_tmp, sizeof l_tmp);
+  wipememory (tmp, sizeof tmp);
+
+  if (burn_depth)
+    _gcry_burn_stack (burn_depth + 4 * sizeof(void *));
+}
+
+
+
+#if defined(USE_AESNI) && defined(__x86_64__) && defined(GCM_USE_INTEL_PCLMUL)
+static const unsigned char gcm_be_mask[16] __attribute__ ((aligned (16))) =
+  { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+static const u32 gcm_ctr_one[4] __attribute__ ((aligned (16))) =
+  { 1, 0, 0, 0 };
+
+/* The GHASH part of the stitched GCM functions.  Eight blocks from
+   HBUF are multiplied by H⁸ to H¹ and the products are summed up in
+   <xmm6:xmm5> with the middle terms in xmm7, so that a single
+   reduction is needed for all eight blocks.  The hash value is kept
+   in little-endian order in xmm15 between the calls.  It is added to
+   the first block, which is therefore multiplied last to keep the
+   dependency chain from one group to the next short.  H¹ is at H1,
+   H² to H⁸ are stored in this order at HTAB.  xmm12 to xmm14 are
+   scratch.  */
+#define gcm_ghash_load(j)                                           \
+  "movdqu " #j "*16(%[hbuf]), %%xmm12\n\t"                          \
+  "pshufb %[be_mask], %%xmm12\n\t"        /* be => le */
+#define gcm_ghash_first(j, hpow)                                    \
+  gcm_ghash_load(j)                                                 \
+  "movdqu " hpow ", %%xmm13\n\t"                                    \
+  "movdqa %%xmm12, %%xmm5\n\t"                                      \
+  "pclmulqdq $0x00, %%xmm13, %%xmm5\n\t"  /* xmm5 = a0*b0 */        \
+  "movdqa %%xmm12, %%xmm6\n\t"                                      \
+  "pclmulqdq $0x11, %%xmm13, %%xmm6\n\t"  /* xmm6 = a1*b1 */        \
+  "movdqa %%xmm12, %%xmm7\n\t"                                      \
+  "pclmulqdq $0x01, %%xmm13, %%xmm7\n\t"                            \
+  "pclmulqdq $0x10, %%xmm13, %%xmm12\n\t"                           \
+  "pxor   %%xmm12, %%xmm7\n\t"            /* xmm7 = a0*b1+a1*b0 */
+#define gcm_ghash_step(j, hpow)                                     \
+  gcm_ghash_load(j)                                                 \
+  gcm_ghash_step_mul(hpow)
+#define gcm_ghash_step_mul(hpow)                                    \
+  "movdqu " hpow ", %%xmm13\n\t"                                    \
+  "movdqa %%xmm12, %%xmm14\n\t"                                     \
+  "pclmulqdq $0x00, %%xmm13, %%xmm14\n\t"                           \
+  "pxor   %%xmm14, %%xmm5\n\t"            /* xmm5 += a0*b0 */       \
+  "movdqa %%xmm12, %%xmm14\n\t"                                     \
+  "pclmulqdq $0x11, %%xmm13, %%xmm14\n\t"                           \
+  "pxor   %%xmm14, %%xmm6\n\t"            /* xmm6 += a1*b1 */       \
+  "movdqa %%xmm12, %%xmm14\n\t"                                     \
+  "pclmulqdq $0x01, %%xmm13, %%xmm14\n\t"                           \
+  "pclmulqdq $0x10, %%xmm13, %%xmm12\n\t"                           \
+  "pxor   %%xmm14, %%xmm7\n\t"                                      \
+  "pxor   %%xmm12, %%xmm7\n\t"            /* xmm7 += a0*b1+a1*b0 */
+#define gcm_ghash_last(hpow)                                        \
+  gcm_ghash_load(0)                                                 \
+  "pxor   %%xmm15, %%xmm12\n\t"           /* X_0 ^= hash */         \
+  gcm_ghash_step_mul(hpow)
+/* Same reduction as in gfmul_pclmul of cipher-gcm.c.  */
+#define gcm_ghash_reduce                                            \
+  "movdqa %%xmm7, %%xmm12\n\t"                                      \
+  "psrldq $8, %%xmm7\n\t"                                           \
+  "pslldq $8, %%xmm12\n\t"                                          \
+  "pxor   %%xmm12, %%xmm5\n\t"                                      \
+  "pxor   %%xmm7, %%xmm6\n\t"  /* <xmm6:xmm5> holds the product */  \
+  "movdqa %%xmm5, %%xmm12\n\t"                                      \
+  "movdqa %%xmm6, %%xmm13\n\t"                                      \
+  "pslld  $1, %%xmm5\n\t"                                           \
+  "pslld  $1, %%xmm6\n\t"                                           \
+  "psrld  $31, %%xmm12\n\t"                                         \
+  "psrld  $31, %%xmm13\n\t"                                         \
+  "movdqa %%xmm12, %%xmm15\n\t"                                     \
+  "pslldq $4, %%xmm13\n\t"                                          \
+  "pslldq $4, %%xmm12\n\t"                                          \
+  "psrldq $12, %%xmm15\n\t"                                         \
+  "por    %%xmm12, %%xmm5\n\t"                                      \
+  "por    %%xmm13, %%xmm6\n\t"                                      \
+  "por    %%xmm6, %%xmm15\n\t"                                      \
+  "movdqa %%xmm5, %%xmm6\n\t"                                       \
+  "movdqa %%xmm5, %%xmm7\n\t"                                       \
+  "pslld  $31, %%xmm6\n\t"                                          \
+  "movdqa %%xmm5, %%xmm13\n\t"                                      \
+  "pslld  $30, %%xmm7\n\t"                                          \
+  "pslld  $25, %%xmm13\n\t"                                         \
+  "pxor   %%xmm7, %%xmm6\n\t"                                       \
+  "pxor   %%xmm13, %%xmm6\n\t"                                      \
+  "movdqa %%xmm6, %%xmm7\n\t"                                       \
+  "pslldq $12, %%xmm6\n\t"                                          \
+  "psrldq $4, %%xmm7\n\t"                                           \
+  "pxor   %%xmm6, %%xmm5\n\t"  /* first phase done */               \
+  "movdqa %%xmm5, %%xmm14\n\t"                                      \
+  "movdqa %%xmm5, %%xmm12\n\t"                                      \
+  "psrld  $1, %%xmm14\n\t"                                          \
+  "movdqa %%xmm5, %%xmm13\n\t"                                      \
+  "psrld  $2, %%xmm12\n\t"                                          \
+  "psrld  $7, %%xmm13\n\t"                                          \
+  "pxor   %%xmm12, %%xmm14\n\t"                                     \
+  "pxor   %%xmm13, %%xmm14\n\t"                                     \
+  "pxor   %%xmm7, %%xmm14\n\t"                                      \
+  "pxor   %%xmm14, %%xmm5\n\t"                                      \
+  "pxor   %%xmm5, %%xmm15\n\t"
+
+#define aesenc_vec8                                          \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdc, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdc, 0xd8\n\t" /* xmm11 */
+#define aesenclast_vec8                                      \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xc8\n\t"       /* xmm1 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd0\n\t"       /* xmm2 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xd8\n\t"       /* xmm3 */  \
+  ".byte 0x66, 0x0f, 0x38, 0xdd, 0xe0\n\t"       /* xmm4 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc0\n\t" /* xmm8 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xc8\n\t" /* xmm9 */  \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd0\n\t" /* xmm10 */ \
+  ".byte 0x66, 0x44, 0x0f, 0x38, 0xdd, 0xd8\n\t" /* xmm11 */
+#define gcm_round(n)                                         \
+  "movdqa " #n "*16(%[key]), %%xmm0\n\t"                     \
+  aesenc_vec8
+#define gcm_ctr_block(xreg)                                  \
+  "movdqa %%xmm0, %%" xreg "\n\t"                            \
+  "pshufb %[be_mask], %%" xreg "\n\t"     /* le => be */     \
+  "paddd  %[one], %%xmm0\n\t"
+#define gcm_output_xor(j, xreg)                              \
+  "movdqu " #j "*16(%[inbuf]), %%xmm0\n\t"                   \
+  "pxor   %%xmm0, %%" xreg "\n\t"                            \
+  "movdqu %%" xreg ", " #j "*16(%[outbuf])\n\t"
+
+/* Hash eight blocks from HBUF into the hash value in xmm15 without
+   any encryption.  */
+static void
+do_aesni_gcm_ghash8 (gcry_cipher_hd_t c, const unsigned char *hbuf)
+{
+  asm volatile (gcm_ghash_first(1, "5*16(%[htab])")
+                gcm_ghash_step(2, "4*16(%[htab])")
+                gcm_ghash_step(3, "3*16(%[htab])")
+                gcm_ghash_step(4, "2*16(%[htab])")
+                gcm_ghash_step(5, "1*16(%[htab])")
+                gcm_ghash_step(6, "0*16(%[htab])")
+                gcm_ghash_step(7, "(%[h1])")
+                gcm_ghash_last("6*16(%[htab])")
+                gcm_ghash_reduce
+                : /* No output */
+                : [hbuf] "r" (hbuf),
+                  [h1] "r" (c->u_mode.gcm.u_ghash_key.key),
+                  [htab] "r" (c->u_mode.gcm.gcm_table),
+                  [be_mask] "m" (*gcm_be_mask)
+                : "cc", "memory");
+}
+
+
+/* Encrypt eight GCM counter blocks and add them to INBUF, storing the
+   result in OUTBUF.  If HBUF is not NULL, eight blocks from HBUF are
+   hashed into the GCM tag while the AES rounds are running; for
+   decryption HBUF is INBUF, for encryption it is the output of the
+   previous call.  The AES state is kept in xmm1 to xmm4 and xmm8 to
+   xmm11 as in do_aesni_enc_vec8, GHASH uses xmm5 to xmm7 and xmm12
+   to xmm15.  The low 32 bits of the counter must not wrap.  */
+static void
+do_aesni_gcm_vec8 (gcry_cipher_hd_t c, const RIJNDAEL_context *ctx,
+                   unsigned char *outbuf, const unsigned char *inbuf,
+                   const unsigned char *hbuf)
+{
+  asm volatile ("movdqu %[ctr], %%xmm0\n\t"
+                "pshufb %[be_mask], %%xmm0\n\t" /* be => le */
+                gcm_ctr_block("xmm1")
+                gcm_ctr_block("xmm2")
+                gcm_ctr_block("xmm3")
+                gcm_ctr_block("xmm4")
+                gcm_ctr_block("xmm8")
+                gcm_ctr_block("xmm9")
+                gcm_ctr_block("xmm10")
+                gcm_ctr_block("xmm11")
+                "pshufb %[be_mask], %%xmm0\n\t" /* le => be */
+                "movdqu %%xmm0, %[ctr]\n\t"
+                "movdqa (%[key]), %%xmm0\n\t"
+                "pxor   %%xmm0, %%xmm1\n\t"
+                "pxor   %%xmm0, %%xmm2\n\t"
+                "pxor   %%xmm0, %%xmm3\n\t"
+                "pxor   %%xmm0, %%xmm4\n\t"
+                "pxor   %%xmm0, %%xmm8\n\t"
+                "pxor   %%xmm0, %%xmm9\n\t"
+                "pxor   %%xmm0, %%xmm10\n\t"
+                "pxor   %%xmm0, %%xmm11\n\t"
+                : [ctr] "+m" (*c->u_ctr.ctr)
+                : [key] "r" (ctx->keyschenc),
+                  [be_mask] "m" (*gcm_be_mask),
+                  [one] "m" (*gcm_ctr_one)
+                : "cc", "memory");
+
+  /* Rounds 1 to 9 exist for all key sizes; the GHASH of eight blocks
+     and its reduction are spread over them.  */
+  if (hbuf)
+    asm volatile (gcm_round(1)
+                  gcm_ghash_first(1, "5*16(%[htab])")
+                  gcm_round(2)
+                  gcm_ghash_step(2, "4*16(%[htab])")
+                  gcm_round(3)
+                  gcm_ghash_step(3, "3*16(%[htab])")
+                  gcm_round(4)
+                  gcm_ghash_step(4, "2*16(%[htab])")
+                  gcm_round(5)
+                  gcm_ghash_step(5, "1*16(%[htab])")
+                  gcm_round(6)
+                  gcm_ghash_step(6, "0*16(%[htab])")
+                  gcm_round(7)
+                  gcm_ghash_step(7, "(%[h1])")
+                  gcm_round(8)
+                  gcm_ghash_last("6*16(%[htab])")
+                  gcm_round(9)
+                  gcm_ghash_reduce
+                  : /* No output */
+                  : [key] "r" (ctx->keyschenc),
+                    [hbuf] "r" (hbuf),
+                    [h1] "r" (c->u_mode.gcm.u_ghash_key.key),
+                    [htab] "r" (c->u_mode.gcm.gcm_table),
+                    [be_mask] "m" (*gcm_be_mask)
+                  : "cc", "memory");
+  else
+    asm volatile (gcm_round(1)
+                  gcm_round(2)
+                  gcm_round(3)
+                  gcm_round(4)
+                  gcm_round(5)
+                  gcm_round(6)
+                  gcm_round(7)
+                  gcm_round(8)
+                  gcm_round(9)
+                  : /* No output */
+                  : [key] "r" (ctx->keyschenc)
+                  : "cc", "memory");
+
+  asm volatile ("movdqa 0xa0(%[key]), %%xmm0\n\t"
+                "cmpl $10, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_vec8
+                "movdqa 0xb0(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0xc0(%[key]), %%xmm0\n\t"
+                "cmpl $12, %[rounds]\n\t"
+                "jz .Lenclast%=\n\t"
+                aesenc_vec8
+                "movdqa 0xd0(%[key]), %%xmm0\n\t"
+                aesenc_vec8
+                "movdqa 0xe0(%[key]), %%xmm0\n"
+
+                ".Lenclast%=:\n\t"
+                aesenclast_vec8
+                gcm_output_xor(0, "xmm1")
+                gcm_output_xor(1, "xmm2")
+                gcm_output_xor(2, "xmm3")
+                gcm_output_xor(3, "xmm4")
+                gcm_output_xor(4, "xmm8")
+                gcm_output_xor(5, "xmm9")
+                gcm_output_xor(6, "xmm10")
+                gcm_output_xor(7, "xmm11")
+                : /* No output */
+                : [key] "r" (ctx->keyschenc),
+                  [rounds] "r" (ctx->rounds),
+                  [inbuf] "r" (inbuf),
+                  [outbuf] "r" (outbuf)
+                : "cc", "memory");
+}
+
+#undef gcm_ghash_load
+#undef gcm_ghash_first
+#undef gcm_ghash_step
+#undef gcm_ghash_step_mul
+#undef gcm_ghash_last
+#undef gcm_ghash_reduce
+#undef aesenc_vec8
+#undef aesenclast_vec8
+#undef gcm_round
+#undef gcm_ctr_block
+#undef gcm_output_xor
+#endif /*USE_AESNI && __x86_64__ && GCM_USE_INTEL_PCLMUL*/
+
+
+/* Bulk encryption or decryption of complete blocks in GCM mode with
+   the CTR encryption and the GHASH done in a single pass.  The
+   counter and the tag are taken from and stored back to the cipher
+   handle C.  Returns the number of blocks processed, which may be
+   less than NBLOCKS or zero; the caller handles the remaining blocks
+   the usual way.  This function is only intended for the bulk
+   encryption feature of cipher.c. */
+size_t
+_gcry_aes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                     const void *inbuf_arg, size_t nblocks, int encrypt)
+{
+#if defined(USE_AESNI) && defined(__x86_64__) && defined(GCM_USE_INTEL_PCLMUL)
+  RIJNDAEL_context *ctx = (void *)&c->context.c;
+  unsigned char *outbuf = outbuf_arg;
+  const unsigned char *inbuf = inbuf_arg;
+  size_t done = 0;
+
+  if (!ctx->use_aesni || !c->u_mode.gcm.use_intel_pclmul)
+    return 0;
+#if defined(USE_VAES) && defined(GCM_USE_INTEL_VPCLMUL)
+  /* Separate sixteen block passes of VAES CTR and VPCLMUL GHASH are
+     faster than this eight block stitched code.  */
+  if (ctx->use_vaes && c->u_mode.gcm.use_intel_vpclmul)
+    return 0;
+#endif
+
+  aesni_prepare ();
+
+  asm volatile ("movdqu %[hash], %%xmm15\n\t"
+                "pshufb %[be_mask], %%xmm15\n\t" /* be => le */
+                : /* No output */
+                : [hash] "m" (*c->u_mode.gcm.u_tag.tag),
+                  [be_mask] "m" (*gcm_be_mask)
+                : "memory");
+
+  /* The eight counter blocks are generated with a 32 bit addition,
+     which is the same as the 128 bit increment of the CTR mode as
+     long as the low word does not wrap.  */
+  for ( ;nblocks - done > 7
+          && buf_get_be32 (c->u_ctr.ctr + 12) <= 0xfffffff7; done += 8)
+    {
+      if (encrypt)
+        do_aesni_gcm_vec8 (c, ctx, outbuf, inbuf,
+                           done ? outbuf - 8*BLOCKSIZE : NULL);
+      else
+        do_aesni_gcm_vec8 (c, ctx, outbuf, inbuf, inbuf);
+      outbuf += 8*BLOCKSIZE;
+      inbuf  += 8*BLOCKSIZE;
+    }
+
+  /* The ciphertext of the last group has not yet been hashed.  */
+  if (encrypt && done)
+    do_aesni_gcm_ghash8 (c, outbuf - 8*BLOCKSIZE);
+
+  asm volatile ("pshufb %[be_mask], %%xmm15\n\t" /* le => be */
+                "movdqu %%xmm15, %[hash]\n\t"
+                : [hash] "=m" (*c->u_mode.gcm.u_tag.tag)
+                : [be_mask] "m" (*gcm_be_mask)
+                : "memory");
+
+  aesni_cleanup ();
+  aesni_cleanup_2_6 ();
+  aesni_cleanup_7_11 ();
+  asm volatile ("pxor %%xmm12, %%xmm12\n\t"
+                "pxor %%xmm13, %%xmm13\n\t"
+                "pxor %%xmm14, %%xmm14\n\t"
+                "pxor %%xmm15, %%xmm15\n" :: );
+
+  return done;
+#else
+  (void)c;
+  (void)outbuf_arg;
+  (void)inbuf_arg;
+  (void)nblocks;
+  (void)encrypt;
+  return 0;
+#endif
+}
+
 
 
 /* Run the self-tests for AES 128.  Returns NULL on success. */
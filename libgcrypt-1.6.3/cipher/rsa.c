@@ -35,13 +35,28 @@
 #include "pubkey-internal.h"
 
 
+/* The maximum number of primes of a multi-prime key.  */
+#define RSA_MAX_PRIMES 4
+
 typedef struct
 {
   gcry_mpi_t n;	    /* modulus */
   gcry_mpi_t e;	    /* exponent */
+  mpi_mont_t mont_n; /* Montgomery context for N or NULL.  */
 } RSA_public_key;
 
 
+/* Values derived from a secret key which a key handle keeps so that
+   they are not computed for each operation.  Index 0 of DMOD and
+   MONT is used for P, index 1 for Q and the others for R.  */
+typedef struct
+{
+  gcry_mpi_t dmod[RSA_MAX_PRIMES]; /* D mod (prime - 1) or NULL.  */
+  mpi_mont_t mont[RSA_MAX_PRIMES]; /* Montgomery context for the prime.  */
+  mpi_mont_t mont_n;               /* Montgomery context for N or NULL.  */
+} RSA_secret_precomp;
+
+
 typedef struct
 {
   gcry_mpi_t n;	    /* public modulus */
@@ -50,6 +65,9 @@ typedef struct
   gcry_mpi_t p;	    /* prime  p. */
   gcry_mpi_t q;	    /* prime  q. */
   gcry_mpi_t u;	    /* inverse of p mod q. */
+  gcry_mpi_t r[RSA_MAX_PRIMES-2]; /* Additional primes or NULL.  */
+  gcry_mpi_t t[RSA_MAX_PRIMES-2]; /* Inverse of p*q*..*r[i-1] mod r[i].  */
+  RSA_secret_precomp *pre;        /* Precomputed values or NULL.  */
 } RSA_secret_key;
 
 
@@ -94,6 +112,7 @@ static const char sample_public_key[] =
 
 
 
+static void release_extra_primes (RSA_secret_key *sk);
 static int test_keys (RSA_secret_key *sk, unsigned nbits);
 static int  check_secret_key (RSA_secret_key *sk);
 static void public (gcry_mpi_t output, gcry_mpi_t input, RSA_public_key *skey);
@@ -101,6 +120,56 @@ static void secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey);
 static unsigned int rsa_get_nbits (gcry_sexp_t parms);
 
 
+/* Release the additional primes and CRT coefficients of a
+   multi-prime key SK.  */
+static void
+release_extra_primes (RSA_secret_key *sk)
+{
+  int i;
+
+  for (i=0; i < RSA_MAX_PRIMES-2; i++)
+    {
+      _gcry_mpi_release (sk->r[i]); sk->r[i] = NULL;
+      _gcry_mpi_release (sk->t[i]); sk->t[i] = NULL;
+    }
+}
+
+
+/* Check that the optional multi-prime parameters of SK are
+   consistent: each additional prime needs its CRT coefficient, they
+   need to be given in order and they are only useful along with P, Q
+   and U.  */
+static gpg_err_code_t
+check_extra_primes (RSA_secret_key *sk)
+{
+  int i;
+
+  for (i=0; i < RSA_MAX_PRIMES-2; i++)
+    {
+      if (!sk->r[i] != !sk->t[i])
+        return GPG_ERR_BAD_SECKEY;
+      if (sk->r[i] && (!sk->p || !sk->q || !sk->u || (i && !sk->r[i-1])))
+        return GPG_ERR_BAD_SECKEY;
+    }
+  return 0;
+}
+
+
+/* Return the maximum number of primes we allow for a key of NBITS.
+   The primes need to stay large enough so that finding one of them
+   with ECM is not easier than factoring N with the NFS.  */
+static unsigned int
+max_primes (unsigned int nbits)
+{
+  if (nbits < 1024)
+    return 2;
+  else if (nbits < 4096)
+    return 3;
+  else
+    return 4;
+}
+
+
 /* Check that a freshly generated key actually works.  Returns 0 on success. */
 static int
 test_keys (RSA_secret_key *sk, unsigned int nbits)
@@ -115,6 +184,7 @@ test_keys (RSA_secret_key *sk, unsigned int nbits)
   /* Put the relevant parameters into a public key structure.  */
   pk.n = sk->n;
   pk.e = sk->e;
+  pk.mont_n = NULL;
 
   /* Create a random plaintext.  */
   _gcry_mpi_randomize (plaintext, nbits, GCRY_WEAK_RANDOM);
@@ -186,13 +256,18 @@ check_exponent (void *arg, gcry_mpi_t a)
  *       > 2 Use this public exponent.  If the given exponent
  *           is not odd one is internally added to it.
  * TRANSIENT_KEY:  If true, generate the primes using the standard RNG.
+ * NPRIMES: The number of primes; values larger than 2 create a
+ *          multi-prime key as described by RFC-3447.  The caller
+ *          needs to check that this is not larger than RSA_MAX_PRIMES
+ *          and suitable for NBITS.
  * Returns: 2 structures filled with all needed values
  */
 static gpg_err_code_t
 generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
-              int transient_key)
+              int transient_key, unsigned int nprimes)
 {
-  gcry_mpi_t p, q; /* the two primes */
+  gcry_mpi_t prime[RSA_MAX_PRIMES]; /* the primes */
+  gcry_mpi_t p, q; /* the first two primes */
   gcry_mpi_t d;    /* the private key */
   gcry_mpi_t u;
   gcry_mpi_t t1, t2;
@@ -202,6 +277,8 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
   gcry_mpi_t g;
   gcry_mpi_t f;
   gcry_random_level_t random_level;
+  unsigned int i, j, pbits;
+  int distinct;
 
   if (fips_mode ())
     {
@@ -241,33 +318,43 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
 
   n = mpi_new (nbits);
 
-  p = q = NULL;
+  memset (prime, 0, sizeof prime);
   do
     {
-      /* select two (very secret) primes */
-      if (p)
-        _gcry_mpi_release (p);
-      if (q)
-        _gcry_mpi_release (q);
-      if (use_e)
-        { /* Do an extra test to ensure that the given exponent is
-             suitable. */
-          p = _gcry_generate_secret_prime (nbits/2, random_level,
-                                           check_exponent, e);
-          q = _gcry_generate_secret_prime (nbits/2, random_level,
-                                           check_exponent, e);
-        }
-      else
-        { /* We check the exponent later. */
-          p = _gcry_generate_secret_prime (nbits/2, random_level, NULL, NULL);
-          q = _gcry_generate_secret_prime (nbits/2, random_level, NULL, NULL);
+      /* select NPRIMES (very secret) primes; the first ones get the
+         extra bits if NBITS is not a multiple of NPRIMES.  */
+      for (i=0; i < nprimes; i++)
+        {
+          _gcry_mpi_release (prime[i]);
+          pbits = nbits / nprimes + (i < nbits % nprimes);
+          if (use_e)
+            { /* Do an extra test to ensure that the given exponent is
+                 suitable. */
+              prime[i] = _gcry_generate_secret_prime (pbits, random_level,
+                                                      check_exponent, e);
+            }
+          else
+            { /* We check the exponent later. */
+              prime[i] = _gcry_generate_secret_prime (pbits, random_level,
+                                                      NULL, NULL);
+            }
         }
-      if (mpi_cmp (p, q) > 0 ) /* p shall be smaller than q (for calc of u)*/
-        mpi_swap(p,q);
+      /* p shall be smaller than q (for calc of u)*/
+      if (mpi_cmp (prime[0], prime[1]) > 0 )
+        mpi_swap (prime[0], prime[1]);
       /* calculate the modulus */
-      mpi_mul( n, p, q );
+      mpi_mul (n, prime[0], prime[1]);
+      for (i=2; i < nprimes; i++)
+        mpi_mul (n, n, prime[i]);
+      distinct = 1;
+      for (i=0; i < nprimes; i++)
+        for (j=i+1; j < nprimes; j++)
+          if (!mpi_cmp (prime[i], prime[j]))
+            distinct = 0;
     }
-  while ( mpi_get_nbits(n) != nbits );
+  while (!distinct || mpi_get_nbits(n) != nbits);
+  p = prime[0];
+  q = prime[1];
 
   /* calculate Euler totient: phi = (p-1)(q-1) */
   t1 = mpi_alloc_secure( mpi_get_nlimbs(p) );
@@ -280,6 +367,15 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
   mpi_mul( phi, t1, t2 );
   mpi_gcd (g, t1, t2);
   mpi_fdiv_q(f, phi, g);
+  /* Extend phi and the lcm f by the additional primes.  */
+  for (i=2; i < nprimes; i++)
+    {
+      mpi_sub_ui (t2, prime[i], 1);
+      mpi_mul (phi, phi, t2);
+      mpi_gcd (g, f, t2);
+      mpi_mul (t1, f, t2);
+      mpi_fdiv_q (f, t1, g);
+    }
 
   while (!mpi_gcd(t1, e, phi)) /* (while gcd is not 1) */
     {
@@ -295,6 +391,16 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
   /* calculate the inverse of p and q (used for chinese remainder theorem)*/
   u = mpi_snew ( nbits );
   mpi_invm(u, p, q );
+  /* and the CRT coefficients of the additional primes */
+  mpi_mul (t1, p, q);
+  for (i=2; i < nprimes; i++)
+    {
+      sk->r[i-2] = prime[i];
+      sk->t[i-2] = mpi_snew (mpi_get_nbits (prime[i]));
+      mpi_fdiv_r (t2, t1, prime[i]);
+      mpi_invm (sk->t[i-2], t2, prime[i]);
+      mpi_mul (t1, t1, prime[i]);
+    }
 
   if( DBG_CIPHER )
     {
@@ -307,6 +413,11 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
       log_mpidump("  e= ", e );
       log_mpidump("  d= ", d );
       log_mpidump("  u= ", u );
+      for (i=2; i < nprimes; i++)
+        {
+          log_mpidump("  r= ", sk->r[i-2] );
+          log_mpidump("  t= ", sk->t[i-2] );
+        }
     }
 
   _gcry_mpi_release (t1);
@@ -331,6 +442,7 @@ generate_std (RSA_secret_key *sk, unsigned int nbits, unsigned long use_e,
       _gcry_mpi_release (sk->q); sk->q = NULL;
       _gcry_mpi_release (sk->d); sk->d = NULL;
       _gcry_mpi_release (sk->u); sk->u = NULL;
+      release_extra_primes (sk);
       fips_signal_error ("self-test after key generation failed");
       return GPG_ERR_SELFTEST_FAILED;
     }
@@ -598,10 +710,12 @@ generate_x931 (RSA_secret_key *sk, unsigned int nbits, unsigned long e_value,
 static int
 check_secret_key( RSA_secret_key *sk )
 {
-  int rc;
-  gcry_mpi_t temp = mpi_alloc( mpi_get_nlimbs(sk->p)*2 );
+  int rc, i;
+  gcry_mpi_t temp = mpi_alloc( mpi_get_nlimbs(sk->n) );
 
   mpi_mul(temp, sk->p, sk->q );
+  for (i=0; i < RSA_MAX_PRIMES-2 && sk->r[i]; i++)
+    mpi_mul (temp, temp, sk->r[i]);
   rc = mpi_cmp( temp, sk->n );
   mpi_free(temp);
   return !rc;
@@ -619,7 +733,9 @@ check_secret_key( RSA_secret_key *sk )
 static void
 public(gcry_mpi_t output, gcry_mpi_t input, RSA_public_key *pkey )
 {
-  if( output == input )  /* powm doesn't like output and input the same */
+  if (pkey->mont_n)
+    mpi_powm_mont (output, input, pkey->e, pkey->mont_n);
+  else if( output == input )  /* powm doesn't like output and input the same */
     {
       gcry_mpi_t x = mpi_alloc( mpi_get_nlimbs(input)*2 );
       mpi_powm( x, input, pkey->e, pkey->n );
@@ -707,8 +823,33 @@ stronger_key_check ( RSA_secret_key *skey )
  *      h = u * (m2 - m1) mod q
  *      m = m1 + h * p
  *
- * Where m is OUTPUT, c is INPUT and d,n,p,q,u are elements of SKEY.
+ * For each additional prime r of a multi-prime key the result is
+ * then extended using Garner's algorithm:
+ *
+ *      m2 = c ^ (d mod (r-1)) mod r
+ *      h = t * (m2 - m) mod r
+ *      m = m + h * p * q * ...
+ *
+ * Where m is OUTPUT, c is INPUT and d,n,p,q,u,r,t are elements of SKEY.
  */
+
+/* Compute OUTPUT = INPUT ^ (d mod (PRIME-1)) mod PRIME for the prime
+   with the index IDX as used by RSA_secret_precomp.  H is used as a
+   scratch MPI.  */
+static void
+secret_crt_powm (gcry_mpi_t output, gcry_mpi_t input, gcry_mpi_t prime,
+                 int idx, gcry_mpi_t h, RSA_secret_key *skey)
+{
+  if (skey->pre && skey->pre->mont[idx])
+    mpi_powm_mont (output, input, skey->pre->dmod[idx], skey->pre->mont[idx]);
+  else
+    {
+      mpi_sub_ui (h, prime, 1);
+      mpi_fdiv_r (h, skey->d, h);
+      mpi_powm (output, input, h, prime);
+    }
+}
+
 static void
 secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
 {
@@ -717,22 +858,23 @@ secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
 
   if (!skey->p || !skey->q || !skey->u)
     {
-      mpi_powm (output, input, skey->d, skey->n);
+      if (skey->pre && skey->pre->mont_n)
+        mpi_powm_mont (output, input, skey->d, skey->pre->mont_n);
+      else
+        mpi_powm (output, input, skey->d, skey->n);
     }
   else
     {
       gcry_mpi_t m1 = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
       gcry_mpi_t m2 = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
       gcry_mpi_t h  = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
+      gcry_mpi_t pq;
+      int i;
 
       /* m1 = c ^ (d mod (p-1)) mod p */
-      mpi_sub_ui( h, skey->p, 1  );
-      mpi_fdiv_r( h, skey->d, h );
-      mpi_powm( m1, input, h, skey->p );
+      secret_crt_powm (m1, input, skey->p, 0, h, skey);
       /* m2 = c ^ (d mod (q-1)) mod q */
-      mpi_sub_ui( h, skey->q, 1  );
-      mpi_fdiv_r( h, skey->d, h );
-      mpi_powm( m2, input, h, skey->q );
+      secret_crt_powm (m2, input, skey->q, 1, h, skey);
       /* h = u * ( m2 - m1 ) mod q */
       mpi_sub( h, m2, m1 );
       if ( mpi_has_sign ( h ) )
@@ -740,7 +882,32 @@ secret (gcry_mpi_t output, gcry_mpi_t input, RSA_secret_key *skey )
       mpi_mulm( h, skey->u, h, skey->q );
       /* m = m2 + h * p */
       mpi_mul ( h, h, skey->p );
-      mpi_add ( output, m1, h );
+
+      if (!skey->r[0])
+        mpi_add ( output, m1, h );
+      else
+        {
+          mpi_add ( m1, m1, h );
+          pq = mpi_alloc_secure( mpi_get_nlimbs(skey->n)+1 );
+          mpi_mul ( pq, skey->p, skey->q );
+          for (i=0; i < RSA_MAX_PRIMES-2 && skey->r[i]; i++)
+            {
+              /* m2 = c ^ (d mod (r-1)) mod r */
+              secret_crt_powm (m2, input, skey->r[i], i+2, h, skey);
+              /* h = t * ( m2 - m ) mod r */
+              mpi_fdiv_r( h, m1, skey->r[i] );
+              mpi_sub( h, m2, h );
+              if ( mpi_has_sign ( h ) )
+                mpi_add ( h, h, skey->r[i] );
+              mpi_mulm( h, skey->t[i], h, skey->r[i] );
+              /* m = m + h * p * q * ... */
+              mpi_mul ( h, h, pq );
+              mpi_add ( m1, m1, h );
+              mpi_mul ( pq, pq, skey->r[i] );
+            }
+          mpi_set ( output, m1 );
+          mpi_free ( pq );
+        }
 
       mpi_free ( h );
       mpi_free ( m1 );
@@ -760,6 +927,7 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   gpg_err_code_t ec;
   unsigned int nbits;
   unsigned long evalue;
+  unsigned int nprimes;
   RSA_secret_key sk;
   gcry_sexp_t deriveparms;
   int flags = 0;
@@ -776,6 +944,12 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   if (ec)
     return ec;
 
+  ec = _gcry_pk_util_get_rsa_use_primes (genparms, &nprimes);
+  if (ec)
+    return ec;
+  if (nprimes < 2 || nprimes > max_primes (nbits))
+    return GPG_ERR_INV_VALUE;
+
   /* Parse the optional flags list.  */
   l1 = sexp_find_token (genparms, "flags", 0);
   if (l1)
@@ -802,6 +976,12 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   if (deriveparms || (flags & PUBKEY_FLAG_USE_X931) || fips_mode ())
     {
       int swapped;
+      if (nprimes != 2)
+        {
+          /* X9.31 and FIPS 186 know only about two primes.  */
+          sexp_release (deriveparms);
+          return GPG_ERR_NOT_SUPPORTED;
+        }
       ec = generate_x931 (&sk, nbits, evalue, deriveparms, &swapped);
       sexp_release (deriveparms);
       if (!ec && swapped)
@@ -821,10 +1001,10 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
         }
       /* Generate.  */
       ec = generate_std (&sk, nbits, evalue,
-                         !!(flags & PUBKEY_FLAG_TRANSIENT_KEY));
+                         !!(flags & PUBKEY_FLAG_TRANSIENT_KEY), nprimes);
     }
 
-  if (!ec)
+  if (!ec && !sk.r[0])
     {
       ec = sexp_build (r_skey, NULL,
                        "(key-data"
@@ -837,6 +1017,39 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
                        sk.n, sk.e, sk.d, sk.p, sk.q, sk.u,
                        swap_info);
     }
+  else if (!ec)
+    {
+      /* Multi-prime key: append the additional primes and their CRT
+         coefficients as r3, t3, r4, t4 to the private key.  */
+      char buffer[100 + (RSA_MAX_PRIMES-2)*20];
+      void *arg_list[9 + 2*(RSA_MAX_PRIMES-2)];
+      char *p;
+      int i, argc = 0;
+
+      p = stpcpy (buffer,
+                  "(key-data"
+                  " (public-key"
+                  "  (rsa(n%m)(e%m)))"
+                  " (private-key"
+                  "  (rsa(n%m)(e%m)(d%m)(p%m)(q%m)(u%m)");
+      arg_list[argc++] = &sk.n;
+      arg_list[argc++] = &sk.e;
+      arg_list[argc++] = &sk.n;
+      arg_list[argc++] = &sk.e;
+      arg_list[argc++] = &sk.d;
+      arg_list[argc++] = &sk.p;
+      arg_list[argc++] = &sk.q;
+      arg_list[argc++] = &sk.u;
+      for (i=0; i < RSA_MAX_PRIMES-2 && sk.r[i]; i++)
+        {
+          p += sprintf (p, "(r%d%%m)(t%d%%m)", i+3, i+3);
+          arg_list[argc++] = &sk.r[i];
+          arg_list[argc++] = &sk.t[i];
+        }
+      p = stpcpy (p, ")) %S)");
+      arg_list[argc++] = &swap_info;
+      ec = sexp_build_array (r_skey, NULL, buffer, arg_list);
+    }
 
   mpi_free (sk.n);
   mpi_free (sk.e);
@@ -844,6 +1057,7 @@ rsa_generate (const gcry_sexp_t genparms, gcry_sexp_t *r_skey)
   mpi_free (sk.q);
   mpi_free (sk.d);
   mpi_free (sk.u);
+  release_extra_primes (&sk);
   sexp_release (swap_info);
 
   return ec;
@@ -854,14 +1068,20 @@ static gcry_err_code_t
 rsa_check_secret_key (gcry_sexp_t keyparms)
 {
   gcry_err_code_t rc;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
+  RSA_secret_key sk;
+
+  memset (&sk, 0, sizeof sk);
 
   /* To check the key we need the optional parameters. */
-  rc = sexp_extract_param (keyparms, NULL, "nedpqu",
+  rc = sexp_extract_param (keyparms, NULL, "nedpqu'r3'?'t3'?'r4'?'t4'?",
                            &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
+                           &sk.r[0], &sk.t[0], &sk.r[1], &sk.t[1],
                            NULL);
   if (rc)
     goto leave;
+  rc = check_extra_primes (&sk);
+  if (rc)
+    goto leave;
 
   if (!check_secret_key (&sk))
     rc = GPG_ERR_BAD_SECKEY;
@@ -873,23 +1093,25 @@ rsa_check_secret_key (gcry_sexp_t keyparms)
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
+  release_extra_primes (&sk);
   if (DBG_CIPHER)
     log_debug ("rsa_testkey    => %s\n", gpg_strerror (rc));
   return rc;
 }
 
 
+/* Encrypt S_DATA with the public key PK and store the result at
+   R_CIPH.  */
 static gcry_err_code_t
-rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+encrypt_with_key (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, RSA_public_key *pk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  RSA_public_key pk = {NULL, NULL};
   gcry_mpi_t ciph = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_ENCRYPT,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (pk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -902,20 +1124,15 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       rc = GPG_ERR_INV_DATA;
       goto leave;
     }
-
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_mpidump ("rsa_encrypt    n", pk.n);
-      log_mpidump ("rsa_encrypt    e", pk.e);
+      log_mpidump ("rsa_encrypt    n", pk->n);
+      log_mpidump ("rsa_encrypt    e", pk->e);
     }
 
   /* Do RSA computation and build result.  */
   ciph = mpi_new (0);
-  public (ciph, data, &pk);
+  public (ciph, data, pk);
   if (DBG_CIPHER)
     log_mpidump ("rsa_encrypt  res", ciph);
   if ((ctx.flags & PUBKEY_FLAG_FIXEDLEN))
@@ -923,7 +1140,7 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       /* We need to make sure to return the correct length to avoid
          problems with missing leading zeroes.  */
       unsigned char *em;
-      size_t emlen = (mpi_get_nbits (pk.n)+7)/8;
+      size_t emlen = (mpi_get_nbits (pk->n)+7)/8;
 
       rc = _gcry_mpi_to_octet_string (&em, NULL, ciph, emlen);
       if (!rc)
@@ -937,8 +1154,6 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
  leave:
   _gcry_mpi_release (ciph);
-  _gcry_mpi_release (pk.n);
-  _gcry_mpi_release (pk.e);
   _gcry_mpi_release (data);
   _gcry_pk_util_free_encoding_ctx (&ctx);
   if (DBG_CIPHER)
@@ -948,14 +1163,31 @@ rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
 
 static gcry_err_code_t
-rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_encrypt (gcry_sexp_t *r_ciph, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  RSA_public_key pk = {NULL, NULL, NULL};
+
+  /* Extract the key.  */
+  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
+  if (!rc)
+    rc = encrypt_with_key (r_ciph, s_data, &pk);
 
+  _gcry_mpi_release (pk.n);
+  _gcry_mpi_release (pk.e);
+  return rc;
+}
+
+
+/* Decrypt S_DATA with the secret key SK and store the result at
+   R_PLAIN.  */
+static gcry_err_code_t
+decrypt_with_key (gcry_sexp_t *r_plain, gcry_sexp_t s_data, RSA_secret_key *sk)
 {
   gpg_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_sexp_t l1 = NULL;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
   gcry_mpi_t plain = NULL;
   gcry_mpi_t r = NULL;	   /* Random number needed for blinding.  */
   gcry_mpi_t ri = NULL;	   /* Modular multiplicative inverse of r.  */
@@ -964,7 +1196,7 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   size_t unpadlen = 0;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_DECRYPT,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (sk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_preparse_encval (s_data, rsa_names, &l1, &ctx);
@@ -980,23 +1212,16 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       rc = GPG_ERR_INV_DATA;
       goto leave;
     }
-
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
-                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_decrypt    n", sk.n);
-      log_printmpi ("rsa_decrypt    e", sk.e);
+      log_printmpi ("rsa_decrypt    n", sk->n);
+      log_printmpi ("rsa_decrypt    e", sk->e);
       if (!fips_mode ())
         {
-          log_printmpi ("rsa_decrypt    d", sk.d);
-          log_printmpi ("rsa_decrypt    p", sk.p);
-          log_printmpi ("rsa_decrypt    q", sk.q);
-          log_printmpi ("rsa_decrypt    u", sk.u);
+          log_printmpi ("rsa_decrypt    d", sk->d);
+          log_printmpi ("rsa_decrypt    p", sk->p);
+          log_printmpi ("rsa_decrypt    q", sk->q);
+          log_printmpi ("rsa_decrypt    u", sk->u);
         }
     }
 
@@ -1004,7 +1229,7 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
      the input and it has not been "padded" using multiples of N.
      This mitigates side-channel attacks (CVE-2013-4576).  */
   mpi_normalize (data);
-  mpi_fdiv_r (data, data, sk.n);
+  mpi_fdiv_r (data, data, sk->n);
 
   /* Allocate MPI for the plaintext.  */
   plain = mpi_snew (ctx.nbits);
@@ -1026,30 +1251,33 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       do
         {
           _gcry_mpi_randomize (r, ctx.nbits, GCRY_WEAK_RANDOM);
-          mpi_mod (r, r, sk.n);
+          mpi_mod (r, r, sk->n);
         }
-      while (!mpi_invm (ri, r, sk.n));
+      while (!mpi_invm (ri, r, sk->n));
 
       /* Do blinding.  We calculate: y = (x * r^e) mod n, where r is
          the random number, e is the public exponent, x is the
          non-blinded data and n is the RSA modulus.  */
-      mpi_powm (bldata, r, sk.e, sk.n);
-      mpi_mulm (bldata, bldata, data, sk.n);
+      if (sk->pre && sk->pre->mont_n)
+        mpi_powm_mont (bldata, r, sk->e, sk->pre->mont_n);
+      else
+        mpi_powm (bldata, r, sk->e, sk->n);
+      mpi_mulm (bldata, bldata, data, sk->n);
 
       /* Perform decryption.  */
-      secret (plain, bldata, &sk);
+      secret (plain, bldata, sk);
       _gcry_mpi_release (bldata); bldata = NULL;
 
       /* Undo blinding.  Here we calculate: y = (x * r^-1) mod n,
          where x is the blinded decrypted data, ri is the modular
          multiplicative inverse of r and n is the RSA modulus.  */
-      mpi_mulm (plain, plain, ri, sk.n);
+      mpi_mulm (plain, plain, ri, sk->n);
 
       _gcry_mpi_release (r); r = NULL;
       _gcry_mpi_release (ri); ri = NULL;
     }
   else
-    secret (plain, data, &sk);
+    secret (plain, data, sk);
 
   if (DBG_CIPHER)
     log_printmpi ("rsa_decrypt  res", plain);
@@ -1087,12 +1315,6 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
  leave:
   xfree (unpad);
   _gcry_mpi_release (plain);
-  _gcry_mpi_release (sk.n);
-  _gcry_mpi_release (sk.e);
-  _gcry_mpi_release (sk.d);
-  _gcry_mpi_release (sk.p);
-  _gcry_mpi_release (sk.q);
-  _gcry_mpi_release (sk.u);
   _gcry_mpi_release (data);
   _gcry_mpi_release (r);
   _gcry_mpi_release (ri);
@@ -1106,16 +1328,46 @@ rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
 
 static gcry_err_code_t
-rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+rsa_decrypt (gcry_sexp_t *r_plain, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gpg_err_code_t rc;
+  RSA_secret_key sk;
+
+  memset (&sk, 0, sizeof sk);
+
+  /* Extract the key.  */
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?'r3'?'t3'?'r4'?'t4'?",
+                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
+                           &sk.r[0], &sk.t[0], &sk.r[1], &sk.t[1],
+                           NULL);
+  if (!rc)
+    rc = check_extra_primes (&sk);
+  if (!rc)
+    rc = decrypt_with_key (r_plain, s_data, &sk);
+
+  _gcry_mpi_release (sk.n);
+  _gcry_mpi_release (sk.e);
+  _gcry_mpi_release (sk.d);
+  _gcry_mpi_release (sk.p);
+  _gcry_mpi_release (sk.q);
+  _gcry_mpi_release (sk.u);
+  release_extra_primes (&sk);
+  return rc;
+}
+
+
+/* Sign S_DATA with the secret key SK and store the signature at
+   R_SIG.  */
+static gcry_err_code_t
+sign_with_key (gcry_sexp_t *r_sig, gcry_sexp_t s_data, RSA_secret_key *sk)
 {
   gpg_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_mpi_t data = NULL;
-  RSA_secret_key sk = {NULL, NULL, NULL, NULL, NULL, NULL};
   gcry_mpi_t sig = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_SIGN,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (sk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1128,29 +1380,22 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       rc = GPG_ERR_INV_DATA;
       goto leave;
     }
-
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?",
-                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
-                           NULL);
-  if (rc)
-    goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_sign      n", sk.n);
-      log_printmpi ("rsa_sign      e", sk.e);
+      log_printmpi ("rsa_sign      n", sk->n);
+      log_printmpi ("rsa_sign      e", sk->e);
       if (!fips_mode ())
         {
-          log_printmpi ("rsa_sign      d", sk.d);
-          log_printmpi ("rsa_sign      p", sk.p);
-          log_printmpi ("rsa_sign      q", sk.q);
-          log_printmpi ("rsa_sign      u", sk.u);
+          log_printmpi ("rsa_sign      d", sk->d);
+          log_printmpi ("rsa_sign      p", sk->p);
+          log_printmpi ("rsa_sign      q", sk->q);
+          log_printmpi ("rsa_sign      u", sk->u);
         }
     }
 
   /* Do RSA computation and build the result.  */
   sig = mpi_new (0);
-  secret (sig, data, &sk);
+  secret (sig, data, sk);
   if (DBG_CIPHER)
     log_printmpi ("rsa_sign    res", sig);
   if ((ctx.flags & PUBKEY_FLAG_FIXEDLEN))
@@ -1158,7 +1403,7 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
       /* We need to make sure to return the correct length to avoid
          problems with missing leading zeroes.  */
       unsigned char *em;
-      size_t emlen = (mpi_get_nbits (sk.n)+7)/8;
+      size_t emlen = (mpi_get_nbits (sk->n)+7)/8;
 
       rc = _gcry_mpi_to_octet_string (&em, NULL, sig, emlen);
       if (!rc)
@@ -1173,33 +1418,56 @@ rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
  leave:
   _gcry_mpi_release (sig);
+  _gcry_mpi_release (data);
+  _gcry_pk_util_free_encoding_ctx (&ctx);
+  if (DBG_CIPHER)
+    log_debug ("rsa_sign      => %s\n", gpg_strerror (rc));
+  return rc;
+}
+
+
+static gcry_err_code_t
+rsa_sign (gcry_sexp_t *r_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gpg_err_code_t rc;
+  RSA_secret_key sk;
+
+  memset (&sk, 0, sizeof sk);
+
+  /* Extract the key.  */
+  rc = sexp_extract_param (keyparms, NULL, "nedp?q?u?'r3'?'t3'?'r4'?'t4'?",
+                           &sk.n, &sk.e, &sk.d, &sk.p, &sk.q, &sk.u,
+                           &sk.r[0], &sk.t[0], &sk.r[1], &sk.t[1],
+                           NULL);
+  if (!rc)
+    rc = check_extra_primes (&sk);
+  if (!rc)
+    rc = sign_with_key (r_sig, s_data, &sk);
+
   _gcry_mpi_release (sk.n);
   _gcry_mpi_release (sk.e);
   _gcry_mpi_release (sk.d);
   _gcry_mpi_release (sk.p);
   _gcry_mpi_release (sk.q);
   _gcry_mpi_release (sk.u);
-  _gcry_mpi_release (data);
-  _gcry_pk_util_free_encoding_ctx (&ctx);
-  if (DBG_CIPHER)
-    log_debug ("rsa_sign      => %s\n", gpg_strerror (rc));
+  release_extra_primes (&sk);
   return rc;
 }
 
 
+/* Check the signature S_SIG on S_DATA using the public key PK.  */
 static gcry_err_code_t
-rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+verify_with_key (gcry_sexp_t s_sig, gcry_sexp_t s_data, RSA_public_key *pk)
 {
   gcry_err_code_t rc;
   struct pk_encoding_ctx ctx;
   gcry_sexp_t l1 = NULL;
   gcry_mpi_t sig = NULL;
   gcry_mpi_t data = NULL;
-  RSA_public_key pk = { NULL, NULL };
   gcry_mpi_t result = NULL;
 
   _gcry_pk_util_init_encoding_ctx (&ctx, PUBKEY_OP_VERIFY,
-                                   rsa_get_nbits (keyparms));
+                                   mpi_get_nbits (pk->n));
 
   /* Extract the data.  */
   rc = _gcry_pk_util_data_to_mpi (s_data, &data, &ctx);
@@ -1218,24 +1486,18 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
   if (rc)
     goto leave;
   rc = sexp_extract_param (l1, NULL, "s", &sig, NULL);
-  if (rc)
-    goto leave;
-  if (DBG_CIPHER)
-    log_printmpi ("rsa_verify  sig", sig);
-
-  /* Extract the key.  */
-  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
   if (rc)
     goto leave;
   if (DBG_CIPHER)
     {
-      log_printmpi ("rsa_verify    n", pk.n);
-      log_printmpi ("rsa_verify    e", pk.e);
+      log_printmpi ("rsa_verify  sig", sig);
+      log_printmpi ("rsa_verify    n", pk->n);
+      log_printmpi ("rsa_verify    e", pk->e);
     }
 
   /* Do RSA computation and compare.  */
   result = mpi_new (0);
-  public (result, sig, &pk);
+  public (result, sig, pk);
   if (DBG_CIPHER)
     log_printmpi ("rsa_verify  cmp", result);
   if (ctx.verify_cmp)
@@ -1245,8 +1507,6 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 
  leave:
   _gcry_mpi_release (result);
-  _gcry_mpi_release (pk.n);
-  _gcry_mpi_release (pk.e);
   _gcry_mpi_release (data);
   _gcry_mpi_release (sig);
   sexp_release (l1);
@@ -1257,6 +1517,179 @@ rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
 }
 
 
+static gcry_err_code_t
+rsa_verify (gcry_sexp_t s_sig, gcry_sexp_t s_data, gcry_sexp_t keyparms)
+{
+  gcry_err_code_t rc;
+  RSA_public_key pk = {NULL, NULL, NULL};
+
+  /* Extract the key.  */
+  rc = sexp_extract_param (keyparms, NULL, "ne", &pk.n, &pk.e, NULL);
+  if (!rc)
+    rc = verify_with_key (s_sig, s_data, &pk);
+
+  _gcry_mpi_release (pk.n);
+  _gcry_mpi_release (pk.e);
+  return rc;
+}
+
+
+
+/* The context of an RSA key handle.  */
+typedef struct
+{
+  RSA_secret_key sk;       /* The key; only N and E for a public key.  */
+  RSA_secret_precomp pre;  /* Precomputed values for SK.  */
+} rsa_hd_ctx_t;
+
+
+/* Return true if A may be used as the modulus of a Montgomery
+   context.  */
+static int
+is_odd_modulus (gcry_mpi_t a)
+{
+  return a && !mpi_has_sign (a) && mpi_test_bit (a, 0);
+}
+
+
+static void
+rsa_close (void *ctx)
+{
+  rsa_hd_ctx_t *c = ctx;
+  int i;
+
+  if (!c)
+    return;
+
+  for (i=0; i < RSA_MAX_PRIMES; i++)
+    {
+      mpi_mont_free (c->pre.mont[i]);
+      _gcry_mpi_release (c->pre.dmod[i]);
+    }
+  mpi_mont_free (c->pre.mont_n);
+  _gcry_mpi_release (c->sk.n);
+  _gcry_mpi_release (c->sk.e);
+  _gcry_mpi_release (c->sk.d);
+  _gcry_mpi_release (c->sk.p);
+  _gcry_mpi_release (c->sk.q);
+  _gcry_mpi_release (c->sk.u);
+  release_extra_primes (&c->sk);
+  xfree (c);
+}
+
+
+/* Extract the key from KEYPARMS and set up the Montgomery contexts
+   for N and all primes as well as the CRT exponents so that they do
+   not need to be computed for each operation.  */
+static gcry_err_code_t
+rsa_open (gcry_sexp_t keyparms, int secret, void **r_ctx)
+{
+  gcry_err_code_t rc;
+  rsa_hd_ctx_t *c;
+  gcry_mpi_t prime[RSA_MAX_PRIMES];
+  int i, nprimes;
+
+  *r_ctx = NULL;
+
+  c = xtrycalloc_secure (1, sizeof *c);
+  if (!c)
+    return gpg_err_code_from_syserror ();
+
+  if (secret)
+    {
+      rc = sexp_extract_param (keyparms, NULL,
+                               "nedp?q?u?'r3'?'t3'?'r4'?'t4'?",
+                               &c->sk.n, &c->sk.e, &c->sk.d,
+                               &c->sk.p, &c->sk.q, &c->sk.u,
+                               &c->sk.r[0], &c->sk.t[0],
+                               &c->sk.r[1], &c->sk.t[1],
+                               NULL);
+      if (!rc)
+        rc = check_extra_primes (&c->sk);
+    }
+  else
+    rc = sexp_extract_param (keyparms, NULL, "ne", &c->sk.n, &c->sk.e, NULL);
+  if (rc)
+    {
+      rsa_close (c);
+      return rc;
+    }
+
+  if (is_odd_modulus (c->sk.n))
+    c->pre.mont_n = mpi_mont_init (c->sk.n, 0);
+
+  /* The CRT values are only used if all primes are usable.  */
+  nprimes = 0;
+  if (secret && c->sk.p && c->sk.q && c->sk.u)
+    {
+      prime[nprimes++] = c->sk.p;
+      prime[nprimes++] = c->sk.q;
+      for (i=0; i < RSA_MAX_PRIMES-2 && c->sk.r[i]; i++)
+        prime[nprimes++] = c->sk.r[i];
+      for (i=0; i < nprimes; i++)
+        if (!is_odd_modulus (prime[i]))
+          break;
+      if (i < nprimes)
+        nprimes = 0;
+    }
+  for (i=0; i < nprimes; i++)
+    {
+      c->pre.dmod[i] = mpi_snew (mpi_get_nbits (prime[i]));
+      mpi_sub_ui (c->pre.dmod[i], prime[i], 1);
+      mpi_fdiv_r (c->pre.dmod[i], c->sk.d, c->pre.dmod[i]);
+      c->pre.mont[i] = mpi_mont_init (prime[i], 0);
+    }
+  c->sk.pre = &c->pre;
+
+  *r_ctx = c;
+  return 0;
+}
+
+
+static gcry_err_code_t
+rsa_hd_encrypt (void *ctx, gcry_sexp_t *r_ciph, gcry_sexp_t s_data)
+{
+  rsa_hd_ctx_t *c = ctx;
+  RSA_public_key pk;
+
+  pk.n = c->sk.n;
+  pk.e = c->sk.e;
+  pk.mont_n = c->pre.mont_n;
+  return encrypt_with_key (r_ciph, s_data, &pk);
+}
+
+
+static gcry_err_code_t
+rsa_hd_decrypt (void *ctx, gcry_sexp_t *r_plain, gcry_sexp_t s_data)
+{
+  rsa_hd_ctx_t *c = ctx;
+
+  return decrypt_with_key (r_plain, s_data, &c->sk);
+}
+
+
+static gcry_err_code_t
+rsa_hd_sign (void *ctx, gcry_sexp_t *r_sig, gcry_sexp_t s_data)
+{
+  rsa_hd_ctx_t *c = ctx;
+
+  return sign_with_key (r_sig, s_data, &c->sk);
+}
+
+
+static gcry_err_code_t
+rsa_hd_verify (void *ctx, gcry_sexp_t s_sig, gcry_sexp_t s_data)
+{
+  rsa_hd_ctx_t *c = ctx;
+  RSA_public_key pk;
+
+  pk.n = c->sk.n;
+  pk.e = c->sk.e;
+  pk.mont_n = c->pre.mont_n;
+  return verify_with_key (s_sig, s_data, &pk);
+}
+
+
 
 /* Return the number of bits for the key described by PARMS.  On error
  * 0 is returned.  The format of PARMS starts with the algorithm name;
@@ -1604,5 +2037,14 @@ gcry_pk_spec_t _gcry_pubkey_spec_rsa =
     rsa_verify,
     rsa_get_nbits,
     run_selftests,
-    compute_keygrip
+    compute_keygrip,
+    NULL,
+    NULL,
+    NULL,
+    rsa_open,
+    rsa_close,
+    rsa_hd_encrypt,
+    rsa_hd_decrypt,
+    rsa_hd_sign,
+    rsa_hd_verify
   };
@@ -48,24 +48,39 @@
 #include "g10lib.h"
 #include "kdf-internal.h"
 #include "bufhelp.h"
+#include "ath.h"
 
 /* We really need a 64 bit type for this code.  */
 #ifdef HAVE_U64_TYPEDEF
 
-#define SALSA20_INPUT_LENGTH 16
+/* USE_AMD64 indicates whether to use the SSE2 Salsa20/8 core from
+   salsa20-amd64.S.  */
+#undef USE_AMD64
+#if defined(__x86_64__) && defined(HAVE_COMPATIBLE_GCC_AMD64_PLATFORM_AS) \
+    && defined(USE_SALSA20)
+# define USE_AMD64 1
+#endif
 
-#define ROTL32(n,x) (((x)<<(n)) | ((x)>>(32-(n))))
+#define SALSA20_INPUT_LENGTH 16
 
 
-/* Reads a 64-bit integer, in network, big-endian, byte order */
-#define READ_UINT64(p) buf_get_be64(p)
+/* The blocks are kept as arrays of 32 bit words in host byte order
+   while ROMix runs.  Word I of a 64 byte Salsa20 block is stored at
+   index WORD_POS[I]; the SSE2 code wants the words ordered by the
+   diagonals of the 4x4 matrix.  */
+#ifdef USE_AMD64
+static const unsigned char word_pos[SALSA20_INPUT_LENGTH] =
+  { 0, 5, 10, 15, 12, 1, 6, 11, 8, 13, 2, 7, 4, 9, 14, 3 };
 
+void _gcry_salsa20_amd64_scrypt_core (u32 *x, const u32 *b);
 
-/* And the other, little-endian, byteorder */
-#define LE_READ_UINT64(p) buf_get_le64(p)
+#define salsa20_8_core_xor(x, b) _gcry_salsa20_amd64_scrypt_core ((x), (b))
 
-#define LE_SWAP32(v) le_bswap32(v)
+#else /*!USE_AMD64*/
+static const unsigned char word_pos[SALSA20_INPUT_LENGTH] =
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
 
+#define ROTL32(n,x) (((x)<<(n)) | ((x)>>(32-(n))))
 
 #define QROUND(x0, x1, x2, x3) do { \
   x1 ^= ROTL32(7, x0 + x3);	    \
@@ -75,165 +90,151 @@
   } while(0)
 
 
+/* X = Salsa20/8 (X xor B).  */
 static void
-_salsa20_core(u32 *dst, const u32 *src, unsigned rounds)
+salsa20_8_core_xor (u32 *x, const u32 *b)
 {
-  u32 x[SALSA20_INPUT_LENGTH];
+  u32 t[SALSA20_INPUT_LENGTH];
   unsigned i;
 
-  assert ( (rounds & 1) == 0);
-
   for (i = 0; i < SALSA20_INPUT_LENGTH; i++)
-    x[i] = LE_SWAP32(src[i]);
+    x[i] = t[i] = x[i] ^ b[i];
 
-  for (i = 0; i < rounds;i += 2)
+  for (i = 0; i < 8; i += 2)
     {
-      QROUND(x[0], x[4], x[8], x[12]);
-      QROUND(x[5], x[9], x[13], x[1]);
-      QROUND(x[10], x[14], x[2], x[6]);
-      QROUND(x[15], x[3], x[7], x[11]);
-
-      QROUND(x[0], x[1], x[2], x[3]);
-      QROUND(x[5], x[6], x[7], x[4]);
-      QROUND(x[10], x[11], x[8], x[9]);
-      QROUND(x[15], x[12], x[13], x[14]);
+      QROUND(t[0], t[4], t[8], t[12]);
+      QROUND(t[5], t[9], t[13], t[1]);
+      QROUND(t[10], t[14], t[2], t[6]);
+      QROUND(t[15], t[3], t[7], t[11]);
+
+      QROUND(t[0], t[1], t[2], t[3]);
+      QROUND(t[5], t[6], t[7], t[4]);
+      QROUND(t[10], t[11], t[8], t[9]);
+      QROUND(t[15], t[12], t[13], t[14]);
     }
 
   for (i = 0; i < SALSA20_INPUT_LENGTH; i++)
-    {
-      u32 t = x[i] + LE_SWAP32(src[i]);
-      dst[i] = LE_SWAP32(t);
-    }
+    x[i] += t[i];
 }
+#endif /*!USE_AMD64*/
 
 
+/* Convert the 128*R bytes at SRC to the internal representation.  */
 static void
-_scryptBlockMix (u32 r, unsigned char *B, unsigned char *tmp2)
+_scryptLoad (u32 r, u32 *dst, const unsigned char *src)
 {
-  u64 i;
-  unsigned char *X = tmp2;
-  unsigned char *Y = tmp2 + 64;
+  u32 i, k;
 
-#if 0
-  if (r == 1)
-    {
-      for (i = 0; i < 2 * r; i++)
-        {
-          size_t j;
-          printf ("B[%d] = ", (int)i);
-          for (j = 0; j < 64; j++)
-            {
-              if (j && !(j % 16))
-                printf ("\n       ");
-              printf (" %02x", B[i * 64 + j]);
-            }
-          putchar ('\n');
-        }
-    }
-#endif
+  for (i = 0; i < 2 * r; i++, dst += 16, src += 64)
+    for (k = 0; k < SALSA20_INPUT_LENGTH; k++)
+      dst[word_pos[k]] = buf_get_le32 (src + 4 * k);
+}
+
+
+/* Convert the internal representation at SRC back to bytes.  */
+static void
+_scryptStore (u32 r, unsigned char *dst, const u32 *src)
+{
+  u32 i, k;
+
+  for (i = 0; i < 2 * r; i++, dst += 64, src += 16)
+    for (k = 0; k < SALSA20_INPUT_LENGTH; k++)
+      buf_put_le32 (dst + 4 * k, src[word_pos[k]]);
+}
+
+
+/* OUT = ScryptBlockMix (IN).  OUT and IN are 32*R words and must not
+   overlap; X is a scratch buffer of 16 words.  The even and odd
+   blocks of the result are directly written to the first and second
+   half of OUT.  */
+static void
+_scryptBlockMix (u32 r, u32 *out, const u32 *in, u32 *X)
+{
+  u32 i;
 
   /* X = B[2 * r - 1] */
-  memcpy (X, &B[(2 * r - 1) * 64], 64);
+  memcpy (X, &in[(2 * r - 1) * 16], 64);
 
   /* for i = 0 to 2 * r - 1 do */
   for (i = 0; i <= 2 * r - 1; i++)
     {
-      /* T = X xor B[i] */
-      buf_xor(X, X, &B[i * 64], 64);
-
-      /* X = Salsa (T) */
-      _salsa20_core ((u32*)X, (u32*)X, 8);
+      /* X = Salsa (X xor B[i]) */
+      salsa20_8_core_xor (X, &in[i * 16]);
 
       /* Y[i] = X */
-      memcpy (&Y[i * 64], X, 64);
-    }
-
-  for (i = 0; i < r; i++)
-    {
-      memcpy (&B[i * 64], &Y[2 * i * 64], 64);
-      memcpy (&B[(r + i) * 64], &Y[(2 * i + 1) * 64], 64);
-    }
-
-#if 0
-  if (r==1)
-    {
-      for (i = 0; i < 2 * r; i++)
-        {
-          size_t j;
-          printf ("B'[%d] =", (int)i);
-          for (j = 0; j < 64; j++)
-            {
-              if (j && !(j % 16))
-                printf ("\n       ");
-              printf (" %02x", B[i * 64 + j]);
-            }
-          putchar ('\n');
-        }
+      memcpy (&out[((i & 1) * r + i / 2) * 16], X, 64);
     }
-#endif
 }
 
+
+/* Run ROMix on the 128*R bytes at B using the N*32*R words at V and
+   the 64*R+16 words at TMP as work space.  */
 static void
-_scryptROMix (u32 r, unsigned char *B, u64 N,
-	      unsigned char *tmp1, unsigned char *tmp2)
+_scryptROMix (u32 r, unsigned char *B, u64 N, u32 *V, u32 *tmp)
 {
-  unsigned char *X = B, *T = B;
-  u64 i;
-
-#if 0
-  if (r == 1)
-    {
-      printf ("B = ");
-      for (i = 0; i < 128 * r; i++)
-        {
-          if (i && !(i % 16))
-            printf ("\n    ");
-          printf (" %02x", B[i]);
-        }
-      putchar ('\n');
-    }
-#endif
+  size_t nwords = 32 * r;
+  u32 *X = tmp;
+  u32 *Y = tmp + nwords;
+  u32 *S = tmp + 2 * nwords;
+  u32 *T;
+  const u32 *last;
+  u64 i, j;
+  size_t k;
+
+  /* V[0] = B;  for i = 0 to N - 2 do V[i+1] = ScryptBlockMix (V[i]) */
+  _scryptLoad (r, V, B);
+  for (i = 0; i < N - 1; i++)
+    _scryptBlockMix (r, &V[(i + 1) * nwords], &V[i * nwords], S);
+
+  /* X = ScryptBlockMix (V[N-1]) */
+  _scryptBlockMix (r, X, &V[(N - 1) * nwords], S);
 
   /* for i = 0 to N - 1 do */
   for (i = 0; i <= N - 1; i++)
     {
-      /* V[i] = X */
-      memcpy (&tmp1[i * 128 * r], X, 128 * r);
-
-      /* X =  ScryptBlockMix (X) */
-      _scryptBlockMix (r, X, tmp2);
+      /* j = Integerify (X) mod N */
+      last = &X[(2 * r - 1) * 16];
+      j = (last[word_pos[0]] | ((u64)last[word_pos[1]] << 32)) % N;
+
+      /* X = ScryptBlockMix (X xor V[j]) */
+      for (k = 0; k < nwords; k++)
+        X[k] ^= V[j * nwords + k];
+      _scryptBlockMix (r, Y, X, S);
+      T = X; X = Y; Y = T;
     }
 
-  /* for i = 0 to N - 1 do */
-  for (i = 0; i <= N - 1; i++)
-    {
-      u64 j;
+  _scryptStore (r, B, X);
+}
 
-      /* j = Integerify (X) mod N */
-      j = LE_READ_UINT64 (&X[128 * r - 64]) % N;
 
-      /* T = X xor V[j] */
-      buf_xor (T, T, &tmp1[j * 128 * r], 128 * r);
+/* The parameters for the threads computing the P lanes of scrypt.
+   Thread IDX uses its own part of V and TMP and computes the lanes
+   IDX, IDX + NTHREADS, ...  */
+struct scrypt_parm_s
+{
+  u32 r;
+  u64 N;
+  u32 p;
+  int nthreads;
+  unsigned char *B;
+  u32 *V;
+  u32 *tmp;
+};
 
-      /* X = scryptBlockMix (T) */
-      _scryptBlockMix (r, T, tmp2);
-    }
+static void
+scrypt_worker (void *arg, int idx)
+{
+  struct scrypt_parm_s *parm = arg;
+  size_t r128 = parm->r * 128;
+  u32 i;
 
-#if 0
-  if (r == 1)
-    {
-      printf ("B' =");
-      for (i = 0; i < 128 * r; i++)
-        {
-          if (i && !(i % 16))
-            printf ("\n    ");
-          printf (" %02x", B[i]);
-        }
-      putchar ('\n');
-    }
-#endif
+  for (i = idx; i < parm->p; i += parm->nthreads)
+    _scryptROMix (parm->r, &parm->B[i * r128], parm->N,
+                  parm->V + (size_t)idx * parm->N * 32 * parm->r,
+                  parm->tmp + (size_t)idx * (64 * parm->r + 16));
 }
 
+
 /**
  */
 gcry_err_code_t
@@ -248,12 +249,13 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
   u32 p = iterations; /* Parallelization parameter.  */
 
   gpg_err_code_t ec;
-  u32 i;
+  struct scrypt_parm_s parm;
   unsigned char *B = NULL;
-  unsigned char *tmp1 = NULL;
-  unsigned char *tmp2 = NULL;
+  u32 *tmp1 = NULL;
+  u32 *tmp2 = NULL;
   size_t r128;
   size_t nbytes;
+  int nthreads;
 
   if (subalgo < 1 || !iterations)
     return GPG_ERR_INV_VALUE;
@@ -277,10 +279,16 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
   if (r128 && nbytes / r128 != N)
     return GPG_ERR_ENOMEM;
 
-  nbytes = 64 + r128;
+  nbytes = 64 + 2 * r128;
   if (nbytes < r128)
     return GPG_ERR_ENOMEM;
 
+  /* Each thread needs its own V of N * r128 bytes.  Use fewer threads
+     if there is not enough memory for all of them.  */
+  nthreads = _gcry_get_worker_threads ();
+  if (nthreads > p)
+    nthreads = p;
+
   B = xtrymalloc (p * r128);
   if (!B)
     {
@@ -288,14 +296,21 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
       goto leave;
     }
 
-  tmp1 = xtrymalloc (N * r128);
+  for (;;)
+    {
+      if ((N * r128) * nthreads / nthreads == N * r128)
+        tmp1 = xtrymalloc (N * r128 * nthreads);
+      if (tmp1 || nthreads == 1)
+        break;
+      nthreads--;
+    }
   if (!tmp1)
     {
       ec = gpg_err_code_from_syserror ();
       goto leave;
     }
 
-  tmp2 = xtrymalloc (64 + r128);
+  tmp2 = xtrymalloc ((64 + 2 * r128) * nthreads);
   if (!tmp2)
     {
       ec = gpg_err_code_from_syserror ();
@@ -305,10 +320,22 @@ _gcry_kdf_scrypt (const unsigned char *passwd, size_t passwdlen,
   ec = _gcry_kdf_pkdf2 (passwd, passwdlen, GCRY_MD_SHA256, salt, saltlen,
                         1 /* iterations */, p * r128, B);
 
-  for (i = 0; !ec && i < p; i++)
-    _scryptROMix (r, &B[i * r128], N, tmp1, tmp2);
+  if (!ec)
+    {
+      parm.r = r;
+      parm.N = N;
+      parm.p = p;
+      parm.nthreads = nthreads;
+      parm.B = B;
+      parm.V = tmp1;
+      parm.tmp = tmp2;
+      if (nthreads > 1)
+        ath_run_parallel (scrypt_worker, &parm, nthreads);
+      else
+        scrypt_worker (&parm, 0);
+    }
 
-  for (i = 0; !ec && i < p; i++)
+  if (!ec)
     ec = _gcry_kdf_pkdf2 (passwd, passwdlen, GCRY_MD_SHA256, B, p * r128,
                           1 /* iterations */, dkLen, DK);
 
@@ -0,0 +1,209 @@
+/* sha1-avx2-multi.c - Eight-way SHA-1 transform using AVX2
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This processes one block of eight independent messages with each
+   32 bit word of the state in one lane of a YMM register.  It is used
+   by _gcry_md_block_hash_multi to hash many short messages.  */
+
+#include <config.h>
+
+#include "types.h"
+#include "g10lib.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+
+/* Load word rows 0..7 (OFF 0) or 8..15 (OFF 32) of the eight blocks,
+   convert them to host byte order and transpose them so that ymm0 to
+   ymm7 hold the words for all lanes.  */
+#define LOAD_TRANSPOSE(off)                                             \
+  "movq 0*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm0\n\t"                                 \
+  "movq 1*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm1\n\t"                                 \
+  "movq 2*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm2\n\t"                                 \
+  "movq 3*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm3\n\t"                                 \
+  "movq 4*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm4\n\t"                                 \
+  "movq 5*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm5\n\t"                                 \
+  "movq 6*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm6\n\t"                                 \
+  "movq 7*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm7\n\t"                                 \
+  "vpunpckldq %%ymm1, %%ymm0, %%ymm8\n\t"                               \
+  "vpunpckhdq %%ymm1, %%ymm0, %%ymm9\n\t"                               \
+  "vpunpckldq %%ymm3, %%ymm2, %%ymm10\n\t"                              \
+  "vpunpckhdq %%ymm3, %%ymm2, %%ymm11\n\t"                              \
+  "vpunpckldq %%ymm5, %%ymm4, %%ymm12\n\t"                              \
+  "vpunpckhdq %%ymm5, %%ymm4, %%ymm13\n\t"                              \
+  "vpunpckldq %%ymm7, %%ymm6, %%ymm14\n\t"                              \
+  "vpunpckhdq %%ymm7, %%ymm6, %%ymm15\n\t"                              \
+  "vpunpcklqdq %%ymm10, %%ymm8, %%ymm0\n\t"                             \
+  "vpunpckhqdq %%ymm10, %%ymm8, %%ymm1\n\t"                             \
+  "vpunpcklqdq %%ymm11, %%ymm9, %%ymm2\n\t"                             \
+  "vpunpckhqdq %%ymm11, %%ymm9, %%ymm3\n\t"                             \
+  "vpunpcklqdq %%ymm14, %%ymm12, %%ymm4\n\t"                            \
+  "vpunpckhqdq %%ymm14, %%ymm12, %%ymm5\n\t"                            \
+  "vpunpcklqdq %%ymm15, %%ymm13, %%ymm6\n\t"                            \
+  "vpunpckhqdq %%ymm15, %%ymm13, %%ymm7\n\t"                            \
+  "vperm2i128 $0x20, %%ymm4, %%ymm0, %%ymm8\n\t"                        \
+  "vperm2i128 $0x20, %%ymm5, %%ymm1, %%ymm9\n\t"                        \
+  "vperm2i128 $0x20, %%ymm6, %%ymm2, %%ymm10\n\t"                       \
+  "vperm2i128 $0x20, %%ymm7, %%ymm3, %%ymm11\n\t"                       \
+  "vperm2i128 $0x31, %%ymm4, %%ymm0, %%ymm12\n\t"                       \
+  "vperm2i128 $0x31, %%ymm5, %%ymm1, %%ymm13\n\t"                       \
+  "vperm2i128 $0x31, %%ymm6, %%ymm2, %%ymm14\n\t"                       \
+  "vperm2i128 $0x31, %%ymm7, %%ymm3, %%ymm15\n\t"                       \
+  "vbroadcasti128 %[mask], %%ymm0\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm8, %%ymm8\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm9, %%ymm9\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm10, %%ymm10\n\t"                                \
+  "vpshufb %%ymm0, %%ymm11, %%ymm11\n\t"                                \
+  "vpshufb %%ymm0, %%ymm12, %%ymm12\n\t"                                \
+  "vpshufb %%ymm0, %%ymm13, %%ymm13\n\t"                                \
+  "vpshufb %%ymm0, %%ymm14, %%ymm14\n\t"                                \
+  "vpshufb %%ymm0, %%ymm15, %%ymm15\n\t"                                \
+  "vmovdqa %%ymm8, (" #off "/4+0)*32(%[w])\n\t"                         \
+  "vmovdqa %%ymm9, (" #off "/4+1)*32(%[w])\n\t"                         \
+  "vmovdqa %%ymm10, (" #off "/4+2)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm11, (" #off "/4+3)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm12, (" #off "/4+4)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm13, (" #off "/4+5)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm14, (" #off "/4+6)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm15, (" #off "/4+7)*32(%[w])\n\t"
+
+/* DST = ROL(X, N) using ymm15 as scratch.  */
+#define ROL(x, n, dst)                                                  \
+  "vpsrld $32-" #n ", " x ", %%ymm15\n\t"                               \
+  "vpslld $" #n ", " x ", " dst "\n\t"                                  \
+  "vpor %%ymm15, " dst ", " dst "\n\t"
+
+/* W[t] = ROL(W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16], 1)  */
+#define SCHED(t)                                                        \
+  "vmovdqa 32*(" #t "-3)(%[w]), %%ymm8\n\t"                             \
+  "vpxor 32*(" #t "-8)(%[w]), %%ymm8, %%ymm8\n\t"                       \
+  "vpxor 32*(" #t "-14)(%[w]), %%ymm8, %%ymm8\n\t"                      \
+  "vpxor 32*(" #t "-16)(%[w]), %%ymm8, %%ymm8\n\t"                      \
+  ROL("%%ymm8", 1, "%%ymm8")                                            \
+  "vmovdqa %%ymm8, 32*(" #t ")(%[w])\n\t"
+
+#define SCHED4(t) SCHED(t) SCHED(t+1) SCHED(t+2) SCHED(t+3)
+
+/* The round functions computed into ymm9.  */
+#define F1(b,c,d)                                                       \
+  "vpxor " d ", " c ", %%ymm9\n\t"                                      \
+  "vpand " b ", %%ymm9, %%ymm9\n\t"                                     \
+  "vpxor " d ", %%ymm9, %%ymm9\n\t"
+#define F2(b,c,d)                                                       \
+  "vpxor " d ", " c ", %%ymm9\n\t"                                      \
+  "vpxor " b ", %%ymm9, %%ymm9\n\t"
+#define F3(b,c,d)                                                       \
+  "vpor " c ", " b ", %%ymm9\n\t"                                       \
+  "vpand " d ", %%ymm9, %%ymm9\n\t"                                     \
+  "vpand " c ", " b ", %%ymm10\n\t"                                     \
+  "vpor %%ymm10, %%ymm9, %%ymm9\n\t"
+#define F4 F2
+
+/* e += ROL(a, 5) + f(b, c, d) + K + W[t]; b = ROL(b, 30)
+   with the round constant in ymm14.  */
+#define ROUND(a,b,c,d,e,f,t)                                            \
+  ROL(a, 5, "%%ymm8")                                                   \
+  f(b,c,d)                                                              \
+  "vpaddd 32*(" #t ")(%[w]), " e ", " e "\n\t"                          \
+  "vpaddd %%ymm14, %%ymm8, %%ymm8\n\t"                                  \
+  "vpaddd %%ymm9, " e ", " e "\n\t"                                     \
+  "vpaddd %%ymm8, " e ", " e "\n\t"                                     \
+  ROL(b, 30, b)
+
+#define A "%%ymm0"
+#define B "%%ymm1"
+#define C "%%ymm2"
+#define D "%%ymm3"
+#define E "%%ymm4"
+
+#define ROUND5(f,t)                                                     \
+  ROUND(A,B,C,D,E,f,t)                                                  \
+  ROUND(E,A,B,C,D,f,t+1)                                                \
+  ROUND(D,E,A,B,C,f,t+2)                                                \
+  ROUND(C,D,E,A,B,f,t+3)                                                \
+  ROUND(B,C,D,E,A,f,t+4)
+
+#define ROUND20(f,k,t)                                                  \
+  "vpbroadcastd " #k "*4(%[k]), %%ymm14\n\t"                            \
+  ROUND5(f,t) ROUND5(f,t+5) ROUND5(f,t+10) ROUND5(f,t+15)
+
+#define STATE_ADD(i)                                                    \
+  "vpaddd " #i "*32(%[state]), %%ymm" #i ", %%ymm" #i "\n\t"              \
+  "vmovdqu %%ymm" #i ", " #i "*32(%[state])\n\t"
+
+static const u32 K[4] __attribute__ ((aligned (16))) =
+  { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+
+/* Process one block from each of the eight BLOCKS.  STATE holds the
+   five chaining values of the eight lanes, word by word.  */
+void
+_gcry_sha1_transform_avx2_8way (u32 *state, const unsigned char **blocks)
+{
+  static const unsigned char bswap32_mask[16] __attribute__ ((aligned (16))) =
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+  u32 w[80 * 8] __attribute__ ((aligned (32)));
+
+  asm volatile (LOAD_TRANSPOSE(0)
+                LOAD_TRANSPOSE(32)
+                SCHED4(16) SCHED4(20) SCHED4(24) SCHED4(28)
+                SCHED4(32) SCHED4(36) SCHED4(40) SCHED4(44)
+                SCHED4(48) SCHED4(52) SCHED4(56) SCHED4(60)
+                SCHED4(64) SCHED4(68) SCHED4(72) SCHED4(76)
+                :
+                : [blocks] "r" (blocks),
+                  [w] "r" (w),
+                  [mask] "m" (*bswap32_mask)
+                : "rax", "cc", "memory");
+
+  asm volatile ("vmovdqu 0*32(%[state]), %%ymm0\n\t"
+                "vmovdqu 1*32(%[state]), %%ymm1\n\t"
+                "vmovdqu 2*32(%[state]), %%ymm2\n\t"
+                "vmovdqu 3*32(%[state]), %%ymm3\n\t"
+                "vmovdqu 4*32(%[state]), %%ymm4\n\t"
+                ROUND20(F1, 0, 0)
+                ROUND20(F2, 1, 20)
+                ROUND20(F3, 2, 40)
+                ROUND20(F4, 3, 60)
+                STATE_ADD(0) STATE_ADD(1) STATE_ADD(2) STATE_ADD(3)
+                STATE_ADD(4)
+
+                /* Clear the registers and the message schedule.  */
+                "vzeroall\n\t"
+                "xorl %%eax, %%eax\n\t"
+                ".Lwipe%=:\n\t"
+                "vmovdqa %%ymm0, (%[w],%%rax)\n\t"
+                "addq $32, %%rax\n\t"
+                "cmpq $80*32, %%rax\n\t"
+                "jb .Lwipe%=\n\t"
+                :
+                : [state] "r" (state),
+                  [w] "r" (w),
+                  [k] "r" (K)
+                : "rax", "cc", "memory");
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_AVX2 */
@@ -0,0 +1,247 @@
+/* sha1-intel-shaext.c - SHA-1 transform using Intel SHA Extensions
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "types.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(HAVE_GCC_INLINE_ASM_SSSE3) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && defined(__x86_64__)
+
+/* The state is kept in xmm0 (ABCD) and xmm1 (E) with the words in
+   reverse order as required by the SHA1RNDS4 and SHA1NEXTE
+   instructions.  xmm2 holds the E value of every other group of four
+   rounds and xmm3 to xmm6 the message schedule.  */
+unsigned int
+_gcry_sha1_transform_intel_shaext (void *state, const unsigned char *data,
+                                   size_t nblks)
+{
+  static const unsigned char be_mask[16] __attribute__ ((aligned (16))) =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+  u32 *h = state;
+
+  if (nblks == 0)
+    return 0;
+
+  asm volatile ("movdqu %[h0], %%xmm0\n\t"
+                "movd %[h4], %%xmm1\n\t"
+                "movdqa %[mask], %%xmm7\n\t"
+                "pshufd $0x1b, %%xmm0, %%xmm0\n\t"
+                "pslldq $12, %%xmm1\n\t"
+                :
+                : [h0] "m" (h[0]), [h4] "m" (h[4]), [mask] "m" (*be_mask)
+                : "memory");
+
+  do
+    {
+      asm volatile ("movdqa %%xmm0, %%xmm8\n\t"
+                    "movdqa %%xmm1, %%xmm9\n\t"
+
+                    /* Rounds 0-3 */
+                    "movdqu 0*16(%[data]), %%xmm3\n\t"
+                    "pshufb %%xmm7, %%xmm3\n\t"                  /* be => le */
+                    "paddd %%xmm3, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1rnds4 $0, %%xmm1, %%xmm0\n\t"
+
+                    /* Rounds 4-7 */
+                    "movdqu 1*16(%[data]), %%xmm4\n\t"
+                    "pshufb %%xmm7, %%xmm4\n\t"                  /* be => le */
+                    "sha1nexte %%xmm4, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1rnds4 $0, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm4, %%xmm3\n\t"
+
+                    /* Rounds 8-11 */
+                    "movdqu 2*16(%[data]), %%xmm5\n\t"
+                    "pshufb %%xmm7, %%xmm5\n\t"                  /* be => le */
+                    "sha1nexte %%xmm5, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1rnds4 $0, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm5, %%xmm4\n\t"
+                    "pxor %%xmm5, %%xmm3\n\t"
+
+                    /* Rounds 12-15 */
+                    "movdqu 3*16(%[data]), %%xmm6\n\t"
+                    "pshufb %%xmm7, %%xmm6\n\t"                  /* be => le */
+                    "sha1nexte %%xmm6, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm6, %%xmm3\n\t"
+                    "sha1rnds4 $0, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm6, %%xmm5\n\t"
+                    "pxor %%xmm6, %%xmm4\n\t"
+
+                    /* Rounds 16-19 */
+                    "sha1nexte %%xmm3, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm3, %%xmm4\n\t"
+                    "sha1rnds4 $0, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm3, %%xmm6\n\t"
+                    "pxor %%xmm3, %%xmm5\n\t"
+
+                    /* Rounds 20-23 */
+                    "sha1nexte %%xmm4, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm4, %%xmm5\n\t"
+                    "sha1rnds4 $1, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm4, %%xmm3\n\t"
+                    "pxor %%xmm4, %%xmm6\n\t"
+
+                    /* Rounds 24-27 */
+                    "sha1nexte %%xmm5, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm5, %%xmm6\n\t"
+                    "sha1rnds4 $1, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm5, %%xmm4\n\t"
+                    "pxor %%xmm5, %%xmm3\n\t"
+
+                    /* Rounds 28-31 */
+                    "sha1nexte %%xmm6, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm6, %%xmm3\n\t"
+                    "sha1rnds4 $1, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm6, %%xmm5\n\t"
+                    "pxor %%xmm6, %%xmm4\n\t"
+
+                    /* Rounds 32-35 */
+                    "sha1nexte %%xmm3, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm3, %%xmm4\n\t"
+                    "sha1rnds4 $1, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm3, %%xmm6\n\t"
+                    "pxor %%xmm3, %%xmm5\n\t"
+
+                    /* Rounds 36-39 */
+                    "sha1nexte %%xmm4, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm4, %%xmm5\n\t"
+                    "sha1rnds4 $1, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm4, %%xmm3\n\t"
+                    "pxor %%xmm4, %%xmm6\n\t"
+
+                    /* Rounds 40-43 */
+                    "sha1nexte %%xmm5, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm5, %%xmm6\n\t"
+                    "sha1rnds4 $2, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm5, %%xmm4\n\t"
+                    "pxor %%xmm5, %%xmm3\n\t"
+
+                    /* Rounds 44-47 */
+                    "sha1nexte %%xmm6, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm6, %%xmm3\n\t"
+                    "sha1rnds4 $2, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm6, %%xmm5\n\t"
+                    "pxor %%xmm6, %%xmm4\n\t"
+
+                    /* Rounds 48-51 */
+                    "sha1nexte %%xmm3, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm3, %%xmm4\n\t"
+                    "sha1rnds4 $2, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm3, %%xmm6\n\t"
+                    "pxor %%xmm3, %%xmm5\n\t"
+
+                    /* Rounds 52-55 */
+                    "sha1nexte %%xmm4, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm4, %%xmm5\n\t"
+                    "sha1rnds4 $2, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm4, %%xmm3\n\t"
+                    "pxor %%xmm4, %%xmm6\n\t"
+
+                    /* Rounds 56-59 */
+                    "sha1nexte %%xmm5, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm5, %%xmm6\n\t"
+                    "sha1rnds4 $2, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm5, %%xmm4\n\t"
+                    "pxor %%xmm5, %%xmm3\n\t"
+
+                    /* Rounds 60-63 */
+                    "sha1nexte %%xmm6, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm6, %%xmm3\n\t"
+                    "sha1rnds4 $3, %%xmm2, %%xmm0\n\t"
+                    "sha1msg1 %%xmm6, %%xmm5\n\t"
+                    "pxor %%xmm6, %%xmm4\n\t"
+
+                    /* Rounds 64-67 */
+                    "sha1nexte %%xmm3, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm3, %%xmm4\n\t"
+                    "sha1rnds4 $3, %%xmm1, %%xmm0\n\t"
+                    "sha1msg1 %%xmm3, %%xmm6\n\t"
+                    "pxor %%xmm3, %%xmm5\n\t"
+
+                    /* Rounds 68-71 */
+                    "sha1nexte %%xmm4, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1msg2 %%xmm4, %%xmm5\n\t"
+                    "sha1rnds4 $3, %%xmm2, %%xmm0\n\t"
+                    "pxor %%xmm4, %%xmm6\n\t"
+
+                    /* Rounds 72-75 */
+                    "sha1nexte %%xmm5, %%xmm1\n\t"
+                    "movdqa %%xmm0, %%xmm2\n\t"
+                    "sha1msg2 %%xmm5, %%xmm6\n\t"
+                    "sha1rnds4 $3, %%xmm1, %%xmm0\n\t"
+
+                    /* Rounds 76-79 */
+                    "sha1nexte %%xmm6, %%xmm2\n\t"
+                    "movdqa %%xmm0, %%xmm1\n\t"
+                    "sha1rnds4 $3, %%xmm2, %%xmm0\n\t"
+
+                    /* Add the saved state.  */
+                    "sha1nexte %%xmm9, %%xmm1\n\t"
+                    "paddd %%xmm8, %%xmm0\n\t"
+                    :
+                    : [data] "r" (data)
+                    : "memory");
+
+      data += 64;
+    }
+  while (--nblks);
+
+  asm volatile ("pshufd $0x1b, %%xmm0, %%xmm0\n\t"
+                "psrldq $12, %%xmm1\n\t"
+                "movdqu %%xmm0, %[h0]\n\t"
+                "movd %%xmm1, %[h4]\n\t"
+                : [h0] "=m" (h[0]), [h4] "=m" (h[4])
+                :
+                : "memory");
+
+  /* Clear used registers.  */
+  asm volatile ("pxor %%xmm0, %%xmm0\n\t"
+                "pxor %%xmm1, %%xmm1\n\t"
+                "pxor %%xmm2, %%xmm2\n\t"
+                "pxor %%xmm3, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm4\n\t"
+                "pxor %%xmm5, %%xmm5\n\t"
+                "pxor %%xmm6, %%xmm6\n\t"
+                "pxor %%xmm8, %%xmm8\n\t"
+                "pxor %%xmm9, %%xmm9\n\t"
+                ::: "cc");
+
+  return 0;
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_SHAEXT */
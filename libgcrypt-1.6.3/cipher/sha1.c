@@ -50,6 +50,22 @@
 # define USE_SSSE3 1
 #endif
 
+/* USE_SHAEXT indicates whether to compile with Intel SHA Extension code. */
+#undef USE_SHAEXT
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(HAVE_GCC_INLINE_ASM_SSSE3) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && defined(__x86_64__)
+# define USE_SHAEXT 1
+#endif
+
+/* USE_AVX2_MULTI indicates whether to compile with the eight-way AVX2
+   code for hashing independent messages.  */
+#undef USE_AVX2_MULTI
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+# define USE_AVX2_MULTI 1
+#endif
+
 
 /* A macro to test whether P is properly aligned for an u32 type.
    Note that config.h provides a suitable replacement for uintptr_t if
@@ -67,10 +83,13 @@ typedef struct
 #ifdef USE_SSSE3
   unsigned int use_ssse3:1;
 #endif
+#ifdef USE_SHAEXT
+  unsigned int use_shaext:1;
+#endif
 } SHA1_CONTEXT;
 
 static unsigned int
-transform (void *c, const unsigned char *data);
+transform (void *c, const unsigned char *data, size_t nblks);
 
 
 static void
@@ -95,6 +114,9 @@ sha1_init (void *context, unsigned int flags)
 #ifdef USE_SSSE3
   hd->use_ssse3 = (_gcry_get_hw_features () & HWF_INTEL_SSSE3) != 0;
 #endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (_gcry_get_hw_features () & HWF_INTEL_SHAEXT) != 0;
+#endif
 }
 
 
@@ -239,19 +261,45 @@ unsigned int
 _gcry_sha1_transform_amd64_ssse3 (void *state, const unsigned char *data);
 #endif
 
+#ifdef USE_SHAEXT
+/* Does not need stack burning. */
+unsigned int
+_gcry_sha1_transform_intel_shaext (void *state, const unsigned char *data,
+                                   size_t nblks);
+#endif
+
 
 static unsigned int
-transform (void *ctx, const unsigned char *data)
+transform (void *ctx, const unsigned char *data, size_t nblks)
 {
   SHA1_CONTEXT *hd = ctx;
+  unsigned int burn;
 
+#ifdef USE_SHAEXT
+  if (hd->use_shaext)
+    return _gcry_sha1_transform_intel_shaext (&hd->h0, data, nblks);
+#endif
 #ifdef USE_SSSE3
   if (hd->use_ssse3)
-    return _gcry_sha1_transform_amd64_ssse3 (&hd->h0, data)
-           + 4 * sizeof(void*);
+    {
+      do
+        {
+          burn = _gcry_sha1_transform_amd64_ssse3 (&hd->h0, data);
+          data += 64;
+        }
+      while (--nblks);
+      return burn + 4 * sizeof(void*);
+    }
 #endif
 
-  return _transform (hd, data);
+  do
+    {
+      burn = _transform (hd, data);
+      data += 64;
+    }
+  while (--nblks);
+
+  return burn;
 }
 
 
@@ -308,7 +356,7 @@ sha1_final(void *context)
   /* append the 64 bit count */
   buf_put_be32(hd->bctx.buf + 56, msb);
   buf_put_be32(hd->bctx.buf + 60, lsb);
-  burn = transform( hd, hd->bctx.buf );
+  burn = transform( hd, hd->bctx.buf, 1 );
   _gcry_burn_stack (burn);
 
   p = hd->bctx.buf;
@@ -361,6 +409,78 @@ _gcry_sha1_hash_buffers (void *outbuf, const gcry_buffer_t *iov, int iovcnt)
 }
 
 
+#ifdef USE_AVX2_MULTI
+void _gcry_sha1_transform_avx2_8way (u32 *state,
+                                     const unsigned char **blocks);
+#endif
+
+/* Shortcut function to hash the IOVCNT independent messages in IOV.
+   The digest of message I is stored at OUTBUF + I * 20.  */
+void
+_gcry_sha1_hash_buffers_multi (void *outbuf,
+                               const gcry_buffer_t *iov, int iovcnt)
+{
+  unsigned char *out = outbuf;
+
+#ifdef USE_AVX2_MULTI
+  if (iovcnt > 1 && (_gcry_get_hw_features () & HWF_INTEL_AVX2))
+    {
+      static const u32 iv[5] =
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+      _gcry_md_block_hash_multi (outbuf, 20, iov, iovcnt, 0, iv, 5, 8,
+                                 _gcry_sha1_transform_avx2_8way);
+      return;
+    }
+#endif
+
+  for (; iovcnt > 0; iov++, iovcnt--, out += 20)
+    _gcry_sha1_hash_buffer (out, (const char*)iov[0].data + iov[0].off,
+                            iov[0].len);
+}
+
+
+/* Hash the IOVCNT messages which repeat themselves with PERIOD past
+   the end of their buffers (see _gcry_md_block_hash_multi) and store
+   the digest of message I at OUTBUF + I * 20.  Returns
+   GPG_ERR_NOT_SUPPORTED if the multi-buffer code is not available or
+   would be slower than hashing the messages one by one.  */
+gpg_err_code_t
+_gcry_sha1_hash_periodic_multi (void *outbuf,
+                                const gcry_buffer_t *iov, int iovcnt,
+                                size_t period)
+{
+#ifdef USE_AVX2_MULTI
+  unsigned int hwf = _gcry_get_hw_features ();
+  /* The eight-way code does about 2.5 times the work of the SSSE3
+     code in the same time; it does not catch up with SHA-NI.  */
+  int use_multi = iovcnt >= 4 && (hwf & HWF_INTEL_AVX2);
+
+#ifdef USE_SHAEXT
+  if (hwf & HWF_INTEL_SHAEXT)
+    use_multi = 0;
+#endif
+
+  if (use_multi)
+    {
+      static const u32 iv[5] =
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+      _gcry_md_block_hash_multi (outbuf, 20, iov, iovcnt, period, iv, 5, 8,
+                                 _gcry_sha1_transform_avx2_8way);
+      return 0;
+    }
+#else
+  (void)outbuf;
+  (void)iov;
+  (void)iovcnt;
+  (void)period;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
 
 /*
      Self-test section.
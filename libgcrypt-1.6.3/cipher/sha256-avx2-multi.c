@@ -0,0 +1,240 @@
+/* sha256-avx2-multi.c - Eight-way SHA-256 transform using AVX2
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* This processes one block of eight independent messages with each
+   32 bit word of the state in one lane of a YMM register.  It is used
+   by _gcry_md_block_hash_multi to hash many short messages.  */
+
+#include <config.h>
+
+#include "types.h"
+#include "g10lib.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+
+/* Load word rows 0..7 (OFF 0) or 8..15 (OFF 32) of the eight blocks,
+   convert them to host byte order and transpose them so that ymm0 to
+   ymm7 hold the words for all lanes.  */
+#define LOAD_TRANSPOSE(off)                                             \
+  "movq 0*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm0\n\t"                                 \
+  "movq 1*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm1\n\t"                                 \
+  "movq 2*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm2\n\t"                                 \
+  "movq 3*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm3\n\t"                                 \
+  "movq 4*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm4\n\t"                                 \
+  "movq 5*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm5\n\t"                                 \
+  "movq 6*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm6\n\t"                                 \
+  "movq 7*8(%[blocks]), %%rax\n\t"                                      \
+  "vmovdqu " #off "(%%rax), %%ymm7\n\t"                                 \
+  "vpunpckldq %%ymm1, %%ymm0, %%ymm8\n\t"                               \
+  "vpunpckhdq %%ymm1, %%ymm0, %%ymm9\n\t"                               \
+  "vpunpckldq %%ymm3, %%ymm2, %%ymm10\n\t"                              \
+  "vpunpckhdq %%ymm3, %%ymm2, %%ymm11\n\t"                              \
+  "vpunpckldq %%ymm5, %%ymm4, %%ymm12\n\t"                              \
+  "vpunpckhdq %%ymm5, %%ymm4, %%ymm13\n\t"                              \
+  "vpunpckldq %%ymm7, %%ymm6, %%ymm14\n\t"                              \
+  "vpunpckhdq %%ymm7, %%ymm6, %%ymm15\n\t"                              \
+  "vpunpcklqdq %%ymm10, %%ymm8, %%ymm0\n\t"                             \
+  "vpunpckhqdq %%ymm10, %%ymm8, %%ymm1\n\t"                             \
+  "vpunpcklqdq %%ymm11, %%ymm9, %%ymm2\n\t"                             \
+  "vpunpckhqdq %%ymm11, %%ymm9, %%ymm3\n\t"                             \
+  "vpunpcklqdq %%ymm14, %%ymm12, %%ymm4\n\t"                            \
+  "vpunpckhqdq %%ymm14, %%ymm12, %%ymm5\n\t"                            \
+  "vpunpcklqdq %%ymm15, %%ymm13, %%ymm6\n\t"                            \
+  "vpunpckhqdq %%ymm15, %%ymm13, %%ymm7\n\t"                            \
+  "vperm2i128 $0x20, %%ymm4, %%ymm0, %%ymm8\n\t"                        \
+  "vperm2i128 $0x20, %%ymm5, %%ymm1, %%ymm9\n\t"                        \
+  "vperm2i128 $0x20, %%ymm6, %%ymm2, %%ymm10\n\t"                       \
+  "vperm2i128 $0x20, %%ymm7, %%ymm3, %%ymm11\n\t"                       \
+  "vperm2i128 $0x31, %%ymm4, %%ymm0, %%ymm12\n\t"                       \
+  "vperm2i128 $0x31, %%ymm5, %%ymm1, %%ymm13\n\t"                       \
+  "vperm2i128 $0x31, %%ymm6, %%ymm2, %%ymm14\n\t"                       \
+  "vperm2i128 $0x31, %%ymm7, %%ymm3, %%ymm15\n\t"                       \
+  "vbroadcasti128 %[mask], %%ymm0\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm8, %%ymm8\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm9, %%ymm9\n\t"                                  \
+  "vpshufb %%ymm0, %%ymm10, %%ymm10\n\t"                                \
+  "vpshufb %%ymm0, %%ymm11, %%ymm11\n\t"                                \
+  "vpshufb %%ymm0, %%ymm12, %%ymm12\n\t"                                \
+  "vpshufb %%ymm0, %%ymm13, %%ymm13\n\t"                                \
+  "vpshufb %%ymm0, %%ymm14, %%ymm14\n\t"                                \
+  "vpshufb %%ymm0, %%ymm15, %%ymm15\n\t"                                \
+  "vmovdqa %%ymm8, (" #off "/4+0)*32(%[w])\n\t"                         \
+  "vmovdqa %%ymm9, (" #off "/4+1)*32(%[w])\n\t"                         \
+  "vmovdqa %%ymm10, (" #off "/4+2)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm11, (" #off "/4+3)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm12, (" #off "/4+4)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm13, (" #off "/4+5)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm14, (" #off "/4+6)*32(%[w])\n\t"                        \
+  "vmovdqa %%ymm15, (" #off "/4+7)*32(%[w])\n\t"
+
+/* ROR of X by N into the running XOR in DST using ymm15 as scratch.  */
+#define XOR_ROR(x, n, dst)                                              \
+  "vpsrld $" #n ", " x ", %%ymm15\n\t"                                  \
+  "vpxor %%ymm15, " dst ", " dst "\n\t"                                 \
+  "vpslld $32-" #n ", " x ", %%ymm15\n\t"                               \
+  "vpxor %%ymm15, " dst ", " dst "\n\t"
+
+#define ROR_FIRST(x, n, dst)                                            \
+  "vpsrld $" #n ", " x ", " dst "\n\t"                                  \
+  "vpslld $32-" #n ", " x ", %%ymm15\n\t"                               \
+  "vpxor %%ymm15, " dst ", " dst "\n\t"
+
+/* W[t] = S1(W[t-2]) + W[t-7] + S0(W[t-15]) + W[t-16]  */
+#define SCHED(t)                                                        \
+  "vmovdqa 32*(" #t "-15)(%[w]), %%ymm8\n\t"                            \
+  "vmovdqa 32*(" #t "-2)(%[w]), %%ymm9\n\t"                             \
+  ROR_FIRST("%%ymm8", 7, "%%ymm10")                                     \
+  XOR_ROR("%%ymm8", 18, "%%ymm10")                                      \
+  "vpsrld $3, %%ymm8, %%ymm15\n\t"                                      \
+  "vpxor %%ymm15, %%ymm10, %%ymm10\n\t"                                 \
+  ROR_FIRST("%%ymm9", 17, "%%ymm11")                                    \
+  XOR_ROR("%%ymm9", 19, "%%ymm11")                                      \
+  "vpsrld $10, %%ymm9, %%ymm15\n\t"                                     \
+  "vpxor %%ymm15, %%ymm11, %%ymm11\n\t"                                 \
+  "vpaddd 32*(" #t "-7)(%[w]), %%ymm10, %%ymm10\n\t"                    \
+  "vpaddd 32*(" #t "-16)(%[w]), %%ymm11, %%ymm11\n\t"                   \
+  "vpaddd %%ymm11, %%ymm10, %%ymm10\n\t"                                \
+  "vmovdqa %%ymm10, 32*(" #t ")(%[w])\n\t"
+
+#define SCHED4(t) SCHED(t) SCHED(t+1) SCHED(t+2) SCHED(t+3)
+
+/* One round with the state in ymm0..ymm7 named by A to H.  */
+#define ROUND(a,b,c,d,e,f,g,h,t)                                        \
+  ROR_FIRST(e, 6, "%%ymm8")                                             \
+  XOR_ROR(e, 11, "%%ymm8")                                              \
+  XOR_ROR(e, 25, "%%ymm8")            /* ymm8 = S1(e) */                \
+  "vpxor " g ", " f ", %%ymm9\n\t"                                      \
+  "vpand " e ", %%ymm9, %%ymm9\n\t"                                     \
+  "vpxor " g ", %%ymm9, %%ymm9\n\t"   /* ymm9 = Ch(e,f,g) */            \
+  "vpaddd %%ymm8, " h ", " h "\n\t"                                     \
+  "vpbroadcastd 4*(" #t ")(%[k]), %%ymm8\n\t"                           \
+  "vpaddd %%ymm9, " h ", " h "\n\t"                                     \
+  "vpaddd 32*(" #t ")(%[w]), %%ymm8, %%ymm8\n\t"                        \
+  "vpaddd %%ymm8, " h ", " h "\n\t"   /* h = T1 */                      \
+  "vpaddd " h ", " d ", " d "\n\t"                                      \
+  ROR_FIRST(a, 2, "%%ymm8")                                             \
+  XOR_ROR(a, 13, "%%ymm8")                                              \
+  XOR_ROR(a, 22, "%%ymm8")            /* ymm8 = S0(a) */                \
+  "vpxor " b ", " a ", %%ymm9\n\t"                                      \
+  "vpand " c ", %%ymm9, %%ymm9\n\t"                                     \
+  "vpand " b ", " a ", %%ymm10\n\t"                                     \
+  "vpxor %%ymm10, %%ymm9, %%ymm9\n\t" /* ymm9 = Maj(a,b,c) */           \
+  "vpaddd %%ymm8, " h ", " h "\n\t"                                     \
+  "vpaddd %%ymm9, " h ", " h "\n\t"
+
+#define A "%%ymm0"
+#define B "%%ymm1"
+#define C "%%ymm2"
+#define D "%%ymm3"
+#define E "%%ymm4"
+#define F "%%ymm5"
+#define G "%%ymm6"
+#define H "%%ymm7"
+
+#define ROUND8(t)                                                       \
+  ROUND(A,B,C,D,E,F,G,H,t)                                              \
+  ROUND(H,A,B,C,D,E,F,G,t+1)                                            \
+  ROUND(G,H,A,B,C,D,E,F,t+2)                                            \
+  ROUND(F,G,H,A,B,C,D,E,t+3)                                            \
+  ROUND(E,F,G,H,A,B,C,D,t+4)                                            \
+  ROUND(D,E,F,G,H,A,B,C,t+5)                                            \
+  ROUND(C,D,E,F,G,H,A,B,t+6)                                            \
+  ROUND(B,C,D,E,F,G,H,A,t+7)
+
+#define STATE_ADD(i)                                                    \
+  "vpaddd " #i "*32(%[state]), %%ymm" #i ", %%ymm" #i "\n\t"              \
+  "vmovdqu %%ymm" #i ", " #i "*32(%[state])\n\t"
+
+static const u32 K[64] __attribute__ ((aligned (64))) =
+  {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+/* Process one block from each of the eight BLOCKS.  STATE holds the
+   eight chaining values of the eight lanes, word by word.  */
+void
+_gcry_sha256_transform_avx2_8way (u32 *state, const unsigned char **blocks)
+{
+  static const unsigned char bswap32_mask[16] __attribute__ ((aligned (16))) =
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+  u32 w[64 * 8] __attribute__ ((aligned (32)));
+
+  asm volatile (LOAD_TRANSPOSE(0)
+                LOAD_TRANSPOSE(32)
+                SCHED4(16) SCHED4(20) SCHED4(24) SCHED4(28)
+                SCHED4(32) SCHED4(36) SCHED4(40) SCHED4(44)
+                SCHED4(48) SCHED4(52) SCHED4(56) SCHED4(60)
+                :
+                : [blocks] "r" (blocks),
+                  [w] "r" (w),
+                  [mask] "m" (*bswap32_mask)
+                : "rax", "cc", "memory");
+
+  asm volatile ("vmovdqu 0*32(%[state]), %%ymm0\n\t"
+                "vmovdqu 1*32(%[state]), %%ymm1\n\t"
+                "vmovdqu 2*32(%[state]), %%ymm2\n\t"
+                "vmovdqu 3*32(%[state]), %%ymm3\n\t"
+                "vmovdqu 4*32(%[state]), %%ymm4\n\t"
+                "vmovdqu 5*32(%[state]), %%ymm5\n\t"
+                "vmovdqu 6*32(%[state]), %%ymm6\n\t"
+                "vmovdqu 7*32(%[state]), %%ymm7\n\t"
+                ROUND8(0) ROUND8(8) ROUND8(16) ROUND8(24)
+                ROUND8(32) ROUND8(40) ROUND8(48) ROUND8(56)
+                STATE_ADD(0) STATE_ADD(1) STATE_ADD(2) STATE_ADD(3)
+                STATE_ADD(4) STATE_ADD(5) STATE_ADD(6) STATE_ADD(7)
+
+                /* Clear the registers and the message schedule.  */
+                "vzeroall\n\t"
+                "xorl %%eax, %%eax\n\t"
+                ".Lwipe%=:\n\t"
+                "vmovdqa %%ymm0, (%[w],%%rax)\n\t"
+                "addq $32, %%rax\n\t"
+                "cmpq $64*32, %%rax\n\t"
+                "jb .Lwipe%=\n\t"
+                :
+                : [state] "r" (state),
+                  [w] "r" (w),
+                  [k] "r" (K)
+                : "rax", "cc", "memory");
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_AVX2 */
@@ -0,0 +1,296 @@
+/* sha256-intel-shaext.c - SHA-256 transform using Intel SHA Extensions
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "types.h"
+
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(HAVE_GCC_INLINE_ASM_SSSE3) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && defined(__x86_64__)
+
+/* The state is kept in xmm1 (ABEF) and xmm2 (CDGH) as required by
+   the SHA256RNDS2 instruction, which takes the message words added to
+   the round constants implicitly in xmm0.  xmm3 to xmm6 hold the
+   message schedule.  */
+unsigned int
+_gcry_sha256_transform_intel_shaext (u32 *state, const unsigned char *data,
+                                     size_t nblks)
+{
+  static const unsigned char bswap32_mask[16] __attribute__ ((aligned (16))) =
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+  static const u32 K[64] __attribute__ ((aligned (16))) =
+    {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+      0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+      0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+      0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+      0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+      0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+  if (nblks == 0)
+    return 0;
+
+  asm volatile ("movdqu 0*16(%[state]), %%xmm7\n\t"   /* DCBA */
+                "movdqu 1*16(%[state]), %%xmm2\n\t"   /* HGFE */
+                "movdqa %[mask], %%xmm8\n\t"
+                "pshufd $0xb1, %%xmm7, %%xmm7\n\t"   /* CDAB */
+                "pshufd $0x1b, %%xmm2, %%xmm2\n\t"   /* EFGH */
+                "movdqa %%xmm7, %%xmm1\n\t"
+                "palignr $8, %%xmm2, %%xmm1\n\t"     /* ABEF */
+                "pblendw $0xf0, %%xmm7, %%xmm2\n\t"  /* CDGH */
+                :
+                : [state] "r" (state), [mask] "m" (*bswap32_mask)
+                : "memory");
+
+  do
+    {
+      asm volatile ("movdqa %%xmm1, %%xmm9\n\t"
+                    "movdqa %%xmm2, %%xmm10\n\t"
+
+                    /* Rounds 0-3 */
+                    "movdqu 0*16(%[data]), %%xmm3\n\t"
+                    "pshufb %%xmm8, %%xmm3\n\t"                  /* be => le */
+                    "movdqa %%xmm3, %%xmm0\n\t"
+                    "paddd 0*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+
+                    /* Rounds 4-7 */
+                    "movdqu 1*16(%[data]), %%xmm4\n\t"
+                    "pshufb %%xmm8, %%xmm4\n\t"                  /* be => le */
+                    "movdqa %%xmm4, %%xmm0\n\t"
+                    "paddd 1*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm4, %%xmm3\n\t"
+
+                    /* Rounds 8-11 */
+                    "movdqu 2*16(%[data]), %%xmm5\n\t"
+                    "pshufb %%xmm8, %%xmm5\n\t"                  /* be => le */
+                    "movdqa %%xmm5, %%xmm0\n\t"
+                    "paddd 2*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm5, %%xmm4\n\t"
+
+                    /* Rounds 12-15 */
+                    "movdqu 3*16(%[data]), %%xmm6\n\t"
+                    "pshufb %%xmm8, %%xmm6\n\t"                  /* be => le */
+                    "movdqa %%xmm6, %%xmm0\n\t"
+                    "paddd 3*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm6, %%xmm7\n\t"
+                    "palignr $4, %%xmm5, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm3\n\t"
+                    "sha256msg2 %%xmm6, %%xmm3\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm6, %%xmm5\n\t"
+
+                    /* Rounds 16-19 */
+                    "movdqa %%xmm3, %%xmm0\n\t"
+                    "paddd 4*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm3, %%xmm7\n\t"
+                    "palignr $4, %%xmm6, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm4\n\t"
+                    "sha256msg2 %%xmm3, %%xmm4\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm3, %%xmm6\n\t"
+
+                    /* Rounds 20-23 */
+                    "movdqa %%xmm4, %%xmm0\n\t"
+                    "paddd 5*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm4, %%xmm7\n\t"
+                    "palignr $4, %%xmm3, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm5\n\t"
+                    "sha256msg2 %%xmm4, %%xmm5\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm4, %%xmm3\n\t"
+
+                    /* Rounds 24-27 */
+                    "movdqa %%xmm5, %%xmm0\n\t"
+                    "paddd 6*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm5, %%xmm7\n\t"
+                    "palignr $4, %%xmm4, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm6\n\t"
+                    "sha256msg2 %%xmm5, %%xmm6\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm5, %%xmm4\n\t"
+
+                    /* Rounds 28-31 */
+                    "movdqa %%xmm6, %%xmm0\n\t"
+                    "paddd 7*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm6, %%xmm7\n\t"
+                    "palignr $4, %%xmm5, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm3\n\t"
+                    "sha256msg2 %%xmm6, %%xmm3\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm6, %%xmm5\n\t"
+
+                    /* Rounds 32-35 */
+                    "movdqa %%xmm3, %%xmm0\n\t"
+                    "paddd 8*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm3, %%xmm7\n\t"
+                    "palignr $4, %%xmm6, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm4\n\t"
+                    "sha256msg2 %%xmm3, %%xmm4\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm3, %%xmm6\n\t"
+
+                    /* Rounds 36-39 */
+                    "movdqa %%xmm4, %%xmm0\n\t"
+                    "paddd 9*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm4, %%xmm7\n\t"
+                    "palignr $4, %%xmm3, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm5\n\t"
+                    "sha256msg2 %%xmm4, %%xmm5\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm4, %%xmm3\n\t"
+
+                    /* Rounds 40-43 */
+                    "movdqa %%xmm5, %%xmm0\n\t"
+                    "paddd 10*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm5, %%xmm7\n\t"
+                    "palignr $4, %%xmm4, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm6\n\t"
+                    "sha256msg2 %%xmm5, %%xmm6\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm5, %%xmm4\n\t"
+
+                    /* Rounds 44-47 */
+                    "movdqa %%xmm6, %%xmm0\n\t"
+                    "paddd 11*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm6, %%xmm7\n\t"
+                    "palignr $4, %%xmm5, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm3\n\t"
+                    "sha256msg2 %%xmm6, %%xmm3\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm6, %%xmm5\n\t"
+
+                    /* Rounds 48-51 */
+                    "movdqa %%xmm3, %%xmm0\n\t"
+                    "paddd 12*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm3, %%xmm7\n\t"
+                    "palignr $4, %%xmm6, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm4\n\t"
+                    "sha256msg2 %%xmm3, %%xmm4\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+                    "sha256msg1 %%xmm3, %%xmm6\n\t"
+
+                    /* Rounds 52-55 */
+                    "movdqa %%xmm4, %%xmm0\n\t"
+                    "paddd 13*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm4, %%xmm7\n\t"
+                    "palignr $4, %%xmm3, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm5\n\t"
+                    "sha256msg2 %%xmm4, %%xmm5\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+
+                    /* Rounds 56-59 */
+                    "movdqa %%xmm5, %%xmm0\n\t"
+                    "paddd 14*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "movdqa %%xmm5, %%xmm7\n\t"
+                    "palignr $4, %%xmm4, %%xmm7\n\t"
+                    "paddd %%xmm7, %%xmm6\n\t"
+                    "sha256msg2 %%xmm5, %%xmm6\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+
+                    /* Rounds 60-63 */
+                    "movdqa %%xmm6, %%xmm0\n\t"
+                    "paddd 15*16(%[k]), %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm1, %%xmm2\n\t"
+                    "pshufd $0x0e, %%xmm0, %%xmm0\n\t"
+                    "sha256rnds2 %%xmm0, %%xmm2, %%xmm1\n\t"
+
+                    /* Add the saved state.  */
+                    "paddd %%xmm9, %%xmm1\n\t"
+                    "paddd %%xmm10, %%xmm2\n\t"
+                    :
+                    : [data] "r" (data), [k] "r" (K)
+                    : "memory");
+
+      data += 64;
+    }
+  while (--nblks);
+
+  asm volatile ("pshufd $0x1b, %%xmm1, %%xmm7\n\t"   /* FEBA */
+                "pshufd $0xb1, %%xmm2, %%xmm2\n\t"   /* DCHG */
+                "movdqa %%xmm7, %%xmm1\n\t"
+                "pblendw $0xf0, %%xmm2, %%xmm1\n\t"  /* DCBA */
+                "palignr $8, %%xmm7, %%xmm2\n\t"     /* HGFE */
+                "movdqu %%xmm1, 0*16(%[state])\n\t"
+                "movdqu %%xmm2, 1*16(%[state])\n\t"
+                :
+                : [state] "r" (state)
+                : "memory");
+
+  /* Clear used registers.  */
+  asm volatile ("pxor %%xmm0, %%xmm0\n\t"
+                "pxor %%xmm1, %%xmm1\n\t"
+                "pxor %%xmm2, %%xmm2\n\t"
+                "pxor %%xmm3, %%xmm3\n\t"
+                "pxor %%xmm4, %%xmm4\n\t"
+                "pxor %%xmm5, %%xmm5\n\t"
+                "pxor %%xmm6, %%xmm6\n\t"
+                "pxor %%xmm7, %%xmm7\n\t"
+                "pxor %%xmm9, %%xmm9\n\t"
+                "pxor %%xmm10, %%xmm10\n\t"
+                ::: "cc");
+
+  return 0;
+}
+
+#endif /* HAVE_GCC_INLINE_ASM_SHAEXT */
@@ -55,6 +55,22 @@
 # define USE_SSSE3 1
 #endif
 
+/* USE_SHAEXT indicates whether to compile with Intel SHA Extension code. */
+#undef USE_SHAEXT
+#if defined(HAVE_GCC_INLINE_ASM_SHAEXT) && \
+    defined(HAVE_GCC_INLINE_ASM_SSSE3) && \
+    defined(ENABLE_SHAEXT_SUPPORT) && defined(__x86_64__)
+# define USE_SHAEXT 1
+#endif
+
+/* USE_AVX2_MULTI indicates whether to compile with the eight-way AVX2
+   code for hashing independent messages.  */
+#undef USE_AVX2_MULTI
+#if defined(HAVE_GCC_INLINE_ASM_AVX2) && \
+    defined(ENABLE_AVX2_SUPPORT) && defined(__x86_64__)
+# define USE_AVX2_MULTI 1
+#endif
+
 
 typedef struct {
   gcry_md_block_ctx_t bctx;
@@ -62,11 +78,14 @@ typedef struct {
 #ifdef USE_SSSE3
   unsigned int use_ssse3:1;
 #endif
+#ifdef USE_SHAEXT
+  unsigned int use_shaext:1;
+#endif
 } SHA256_CONTEXT;
 
 
 static unsigned int
-transform (void *c, const unsigned char *data);
+transform (void *c, const unsigned char *data, size_t nblks);
 
 
 static void
@@ -94,6 +113,9 @@ sha256_init (void *context, unsigned int flags)
 #ifdef USE_SSSE3
   hd->use_ssse3 = (_gcry_get_hw_features () & HWF_INTEL_SSSE3) != 0;
 #endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (_gcry_get_hw_features () & HWF_INTEL_SHAEXT) != 0;
+#endif
 }
 
 
@@ -122,6 +144,9 @@ sha224_init (void *context, unsigned int flags)
 #ifdef USE_SSSE3
   hd->use_ssse3 = (_gcry_get_hw_features () & HWF_INTEL_SSSE3) != 0;
 #endif
+#ifdef USE_SHAEXT
+  hd->use_shaext = (_gcry_get_hw_features () & HWF_INTEL_SHAEXT) != 0;
+#endif
 }
 
 
@@ -285,19 +310,38 @@ unsigned int _gcry_sha256_transform_amd64_ssse3(const void *input_data,
 					        u32 state[8], size_t num_blks);
 #endif
 
+#ifdef USE_SHAEXT
+/* Does not need stack burning. */
+unsigned int _gcry_sha256_transform_intel_shaext(u32 *state,
+                                                 const unsigned char *data,
+                                                 size_t nblks);
+#endif
+
 
 static unsigned int
-transform (void *ctx, const unsigned char *data)
+transform (void *ctx, const unsigned char *data, size_t nblks)
 {
   SHA256_CONTEXT *hd = ctx;
+  unsigned int burn;
 
+#ifdef USE_SHAEXT
+  if (hd->use_shaext)
+    return _gcry_sha256_transform_intel_shaext (&hd->h0, data, nblks);
+#endif
 #ifdef USE_SSSE3
   if (hd->use_ssse3)
-    return _gcry_sha256_transform_amd64_ssse3 (data, &hd->h0, 1)
+    return _gcry_sha256_transform_amd64_ssse3 (data, &hd->h0, nblks)
            + 4 * sizeof(void*);
 #endif
 
-  return _transform (hd, data);
+  do
+    {
+      burn = _transform (hd, data);
+      data += 64;
+    }
+  while (--nblks);
+
+  return burn;
 }
 
 
@@ -352,7 +396,7 @@ sha256_final(void *context)
   /* append the 64 bit count */
   buf_put_be32(hd->bctx.buf + 56, msb);
   buf_put_be32(hd->bctx.buf + 60, lsb);
-  burn = transform (hd, hd->bctx.buf);
+  burn = transform (hd, hd->bctx.buf, 1);
   _gcry_burn_stack (burn);
 
   p = hd->bctx.buf;
@@ -377,6 +421,161 @@ sha256_read (void *context)
 }
 
 
+#ifdef USE_AVX2_MULTI
+void _gcry_sha256_transform_avx2_8way (u32 *state,
+                                       const unsigned char **blocks);
+#endif
+
+/* The initial chaining values for the multi-buffer code.  */
+static const u32 sha224_iv[8] =
+  {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+    0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+  };
+
+static const u32 sha256_iv[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+/* Common code for the SHA-224 and SHA-256 multi-buffer functions.  IV
+   holds the initial chaining values matching INIT.  */
+static void
+sha256_hash_buffers_multi (void *outbuf, size_t dlen,
+                           void (*init) (void *, unsigned int),
+                           const u32 *iv,
+                           const gcry_buffer_t *iov, int iovcnt)
+{
+  unsigned char *out = outbuf;
+  SHA256_CONTEXT hd;
+#ifdef USE_AVX2_MULTI
+  unsigned int hwf = _gcry_get_hw_features ();
+  int use_multi = iovcnt > 1 && (hwf & HWF_INTEL_AVX2);
+  size_t total;
+  int i;
+
+#ifdef USE_SHAEXT
+  /* The SHA-NI code runs a single stream at about the speed of the
+     eight-way AVX2 code, thus use the latter only when the per-message
+     padding overhead dominates.  */
+  if (use_multi && (hwf & HWF_INTEL_SHAEXT))
+    {
+      for (total = 0, i = 0; i < iovcnt; i++)
+        total += iov[i].len;
+      use_multi = total / iovcnt < 512;
+    }
+#else
+  (void)total;
+  (void)i;
+#endif
+
+  if (use_multi)
+    {
+      _gcry_md_block_hash_multi (outbuf, dlen, iov, iovcnt, 0, iv, 8, 8,
+                                 _gcry_sha256_transform_avx2_8way);
+      return;
+    }
+#else
+  (void)iv;
+#endif
+
+  for (; iovcnt > 0; iov++, iovcnt--, out += dlen)
+    {
+      init (&hd, 0);
+      _gcry_md_block_write (&hd, (const char*)iov[0].data + iov[0].off,
+                            iov[0].len);
+      sha256_final (&hd);
+      memcpy (out, hd.bctx.buf, dlen);
+    }
+  wipememory (&hd, sizeof hd);
+}
+
+
+/* Shortcut function to hash the IOVCNT independent messages in IOV.
+   The digest of message I is stored at OUTBUF + I * 32.  */
+void
+_gcry_sha256_hash_buffers_multi (void *outbuf,
+                                 const gcry_buffer_t *iov, int iovcnt)
+{
+  sha256_hash_buffers_multi (outbuf, 32, sha256_init, sha256_iv,
+                             iov, iovcnt);
+}
+
+
+/* Same as above but for SHA-224; the digests are 28 bytes.  */
+void
+_gcry_sha224_hash_buffers_multi (void *outbuf,
+                                 const gcry_buffer_t *iov, int iovcnt)
+{
+  sha256_hash_buffers_multi (outbuf, 28, sha224_init, sha224_iv,
+                             iov, iovcnt);
+}
+
+
+/* Common code for the periodic SHA-224 and SHA-256 multi-buffer
+   functions.  */
+static gpg_err_code_t
+sha256_hash_periodic_multi (void *outbuf, size_t dlen, const u32 *iv,
+                            const gcry_buffer_t *iov, int iovcnt,
+                            size_t period)
+{
+#ifdef USE_AVX2_MULTI
+  unsigned int hwf = _gcry_get_hw_features ();
+  /* The eight-way code does about 3.7 times the work of the SSSE3
+     code in the same time; it does not catch up with SHA-NI.  */
+  int use_multi = iovcnt >= 3 && (hwf & HWF_INTEL_AVX2);
+
+#ifdef USE_SHAEXT
+  if (hwf & HWF_INTEL_SHAEXT)
+    use_multi = 0;
+#endif
+
+  if (use_multi)
+    {
+      _gcry_md_block_hash_multi (outbuf, dlen, iov, iovcnt, period, iv, 8, 8,
+                                 _gcry_sha256_transform_avx2_8way);
+      return 0;
+    }
+#else
+  (void)outbuf;
+  (void)dlen;
+  (void)iv;
+  (void)iov;
+  (void)iovcnt;
+  (void)period;
+#endif
+
+  return GPG_ERR_NOT_SUPPORTED;
+}
+
+
+/* Hash the IOVCNT messages which repeat themselves with PERIOD past
+   the end of their buffers (see _gcry_md_block_hash_multi) and store
+   the digest of message I at OUTBUF + I * 32.  Returns
+   GPG_ERR_NOT_SUPPORTED if the multi-buffer code is not available or
+   would be slower than hashing the messages one by one.  */
+gpg_err_code_t
+_gcry_sha256_hash_periodic_multi (void *outbuf,
+                                  const gcry_buffer_t *iov, int iovcnt,
+                                  size_t period)
+{
+  return sha256_hash_periodic_multi (outbuf, 32, sha256_iv,
+                                     iov, iovcnt, period);
+}
+
+
+/* Same as above but for SHA-224; the digests are 28 bytes.  */
+gpg_err_code_t
+_gcry_sha224_hash_periodic_multi (void *outbuf,
+                                  const gcry_buffer_t *iov, int iovcnt,
+                                  size_t period)
+{
+  return sha256_hash_periodic_multi (outbuf, 28, sha224_iv,
+                                     iov, iovcnt, period);
+}
+
+
 
 /*
      Self-test section.
@@ -1194,7 +1194,7 @@ static inline void g (u64 *h, u64 *m, u64 *N)
 
 
 static unsigned int
-transform64 (void *context, const unsigned char *inbuf_arg);
+transform64 (void *context, const unsigned char *inbuf_arg, size_t nblks);
 
 
 static void
@@ -1251,11 +1251,16 @@ transform (STRIBOG_CONTEXT *hd, const unsigned char *data, unsigned count)
 }
 
 static unsigned int
-transform64 (void *context, const unsigned char *inbuf_arg)
+transform64 (void *context, const unsigned char *inbuf_arg, size_t nblks)
 {
   STRIBOG_CONTEXT *hd = context;
 
-  transform (hd, inbuf_arg, 64 * 8);
+  do
+    {
+      transform (hd, inbuf_arg, 64 * 8);
+      inbuf_arg += 64;
+    }
+  while (--nblks);
 
   return /* burn_stack */ 768;
 }
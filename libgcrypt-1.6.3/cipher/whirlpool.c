@@ -1169,7 +1169,7 @@ static const u64 C7[256] =
  * Transform block.
  */
 static unsigned int
-whirlpool_transform (void *ctx, const unsigned char *data)
+whirlpool_transform_blk (void *ctx, const unsigned char *data)
 {
   whirlpool_context_t *context = ctx;
   whirlpool_block_t data_block;
@@ -1269,6 +1269,22 @@ whirlpool_transform (void *ctx, const unsigned char *data)
 }
 
 
+static unsigned int
+whirlpool_transform (void *ctx, const unsigned char *data, size_t nblks)
+{
+  unsigned int burn;
+
+  do
+    {
+      burn = whirlpool_transform_blk (ctx, data);
+      data += BLOCK_SIZE;
+    }
+  while (--nblks);
+
+  return burn;
+}
+
+
 static void
 whirlpool_init (void *ctx, unsigned int flags)
 {
@@ -1303,7 +1319,7 @@ whirlpool_add_bugemu (whirlpool_context_t *context,
   if (context->bugemu.count == BLOCK_SIZE)
     {
       /* Flush the buffer.  */
-      whirlpool_transform (context, context->bctx.buf);
+      whirlpool_transform (context, context->bctx.buf, 1);
       context->bugemu.count = 0;
     }
   if (! buffer)
@@ -1323,7 +1339,7 @@ whirlpool_add_bugemu (whirlpool_context_t *context,
 
   while (buffer_n >= BLOCK_SIZE)
     {
-      whirlpool_transform (context, buffer);
+      whirlpool_transform (context, buffer, 1);
       context->bugemu.count = 0;
       buffer_n -= BLOCK_SIZE;
       buffer += BLOCK_SIZE;
@@ -27,11 +27,60 @@
 #include "g10lib.h"
 #include "context.h"
 #include "ec-context.h"
+#include "ec-internal.h"
 
 
+#define ED25519_LIMBS (256 / BITS_PER_MPI_LIMB)
+
+/* W = W mod P for p = 2^255 - 19.  Because 2^256 = 38 (mod p) the
+   upper half of W is folded into the lower half with a single
+   multiply-accumulate.  Values of up to 512 bits and of either sign
+   are reduced without any memory allocation; larger ones are passed
+   to the generic code.  */
 void
-_gcry_mpi_ec_ed25519_mod (gcry_mpi_t a)
+_gcry_mpi_ec_ed25519_mod (gcry_mpi_t w, mpi_ec_t ctx)
 {
-  (void)a;
+  mpi_limb_t buf[2*ED25519_LIMBS];
+  mpi_limb_t cy, top;
+  mpi_size_t i, n;
+
+  if (w->nlimbs > 2*ED25519_LIMBS)
+    {
+      _gcry_mpi_mod (w, w, ctx->p);
+      return;
+    }
+
+  for (i=0; i < w->nlimbs; i++)
+    buf[i] = w->d[i];
+  for (; i < 2*ED25519_LIMBS; i++)
+    buf[i] = 0;
+
+  /* BUF = LO + 38*HI; the carry is at most 38.  */
+  cy = _gcry_mpih_addmul_1 (buf, buf + ED25519_LIMBS, ED25519_LIMBS, 38);
+  cy = _gcry_mpih_add_1 (buf, buf, ED25519_LIMBS, cy * 38);
+  if (cy)
+    _gcry_mpih_add_1 (buf, buf, ED25519_LIMBS, 38);
+
+  /* Fold bit 255; the result is then less than 2P.  */
+  top = buf[ED25519_LIMBS-1] >> (BITS_PER_MPI_LIMB - 1);
+  buf[ED25519_LIMBS-1] &= ~((mpi_limb_t)1 << (BITS_PER_MPI_LIMB - 1));
+  _gcry_mpih_add_1 (buf, buf, ED25519_LIMBS, top * 19);
+  if (_gcry_mpih_cmp (buf, ctx->p->d, ED25519_LIMBS) >= 0)
+    _gcry_mpih_sub_n (buf, buf, ctx->p->d, ED25519_LIMBS);
+
+  /* For a negative W we need P - BUF.  */
+  if (w->sign)
+    {
+      n = ED25519_LIMBS;
+      MPN_NORMALIZE (buf, n);
+      if (n)
+        _gcry_mpih_sub_n (buf, ctx->p->d, buf, ED25519_LIMBS);
+    }
 
+  RESIZE_IF_NEEDED (w, ED25519_LIMBS);
+  MPN_COPY (w->d, buf, ED25519_LIMBS);
+  n = ED25519_LIMBS;
+  MPN_NORMALIZE (w->d, n);
+  w->nlimbs = n;
+  w->sign = 0;
 }
@@ -20,6 +20,8 @@
 #ifndef GCRY_EC_INTERNAL_H
 #define GCRY_EC_INTERNAL_H
 
-void _gcry_mpi_ec_ed25519_mod (gcry_mpi_t a);
+void _gcry_mpi_ec_ed25519_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist256_mod (gcry_mpi_t w, mpi_ec_t ctx);
+void _gcry_mpi_ec_nist384_mod (gcry_mpi_t w, mpi_ec_t ctx);
 
 #endif /*GCRY_EC_INTERNAL_H*/
@@ -0,0 +1,224 @@
+/* ec-nist.c -  NIST optimized elliptic curve functions
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mpi-internal.h"
+#include "longlong.h"
+#include "g10lib.h"
+#include "context.h"
+#include "ec-context.h"
+#include "ec-internal.h"
+
+
+/* The Solinas reduction for the generalized Mersenne primes of NIST
+   P-256 and P-384 as given in FIPS 186-3, D.2.  The input is split
+   into 32 bit words C[i] and each word of the result is a small sum
+   of input words.  Working on 32 bit words lets us use the same code
+   for all limb sizes and a u64 is large enough to accumulate a
+   column without overflow; negative column sums simply wrap around
+   and the signed carry is propagated to the next column.  */
+
+#define SOLINAS_MAX_WORDS 12
+
+#define C(i) ((u64)c[(i)])
+
+#define COLUMN(j, expr)                         \
+  do {                                          \
+    acc = (u64)carry + (expr);                  \
+    r[(j)] = (u32)acc;                          \
+    carry = column_carry (acc);                 \
+  } while (0)
+
+
+/* Return the signed carry from the two's complement column sum A.  */
+static inline int
+column_carry (u64 a)
+{
+  return (int)(u32)(a >> 32);
+}
+
+
+/* Load W into the NWORDS words of C.  Returns false if W is too
+   large; the caller then needs to use the generic code.  */
+static int
+load_words (u32 *c, unsigned int nwords, gcry_mpi_t w)
+{
+  mpi_size_t i;
+
+  if (w->nlimbs * BYTES_PER_MPI_LIMB > nwords * 4)
+    return 0;
+
+  memset (c, 0, nwords * 4);
+  for (i=0; i < w->nlimbs; i++)
+    {
+#if BYTES_PER_MPI_LIMB == 8
+      c[2*i]   = (u32)w->d[i];
+      c[2*i+1] = (u32)(w->d[i] >> 32);
+#else
+      c[i] = w->d[i];
+#endif
+    }
+  return 1;
+}
+
+
+/* Finish the reduction of the NWORDS words R with the pending signed
+   CARRY and store the result in W.  FOLD gives 2^(32*NWORDS) mod P,
+   least significant word first.  */
+static void
+store_words (gcry_mpi_t w, mpi_ec_t ctx, u32 *r, unsigned int nwords,
+             int carry, const int *fold)
+{
+  const mpi_size_t plimbs = nwords * 4 / BYTES_PER_MPI_LIMB;
+  mpi_limb_t rl[SOLINAS_MAX_WORDS];
+  mpi_size_t i, n;
+  unsigned int j;
+  int cc;
+  u64 acc;
+
+  /* Fold the carry back.  This converges after at most two
+     rounds.  */
+  while (carry)
+    {
+      cc = carry;
+      carry = 0;
+      for (j=0; j < nwords; j++)
+        {
+          acc = (u64)r[j] + (u64)carry + (u64)(cc * fold[j]);
+          r[j] = (u32)acc;
+          carry = column_carry (acc);
+        }
+    }
+
+  /* Back to limbs; R is now less than 2^(32*NWORDS) < 2P.  */
+  for (i=0; i < plimbs; i++)
+    {
+#if BYTES_PER_MPI_LIMB == 8
+      rl[i] = ((mpi_limb_t)r[2*i+1] << 32) | r[2*i];
+#else
+      rl[i] = r[i];
+#endif
+    }
+  if (_gcry_mpih_cmp (rl, ctx->p->d, plimbs) >= 0)
+    _gcry_mpih_sub_n (rl, rl, ctx->p->d, plimbs);
+
+  /* For a negative W we need P - R.  */
+  if (w->sign)
+    {
+      n = plimbs;
+      MPN_NORMALIZE (rl, n);
+      if (n)
+        _gcry_mpih_sub_n (rl, ctx->p->d, rl, plimbs);
+    }
+
+  RESIZE_IF_NEEDED (w, plimbs);
+  MPN_COPY (w->d, rl, plimbs);
+  n = plimbs;
+  MPN_NORMALIZE (w->d, n);
+  w->nlimbs = n;
+  w->sign = 0;
+}
+
+
+/* W = W mod P for p = 2^256 - 2^224 + 2^192 + 2^96 - 1.  Values of up
+   to 512 bits and of either sign are reduced without any memory
+   allocation; larger ones are passed to the generic code.  */
+void
+_gcry_mpi_ec_nist256_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+#if BYTES_PER_MPI_LIMB == 4 || BYTES_PER_MPI_LIMB == 8
+  static const int fold[8] = { 1, 0, 0, -1, 0, 0, -1, 1 };
+  u32 c[16];
+  u32 r[8];
+  int carry = 0;
+  u64 acc;
+
+  if (w->nlimbs * BYTES_PER_MPI_LIMB < 32 && !w->sign)
+    return;  /* Already reduced.  */
+  if (!load_words (c, 16, w))
+    {
+      _gcry_mpi_mod (w, w, ctx->p);
+      return;
+    }
+
+  /* r = s1 + 2 s2 + 2 s3 + s4 + s5 - s6 - s7 - s8 - s9  */
+  COLUMN (0, C(0) + C(8) + C(9) - C(11) - C(12) - C(13) - C(14));
+  COLUMN (1, C(1) + C(9) + C(10) - C(12) - C(13) - C(14) - C(15));
+  COLUMN (2, C(2) + C(10) + C(11) - C(13) - C(14) - C(15));
+  COLUMN (3, C(3) + 2*C(11) + 2*C(12) + C(13) - C(8) - C(9) - C(15));
+  COLUMN (4, C(4) + 2*C(12) + 2*C(13) + C(14) - C(9) - C(10));
+  COLUMN (5, C(5) + 2*C(13) + 2*C(14) + C(15) - C(10) - C(11));
+  COLUMN (6, C(6) + C(13) + 3*C(14) + 2*C(15) - C(8) - C(9));
+  COLUMN (7, C(7) + C(8) + 3*C(15) - C(10) - C(11) - C(12) - C(13));
+
+  store_words (w, ctx, r, 8, carry, fold);
+#else /* Unsupported limb size.  */
+  _gcry_mpi_mod (w, w, ctx->p);
+#endif
+}
+
+
+/* W = W mod P for p = 2^384 - 2^128 - 2^96 + 2^32 - 1.  Values of up
+   to 768 bits and of either sign are reduced without any memory
+   allocation; larger ones are passed to the generic code.  */
+void
+_gcry_mpi_ec_nist384_mod (gcry_mpi_t w, mpi_ec_t ctx)
+{
+#if BYTES_PER_MPI_LIMB == 4 || BYTES_PER_MPI_LIMB == 8
+  static const int fold[12] = { 1, -1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+  u32 c[24];
+  u32 r[12];
+  int carry = 0;
+  u64 acc;
+
+  if (w->nlimbs * BYTES_PER_MPI_LIMB < 48 && !w->sign)
+    return;  /* Already reduced.  */
+  if (!load_words (c, 24, w))
+    {
+      _gcry_mpi_mod (w, w, ctx->p);
+      return;
+    }
+
+  /* r = s1 + 2 s2 + s3 + s4 + s5 + s6 + s7 - s8 - s9 - s10  */
+  COLUMN ( 0, C(0) + C(12) + C(20) + C(21) - C(23));
+  COLUMN ( 1, C(1) + C(13) + C(22) + C(23) - C(12) - C(20));
+  COLUMN ( 2, C(2) + C(14) + C(23) - C(13) - C(21));
+  COLUMN ( 3, C(3) + C(12) + C(15) + C(20) + C(21)
+              - C(14) - C(22) - C(23));
+  COLUMN ( 4, C(4) + C(12) + C(13) + C(16) + C(20) + 2*C(21) + C(22)
+              - C(15) - 2*C(23));
+  COLUMN ( 5, C(5) + C(13) + C(14) + C(17) + C(21) + 2*C(22) + C(23)
+              - C(16));
+  COLUMN ( 6, C(6) + C(14) + C(15) + C(18) + C(22) + 2*C(23) - C(17));
+  COLUMN ( 7, C(7) + C(15) + C(16) + C(19) + C(23) - C(18));
+  COLUMN ( 8, C(8) + C(16) + C(17) + C(20) - C(19));
+  COLUMN ( 9, C(9) + C(17) + C(18) + C(21) - C(20));
+  COLUMN (10, C(10) + C(18) + C(19) + C(22) - C(21));
+  COLUMN (11, C(11) + C(19) + C(20) + C(23) - C(22));
+
+  store_words (w, ctx, r, 12, carry, fold);
+#else /* Unsupported limb size.  */
+  _gcry_mpi_mod (w, w, ctx->p);
+#endif
+}
@@ -21,6 +21,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "mpi-internal.h"
@@ -225,14 +226,91 @@ _gcry_mpi_point_snatch_set (mpi_point_t point,
 }
 
 
+/* Set up the scratch arena of CTX.  PROD takes a product of two
+   numbers of up to P's size plus a limb for the normalization shift;
+   QUOT takes the quotient of a division of PROD by P.  */
+static void
+ec_arena_init (mpi_ec_t ctx)
+{
+  mpi_size_t psize = ctx->p->nlimbs;
+
+  ctx->t.arena.psize = psize;
+  ctx->t.arena.prodsize = 2 * psize + 2;
+  ctx->t.arena.nlimbs = ctx->t.arena.prodsize + (psize + 3) + psize;
+  ctx->t.arena.d = mpi_alloc_limb_space (ctx->t.arena.nlimbs, 0);
+  ctx->t.arena.prod = ctx->t.arena.d;
+  ctx->t.arena.quot = ctx->t.arena.prod + ctx->t.arena.prodsize;
+  ctx->t.arena.pnorm = ctx->t.arena.quot + psize + 3;
+
+  count_leading_zeros (ctx->t.arena.shift, ctx->p->d[psize-1]);
+  if (ctx->t.arena.shift)
+    _gcry_mpih_lshift (ctx->t.arena.pnorm, ctx->p->d, psize,
+                       ctx->t.arena.shift);
+  else
+    MPN_COPY (ctx->t.arena.pnorm, ctx->p->d, psize);
+}
+
+
+/* W = PROD mod P, where PROD are the first NSIZE limbs of the product
+   buffer of the arena and NEGATIVE gives its sign.  NSIZE must be
+   less than the size of the buffer, whose content is clobbered.  */
+static void
+ec_mod_arena (gcry_mpi_t w, mpi_size_t nsize, int negative, mpi_ec_t ctx)
+{
+  mpi_ptr_t np = ctx->t.arena.prod;
+  mpi_size_t psize = ctx->t.arena.psize;
+  unsigned int shift = ctx->t.arena.shift;
+  mpi_size_t rsize;
+  mpi_limb_t cy;
+
+  MPN_NORMALIZE (np, nsize);
+  rsize = nsize;
+  if (nsize >= psize)
+    {
+      /* This is what mpi_tdiv_qr does but without allocating the
+         normalized operands.  */
+      if (shift)
+        {
+          cy = _gcry_mpih_lshift (np, np, nsize, shift);
+          if (cy)
+            np[nsize++] = cy;
+        }
+      _gcry_mpih_divrem (ctx->t.arena.quot, 0, np, nsize,
+                         ctx->t.arena.pnorm, psize);
+      if (shift)
+        _gcry_mpih_rshift (np, np, psize, shift);
+      rsize = psize;
+      MPN_NORMALIZE (np, rsize);
+    }
+
+  if (negative && rsize)
+    {
+      /* Return P - R as mpi_mod does.  */
+      _gcry_mpih_sub (np, ctx->p->d, psize, np, rsize);
+      rsize = psize;
+      MPN_NORMALIZE (np, rsize);
+    }
+
+  RESIZE_IF_NEEDED (w, psize);
+  MPN_COPY (w->d, np, rsize);
+  w->nlimbs = rsize;
+  w->sign = 0;
+}
+
+
 /* W = W mod P.  */
 static void
 ec_mod (gcry_mpi_t w, mpi_ec_t ec)
 {
-  if (0 && ec->dialect == ECC_DIALECT_ED25519)
-    _gcry_mpi_ec_ed25519_mod (w);
+  if (ec->t.mod)
+    ec->t.mod (w, ec);
   else if (ec->t.p_barrett)
     _gcry_mpi_mod_barrett (w, w, ec->t.p_barrett);
+  else if (w->nlimbs < ec->t.arena.prodsize)
+    {
+      MPN_COPY (ec->t.arena.prod, w->d, w->nlimbs);
+      ec_mod_arena (w, w->nlimbs, w->sign, ec);
+    }
   else
     _gcry_mpi_mod (w, w, ec->p);
 }
@@ -255,6 +333,42 @@ ec_subm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ec)
 static void
 ec_mulm (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, mpi_ec_t ctx)
 {
+  mpi_size_t nsize = u->nlimbs + v->nlimbs;
+
+  if (u->nlimbs && v->nlimbs && nsize < ctx->t.arena.prodsize
+      && (ctx->t.mod || !ctx->t.p_barrett))
+    {
+      /* Fast path: Multiply into the arena and reduce from there;
+         this avoids all memory allocation.  */
+      mpi_ptr_t prod = ctx->t.arena.prod;
+      int sign = u->sign ^ v->sign;
+
+      if (u == v)
+        _gcry_mpih_sqr_n_basecase (prod, u->d, u->nlimbs);
+      else if (u->nlimbs >= v->nlimbs)
+        _gcry_mpih_mul (prod, u->d, u->nlimbs, v->d, v->nlimbs);
+      else
+        _gcry_mpih_mul (prod, v->d, v->nlimbs, u->d, u->nlimbs);
+
+      /* The fast reduction functions are limited to products of
+         reduced values.  */
+      if (ctx->t.mod && nsize <= 2 * ctx->p->nlimbs)
+        {
+          struct gcry_mpi tmp;
+
+          tmp.alloced = ctx->t.arena.prodsize;
+          tmp.nlimbs = nsize;
+          MPN_NORMALIZE (prod, tmp.nlimbs);
+          tmp.sign = sign;
+          tmp.flags = 0;
+          tmp.d = prod;
+          ctx->t.mod (&tmp, ctx);
+          mpi_set (w, &tmp);
+        }
+      else
+        ec_mod_arena (w, nsize, sign, ctx);
+      return;
+    }
   mpi_mul (w, u, v);
   ec_mod (w, ctx);
 }
@@ -290,11 +404,14 @@ ec_pow2 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
 
 /* Shortcut for
      ec_powm (B, B, mpi_const (MPI_C_THREE), ctx);
-   for easier optimization.  */
+   for easier optimization.  Two multiplications are much faster than
+   mpi_powm and make use of the fast reduction.  W and B must be
+   different.  */
 static void
 ec_pow3 (gcry_mpi_t w, const gcry_mpi_t b, mpi_ec_t ctx)
 {
-  mpi_powm (w, b, mpi_const (MPI_C_THREE), ctx->p);
+  ec_mulm (w, b, b, ctx);
+  ec_mulm (w, w, b, ctx);
 }
 
 
@@ -353,6 +470,27 @@ ec_get_two_inv_p (mpi_ec_t ec)
 }
 
 
+/* Primes for which a specialized reduction function is available.  */
+static const struct
+{
+  unsigned int nbits;
+  const char *p;
+  void (*mod) (gcry_mpi_t w, mpi_ec_t ctx);
+} field_table[] =
+  {
+    { 255,
+      "0x7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFED",
+      _gcry_mpi_ec_ed25519_mod },
+    { 256,
+      "0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF",
+      _gcry_mpi_ec_nist256_mod },
+    { 384,
+      "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFE"
+      "FFFFFFFF0000000000000000FFFFFFFF",
+      _gcry_mpi_ec_nist384_mod },
+    { 0, NULL, NULL }
+  };
+
 
 /* This function initialized a context for elliptic curve based on the
    field GF(p).  P is the prime specifying this field, A is the first
@@ -364,6 +502,7 @@ ec_p_init (mpi_ec_t ctx, enum gcry_mpi_ec_models model,
            gcry_mpi_t p, gcry_mpi_t a, gcry_mpi_t b)
 {
   int i;
+  unsigned int pbits;
   static int use_barrett;
 
   if (!use_barrett)
@@ -394,24 +533,25 @@ ec_p_init (mpi_ec_t ctx, enum gcry_mpi_ec_models model,
   /* Allocate scratch variables.  */
   for (i=0; i< DIM(ctx->t.scratch); i++)
     ctx->t.scratch[i] = mpi_alloc_like (ctx->p);
+  ec_arena_init (ctx);
 
   /* Prepare for fast reduction.  */
-  /* FIXME: need a test for NIST values.  However it does not gain us
-     any real advantage, for 384 bits it is actually slower than using
-     mpi_mulm.  */
-/*   ctx->nist_nbits = mpi_get_nbits (ctx->p); */
-/*   if (ctx->nist_nbits == 192) */
-/*     { */
-/*       for (i=0; i < 4; i++) */
-/*         ctx->s[i] = mpi_new (192); */
-/*       ctx->c    = mpi_new (192*2); */
-/*     } */
-/*   else if (ctx->nist_nbits == 384) */
-/*     { */
-/*       for (i=0; i < 10; i++) */
-/*         ctx->s[i] = mpi_new (384); */
-/*       ctx->c    = mpi_new (384*2); */
-/*     } */
+  ctx->t.mod = NULL;
+  pbits = mpi_get_nbits (ctx->p);
+  for (i=0; field_table[i].p; i++)
+    {
+      gcry_mpi_t f_p;
+
+      if (field_table[i].nbits != pbits)
+        continue;
+      if (_gcry_mpi_scan (&f_p, GCRYMPI_FMT_HEX, field_table[i].p, 0, NULL))
+        log_fatal ("scanning ECC parameter failed\n");
+      if (!mpi_cmp (f_p, ctx->p))
+        ctx->t.mod = field_table[i].mod;
+      mpi_free (f_p);
+      if (ctx->t.mod)
+        break;
+    }
 }
 
 
@@ -439,6 +579,7 @@ ec_deinit (void *opaque)
 
   for (i=0; i< DIM(ctx->t.scratch); i++)
     mpi_free (ctx->t.scratch[i]);
+  _gcry_mpi_free_limb_space (ctx->t.arena.d, ctx->t.arena.nlimbs);
 
 /*   if (ctx->nist_nbits == 192) */
 /*     { */
@@ -600,10 +741,21 @@ _gcry_mpi_ec_get_affine (gcry_mpi_t x, gcry_mpi_t y, mpi_point_t point,
 
     case MPI_EC_MONTGOMERY:
       {
-        log_fatal ("%s: %s not yet supported\n",
-                   "_gcry_mpi_ec_get_affine", "Montgomery");
+        /* Only the x-coordinate is maintained.  */
+        gcry_mpi_t z;
+
+        if (y)
+          log_fatal ("%s: Getting Y-coordinate on %s is not supported\n",
+                     "_gcry_mpi_ec_get_affine", "Montgomery");
+        if (x)
+          {
+            z = mpi_new (0);
+            ec_invm (z, point->z, ctx);
+            ec_mulm (x, point->x, z, ctx);
+            _gcry_mpi_release (z);
+          }
       }
-      return -1;
+      return 0;
 
     case MPI_EC_TWISTEDEDWARDS:
       {
@@ -668,7 +820,8 @@ dup_point_weierstrass (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
           /*                          T1: used for aZ^4. */
           ec_pow2 (l1, point->x, ctx);
           ec_mulm (l1, l1, mpi_const (MPI_C_THREE), ctx);
-          ec_powm (t1, point->z, mpi_const (MPI_C_FOUR), ctx);
+          ec_pow2 (t1, point->z, ctx);
+          ec_pow2 (t1, t1, ctx);
           ec_mulm (t1, t1, ctx->a, ctx);
           ec_addm (l1, l1, t1, ctx);
         }
@@ -711,15 +864,42 @@ dup_point_weierstrass (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
 }
 
 
-/*  RESULT = 2 * POINT  (Montgomery version). */
+/*  RESULT = 2 * POINT  (Montgomery version).  Only X and Z are used;
+    the curve coefficient A is given as (A-2)/4 in CTX->A.  */
 static void
 dup_point_montgomery (mpi_point_t result, mpi_point_t point, mpi_ec_t ctx)
 {
-  (void)result;
-  (void)point;
-  (void)ctx;
-  log_fatal ("%s: %s not yet supported\n",
-             "_gcry_mpi_ec_dup_point", "Montgomery");
+#define X1 (point->x)
+#define Z1 (point->z)
+#define X2 (result->x)
+#define Z2 (result->z)
+#define AA (ctx->t.scratch[0])
+#define BB (ctx->t.scratch[1])
+#define E  (ctx->t.scratch[2])
+
+  /* AA = (X1 + Z1)^2 */
+  ec_addm (AA, X1, Z1, ctx);
+  ec_pow2 (AA, AA, ctx);
+  /* BB = (X1 - Z1)^2 */
+  ec_subm (BB, X1, Z1, ctx);
+  ec_pow2 (BB, BB, ctx);
+  /* E = AA - BB */
+  ec_subm (E, AA, BB, ctx);
+  /* X2 = AA*BB */
+  ec_mulm (X2, AA, BB, ctx);
+  /* Z2 = E*(AA + a24*E) */
+  ec_mulm (Z2, ctx->a, E, ctx);
+  ec_addm (Z2, Z2, AA, ctx);
+  ec_mulm (Z2, Z2, E, ctx);
+  mpi_clear (result->y);
+
+#undef X1
+#undef Z1
+#undef X2
+#undef Z2
+#undef AA
+#undef BB
+#undef E
 }
 
 
@@ -888,10 +1068,10 @@ add_points_weierstrass (mpi_point_t result,
       /* l3 = l1 - l2 */
       ec_subm (l3, l1, l2, ctx);
       /* l4 = y1 z2^3  */
-      ec_powm (l4, z2, mpi_const (MPI_C_THREE), ctx);
+      ec_pow3 (l4, z2, ctx);
       ec_mulm (l4, l4, y1, ctx);
       /* l5 = y2 z1^3  */
-      ec_powm (l5, z1, mpi_const (MPI_C_THREE), ctx);
+      ec_pow3 (l5, z1, ctx);
       ec_mulm (l5, l5, y2, ctx);
       /* l6 = l4 - l5  */
       ec_subm (l6, l4, l5, ctx);
@@ -930,7 +1110,7 @@ add_points_weierstrass (mpi_point_t result,
           ec_subm (l9, t2, t1, ctx);
           /* y3 = (l9 l6 - l8 l3^3)/2  */
           ec_mulm (l9, l9, l6, ctx);
-          ec_powm (t1, l3, mpi_const (MPI_C_THREE), ctx); /* fixme: Use saved value*/
+          ec_pow3 (t1, l3, ctx); /* fixme: Use saved value*/
           ec_mulm (t1, t1, l8, ctx);
           ec_subm (y3, l9, t1, ctx);
           ec_mulm (y3, y3, ec_get_two_inv_p (ctx), ctx);
@@ -960,18 +1140,96 @@ add_points_weierstrass (mpi_point_t result,
 }
 
 
-/* RESULT = P1 + P2  (Montgomery version).*/
+/* RESULT = P1 + P2  (Montgomery version).  With x-only coordinates
+   the sum can only be computed if one of the points is the neutral
+   element or both are equal; otherwise the difference P1 - P2 is
+   required, which is what montgomery_ladder does.  */
 static void
 add_points_montgomery (mpi_point_t result,
                        mpi_point_t p1, mpi_point_t p2,
                        mpi_ec_t ctx)
 {
-  (void)result;
-  (void)p1;
-  (void)p2;
-  (void)ctx;
-  log_fatal ("%s: %s not yet supported\n",
-             "_gcry_mpi_ec_add_points", "Montgomery");
+  gcry_mpi_t t;
+
+  if (!mpi_cmp_ui (p1->z, 0))
+    point_set (result, p2);
+  else if (!mpi_cmp_ui (p2->z, 0))
+    point_set (result, p1);
+  else
+    {
+      /* X1/Z1 == X2/Z2 ?  */
+      t = mpi_new (0);
+      ec_mulm (t, p1->x, p2->z, ctx);
+      ec_mulm (result->y, p2->x, p1->z, ctx);
+      if (mpi_cmp (t, result->y))
+        log_fatal ("%s: %s requires the difference of the points\n",
+                   "_gcry_mpi_ec_add_points", "Montgomery");
+      _gcry_mpi_release (t);
+      dup_point_montgomery (result, p1, ctx);
+    }
+}
+
+
+/* Set the neutral element of the group into P.  */
+static void
+point_set_neutral (mpi_point_t p, mpi_ec_t ctx)
+{
+  if (ctx->model == MPI_EC_TWISTEDEDWARDS)
+    {
+      mpi_set_ui (p->x, 0);
+      mpi_set_ui (p->y, 1);
+      mpi_set_ui (p->z, 1);
+    }
+  else
+    {
+      mpi_set_ui (p->x, 1);
+      mpi_set_ui (p->y, 1);
+      mpi_set_ui (p->z, 0);
+    }
+}
+
+
+/* One step of the Montgomery ladder: PRD = 2*P1 and SUM = P1 + P2,
+   where DIF_X is the affine x-coordinate of P1 - P2.  The formulas
+   are from RFC 7748; the curve coefficient is given as (A-2)/4 in
+   CTX->A.  */
+static void
+montgomery_ladder (mpi_point_t prd, mpi_point_t sum,
+                   mpi_point_t p1, mpi_point_t p2, gcry_mpi_t dif_x,
+                   mpi_ec_t ctx)
+{
+#define A  (ctx->t.scratch[3])
+#define B  (ctx->t.scratch[4])
+#define C  (ctx->t.scratch[5])
+#define D  (ctx->t.scratch[6])
+
+  ec_addm (A, p1->x, p1->z, ctx);
+  ec_subm (B, p1->x, p1->z, ctx);
+  ec_addm (C, p2->x, p2->z, ctx);
+  ec_subm (D, p2->x, p2->z, ctx);
+  /* DA = D*A, CB = C*B */
+  ec_mulm (D, D, A, ctx);
+  ec_mulm (C, C, B, ctx);
+  /* SUM.X = (DA + CB)^2, SUM.Z = x1*(DA - CB)^2 */
+  ec_addm (sum->x, D, C, ctx);
+  ec_pow2 (sum->x, sum->x, ctx);
+  ec_subm (sum->z, D, C, ctx);
+  ec_pow2 (sum->z, sum->z, ctx);
+  ec_mulm (sum->z, sum->z, dif_x, ctx);
+  /* AA = A^2, BB = B^2, E = AA - BB */
+  ec_pow2 (A, A, ctx);
+  ec_pow2 (B, B, ctx);
+  ec_mulm (prd->x, A, B, ctx);
+  ec_subm (B, A, B, ctx);
+  /* PRD.Z = E*(AA + a24*E) */
+  ec_mulm (prd->z, ctx->a, B, ctx);
+  ec_addm (prd->z, prd->z, A, ctx);
+  ec_mulm (prd->z, prd->z, B, ctx);
+
+#undef A
+#undef B
+#undef C
+#undef D
 }
 
 
@@ -1144,6 +1402,67 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
         }
       return;
     }
+  else if (ctx->model == MPI_EC_MONTGOMERY)
+    {
+      /* X-only Montgomery ladder.  The loop always runs over all bits
+         of the field size and the conditional swaps do not depend on
+         branches; thus the timing does not depend on the scalar.  */
+      unsigned int nbits;
+      int j, swap, bit;
+      mpi_point_struct q0, q1;
+      gcry_mpi_t dif_x;
+      mpi_size_t nlimbs = ctx->p->nlimbs;
+
+      nbits = mpi_get_nbits (scalar);
+      if (nbits < ctx->nbits)
+        nbits = ctx->nbits;
+
+      point_init (&q0);
+      point_init (&q1);
+      dif_x = mpi_new (0);
+
+      if (!mpi_cmp_ui (point->z, 0))
+        {
+          point_set_neutral (result, ctx);
+          goto leave_montgomery;
+        }
+      if (!mpi_cmp_ui (point->z, 1))
+        mpi_set (dif_x, point->x);
+      else
+        _gcry_mpi_ec_get_affine (dif_x, NULL, point, ctx);
+
+      /* Q0 = neutral element, Q1 = POINT.  */
+      mpi_set_ui (q0.x, 1);
+      mpi_set_ui (q0.z, 0);
+      mpi_set (q1.x, dif_x);
+      mpi_set_ui (q1.z, 1);
+      mpi_resize (q0.x, nlimbs);
+      mpi_resize (q0.z, nlimbs);
+      mpi_resize (q1.x, nlimbs);
+      mpi_resize (q1.z, nlimbs);
+
+      swap = 0;
+      for (j=nbits-1; j >= 0; j--)
+        {
+          bit = mpi_test_bit (scalar, j);
+          mpi_swap_cond (q0.x, q1.x, swap ^ bit);
+          mpi_swap_cond (q0.z, q1.z, swap ^ bit);
+          swap = bit;
+          montgomery_ladder (&q0, &q1, &q0, &q1, dif_x, ctx);
+        }
+      mpi_swap_cond (q0.x, q1.x, swap);
+      mpi_swap_cond (q0.z, q1.z, swap);
+
+      mpi_set (result->x, q0.x);
+      mpi_clear (result->y);
+      mpi_set (result->z, q0.z);
+
+    leave_montgomery:
+      mpi_free (dif_x);
+      point_free (&q1);
+      point_free (&q0);
+      return;
+    }
 
   x1 = mpi_alloc_like (ctx->p);
   y1 = mpi_alloc_like (ctx->p);
@@ -1231,6 +1550,694 @@ _gcry_mpi_ec_mul_point (mpi_point_t result,
 }
 
 
+/* Window width for the fixed-base tables.  Each table has
+   2^BASE_TABLE_W points per window.  */
+#define BASE_TABLE_W 4
+
+/* A table of precomputed multiples of a fixed base point G.  Row I
+   holds the points J * 2^(W*I) * G for J = 0 .. 2^W-1 in affine
+   coordinates (Z = 1, except for the neutral element).  A scalar
+   multiplication with G is then a sum of one entry per row and does
+   not need any point doubling.  */
+struct mpi_ec_base_table_s
+{
+  unsigned int nbits;     /* Largest supported scalar in bits.  */
+  unsigned int nwindows;  /* Number of rows.  */
+  unsigned int nlimbs;    /* Allocated limbs of each coordinate.  */
+  gcry_mpi_t b3;          /* 3*b mod p for Weierstrass curves.  */
+  mpi_point_struct *points;
+};
+
+
+/* Allocate the coordinates of P with exactly NLIMBS limbs so that
+   mpi_set_cond may be used between table entries.  */
+static void
+point_init_limbs (mpi_point_t p, unsigned int nlimbs)
+{
+  p->x = mpi_alloc (nlimbs);
+  p->y = mpi_alloc (nlimbs);
+  p->z = mpi_alloc (nlimbs);
+}
+
+
+/* Convert the N projective points at POINTS to affine coordinates
+   and store them in the table entries at RESULT.  Points at infinity
+   are stored as the neutral element.  Montgomery's trick is used so
+   that only one inversion is required for all points.  */
+static void
+base_table_set_affine (mpi_point_t result, mpi_point_t points,
+                       unsigned int n, mpi_ec_t ctx)
+{
+  gcry_mpi_t *prod;
+  gcry_mpi_t inv, zinv, z2;
+  unsigned int i;
+
+  /* PROD[i] is the product of the Z coordinates of the points 0..i,
+     not counting those at infinity.  */
+  prod = xcalloc (n, sizeof *prod);
+  for (i=0; i < n; i++)
+    {
+      prod[i] = mpi_new (0);
+      if (!mpi_cmp_ui (points[i].z, 0))
+        {
+          if (i)
+            mpi_set (prod[i], prod[i-1]);
+          else
+            mpi_set_ui (prod[i], 1);
+        }
+      else if (i)
+        ec_mulm (prod[i], prod[i-1], points[i].z, ctx);
+      else
+        mpi_set (prod[i], points[i].z);
+    }
+
+  inv = mpi_new (0);
+  zinv = mpi_new (0);
+  z2 = mpi_new (0);
+  ec_invm (inv, prod[n-1], ctx);
+  for (i=n; i-- > 0; )
+    {
+      if (!mpi_cmp_ui (points[i].z, 0))
+        {
+          point_set_neutral (&result[i], ctx);
+          /* For Weierstrass curves use (0 : 1 : 0), the neutral
+             element in homogeneous projective coordinates, as
+             required by add_points_weierstrass_complete.  As Jacobian
+             point it is still at infinity.  */
+          if (ctx->model == MPI_EC_WEIERSTRASS)
+            mpi_set_ui (result[i].x, 0);
+          continue;
+        }
+
+      /* INV is the inverse of PROD[i] here.  */
+      if (i)
+        {
+          ec_mulm (zinv, inv, prod[i-1], ctx);
+          ec_mulm (inv, inv, points[i].z, ctx);
+        }
+      else
+        mpi_set (zinv, inv);
+
+      /* Go through Z2 to keep the allocated size of the table
+         entries.  */
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        {
+          /* Jacobian coordinates: x = X/Z^2, y = Y/Z^3.  */
+          ec_mulm (z2, zinv, zinv, ctx);
+          ec_mulm (zinv, z2, zinv, ctx);
+          ec_mulm (z2, points[i].x, z2, ctx);
+          mpi_set (result[i].x, z2);
+          ec_mulm (z2, points[i].y, zinv, ctx);
+          mpi_set (result[i].y, z2);
+        }
+      else
+        {
+          ec_mulm (z2, points[i].x, zinv, ctx);
+          mpi_set (result[i].x, z2);
+          ec_mulm (z2, points[i].y, zinv, ctx);
+          mpi_set (result[i].y, z2);
+        }
+      mpi_set_ui (result[i].z, 1);
+    }
+
+  mpi_free (z2);
+  mpi_free (zinv);
+  mpi_free (inv);
+  for (i=0; i < n; i++)
+    mpi_free (prod[i]);
+  xfree (prod);
+}
+
+
+/* Create a table of multiples of the base point G for use with
+   _gcry_mpi_ec_mul_base.  The table is only valid for the curve
+   described by CTX.  Returns NULL if out of core.  */
+mpi_ec_base_table_t
+_gcry_mpi_ec_base_table_new (mpi_point_t G, mpi_ec_t ctx)
+{
+  mpi_ec_base_table_t tbl;
+  mpi_point_struct base;
+  mpi_point_t proj, row;
+  unsigned int i, j, n;
+
+  if (ctx->model == MPI_EC_MONTGOMERY)
+    return NULL;
+
+  tbl = xtrycalloc (1, sizeof *tbl);
+  if (!tbl)
+    return NULL;
+  tbl->nbits = ctx->nbits;
+  tbl->nwindows = (tbl->nbits + BASE_TABLE_W - 1) / BASE_TABLE_W;
+  tbl->nlimbs = ctx->p->nlimbs;
+  n = tbl->nwindows << BASE_TABLE_W;
+  tbl->points = xtrycalloc (n, sizeof *tbl->points);
+  if (!tbl->points)
+    {
+      xfree (tbl);
+      return NULL;
+    }
+  proj = xtrycalloc (n, sizeof *proj);
+  if (!proj)
+    {
+      xfree (tbl->points);
+      xfree (tbl);
+      return NULL;
+    }
+  for (i=0; i < n; i++)
+    {
+      point_init_limbs (&tbl->points[i], tbl->nlimbs);
+      point_init (&proj[i]);
+    }
+
+  /* Compute the multiples in projective coordinates first.  */
+  point_init (&base);
+  point_set (&base, G);
+  for (i=0; i < tbl->nwindows; i++)
+    {
+      row = proj + (i << BASE_TABLE_W);
+      point_set_neutral (&row[0], ctx);
+      point_set (&row[1], &base);
+      for (j=2; j < (1 << BASE_TABLE_W); j++)
+        _gcry_mpi_ec_add_points (&row[j], &row[j-1], &base, ctx);
+      for (j=0; j < BASE_TABLE_W; j++)
+        _gcry_mpi_ec_dup_point (&base, &base, ctx);
+    }
+  point_free (&base);
+
+  base_table_set_affine (tbl->points, proj, n, ctx);
+
+  for (i=0; i < n; i++)
+    point_free (&proj[i]);
+  xfree (proj);
+
+  if (ctx->model == MPI_EC_WEIERSTRASS)
+    {
+      tbl->b3 = mpi_new (0);
+      ec_addm (tbl->b3, ctx->b, ctx->b, ctx);
+      ec_addm (tbl->b3, tbl->b3, ctx->b, ctx);
+    }
+
+  return tbl;
+}
+
+
+/* Release a table created by _gcry_mpi_ec_base_table_new.  */
+void
+_gcry_mpi_ec_base_table_free (mpi_ec_base_table_t tbl)
+{
+  unsigned int i, n;
+
+  if (!tbl)
+    return;
+  n = tbl->nwindows << BASE_TABLE_W;
+  for (i=0; i < n; i++)
+    point_free (&tbl->points[i]);
+  xfree (tbl->points);
+  mpi_free (tbl->b3);
+  xfree (tbl);
+}
+
+
+/* Set RESULT to ROW[DIGIT], where ROW is a row of a base table.  All
+   entries of the row are read and the wanted one is copied using a
+   mask; thus neither the memory access pattern nor a branch depends
+   on DIGIT.  The coordinates of RESULT must have been allocated with
+   point_init_limbs.  */
+static void
+base_table_select (mpi_point_t result, mpi_point_t row, unsigned int digit)
+{
+  unsigned int j, eq;
+
+  for (j=0; j < (1 << BASE_TABLE_W); j++)
+    {
+      /* EQ is 1 if DIGIT equals J and 0 otherwise.  */
+      eq = digit ^ j;
+      eq = ((eq - 1) >> (sizeof eq * 8 - 1)) & 1;
+      mpi_set_cond (result->x, row[j].x, eq);
+      mpi_set_cond (result->y, row[j].y, eq);
+      mpi_set_cond (result->z, row[j].z, eq);
+    }
+}
+
+
+/* RESULT = P1 + P2 for points on a short Weierstrass curve given in
+   homogeneous projective coordinates; i.e. x = X/Z and y = Y/Z, with
+   (0 : 1 : 0) as the neutral element.  This is Algorithm 1 of Renes,
+   Costello and Batina, "Complete addition formulas for prime order
+   elliptic curves".  It has no exceptional cases; thus P1 = P2 and
+   the neutral element need no branches.  B3 is 3*b mod p.  RESULT
+   may be the same as P1 but not as P2.  */
+static void
+add_points_weierstrass_complete (mpi_point_t result,
+                                 mpi_point_t p1, mpi_point_t p2,
+                                 gcry_mpi_t b3, mpi_ec_t ctx)
+{
+#define X1 (p1->x)
+#define Y1 (p1->y)
+#define Z1 (p1->z)
+#define X2 (p2->x)
+#define Y2 (p2->y)
+#define Z2 (p2->z)
+#define X3 (result->x)
+#define Y3 (result->y)
+#define Z3 (result->z)
+#define t0 (ctx->t.scratch[0])
+#define t1 (ctx->t.scratch[1])
+#define t2 (ctx->t.scratch[2])
+#define t3 (ctx->t.scratch[3])
+#define t4 (ctx->t.scratch[4])
+#define t5 (ctx->t.scratch[5])
+
+  ec_mulm (t0, X1, X2, ctx);
+  ec_mulm (t1, Y1, Y2, ctx);
+  ec_mulm (t2, Z1, Z2, ctx);
+
+  /* t3 = X1*Y2 + X2*Y1 */
+  ec_addm (t3, X1, Y1, ctx);
+  ec_addm (t4, X2, Y2, ctx);
+  ec_mulm (t3, t3, t4, ctx);
+  ec_addm (t4, t0, t1, ctx);
+  ec_subm (t3, t3, t4, ctx);
+
+  /* t4 = X1*Z2 + X2*Z1 */
+  ec_addm (t4, X1, Z1, ctx);
+  ec_addm (t5, X2, Z2, ctx);
+  ec_mulm (t4, t4, t5, ctx);
+  ec_addm (t5, t0, t2, ctx);
+  ec_subm (t4, t4, t5, ctx);
+
+  /* t5 = Y1*Z2 + Y2*Z1; from here on P1 is not used.  */
+  ec_addm (t5, Y1, Z1, ctx);
+  ec_addm (X3, Y2, Z2, ctx);
+  ec_mulm (t5, t5, X3, ctx);
+  ec_addm (X3, t1, t2, ctx);
+  ec_subm (t5, t5, X3, ctx);
+
+  ec_mulm (Z3, ctx->a, t4, ctx);
+  ec_mulm (X3, b3, t2, ctx);
+  ec_addm (Z3, X3, Z3, ctx);
+  ec_subm (X3, t1, Z3, ctx);
+  ec_addm (Z3, t1, Z3, ctx);
+  ec_mulm (Y3, X3, Z3, ctx);
+
+  ec_addm (t1, t0, t0, ctx);
+  ec_addm (t1, t1, t0, ctx);
+  ec_mulm (t2, ctx->a, t2, ctx);
+  ec_mulm (t4, b3, t4, ctx);
+  ec_addm (t1, t1, t2, ctx);
+  ec_subm (t2, t0, t2, ctx);
+  ec_mulm (t2, ctx->a, t2, ctx);
+  ec_addm (t4, t4, t2, ctx);
+
+  ec_mulm (t0, t1, t4, ctx);
+  ec_addm (Y3, Y3, t0, ctx);
+  ec_mulm (t0, t5, t4, ctx);
+  ec_mulm (X3, t3, X3, ctx);
+  ec_subm (X3, X3, t0, ctx);
+  ec_mod (X3, ctx);
+  ec_mulm (t0, t3, t1, ctx);
+  ec_mulm (Z3, t5, Z3, ctx);
+  ec_addm (Z3, Z3, t0, ctx);
+
+#undef X1
+#undef Y1
+#undef Z1
+#undef X2
+#undef Y2
+#undef Z2
+#undef X3
+#undef Y3
+#undef Z3
+#undef t0
+#undef t1
+#undef t2
+#undef t3
+#undef t4
+#undef t5
+}
+
+
+/* Fixed-base scalar multiplication with a secret SCALAR; see
+   _gcry_mpi_ec_mul_base.  One entry of each row is added, including
+   the neutral element for zero digits.  The entries are fetched with
+   base_table_select and added with formulas which have no special
+   cases, so that the sequence of operations does not depend on
+   SCALAR.  */
+static void
+mul_base_secure (mpi_point_t result, gcry_mpi_t scalar,
+                 mpi_ec_base_table_t tbl, mpi_ec_t ctx)
+{
+  mpi_point_struct entry;
+  unsigned int i, j, digit;
+
+  point_init_limbs (&entry, tbl->nlimbs);
+
+  if (ctx->model == MPI_EC_WEIERSTRASS)
+    {
+      mpi_set_ui (result->x, 0);
+      mpi_set_ui (result->y, 1);
+      mpi_set_ui (result->z, 0);
+    }
+  else
+    point_set_neutral (result, ctx);
+
+  for (i=0; i < tbl->nwindows; i++)
+    {
+      digit = 0;
+      for (j=0; j < BASE_TABLE_W; j++)
+        digit |= mpi_test_bit (scalar, i * BASE_TABLE_W + j) << j;
+      base_table_select (&entry, tbl->points + (i << BASE_TABLE_W), digit);
+      if (ctx->model == MPI_EC_WEIERSTRASS)
+        add_points_weierstrass_complete (result, result, &entry, tbl->b3, ctx);
+      else
+        _gcry_mpi_ec_add_points (result, result, &entry, ctx);
+    }
+
+  if (ctx->model == MPI_EC_WEIERSTRASS)
+    {
+      /* Convert to Jacobian coordinates: (X*Z : Y*Z^2 : Z).  */
+      ec_mulm (result->x, result->x, result->z, ctx);
+      ec_mulm (result->y, result->y, result->z, ctx);
+      ec_mulm (result->y, result->y, result->z, ctx);
+    }
+
+  point_free (&entry);
+}
+
+
+/* Fixed-base scalar multiplication: RESULT = SCALAR * G where TBL has
+   been created for G.  If TBL is NULL or SCALAR does not fit into the
+   table the generic _gcry_mpi_ec_mul_point is used.  If SCALAR is in
+   secure memory it is assumed to be a secret and mul_base_secure is
+   used.  */
+void
+_gcry_mpi_ec_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                       mpi_point_t G, mpi_ec_base_table_t tbl,
+                       mpi_ec_t ctx)
+{
+  mpi_point_t row;
+  unsigned int i, j, digit;
+
+  if (!tbl || mpi_has_sign (scalar) || mpi_get_nbits (scalar) > tbl->nbits)
+    {
+      _gcry_mpi_ec_mul_point (result, scalar, G, ctx);
+      return;
+    }
+  if (mpi_is_secure (scalar))
+    {
+      mul_base_secure (result, scalar, tbl, ctx);
+      return;
+    }
+
+  point_set_neutral (result, ctx);
+  for (i=0; i < tbl->nwindows; i++)
+    {
+      row = tbl->points + (i << BASE_TABLE_W);
+      digit = 0;
+      for (j=0; j < BASE_TABLE_W; j++)
+        digit |= mpi_test_bit (scalar, i * BASE_TABLE_W + j) << j;
+      if (digit)
+        _gcry_mpi_ec_add_points (result, result, &row[digit], ctx);
+    }
+}
+
+
+/* Window width used for the wNAF representation in
+   _gcry_mpi_ec_mul_add_points.  */
+#define WNAF_W 5
+#define WNAF_TBLSIZE (1 << (WNAF_W - 2))
+
+/* Store the width-WNAF_W non-adjacent form of the non-negative
+   SCALAR at NAF, least significant digit first.  NAF must have room
+   for mpi_get_nbits (SCALAR) + 1 digits.  Each digit is either zero
+   or odd and less than 2^(WNAF_W-1) in magnitude.  Returns the number
+   of digits.  */
+static unsigned int
+compute_wnaf (signed char *naf, gcry_mpi_t scalar)
+{
+  gcry_mpi_t k;
+  unsigned int n = 0;
+  int d;
+
+  k = mpi_copy (scalar);
+  while (mpi_cmp_ui (k, 0) > 0)
+    {
+      if (mpi_test_bit (k, 0))
+        {
+          d = k->d[0] & ((1 << WNAF_W) - 1);
+          if (d >= (1 << (WNAF_W - 1)))
+            d -= (1 << WNAF_W);
+          if (d > 0)
+            mpi_sub_ui (k, k, d);
+          else
+            mpi_add_ui (k, k, -d);
+        }
+      else
+        d = 0;
+      naf[n++] = d;
+      mpi_rshift (k, k, 1);
+    }
+  mpi_free (k);
+  return n;
+}
+
+
+/* Negate the projective POINT in place.  */
+static void
+point_negate (mpi_point_t point, mpi_ec_t ctx)
+{
+  gcry_mpi_t c;
+
+  c = ctx->model == MPI_EC_TWISTEDEDWARDS? point->x : point->y;
+  mpi_sub (c, ctx->p, c);
+  ec_mod (c, ctx);
+}
+
+
+/* Fill TBL with the odd multiples P, 3P, ..., (2*WNAF_TBLSIZE-1)P
+   followed by their negations.  TBL must have room for
+   2*WNAF_TBLSIZE initialized points.  */
+static void
+wnaf_precompute (mpi_point_t tbl, mpi_point_t point, mpi_ec_t ctx)
+{
+  mpi_point_struct twice;
+  int i;
+
+  point_init (&twice);
+  _gcry_mpi_ec_dup_point (&twice, point, ctx);
+  point_set (&tbl[0], point);
+  for (i=1; i < WNAF_TBLSIZE; i++)
+    _gcry_mpi_ec_add_points (&tbl[i], &tbl[i-1], &twice, ctx);
+  for (i=0; i < WNAF_TBLSIZE; i++)
+    {
+      point_set (&tbl[WNAF_TBLSIZE + i], &tbl[i]);
+      point_negate (&tbl[WNAF_TBLSIZE + i], ctx);
+    }
+  point_free (&twice);
+}
+
+
+/* Double scalar multiplication: RESULT = K1 * P1 + K2 * P2.  Both
+   scalars are recoded into wNAF form and processed in one
+   left-to-right pass so that the doublings are shared (Straus'
+   method).  This function does not run in constant time and may thus
+   only be used with public scalars as in signature verification.  */
+void
+_gcry_mpi_ec_mul_add_points (mpi_point_t result,
+                             gcry_mpi_t k1, mpi_point_t p1,
+                             gcry_mpi_t k2, mpi_point_t p2,
+                             mpi_ec_t ctx)
+{
+  mpi_point_struct tbl1[2*WNAF_TBLSIZE], tbl2[2*WNAF_TBLSIZE];
+  signed char *naf1, *naf2;
+  unsigned int n1, n2;
+  int i, d;
+
+  if (ctx->model == MPI_EC_MONTGOMERY
+      || mpi_has_sign (k1) || mpi_has_sign (k2))
+    {
+      mpi_point_struct tmppnt;
+
+      point_init (&tmppnt);
+      _gcry_mpi_ec_mul_point (result, k1, p1, ctx);
+      _gcry_mpi_ec_mul_point (&tmppnt, k2, p2, ctx);
+      _gcry_mpi_ec_add_points (result, result, &tmppnt, ctx);
+      point_free (&tmppnt);
+      return;
+    }
+
+  naf1 = xmalloc (mpi_get_nbits (k1) + 1);
+  naf2 = xmalloc (mpi_get_nbits (k2) + 1);
+  n1 = compute_wnaf (naf1, k1);
+  n2 = compute_wnaf (naf2, k2);
+
+  for (i=0; i < 2*WNAF_TBLSIZE; i++)
+    {
+      point_init (&tbl1[i]);
+      point_init (&tbl2[i]);
+    }
+  if (n1)
+    wnaf_precompute (tbl1, p1, ctx);
+  if (n2)
+    wnaf_precompute (tbl2, p2, ctx);
+
+  point_set_neutral (result, ctx);
+  for (i = (n1 > n2? n1 : n2) - 1; i >= 0; i--)
+    {
+      _gcry_mpi_ec_dup_point (result, result, ctx);
+      d = i < n1? naf1[i] : 0;
+      if (d > 0)
+        _gcry_mpi_ec_add_points (result, result, &tbl1[d >> 1], ctx);
+      else if (d < 0)
+        _gcry_mpi_ec_add_points (result, result,
+                                 &tbl1[WNAF_TBLSIZE + ((-d) >> 1)], ctx);
+      d = i < n2? naf2[i] : 0;
+      if (d > 0)
+        _gcry_mpi_ec_add_points (result, result, &tbl2[d >> 1], ctx);
+      else if (d < 0)
+        _gcry_mpi_ec_add_points (result, result,
+                                 &tbl2[WNAF_TBLSIZE + ((-d) >> 1)], ctx);
+    }
+
+  for (i=0; i < 2*WNAF_TBLSIZE; i++)
+    {
+      point_free (&tbl1[i]);
+      point_free (&tbl2[i]);
+    }
+  xfree (naf1);
+  xfree (naf2);
+}
+
+
+/* Return the C bit wide window of the non-negative SCALAR starting at
+   bit POS.  */
+static unsigned int
+get_window (gcry_mpi_t scalar, unsigned int pos, unsigned int c)
+{
+  unsigned int idx = pos / BITS_PER_MPI_LIMB;
+  unsigned int sh = pos % BITS_PER_MPI_LIMB;
+  mpi_limb_t v;
+
+  if (idx >= scalar->nlimbs)
+    return 0;
+  v = scalar->d[idx] >> sh;
+  if (sh + c > BITS_PER_MPI_LIMB && idx + 1 < scalar->nlimbs)
+    v |= scalar->d[idx+1] << (BITS_PER_MPI_LIMB - sh);
+  return v & ((1 << c) - 1);
+}
+
+
+/* Multi-scalar multiplication: RESULT = sum SCALARS[i] * POINTS[i]
+   for the N points in the array POINTS.  This uses the bucket method
+   of Pippenger, which for large N needs far fewer additions than N
+   separate multiplications.  The scalars must be non-negative.  This
+   function does not run in constant time and may only be used with
+   public data as in batch signature verification.  */
+void
+_gcry_mpi_ec_mul_multi (mpi_point_t result, unsigned int n,
+                        gcry_mpi_t *scalars, mpi_point_t points,
+                        mpi_ec_t ctx)
+{
+  mpi_point_struct *buckets;
+  mpi_point_struct running, sum;
+  unsigned char *used;
+  unsigned int nbits, c, nbuckets, i, j, d;
+  int pos, have_running, have_sum;
+
+  if (ctx->model == MPI_EC_MONTGOMERY)
+    {
+      mpi_point_struct tmppnt;
+
+      point_init (&tmppnt);
+      point_set_neutral (result, ctx);
+      for (i=0; i < n; i++)
+        {
+          _gcry_mpi_ec_mul_point (&tmppnt, scalars[i], &points[i], ctx);
+          _gcry_mpi_ec_add_points (result, result, &tmppnt, ctx);
+        }
+      point_free (&tmppnt);
+      return;
+    }
+
+  nbits = 0;
+  for (i=0; i < n; i++)
+    {
+      gcry_assert (!mpi_has_sign (scalars[i]));
+      j = mpi_get_nbits (scalars[i]);
+      if (j > nbits)
+        nbits = j;
+    }
+
+  /* The window size is chosen so that the number of buckets is about
+     an eighth of the number of points.  */
+  for (c=2; c < 12 && (1u << (c + 3)) < n; c++)
+    ;
+  nbuckets = (1 << c) - 1;
+
+  buckets = xmalloc (nbuckets * sizeof *buckets);
+  used = xmalloc (nbuckets);
+  for (j=0; j < nbuckets; j++)
+    point_init (&buckets[j]);
+  point_init (&running);
+  point_init (&sum);
+
+  point_set_neutral (result, ctx);
+  for (pos = nbits? (int)(((nbits + c - 1) / c - 1) * c) : -1;
+       pos >= 0; pos -= (int)c)
+    {
+      for (j=0; j < c; j++)
+        _gcry_mpi_ec_dup_point (result, result, ctx);
+
+      memset (used, 0, nbuckets);
+      for (i=0; i < n; i++)
+        {
+          d = get_window (scalars[i], pos, c);
+          if (!d)
+            continue;
+          if (used[d-1])
+            _gcry_mpi_ec_add_points (&buckets[d-1], &buckets[d-1],
+                                     &points[i], ctx);
+          else
+            {
+              point_set (&buckets[d-1], &points[i]);
+              used[d-1] = 1;
+            }
+        }
+
+      /* Sum up j * bucket[j] using running sums.  */
+      have_running = have_sum = 0;
+      for (j=nbuckets; j > 0; j--)
+        {
+          if (used[j-1])
+            {
+              if (have_running)
+                _gcry_mpi_ec_add_points (&running, &running,
+                                         &buckets[j-1], ctx);
+              else
+                point_set (&running, &buckets[j-1]);
+              have_running = 1;
+            }
+          if (!have_running)
+            continue;
+          if (have_sum)
+            _gcry_mpi_ec_add_points (&sum, &sum, &running, ctx);
+          else
+            point_set (&sum, &running);
+          have_sum = 1;
+        }
+      if (have_sum)
+        _gcry_mpi_ec_add_points (result, result, &sum, ctx);
+    }
+
+  for (j=0; j < nbuckets; j++)
+    point_free (&buckets[j]);
+  point_free (&running);
+  point_free (&sum);
+  xfree (used);
+  xfree (buckets);
+}
+
+
 /* Return true if POINT is on the curve described by CTX.  */
 int
 _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx)
@@ -1242,7 +2249,8 @@ _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx)
   y = mpi_new (0);
   w = mpi_new (0);
 
-  if (_gcry_mpi_ec_get_affine (x, y, point, ctx))
+  if (_gcry_mpi_ec_get_affine (x, ctx->model == MPI_EC_MONTGOMERY? NULL : y,
+                               point, ctx))
     return 0;
 
   switch (ctx->model)
@@ -1266,8 +2274,25 @@ _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx)
       }
       break;
     case MPI_EC_MONTGOMERY:
-      log_fatal ("%s: %s not yet supported\n",
-                 "_gcry_mpi_ec_curve_point", "Montgomery");
+      {
+        /* Without y we can only check that x^3 + A*x^2 + x is a
+           square so that x belongs to the curve and not to its
+           twist.  CTX->A holds (A-2)/4.  */
+        gcry_mpi_t e = mpi_new (0);
+
+        mpi_mul_ui (y, ctx->a, 4);
+        mpi_add_ui (y, y, 2);
+        ec_addm (y, y, x, ctx);         /* y = x + A */
+        ec_mulm (y, y, x, ctx);         /* y = x^2 + A*x */
+        mpi_add_ui (y, y, 1);
+        ec_mulm (w, y, x, ctx);         /* w = x^3 + A*x^2 + x */
+        mpi_sub_ui (e, ctx->p, 1);
+        mpi_rshift (e, e, 1);
+        ec_powm (w, w, e, ctx);         /* Euler's criterion.  */
+        if (mpi_cmp_ui (w, 1) <= 0)
+          res = 1;
+        _gcry_mpi_release (e);
+      }
       break;
     case MPI_EC_TWISTEDEDWARDS:
       {
@@ -84,8 +84,12 @@ _gcry_mpi_add_ui (gcry_mpi_t w, gcry_mpi_t u, unsigned long v )
 }
 
 
-void
-_gcry_mpi_add(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
+/****************
+ * Store U + V in W, or U - V if NEGATE_V is set.  U, V and W may be
+ * the same.  V is not modified, so that it may be a constant.
+ */
+static void
+add_or_sub (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v, int negate_v)
 {
     mpi_ptr_t wp, up, vp;
     mpi_size_t usize, vsize, wsize;
@@ -93,7 +97,7 @@ _gcry_mpi_add(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
 
     if( u->nlimbs < v->nlimbs ) { /* Swap U and V. */
 	usize = v->nlimbs;
-	usign = v->sign;
+	usign = v->sign ^ negate_v;
 	vsize = u->nlimbs;
 	vsign = u->sign;
 	wsize = usize + 1;
@@ -106,7 +110,7 @@ _gcry_mpi_add(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
 	usize = u->nlimbs;
 	usign = u->sign;
 	vsize = v->nlimbs;
-	vsign = v->sign;
+	vsign = v->sign ^ negate_v;
 	wsize = usize + 1;
 	RESIZE_IF_NEEDED(w, wsize);
 	/* These must be after realloc (u or v may be the same as w).  */
@@ -157,6 +161,13 @@ _gcry_mpi_add(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
 }
 
 
+void
+_gcry_mpi_add(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
+{
+  add_or_sub (w, u, v, 0);
+}
+
+
 /****************
  * Subtract the unsigned integer V from the mpi-integer U and store the
  * result in W.
@@ -213,10 +224,7 @@ _gcry_mpi_sub_ui(gcry_mpi_t w, gcry_mpi_t u, unsigned long v )
 void
 _gcry_mpi_sub(gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v)
 {
-  gcry_mpi_t vv = mpi_copy (v);
-  vv->sign = ! vv->sign;
-  mpi_add (w, u, vv);
-  mpi_free (vv);
+  add_or_sub (w, u, v, 1);
 }
 
 
@@ -234,6 +234,27 @@ void _gcry_mpih_mul_karatsuba_case( mpi_ptr_t prodp,
 				 struct karatsuba_ctx *ctx );
 
 
+/*-- mpih-mul-adx.c --*/
+
+/* Use the MULX/ADX helpers on AMD64 if the assembler supports them.  */
+#undef USE_MPIH_ADX
+#if defined(__x86_64__) && BYTES_PER_MPI_LIMB == 8 \
+    && defined(HAVE_GCC_INLINE_ASM_BMI2) && defined(HAVE_GCC_INLINE_ASM_ADX)
+# define USE_MPIH_ADX 1
+#endif
+
+#ifdef USE_MPIH_ADX
+extern int _gcry_mpih_use_adx;
+mpi_limb_t _gcry_mpih_addmul_1_adx (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                                    mpi_size_t s1_size, mpi_limb_t s2_limb);
+# define MPIH_ADDMUL_1(r,s,n,l) (_gcry_mpih_use_adx                       \
+                                 ? _gcry_mpih_addmul_1_adx ((r),(s),(n),(l)) \
+                                 : _gcry_mpih_addmul_1 ((r),(s),(n),(l)))
+#else
+# define MPIH_ADDMUL_1(r,s,n,l) _gcry_mpih_addmul_1 ((r),(s),(n),(l))
+#endif
+
+
 /*-- mpih-mul_1.c (or xxx/cpu/ *.S) --*/
 mpi_limb_t _gcry_mpih_mul_1( mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
 			  mpi_size_t s1_size, mpi_limb_t s2_limb);
@@ -34,6 +34,299 @@
 #include "longlong.h"
 
 
+/* Context used with Montgomery multiplication.  */
+struct mont_ctx_s
+{
+  gcry_mpi_t m;      /* The modulus - may not be modified.  */
+  int m_copied;      /* If true, M needs to be released.  */
+  mpi_size_t n;      /* Number of limbs of M.  */
+  mpi_limb_t minv;   /* -M^(-1) mod 2^BITS_PER_MPI_LIMB.  */
+  mpi_ptr_t r2;      /* R^2 mod M with R = 2^(N*BITS_PER_MPI_LIMB).  */
+  mpi_ptr_t one;     /* R mod M; this is 1 in Montgomery representation.  */
+  int secure;        /* R2 and ONE are in secure memory.  */
+};
+
+
+/* Store A mod M into the N limbs at RP using an MPI of at most N
+   limbs.  */
+static void
+mont_set_limbs (mpi_ptr_t rp, mpi_size_t n, gcry_mpi_t a)
+{
+  MPN_ZERO (rp, n);
+  MPN_COPY (rp, a->d, a->nlimbs);
+}
+
+
+/* This function returns a new context for Montgomery based operations
+   on the odd modulus M.  This context needs to be released using
+   _gcry_mpi_mont_free.  If COPY is true M will be transferred to the
+   context and the user may change M.  If COPY is false, M may not be
+   changed until _gcry_mpi_mont_free has been called.  */
+mpi_mont_t
+_gcry_mpi_mont_init (gcry_mpi_t m, int copy)
+{
+  mpi_mont_t ctx;
+  gcry_mpi_t tmp;
+  mpi_limb_t inv;
+  int i;
+
+  mpi_normalize (m);
+  if (!m->nlimbs || !(m->d[0] & 1) || m->sign)
+    log_bug ("mpi_mont_init: modulus not positive and odd\n");
+
+  ctx = xcalloc (1, sizeof *ctx);
+  if (copy)
+    {
+      ctx->m = mpi_copy (m);
+      ctx->m_copied = 1;
+    }
+  else
+    ctx->m = m;
+  ctx->n = m->nlimbs;
+  ctx->secure = mpi_is_secure (m);
+
+  /* Newton iteration for the inverse of the least significant limb;
+     each step doubles the number of correct bits and M[0] is its own
+     inverse modulo 8.  */
+  inv = m->d[0];
+  for (i=0; i < 6; i++)
+    inv *= 2 - m->d[0] * inv;
+  ctx->minv = -inv;
+
+  ctx->r2 = mpi_alloc_limb_space (ctx->n, ctx->secure);
+  ctx->one = mpi_alloc_limb_space (ctx->n, ctx->secure);
+  tmp = ctx->secure? mpi_alloc_secure (2 * ctx->n + 1)
+                   : mpi_alloc (2 * ctx->n + 1);
+  mpi_set_ui (tmp, 1);
+  mpi_lshift_limbs (tmp, ctx->n);
+  mpi_fdiv_r (tmp, tmp, m);
+  mont_set_limbs (ctx->one, ctx->n, tmp);
+  mpi_set_ui (tmp, 1);
+  mpi_lshift_limbs (tmp, 2 * ctx->n);
+  mpi_fdiv_r (tmp, tmp, m);
+  mont_set_limbs (ctx->r2, ctx->n, tmp);
+  mpi_free (tmp);
+
+  return ctx;
+}
+
+
+void
+_gcry_mpi_mont_free (mpi_mont_t ctx)
+{
+  if (ctx)
+    {
+      _gcry_mpi_free_limb_space (ctx->r2, ctx->secure? ctx->n : 0);
+      _gcry_mpi_free_limb_space (ctx->one, ctx->secure? ctx->n : 0);
+      if (ctx->m_copied)
+        mpi_free (ctx->m);
+      xfree (ctx);
+    }
+}
+
+
+/* Copy the N limbs at UP to RP if SET is true without a data
+   dependent branch.  */
+static void
+mont_set_cond (mpi_ptr_t rp, mpi_ptr_t up, mpi_size_t n, unsigned long set)
+{
+  mpi_limb_t mask = ((mpi_limb_t)0) - !!set;
+  mpi_size_t i;
+
+  for (i=0; i < n; i++)
+    rp[i] ^= mask & (rp[i] ^ up[i]);
+}
+
+
+/* Montgomery reduction: Store T * R^(-1) mod M into the N limbs at RP.
+   T has 2N limbs, must be less than M * R, and is destroyed.  */
+static void
+mont_redc (mpi_ptr_t rp, mpi_ptr_t tp, mpi_mont_t ctx)
+{
+  mpi_ptr_t mp = ctx->m->d;
+  mpi_size_t n = ctx->n;
+  mpi_size_t i;
+  mpi_limb_t cy, borrow;
+
+  /* Each step clears the lowest limb of T; the carry is parked there
+     and added in one go at the end.  */
+  for (i=0; i < n; i++)
+    {
+      cy = MPIH_ADDMUL_1 (tp + i, mp, n, tp[i] * ctx->minv);
+      tp[i] = cy;
+    }
+  cy = _gcry_mpih_add_n (rp, tp + n, tp, n);
+
+  /* The result is less than 2M; subtract M if required.  Because RP
+     plus the carry is less than 2M, a carry implies a borrow.  */
+  borrow = _gcry_mpih_sub_n (tp, rp, mp, n);
+  mont_set_cond (rp, tp, n, cy == borrow);
+}
+
+
+/* RP = UP * VP * R^(-1) mod M.  RP may be the same as UP or VP.  TP
+   is scratch space of 2N limbs.  */
+static void
+mont_mul (mpi_ptr_t rp, mpi_ptr_t up, mpi_ptr_t vp, mpi_mont_t ctx,
+          mpi_ptr_t tp, struct karatsuba_ctx *karactx)
+{
+  if (ctx->n < KARATSUBA_THRESHOLD)
+    _gcry_mpih_mul (tp, up, ctx->n, vp, ctx->n);
+  else
+    _gcry_mpih_mul_karatsuba_case (tp, up, ctx->n, vp, ctx->n, karactx);
+  mont_redc (rp, tp, ctx);
+}
+
+
+/* RP = UP * UP * R^(-1) mod M.  TP is scratch space of 2N limbs and
+   TSPACE of 2N limbs if N is not below the Karatsuba threshold.  */
+static void
+mont_sqr (mpi_ptr_t rp, mpi_ptr_t up, mpi_mont_t ctx,
+          mpi_ptr_t tp, mpi_ptr_t tspace)
+{
+  if (ctx->n < KARATSUBA_THRESHOLD)
+    _gcry_mpih_sqr_n_basecase (tp, up, ctx->n);
+  else
+    _gcry_mpih_sqr_n (tp, up, ctx->n, tspace);
+  mont_redc (rp, tp, ctx);
+}
+
+
+/* Return the W bits of the exponent EP starting at bit POS.  */
+static unsigned int
+mont_expo_window (mpi_ptr_t ep, mpi_size_t esize, unsigned int pos,
+                  unsigned int w)
+{
+  mpi_size_t i = pos / BITS_PER_MPI_LIMB;
+  unsigned int s = pos % BITS_PER_MPI_LIMB;
+  mpi_limb_t x;
+
+  x = ep[i] >> s;
+  if (s + w > BITS_PER_MPI_LIMB && i + 1 < esize)
+    x |= ep[i+1] << (BITS_PER_MPI_LIMB - s);
+  return x & ((1 << w) - 1);
+}
+
+
+/****************
+ * RES = BASE ^ EXPO mod M
+ *
+ * with M and its precomputed values taken from the Montgomery
+ * context CTX.  A fixed window is used and, as far as the exponent
+ * is stored in secure memory and thus assumed to be secret, the
+ * table entries are selected without a data dependent memory access
+ * and a multiplication is done for every window.  This gives the
+ * same sequence of operations for all exponents of the same
+ * length.
+ */
+void
+_gcry_mpi_powm_mont (gcry_mpi_t res, gcry_mpi_t base, gcry_mpi_t expo,
+                     mpi_mont_t ctx)
+{
+  mpi_size_t n = ctx->n;
+  mpi_size_t esize = expo->nlimbs;
+  mpi_ptr_t ep = expo->d;
+  int esec = mpi_is_secure (expo);
+  int secure = esec || ctx->secure || mpi_is_secure (base);
+  unsigned int nbits, nwin, W, k, idx;
+  mpi_ptr_t wspace, table, acc, sel, tp, tspace, up;
+  mpi_size_t wsize;
+  struct karatsuba_ctx karactx;
+  int i;
+
+  if (!esize)
+    {
+      /* Exponent is zero, result is 1 mod M.  */
+      mpi_set_ui (res, !(n == 1 && ctx->m->d[0] == 1));
+      return;
+    }
+
+  nbits = mpi_get_nbits (expo);
+  if (nbits > 768)
+    W = 5;
+  else if (nbits > 192)
+    W = 4;
+  else if (nbits > 48)
+    W = 3;
+  else if (nbits > 24)
+    W = 2;
+  else
+    W = 1;
+
+  /* Workspace for the table of BASE^i * R mod M, the accumulator, the
+     selected table entry, the product and the squaring helper.  */
+  wsize = ((1 << W) + 6) * n;
+  wspace = mpi_alloc_limb_space (wsize, secure);
+  table  = wspace;
+  acc    = table + (1 << W) * n;
+  sel    = acc + n;
+  tp     = sel + n;
+  tspace = tp + 2 * n;
+  memset (&karactx, 0, sizeof karactx);
+
+  /* Convert the base.  It needs to be reduced first unless it is a
+     non-negative number less than M.  */
+  if (base->sign || base->nlimbs > n
+      || (base->nlimbs == n && _gcry_mpih_cmp (base->d, ctx->m->d, n) >= 0))
+    {
+      gcry_mpi_t b = secure? mpi_alloc_secure (n) : mpi_alloc (n);
+
+      mpi_fdiv_r (b, base, ctx->m);
+      mont_set_limbs (sel, n, b);
+      mpi_free (b);
+    }
+  else
+    mont_set_limbs (sel, n, base);
+
+  MPN_COPY (table, ctx->one, n);
+  up = table + n;
+  mont_mul (up, sel, ctx->r2, ctx, tp, &karactx);
+  for (k = 2; k < (1 << W); k++)
+    mont_mul (table + k * n, table + (k - 1) * n, up, ctx, tp, &karactx);
+
+  /* Main loop.  */
+  nwin = (nbits + W - 1) / W;
+  for (i = nwin - 1; i >= 0; i--)
+    {
+      idx = mont_expo_window (ep, esize, i * W, W);
+      if (esec)
+        {
+          for (k = 0; k < (1 << W); k++)
+            mont_set_cond (sel, table + k * n, n, k == idx);
+          up = sel;
+        }
+      else if (idx || i == nwin - 1)
+        up = table + idx * n;
+      else
+        up = NULL;
+
+      if (i == nwin - 1)
+        MPN_COPY (acc, up, n);
+      else
+        {
+          for (k = 0; k < W; k++)
+            mont_sqr (acc, acc, ctx, tp, tspace);
+          if (up)
+            mont_mul (acc, acc, up, ctx, tp, &karactx);
+        }
+    }
+
+  /* Convert back.  */
+  MPN_COPY (tp, acc, n);
+  MPN_ZERO (tp + n, n);
+  mont_redc (acc, tp, ctx);
+
+  RESIZE_IF_NEEDED (res, n);
+  MPN_COPY (res->d, acc, n);
+  MPN_NORMALIZE (res->d, n);
+  res->nlimbs = n;
+  res->sign = 0;
+
+  _gcry_mpih_release_karatsuba_ctx (&karactx);
+  _gcry_mpi_free_limb_space (wspace, secure? wsize : 0);
+}
+
+
 /*
  * When you need old implementation, please add compilation option
  * -DUSE_ALGORITHM_SIMPLE_EXPONENTIATION
@@ -465,6 +758,19 @@ _gcry_mpi_powm (gcry_mpi_t res,
       goto leave;
     }
 
+  /* For odd moduli Montgomery multiplication avoids the divisions.
+     The context, and thus R^2 mod MOD, is computed for each call;
+     callers using the same modulus again should keep a context and
+     use _gcry_mpi_powm_mont directly as the key handles do.  */
+  if (!msign && (mod->d[0] & 1))
+    {
+      mpi_mont_t mctx = _gcry_mpi_mont_init (mod, 0);
+
+      _gcry_mpi_powm_mont (res, base, expo, mctx);
+      _gcry_mpi_mont_free (mctx);
+      return;
+    }
+
   /* Normalize MOD (i.e. make its most significant bit set) as
      required by mpn_divrem.  This will make the intermediate values
      in the calculation slightly larger, but the correct result is
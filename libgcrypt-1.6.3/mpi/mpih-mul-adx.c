@@ -0,0 +1,101 @@
+/* mpih-mul-adx.c  -  MULX/ADX based multiplication helpers for AMD64
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mpi-internal.h"
+#include "g10lib.h"
+
+#ifdef USE_MPIH_ADX
+
+/* Set by _gcry_mpi_init if the CPU supports BMI2 and ADX.  */
+int _gcry_mpih_use_adx;
+
+
+/* One step of the multiply and add loop.  MULX leaves the flags
+   alone, so that the carry of the high limbs runs through CF (ADCX)
+   and the carry of the additions to RES_PTR through OF (ADOX).
+   HI_IN is the high limb of the previous step and HI_OUT receives
+   the high limb of this step.  */
+#define ADDMUL_STEP(off, hi_in, hi_out)                    \
+        "mulxq " off "(%[up]), %[lo], %[" hi_out "]\n\t"   \
+        "adcxq %[" hi_in "], %[lo]\n\t"                    \
+        "adoxq " off "(%[rp]), %[lo]\n\t"                  \
+        "movq %[lo], " off "(%[rp])\n\t"
+
+/****************
+ * Multiply the S1_SIZE limbs at S1_PTR with S2_LIMB, add the result
+ * to RES_PTR and return the carry limb.  S1_SIZE must be at least 1.
+ * This is the same as _gcry_mpih_addmul_1 but runs two independent
+ * carry chains.  The loop is unrolled by four; JRCXZ and LEA are used
+ * for the loop control because they do not touch the flags.
+ */
+mpi_limb_t
+_gcry_mpih_addmul_1_adx (mpi_ptr_t res_ptr, mpi_ptr_t s1_ptr,
+                         mpi_size_t s1_size, mpi_limb_t s2_limb)
+{
+  mpi_limb_t hi, lo, t;
+  unsigned long rest = s1_size & 3;
+  unsigned long quads = s1_size >> 2;
+
+  __asm__ __volatile__
+    ("xorl %k[hi], %k[hi]\n\t"      /* Clears CF and OF.  */
+     "jrcxz 2f\n\t"
+
+     "1:\n\t"
+     ADDMUL_STEP ("0", "hi", "t")
+     "movq %[t], %[hi]\n\t"
+     "leaq 8(%[up]), %[up]\n\t"
+     "leaq 8(%[rp]), %[rp]\n\t"
+     "leaq -1(%%rcx), %%rcx\n\t"
+     "jrcxz 2f\n\t"
+     "jmp 1b\n"
+
+     "2:\n\t"
+     "movq %[quads], %%rcx\n\t"
+     "jrcxz 4f\n"
+
+     "3:\n\t"
+     ADDMUL_STEP ("0",  "hi", "t")
+     ADDMUL_STEP ("8",  "t",  "hi")
+     ADDMUL_STEP ("16", "hi", "t")
+     ADDMUL_STEP ("24", "t",  "hi")
+     "leaq 32(%[up]), %[up]\n\t"
+     "leaq 32(%[rp]), %[rp]\n\t"
+     "leaq -1(%%rcx), %%rcx\n\t"
+     "jrcxz 4f\n\t"
+     "jmp 3b\n"
+
+     "4:\n\t"
+     "movl $0, %k[lo]\n\t"
+     "adcxq %[lo], %[hi]\n\t"
+     "adoxq %[lo], %[hi]\n\t"
+     : [hi] "=&r" (hi), [lo] "=&r" (lo), [t] "=&r" (t),
+       [up] "+r" (s1_ptr), [rp] "+r" (res_ptr), "+c" (rest)
+     : [quads] "r" (quads), "d" (s2_limb)
+     : "cc", "memory");
+
+  return hi;
+}
+
+#undef ADDMUL_STEP
+
+#endif /*USE_MPIH_ADX*/
@@ -103,7 +103,7 @@ mul_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up,
 	       cy = _gcry_mpih_add_n(prodp, prodp, up, size);
 	}
 	else
-	    cy = _gcry_mpih_addmul_1(prodp, up, size, v_limb);
+	    cy = MPIH_ADDMUL_1 (prodp, up, size, v_limb);
 
 	prodp[size] = cy;
 	prodp++;
@@ -132,9 +132,9 @@ mul_n( mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
       mpi_limb_t cy_limb;
 
       MPN_MUL_N_RECURSE( prodp, up, vp, esize, tspace );
-      cy_limb = _gcry_mpih_addmul_1( prodp + esize, up, esize, vp[esize] );
+      cy_limb = MPIH_ADDMUL_1 (prodp + esize, up, esize, vp[esize]);
       prodp[esize + esize] = cy_limb;
-      cy_limb = _gcry_mpih_addmul_1( prodp + esize, vp, size, up[esize] );
+      cy_limb = MPIH_ADDMUL_1 (prodp + esize, vp, size, up[esize] );
       prodp[esize + size] = cy_limb;
     }
     else {
@@ -222,43 +222,50 @@ mul_n( mpi_ptr_t prodp, mpi_ptr_t up, mpi_ptr_t vp,
 }
 
 
+/* Square the SIZE limbs at UP and store the 2 * SIZE limbs of the
+ * result at PRODP.  Other than a plain multiplication this computes
+ * each cross product u_i * u_j only once: The triangle of all
+ * products with i < j is formed, doubled by a shift, and the squares
+ * u_i^2 are added on the diagonal.  This saves almost half of the
+ * single limb multiplications.  */
 void
 _gcry_mpih_sqr_n_basecase( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t size )
 {
     mpi_size_t i;
-    mpi_limb_t cy_limb;
-    mpi_limb_t v_limb;
+    mpi_limb_t cy_limb, hi, lo, x, c1, c2;
 
-    /* Multiply by the first limb in V separately, as the result can be
-     * stored (not added) to PROD.  We also avoid a loop for zeroing.  */
-    v_limb = up[0];
-    if( v_limb <= 1 ) {
-	if( v_limb == 1 )
-	    MPN_COPY( prodp, up, size );
-	else
-	    MPN_ZERO(prodp, size);
-	cy_limb = 0;
+    if( size == 1 ) {
+	umul_ppmm( prodp[1], prodp[0], up[0], up[0] );
+	return;
     }
-    else
-	cy_limb = _gcry_mpih_mul_1( prodp, up, size, v_limb );
-
-    prodp[size] = cy_limb;
-    prodp++;
 
-    /* For each iteration in the outer loop, multiply one limb from
-     * U with one limb from V, and add it to PROD.  */
-    for( i=1; i < size; i++) {
-	v_limb = up[i];
-	if( v_limb <= 1 ) {
-	    cy_limb = 0;
-	    if( v_limb == 1 )
-		cy_limb = _gcry_mpih_add_n(prodp, prodp, up, size);
-	}
-	else
-	    cy_limb = _gcry_mpih_addmul_1(prodp, up, size, v_limb);
-
-	prodp[size] = cy_limb;
-	prodp++;
+    /* The triangle goes to PRODP[1 .. 2*SIZE-2]; row I starts at
+     * 2*I+1 and its carry limb is the first limb not yet written.  */
+    prodp[0] = 0;
+    prodp[size] = _gcry_mpih_mul_1( prodp + 1, up + 1, size - 1, up[0] );
+    for( i=1; i < size - 1; i++ )
+	prodp[size + i] = MPIH_ADDMUL_1 (prodp + 2 * i + 1, up + i + 1,
+					 size - i - 1, up[i]);
+
+    /* Double it.  */
+    prodp[2 * size - 1] = _gcry_mpih_lshift( prodp + 1, prodp + 1,
+					     2 * size - 2, 1 );
+
+    /* Add the diagonal.  */
+    cy_limb = 0;
+    for( i=0; i < size; i++ ) {
+	umul_ppmm( hi, lo, up[i], up[i] );
+	x = prodp[2 * i] + lo;
+	c1 = x < lo;
+	x += cy_limb;
+	c1 += x < cy_limb;
+	prodp[2 * i] = x;
+	x = prodp[2 * i + 1] + hi;
+	c2 = x < hi;
+	x += c1;
+	c2 += x < c1;
+	prodp[2 * i + 1] = x;
+	cy_limb = c2;
     }
 }
 
@@ -282,9 +289,9 @@ _gcry_mpih_sqr_n( mpi_ptr_t prodp,
 	mpi_limb_t cy_limb;
 
 	MPN_SQR_N_RECURSE( prodp, up, esize, tspace );
-	cy_limb = _gcry_mpih_addmul_1( prodp + esize, up, esize, up[esize] );
+	cy_limb = MPIH_ADDMUL_1 (prodp + esize, up, esize, up[esize] );
 	prodp[esize + esize] = cy_limb;
-	cy_limb = _gcry_mpih_addmul_1( prodp + esize, up, size, up[esize] );
+	cy_limb = MPIH_ADDMUL_1 (prodp + esize, up, size, up[esize] );
 
 	prodp[esize + size] = cy_limb;
     }
@@ -513,7 +520,7 @@ _gcry_mpih_mul( mpi_ptr_t prodp, mpi_ptr_t up, mpi_size_t usize,
 		   cy = _gcry_mpih_add_n(prodp, prodp, up, usize);
 	    }
 	    else
-		cy = _gcry_mpih_addmul_1(prodp, up, usize, v_limb);
+		cy = MPIH_ADDMUL_1 (prodp, up, usize, v_limb);
 
 	    prodp[usize] = cy;
 	    prodp++;
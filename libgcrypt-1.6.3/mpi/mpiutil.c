@@ -64,6 +64,12 @@ _gcry_mpi_init (void)
       constants[idx]->flags = (16|32);
     }
 
+#ifdef USE_MPIH_ADX
+  if ((_gcry_get_hw_features () & (HWF_INTEL_BMI2 | HWF_INTEL_ADX))
+      == (HWF_INTEL_BMI2 | HWF_INTEL_ADX))
+    _gcry_mpih_use_adx = 1;
+#endif
+
   return 0;
 }
 
@@ -508,6 +514,37 @@ _gcry_mpi_set_cond (gcry_mpi_t w, const gcry_mpi_t u, unsigned long set)
 }
 
 
+/* Swap the values of A and B if SWAP is true without a data
+   dependent branch.  Both must have room for the larger value.  */
+void
+_gcry_mpi_swap_cond (gcry_mpi_t a, gcry_mpi_t b, unsigned long swap)
+{
+  mpi_size_t i;
+  mpi_size_t nlimbs;
+  mpi_limb_t mask = ((mpi_limb_t)0) - !!swap;
+  mpi_limb_t x;
+
+  nlimbs = a->alloced < b->alloced? a->alloced : b->alloced;
+  if (a->nlimbs > nlimbs || b->nlimbs > nlimbs)
+    log_bug ("mpi_swap_cond: different sizes\n");
+
+  for (i = 0; i < nlimbs; i++)
+    {
+      x = mask & (a->d[i] ^ b->d[i]);
+      a->d[i] = a->d[i] ^ x;
+      b->d[i] = b->d[i] ^ x;
+    }
+
+  x = mask & (a->nlimbs ^ b->nlimbs);
+  a->nlimbs = a->nlimbs ^ x;
+  b->nlimbs = b->nlimbs ^ x;
+
+  x = mask & (a->sign ^ b->sign);
+  a->sign = a->sign ^ x;
+  b->sign = b->sign ^ x;
+}
+
+
 gcry_mpi_t
 _gcry_mpi_set_ui (gcry_mpi_t w, unsigned long u)
 {
@@ -228,8 +228,53 @@ static char *daemon_socket_name;
 
 
 
+/* --- Stuff pertaining to the per-thread generator. --- */
+#if USE_AES
+# define USE_THREAD_RNG 1
+
+/* Requests for GCRY_WEAK_RANDOM and GCRY_STRONG_RANDOM are served by
+   a generator owned by the calling thread so that concurrent callers
+   don't contend for the pool lock.  The generator is AES-256 in CTR
+   mode keyed from the pool.  After each request the key and counter
+   are replaced by fresh output so that output already returned can't
+   be recovered from the state.  It is reseeded from the pool after
+   THREAD_RNG_RESEED_BYTES of output, after a fork and after entropy
+   has been added with gcry_random_add_bytes.  */
+struct thread_rng_s
+{
+  gcry_cipher_hd_t hd;
+  size_t nbytes;             /* Output since the last reseed.  */
+  pid_t pid;                 /* The process which seeded it.  */
+  unsigned int generation;   /* THREAD_RNG_GENERATION at seeding.  */
+  int seeded;
+};
+
+/* Reseed after this many bytes of output.  */
+#define THREAD_RNG_RESEED_BYTES (1024 * 1024)
+
+/* Replace the key after at most this many bytes of output.  */
+#define THREAD_RNG_CHUNKSIZE (64 * 1024)
+
+/* The key and the initial counter.  */
+#define THREAD_RNG_SEEDLEN (32 + 16)
+
+/* The key to the generator of the current thread.  */
+static ath_key_t thread_rng_key;
+static int thread_rng_key_valid;
+
+/* Incremented with the pool locked to ask all generators for a
+   reseed.  */
+static volatile unsigned int thread_rng_generation;
+
+#endif /*USE_AES*/
+
+
+
 /* ---  Prototypes  --- */
 static void read_pool (byte *buffer, size_t length, int level );
+#ifdef USE_THREAD_RNG
+static void thread_rng_release (void *value);
+#endif
 static void add_randomness (const void *buffer, size_t length,
                             enum random_origins origin);
 static void random_poll (void);
@@ -268,6 +313,12 @@ initialize_basics(void)
       if (err)
         log_fatal ("failed to create the pool lock: %s\n", strerror (err) );
 
+#ifdef USE_THREAD_RNG
+      /* Without the key all requests are served from the pool.  */
+      thread_rng_key_valid = !ath_key_create (&thread_rng_key,
+                                              thread_rng_release);
+#endif
+
 #ifdef USE_RANDOM_DAEMON
       _gcry_daemon_initialize_basics ();
 #endif /*USE_RANDOM_DAEMON*/
@@ -496,6 +547,9 @@ _gcry_rngcsprng_add_bytes (const void *buf, size_t buflen, int quality)
       lock_pool ();
       if (rndpool)
         add_randomness (bufptr, nbytes, RANDOM_ORIGIN_EXTERNAL);
+#ifdef USE_THREAD_RNG
+      thread_rng_generation++;
+#endif
       unlock_pool ();
       bufptr += nbytes;
       buflen -= nbytes;
@@ -504,6 +558,104 @@ _gcry_rngcsprng_add_bytes (const void *buf, size_t buflen, int quality)
 }
 
 
+#ifdef USE_THREAD_RNG
+/* Release the generator VALUE of a terminating thread.  */
+static void
+thread_rng_release (void *value)
+{
+  struct thread_rng_s *rng = value;
+
+  _gcry_cipher_close (rng->hd);
+  wipememory (rng, sizeof *rng);
+  xfree (rng);
+}
+
+
+/* Load the key and the counter from the THREAD_RNG_SEEDLEN bytes at
+   SEED into RNG and wipe SEED.  */
+static void
+thread_rng_setkey (struct thread_rng_s *rng, byte *seed)
+{
+  if (_gcry_cipher_setkey (rng->hd, seed, 32)
+      || _gcry_cipher_setctr (rng->hd, seed + 32, 16))
+    log_fatal ("failed to key the thread RNG\n");
+  wipememory (seed, THREAD_RNG_SEEDLEN);
+}
+
+
+/* Fill BUFFER with LENGTH bytes from the generator of the calling
+   thread.  Returns 0 on success or -1 if no generator is available;
+   the caller then needs to use the pool.  */
+static int
+thread_rng_randomize (byte *buffer, size_t length)
+{
+  struct thread_rng_s *rng;
+  byte seed[THREAD_RNG_SEEDLEN];
+  pid_t pid;
+  size_t n;
+
+  if (!thread_rng_key_valid)
+    return -1;
+
+  rng = ath_key_get (&thread_rng_key);
+  if (!rng)
+    {
+      rng = secure_alloc? xtrycalloc_secure (1, sizeof *rng)
+                        : xtrycalloc (1, sizeof *rng);
+      if (!rng)
+        return -1;
+      if (_gcry_cipher_open (&rng->hd, GCRY_CIPHER_AES256,
+                             GCRY_CIPHER_MODE_CTR,
+                             secure_alloc? GCRY_CIPHER_SECURE : 0))
+        {
+          xfree (rng);
+          return -1;
+        }
+      if (ath_key_set (&thread_rng_key, rng))
+        {
+          thread_rng_release (rng);
+          return -1;
+        }
+    }
+
+  pid = getpid ();
+  while (length)
+    {
+      if (!rng->seeded || rng->pid != pid
+          || rng->generation != thread_rng_generation
+          || rng->nbytes >= THREAD_RNG_RESEED_BYTES)
+        {
+          initialize ();
+          lock_pool ();
+          rndstats.getbytes1 += sizeof seed;
+          rndstats.ngetbytes1++;
+          read_pool (seed, sizeof seed, GCRY_STRONG_RANDOM);
+          rng->generation = thread_rng_generation;
+          unlock_pool ();
+          thread_rng_setkey (rng, seed);
+          rng->pid = pid;
+          rng->nbytes = 0;
+          rng->seeded = 1;
+        }
+
+      n = length > THREAD_RNG_CHUNKSIZE? THREAD_RNG_CHUNKSIZE : length;
+      memset (buffer, 0, n);
+      _gcry_cipher_encrypt (rng->hd, buffer, n, NULL, 0);
+      rng->nbytes += n;
+      buffer += n;
+      length -= n;
+
+      /* Fast key erasure.  */
+      memset (seed, 0, sizeof seed);
+      _gcry_cipher_encrypt (rng->hd, seed, sizeof seed, NULL, 0);
+      thread_rng_setkey (rng, seed);
+    }
+
+  return 0;
+}
+#endif /*USE_THREAD_RNG*/
+
+
 /* Public function to fill the buffer with LENGTH bytes of
    cryptographically strong random bytes.  Level GCRY_WEAK_RANDOM is
    not very strong, GCRY_STRONG_RANDOM is strong enough for most
@@ -515,9 +667,6 @@ _gcry_rngcsprng_randomize (void *buffer, size_t length,
 {
   unsigned char *p;
 
-  /* Make sure we are initialized. */
-  initialize ();
-
   /* Handle our hack used for regression tests of Libgcrypt. */
   if ( quick_test && level > GCRY_STRONG_RANDOM )
     level = GCRY_STRONG_RANDOM;
@@ -532,6 +681,17 @@ _gcry_rngcsprng_randomize (void *buffer, size_t length,
   allow_daemon = 0; /* Daemon failed - switch off. */
 #endif /*USE_RANDOM_DAEMON*/
 
+#ifdef USE_THREAD_RNG
+  /* The per-thread generator initializes the pool when it needs a
+     seed.  */
+  if (level < GCRY_VERY_STRONG_RANDOM
+      && !thread_rng_randomize (buffer, length))
+    return;
+#endif /*USE_THREAD_RNG*/
+
+  /* Make sure we are initialized. */
+  initialize ();
+
   /* Acquire the pool lock. */
   lock_pool ();
 
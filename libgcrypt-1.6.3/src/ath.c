@@ -50,6 +50,11 @@
 # pragma weak pthread_mutex_lock
 # pragma weak pthread_mutex_unlock
 # pragma weak pthread_mutex_destroy
+# pragma weak pthread_create
+# pragma weak pthread_join
+# pragma weak pthread_key_create
+# pragma weak pthread_getspecific
+# pragma weak pthread_setspecific
 #endif
 
 /* For the dummy interface.  The MUTEX_NOTINIT value is used to check
@@ -404,3 +409,217 @@ ath_mutex_unlock (ath_mutex_t *lock)
 
   return err;
 }
+
+
+/* Create a key for thread specific values and store it at KEY.  If
+   DESTRUCTOR is not NULL it is called with the value of a thread
+   when that thread terminates and the value is not NULL; this is not
+   supported for Windows threads.  This function returns 0 on success
+   or an system error code (i.e. an ERRNO value).  Keys can't be
+   deleted.  */
+int
+ath_key_create (ath_key_t *key, void (*destructor) (void *value))
+{
+  int err;
+
+  switch (thread_model)
+    {
+    case ath_model_none:
+      {
+        void **slot;
+
+        /* Without threads the key is a slot for the single value.  */
+        slot = calloc (1, sizeof *slot);
+        if (!slot)
+          err = errno? errno : ENOMEM;
+        else
+          {
+            *key = (void*)slot;
+            err = 0;
+          }
+      }
+      break;
+
+#if USE_POSIX_THREADS
+    case ath_model_pthreads:
+    case ath_model_pthreads_weak:
+      {
+        pthread_key_t *pkey;
+
+        pkey = malloc (sizeof *pkey);
+        if (!pkey)
+          err = errno? errno : ENOMEM;
+        else
+          {
+            err = pthread_key_create (pkey, destructor);
+            if (err)
+              free (pkey);
+            else
+              *key = (void*)pkey;
+          }
+      }
+      break;
+#endif /*USE_POSIX_THREADS*/
+
+#if HAVE_W32_SYSTEM
+    case ath_model_w32:
+      {
+        DWORD *tkey;
+
+        tkey = malloc (sizeof *tkey);
+        if (!tkey)
+          err = errno? errno : ENOMEM;
+        else if ((*tkey = TlsAlloc ()) == TLS_OUT_OF_INDEXES)
+          {
+            free (tkey);
+            err = EAGAIN;
+          }
+        else
+          {
+            *key = (void*)tkey;
+            err = 0;
+          }
+      }
+      break;
+#endif /*HAVE_W32_SYSTEM*/
+
+    default:
+      err = EINVAL;
+      break;
+    }
+
+  (void)destructor;
+  return err;
+}
+
+
+/* Return the value of the calling thread for KEY or NULL if none has
+   been set.  */
+void *
+ath_key_get (ath_key_t *key)
+{
+  switch (thread_model)
+    {
+    case ath_model_none:
+      return *(void **)(*key);
+
+#if USE_POSIX_THREADS
+    case ath_model_pthreads:
+    case ath_model_pthreads_weak:
+      return pthread_getspecific (*(pthread_key_t*)(*key));
+#endif /*USE_POSIX_THREADS*/
+
+#if HAVE_W32_SYSTEM
+    case ath_model_w32:
+      return TlsGetValue (*(DWORD*)(*key));
+#endif /*HAVE_W32_SYSTEM*/
+
+    default:
+      return NULL;
+    }
+}
+
+
+/* Set the value of the calling thread for KEY to VALUE.  On success
+   the function returns 0; on error an error code.  */
+int
+ath_key_set (ath_key_t *key, void *value)
+{
+  int err;
+
+  switch (thread_model)
+    {
+    case ath_model_none:
+      *(void **)(*key) = value;
+      err = 0;
+      break;
+
+#if USE_POSIX_THREADS
+    case ath_model_pthreads:
+    case ath_model_pthreads_weak:
+      err = pthread_setspecific (*(pthread_key_t*)(*key), value);
+      break;
+#endif /*USE_POSIX_THREADS*/
+
+#if HAVE_W32_SYSTEM
+    case ath_model_w32:
+      err = TlsSetValue (*(DWORD*)(*key), value)? 0 : EINVAL;
+      break;
+#endif /*HAVE_W32_SYSTEM*/
+
+    default:
+      err = EINVAL;
+      break;
+    }
+
+  return err;
+}
+
+
+#if USE_POSIX_THREADS
+/* The argument passed to the threads of ath_run_parallel.  */
+struct parallel_parm_s
+{
+  void (*func) (void *arg, int idx);
+  void *arg;
+  int idx;
+};
+
+static void *
+parallel_thread (void *opaque)
+{
+  struct parallel_parm_s *parm = opaque;
+
+  parm->func (parm->arg, parm->idx);
+  return NULL;
+}
+#endif /*USE_POSIX_THREADS*/
+
+
+/* Call FUNC (ARG, IDX) for all IDX from 0 to N-1 and return after all
+   calls have returned.  If POSIX threads are in use, the calls with
+   IDX > 0 are run concurrently in new threads while the calling
+   thread runs IDX 0.  Without thread support or if a thread can't be
+   created, the calls are done sequentially by the calling thread;
+   thus FUNC may never wait for another call to make progress.  N is
+   silently limited to ATH_MAX_PARALLEL.  */
+void
+ath_run_parallel (void (*func) (void *arg, int idx), void *arg, int n)
+{
+  int i;
+#if USE_POSIX_THREADS
+  pthread_t tid[ATH_MAX_PARALLEL];
+  struct parallel_parm_s parm[ATH_MAX_PARALLEL];
+  int started[ATH_MAX_PARALLEL];
+#endif /*USE_POSIX_THREADS*/
+
+  if (n > ATH_MAX_PARALLEL)
+    n = ATH_MAX_PARALLEL;
+
+#if USE_POSIX_THREADS
+  if (n > 1 && (thread_model == ath_model_pthreads
+                || thread_model == ath_model_pthreads_weak))
+    {
+      for (i=1; i < n; i++)
+        {
+          parm[i].func = func;
+          parm[i].arg = arg;
+          parm[i].idx = i;
+          started[i] = !pthread_create (&tid[i], NULL,
+                                        parallel_thread, parm + i);
+        }
+      func (arg, 0);
+      for (i=1; i < n; i++)
+        {
+          if (started[i])
+            pthread_join (tid[i], NULL);
+          else
+            func (arg, i);
+        }
+      return;
+    }
+#endif /*USE_POSIX_THREADS*/
+
+  for (i=0; i < n; i++)
+    func (arg, i);
+}
@@ -56,6 +56,10 @@
 #define ath_mutex_destroy _ATH_PREFIX(ath_mutex_destroy)
 #define ath_mutex_lock _ATH_PREFIX(ath_mutex_lock)
 #define ath_mutex_unlock _ATH_PREFIX(ath_mutex_unlock)
+#define ath_run_parallel _ATH_PREFIX(ath_run_parallel)
+#define ath_key_create _ATH_PREFIX(ath_key_create)
+#define ath_key_get _ATH_PREFIX(ath_key_get)
+#define ath_key_set _ATH_PREFIX(ath_key_set)
 #endif
 
 
@@ -90,4 +94,16 @@ int ath_mutex_destroy (ath_mutex_t *mutex);
 int ath_mutex_lock (ath_mutex_t *mutex);
 int ath_mutex_unlock (ath_mutex_t *mutex);
 
+/* Thread specific data.  */
+typedef void *ath_key_t;
+
+int ath_key_create (ath_key_t *key, void (*destructor) (void *value));
+void *ath_key_get (ath_key_t *key);
+int ath_key_set (ath_key_t *key, void *value);
+
+/* Running a function in several threads.  */
+#define ATH_MAX_PARALLEL 64
+
+void ath_run_parallel (void (*func) (void *arg, int idx), void *arg, int n);
+
 #endif	/* ATH_H */
@@ -76,9 +76,34 @@ typedef gcry_err_code_t (*gcry_pk_verify_t) (gcry_sexp_t s_sig,
                                              gcry_sexp_t s_data,
                                              gcry_sexp_t keyparms);
 
+/* Type for the pk_verify_batch function.  */
+typedef gcry_err_code_t (*gcry_pk_verify_batch_t) (gcry_sexp_t *s_sigs,
+                                                   gcry_sexp_t *s_data,
+                                                   gcry_sexp_t *keyparms,
+                                                   unsigned int n,
+                                                   gcry_err_code_t *r_results);
+
 /* Type for the pk_get_nbits function.  */
 typedef unsigned (*gcry_pk_get_nbits_t) (gcry_sexp_t keyparms);
 
+/* Type for the pk_open function.  It prepares the key KEYPARMS, which
+   is a private key if SECRET is set, for use with a key handle and
+   stores the algorithm specific context at R_CTX.  */
+typedef gcry_err_code_t (*gcry_pk_open_t) (gcry_sexp_t keyparms, int secret,
+                                           void **r_ctx);
+
+/* Type for the pk_close function.  */
+typedef void (*gcry_pk_close_t) (void *ctx);
+
+/* Type for the pk_hd_encrypt, pk_hd_decrypt and pk_hd_sign
+   functions.  */
+typedef gcry_err_code_t (*gcry_pk_hd_op_t) (void *ctx, gcry_sexp_t *r_result,
+                                            gcry_sexp_t s_data);
+
+/* Type for the pk_hd_verify function.  */
+typedef gcry_err_code_t (*gcry_pk_hd_verify_t) (void *ctx, gcry_sexp_t s_sig,
+                                                gcry_sexp_t s_data);
+
 
 /* The type used to compute the keygrip.  */
 typedef gpg_err_code_t (*pk_comp_keygrip_t) (gcry_md_hd_t md,
@@ -119,6 +144,13 @@ typedef struct gcry_pk_spec
   pk_comp_keygrip_t comp_keygrip;
   pk_get_curve_t get_curve;
   pk_get_curve_param_t get_curve_param;
+  gcry_pk_verify_batch_t verify_batch;
+  gcry_pk_open_t open;
+  gcry_pk_close_t close;
+  gcry_pk_hd_op_t hd_encrypt;
+  gcry_pk_hd_op_t hd_decrypt;
+  gcry_pk_hd_op_t hd_sign;
+  gcry_pk_hd_verify_t hd_verify;
 } gcry_pk_spec_t;
 
 
@@ -215,6 +247,9 @@ typedef void (*gcry_md_final_t) (void *c);
 /* Type for the md_read function.  */
 typedef unsigned char *(*gcry_md_read_t) (void *c);
 
+/* Type for the md_extract function.  */
+typedef void (*gcry_md_extract_t) (void *c, void *outbuf, size_t nbytes);
+
 typedef struct gcry_md_oid_spec
 {
   const char *oidstring;
@@ -239,6 +274,7 @@ typedef struct gcry_md_spec
   gcry_md_read_t read;
   size_t contextsize; /* allocate this amount of context */
   selftest_func_t selftest;
+  gcry_md_extract_t extract; /* Only for extendable-output functions.  */
 } gcry_md_spec_t;
 
 
@@ -109,6 +109,11 @@ gcry_err_code_t _gcry_cipher_cmac_check_tag
 gcry_err_code_t _gcry_cipher_cmac_set_subkeys
 /*           */ (gcry_cipher_hd_t c);
 
+/*-- md.c --*/
+gpg_err_code_t _gcry_md_hash_periodic_multi (int algo, void *digests,
+                                             const gcry_buffer_t *iov,
+                                             int iovcnt, size_t period);
+
 /*-- rmd160.c --*/
 void _gcry_rmd160_hash_buffer (void *outbuf,
                                const void *buffer, size_t length);
@@ -117,6 +122,27 @@ void _gcry_sha1_hash_buffer (void *outbuf,
                              const void *buffer, size_t length);
 void _gcry_sha1_hash_buffers (void *outbuf,
                               const gcry_buffer_t *iov, int iovcnt);
+void _gcry_sha1_hash_buffers_multi (void *outbuf,
+                                    const gcry_buffer_t *iov, int iovcnt);
+gpg_err_code_t _gcry_sha1_hash_periodic_multi (void *outbuf,
+                                               const gcry_buffer_t *iov,
+                                               int iovcnt, size_t period);
+
+/*-- sha256.c --*/
+void _gcry_sha224_hash_buffers_multi (void *outbuf,
+                                      const gcry_buffer_t *iov, int iovcnt);
+void _gcry_sha256_hash_buffers_multi (void *outbuf,
+                                      const gcry_buffer_t *iov, int iovcnt);
+gpg_err_code_t _gcry_sha224_hash_periodic_multi (void *outbuf,
+                                                 const gcry_buffer_t *iov,
+                                                 int iovcnt, size_t period);
+gpg_err_code_t _gcry_sha256_hash_periodic_multi (void *outbuf,
+                                                 const gcry_buffer_t *iov,
+                                                 int iovcnt, size_t period);
+
+/*-- keccak.c --*/
+void _gcry_sha3_hash_buffers_multi (int algo, void *outbuf,
+                                    const gcry_buffer_t *iov, int iovcnt);
 
 /*-- rijndael.c --*/
 void _gcry_aes_cfb_enc (void *context, unsigned char *iv,
@@ -134,6 +160,13 @@ void _gcry_aes_cbc_dec (void *context, unsigned char *iv,
 void _gcry_aes_ctr_enc (void *context, unsigned char *ctr,
                         void *outbuf_arg, const void *inbuf_arg,
                         size_t nblocks);
+void _gcry_aes_ocb_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                          const void *inbuf_arg, size_t nblocks, int encrypt);
+void _gcry_aes_ocb_auth (gcry_cipher_hd_t c, const void *abuf_arg,
+                         size_t nblocks);
+size_t _gcry_aes_gcm_crypt (gcry_cipher_hd_t c, void *outbuf_arg,
+                            const void *inbuf_arg, size_t nblocks,
+                            int encrypt);
 
 /*-- blowfish.c --*/
 void _gcry_blowfish_cfb_dec (void *context, unsigned char *iv,
@@ -161,6 +194,32 @@ void _gcry_cast5_ctr_enc (void *context, unsigned char *ctr,
 			  void *outbuf_arg, const void *inbuf_arg,
 			  size_t nblocks);
 
+/*-- des.c --*/
+void _gcry_3des_cfb_dec (void *context, unsigned char *iv,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
+void _gcry_3des_cbc_dec (void *context, unsigned char *iv,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
+void _gcry_3des_ctr_enc (void *context, unsigned char *ctr,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
+/*-- idea.c --*/
+void _gcry_idea_cfb_dec (void *context, unsigned char *iv,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
+void _gcry_idea_cbc_dec (void *context, unsigned char *iv,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
+void _gcry_idea_ctr_enc (void *context, unsigned char *ctr,
+			 void *outbuf_arg, const void *inbuf_arg,
+			 size_t nblocks);
+
 /*-- camellia-glue.c --*/
 void _gcry_camellia_ctr_enc (void *context, unsigned char *ctr,
                              void *outbuf_arg, const void *inbuf_arg,
@@ -237,6 +296,7 @@ extern gcry_cipher_spec_t _gcry_cipher_spec_idea;
 extern gcry_cipher_spec_t _gcry_cipher_spec_salsa20;
 extern gcry_cipher_spec_t _gcry_cipher_spec_salsa20r12;
 extern gcry_cipher_spec_t _gcry_cipher_spec_gost28147;
+extern gcry_cipher_spec_t _gcry_cipher_spec_chacha20;
 
 /* Declarations for the digest specifications.  */
 extern gcry_md_spec_t _gcry_digest_spec_crc32;
@@ -253,6 +313,12 @@ extern gcry_md_spec_t _gcry_digest_spec_sha224;
 extern gcry_md_spec_t _gcry_digest_spec_sha256;
 extern gcry_md_spec_t _gcry_digest_spec_sha512;
 extern gcry_md_spec_t _gcry_digest_spec_sha384;
+extern gcry_md_spec_t _gcry_digest_spec_sha3_224;
+extern gcry_md_spec_t _gcry_digest_spec_sha3_256;
+extern gcry_md_spec_t _gcry_digest_spec_sha3_384;
+extern gcry_md_spec_t _gcry_digest_spec_sha3_512;
+extern gcry_md_spec_t _gcry_digest_spec_shake128;
+extern gcry_md_spec_t _gcry_digest_spec_shake256;
 extern gcry_md_spec_t _gcry_digest_spec_tiger;
 extern gcry_md_spec_t _gcry_digest_spec_tiger1;
 extern gcry_md_spec_t _gcry_digest_spec_tiger2;
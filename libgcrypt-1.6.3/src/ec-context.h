@@ -60,10 +60,21 @@ struct mpi_ec_ctx_s
     /* Scratch variables.  */
     gcry_mpi_t scratch[11];
 
-    /* Helper for fast reduction.  */
-    /*   int nist_nbits; /\* If this is a NIST curve, the # of bits.  *\/ */
-    /*   gcry_mpi_t s[10]; */
-    /*   gcry_mpi_t c; */
+    /* Limb buffers used by ec_mulm and ec_mod so that the point
+       operations do not need to allocate memory; see ec_arena_init.  */
+    struct {
+      mpi_limb_t *d;            /* All buffers in one allocation.  */
+      unsigned int nlimbs;      /* Allocated limbs of D.  */
+      mpi_limb_t *prod;         /* Product or dividend.  */
+      unsigned int prodsize;    /* Allocated limbs of PROD.  */
+      mpi_limb_t *quot;         /* Quotient of the division by P.  */
+      mpi_limb_t *pnorm;        /* P shifted to have its MSB set.  */
+      unsigned int psize;       /* Number of limbs of P.  */
+      unsigned int shift;       /* Shift count used for PNORM.  */
+    } arena;
+
+    /* Fast reduction modulo P for well-known primes or NULL.  */
+    void (*mod) (gcry_mpi_t w, struct mpi_ec_ctx_s *ctx);
   } t;
 };
 
@@ -95,6 +95,7 @@ int _gcry_global_is_operational (void);
 gcry_error_t _gcry_vcontrol (enum gcry_ctl_cmds cmd, va_list arg_ptr);
 void  _gcry_check_heap (const void *a);
 int _gcry_get_debug_flag (unsigned int mask);
+int _gcry_get_worker_threads (void);
 
 /* Malloc functions and common wrapper macros.  */
 void *_gcry_malloc (size_t n) _GCRY_GCC_ATTR_MALLOC;
@@ -205,6 +206,11 @@ int _gcry_log_verbosity( int level );
 #define HWF_INTEL_RDRAND 512
 #define HWF_INTEL_AVX    1024
 #define HWF_INTEL_AVX2   2048
+#define HWF_INTEL_ADX    8192
+#define HWF_INTEL_AVX512 16384
+#define HWF_INTEL_VAES   32768
+#define HWF_INTEL_VPCLMUL 65536
+#define HWF_INTEL_SHAEXT 131072
 
 #define HWF_ARM_NEON     4096
 
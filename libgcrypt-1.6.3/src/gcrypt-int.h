@@ -104,6 +104,19 @@ gpg_err_code_t _gcry_pk_sign (gcry_sexp_t *result,
                               gcry_sexp_t data, gcry_sexp_t skey);
 gpg_err_code_t _gcry_pk_verify (gcry_sexp_t sigval,
                                 gcry_sexp_t data, gcry_sexp_t pkey);
+gpg_err_code_t _gcry_pk_verify_batch (gcry_sexp_t *sigvals, gcry_sexp_t *data,
+                                      gcry_sexp_t *pkeys, unsigned int n,
+                                      gcry_error_t *r_errors);
+gpg_err_code_t _gcry_pk_open (gcry_pk_hd_t *r_hd, gcry_sexp_t key);
+void _gcry_pk_close (gcry_pk_hd_t hd);
+gpg_err_code_t _gcry_pk_hd_encrypt (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                                    gcry_sexp_t data);
+gpg_err_code_t _gcry_pk_hd_decrypt (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                                    gcry_sexp_t data);
+gpg_err_code_t _gcry_pk_hd_sign (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                                 gcry_sexp_t data);
+gpg_err_code_t _gcry_pk_hd_verify (gcry_pk_hd_t hd, gcry_sexp_t sigval,
+                                   gcry_sexp_t data);
 gpg_err_code_t _gcry_pk_testkey (gcry_sexp_t key);
 gpg_err_code_t _gcry_pk_genkey (gcry_sexp_t *r_key, gcry_sexp_t s_parms);
 gpg_err_code_t _gcry_pk_ctl (int cmd, void *buffer, size_t buflen);
@@ -129,11 +142,17 @@ gpg_err_code_t _gcry_md_ctl (gcry_md_hd_t hd, int cmd,
                           void *buffer, size_t buflen);
 void _gcry_md_write (gcry_md_hd_t hd, const void *buffer, size_t length);
 unsigned char *_gcry_md_read (gcry_md_hd_t hd, int algo);
+gpg_err_code_t _gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer,
+                                 size_t length);
 void _gcry_md_hash_buffer (int algo, void *digest,
                            const void *buffer, size_t length);
 gpg_err_code_t _gcry_md_hash_buffers (int algo, unsigned int flags,
                                       void *digest,
                                       const gcry_buffer_t *iov, int iovcnt);
+gpg_err_code_t _gcry_md_hash_buffers_multi (int algo, unsigned int flags,
+                                            void *digests,
+                                            const gcry_buffer_t *iov,
+                                            int iovcnt);
 int _gcry_md_get_algo (gcry_md_hd_t hd);
 unsigned int _gcry_md_get_algo_dlen (int algo);
 int _gcry_md_is_enabled (gcry_md_hd_t a, int algo);
@@ -194,6 +213,19 @@ gpg_err_code_t _gcry_kdf_derive (const void *passphrase, size_t passphraselen,
                                  unsigned long iterations,
                                  size_t keysize, void *keybuffer);
 
+gpg_err_code_t _gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+                               const unsigned long *param,
+                               unsigned int paramlen,
+                               const void *passphrase, size_t passphraselen,
+                               const void *salt, size_t saltlen,
+                               const void *key, size_t keylen,
+                               const void *ad, size_t adlen);
+gpg_err_code_t _gcry_kdf_compute (gcry_kdf_hd_t h,
+                                  const struct gcry_kdf_thread_ops *ops);
+gpg_err_code_t _gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen,
+                                void *result);
+void _gcry_kdf_close (gcry_kdf_hd_t h);
+
 
 gpg_err_code_t _gcry_prime_generate (gcry_mpi_t *prime,
                                      unsigned int prime_bits,
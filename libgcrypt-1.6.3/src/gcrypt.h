@@ -327,7 +327,13 @@ enum gcry_ctl_cmds
     GCRYCTL_SET_CCM_LENGTHS = 69,
     GCRYCTL_CLOSE_RANDOM_DEVICE = 70,
     GCRYCTL_INACTIVATE_FIPS_FLAG = 71,
-    GCRYCTL_REACTIVATE_FIPS_FLAG = 72
+    GCRYCTL_REACTIVATE_FIPS_FLAG = 72,
+    /* Note: 73 and 74 are not used.  */
+    GCRYCTL_SET_TAGLEN = 75,
+    /* Note: 76 and 77 are not used.  */
+    GCRYCTL_AUTO_EXPAND_SECMEM = 78,
+    /* Note: Values from 1000 on are used by local extensions.  */
+    GCRYCTL_SET_WORKER_THREADS = 1000
   };
 
 /* Perform various operations defined by CMD. */
@@ -878,7 +884,8 @@ enum gcry_cipher_algos
     GCRY_CIPHER_CAMELLIA256 = 312,
     GCRY_CIPHER_SALSA20     = 313,
     GCRY_CIPHER_SALSA20R12  = 314,
-    GCRY_CIPHER_GOST28147   = 315
+    GCRY_CIPHER_GOST28147   = 315,
+    GCRY_CIPHER_CHACHA20    = 316
   };
 
 /* The Rijndael algorithm is basically AES, so provide some macros. */
@@ -901,7 +908,9 @@ enum gcry_cipher_modes
     GCRY_CIPHER_MODE_CTR    = 6,  /* Counter. */
     GCRY_CIPHER_MODE_AESWRAP= 7,  /* AES-WRAP algorithm.  */
     GCRY_CIPHER_MODE_CCM    = 8,  /* Counter with CBC-MAC.  */
-    GCRY_CIPHER_MODE_GCM    = 9   /* Galois Counter Mode. */
+    GCRY_CIPHER_MODE_GCM    = 9,  /* Galois Counter Mode. */
+    GCRY_CIPHER_MODE_POLY1305 = 10, /* ChaCha20-Poly1305 AEAD (RFC 7539). */
+    GCRY_CIPHER_MODE_OCB    = 11  /* OCB3 mode (RFC 7253).  */
   };
 
 /* Flags used with the open function. */
@@ -998,6 +1007,11 @@ gcry_error_t gcry_cipher_checktag (gcry_cipher_hd_t hd, const void *intag,
 #define gcry_cipher_cts(h,on)  gcry_cipher_ctl( (h), GCRYCTL_SET_CBC_CTS, \
                                                                    NULL, on )
 
+/* Indicate to the encrypt and decrypt functions that the next call
+   provides the final data.  Only used with some modes.  */
+#define gcry_cipher_final(a) \
+            gcry_cipher_ctl ((a), GCRYCTL_FINALIZE, NULL, 0)
+
 /* Set counter for CTR mode.  (CTR,CTRLEN) must denote a buffer of
    block size length, or (NULL,0) to set the CTR to the all-zero block. */
 gpg_error_t gcry_cipher_setctr (gcry_cipher_hd_t hd,
@@ -1045,6 +1059,11 @@ enum gcry_pk_algos
 #define GCRY_PK_GET_PUBKEY 1
 #define GCRY_PK_GET_SECKEY 2
 
+/* The data object used to hold a handle to a prepared public or
+   private key.  */
+struct gcry_pk_handle;
+typedef struct gcry_pk_handle *gcry_pk_hd_t;
+
 /* Encrypt the DATA using the public key PKEY and store the result as
    a newly created S-expression at RESULT. */
 gcry_error_t gcry_pk_encrypt (gcry_sexp_t *result,
@@ -1064,6 +1083,31 @@ gcry_error_t gcry_pk_sign (gcry_sexp_t *result,
 gcry_error_t gcry_pk_verify (gcry_sexp_t sigval,
                              gcry_sexp_t data, gcry_sexp_t pkey);
 
+/* Check the N signatures SIGVALS[i] on DATA[i] using the public keys
+   PKEYS[i].  The result for each signature is stored at R_ERRORS
+   unless that is NULL. */
+gcry_error_t gcry_pk_verify_batch (gcry_sexp_t *sigvals, gcry_sexp_t *data,
+                                   gcry_sexp_t *pkeys, unsigned int n,
+                                   gcry_error_t *r_errors);
+
+/* Prepare the public or private KEY for repeated use and store a
+   handle for it at R_HD. */
+gcry_error_t gcry_pk_open (gcry_pk_hd_t *r_hd, gcry_sexp_t key);
+
+/* Release the key handle HD. */
+void gcry_pk_close (gcry_pk_hd_t hd);
+
+/* Same as gcry_pk_encrypt, gcry_pk_decrypt, gcry_pk_sign and
+   gcry_pk_verify but using the key of the handle HD. */
+gcry_error_t gcry_pk_hd_encrypt (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                                 gcry_sexp_t data);
+gcry_error_t gcry_pk_hd_decrypt (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                                 gcry_sexp_t data);
+gcry_error_t gcry_pk_hd_sign (gcry_pk_hd_t hd, gcry_sexp_t *result,
+                              gcry_sexp_t data);
+gcry_error_t gcry_pk_hd_verify (gcry_pk_hd_t hd, gcry_sexp_t sigval,
+                                gcry_sexp_t data);
+
 /* Check that private KEY is sane. */
 gcry_error_t gcry_pk_testkey (gcry_sexp_t key);
 
@@ -1144,7 +1188,13 @@ enum gcry_md_algos
     GCRY_MD_TIGER2        = 307, /* TIGER2 variant.   */
     GCRY_MD_GOSTR3411_94  = 308, /* GOST R 34.11-94.  */
     GCRY_MD_STRIBOG256    = 309, /* GOST R 34.11-2012, 256 bit.  */
-    GCRY_MD_STRIBOG512    = 310  /* GOST R 34.11-2012, 512 bit.  */
+    GCRY_MD_STRIBOG512    = 310, /* GOST R 34.11-2012, 512 bit.  */
+    GCRY_MD_SHA3_224      = 312,
+    GCRY_MD_SHA3_256      = 313,
+    GCRY_MD_SHA3_384      = 314,
+    GCRY_MD_SHA3_512      = 315,
+    GCRY_MD_SHAKE128      = 316, /* Extendable-output function.  */
+    GCRY_MD_SHAKE256      = 317  /* Extendable-output function.  */
   };
 
 /* Flags used with the open function.  */
@@ -1209,6 +1259,11 @@ void gcry_md_write (gcry_md_hd_t hd, const void *buffer, size_t length);
    algorithm ALGO. */
 unsigned char *gcry_md_read (gcry_md_hd_t hd, int algo);
 
+/* Read LENGTH bytes of output of the extendable-output function ALGO
+   from HD into BUFFER.  Repeated calls continue the output.  */
+gpg_error_t gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer,
+                             size_t length);
+
 /* Convenience function to calculate the hash from the data in BUFFER
    of size LENGTH using the algorithm ALGO avoiding the creating of a
    hash object.  The hash is returned in the caller provided buffer
@@ -1221,6 +1276,13 @@ void gcry_md_hash_buffer (int algo, void *digest,
 gpg_error_t gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
                                   const gcry_buffer_t *iov, int iovcnt);
 
+/* Convenience function to hash IOVCNT independent messages.  The
+   digest of IOV[i] is stored at DIGESTS + i * gcry_md_get_algo_dlen
+   (ALGO).  FLAGS must be 0.  */
+gpg_error_t gcry_md_hash_buffers_multi (int algo, unsigned int flags,
+                                        void *digests,
+                                        const gcry_buffer_t *iov, int iovcnt);
+
 /* Retrieve the algorithm used with HD.  This does not work reliable
    if more than one algorithm is enabled in HD. */
 int gcry_md_get_algo (gcry_md_hd_t hd);
@@ -1337,7 +1399,9 @@ enum gcry_mac_algos
     GCRY_MAC_GMAC_CAMELLIA      = 402,
     GCRY_MAC_GMAC_TWOFISH       = 403,
     GCRY_MAC_GMAC_SERPENT       = 404,
-    GCRY_MAC_GMAC_SEED          = 405
+    GCRY_MAC_GMAC_SEED          = 405,
+
+    GCRY_MAC_POLY1305           = 501
   };
 
 /* Flags used with the open function.  */
@@ -1421,7 +1485,16 @@ enum gcry_kdf_algos
     GCRY_KDF_ITERSALTED_S2K = 19,
     GCRY_KDF_PBKDF1 = 33,
     GCRY_KDF_PBKDF2 = 34,
-    GCRY_KDF_SCRYPT = 48
+    GCRY_KDF_SCRYPT = 48,
+    GCRY_KDF_ARGON2 = 64
+  };
+
+/* The variants of GCRY_KDF_ARGON2.  */
+enum gcry_kdf_subalgo_argon2
+  {
+    GCRY_KDF_ARGON2D  = 0,
+    GCRY_KDF_ARGON2I  = 1,
+    GCRY_KDF_ARGON2ID = 2
   };
 
 /* Derive a key from a passphrase.  */
@@ -1431,6 +1504,45 @@ gpg_error_t gcry_kdf_derive (const void *passphrase, size_t passphraselen,
                              unsigned long iterations,
                              size_t keysize, void *keybuffer);
 
+/* The handle for KDFs with more parameters, like Argon2.  */
+struct gcry_kdf_handle;
+typedef struct gcry_kdf_handle *gcry_kdf_hd_t;
+
+/* Functions to run the jobs of gcry_kdf_compute concurrently.
+   DISPATCH_JOB starts JOB_FN (JOB_PRIV) and WAIT_ALL_JOBS waits until
+   all started jobs have finished.  Both return a negative value on
+   error.  */
+typedef void (*gcry_kdf_job_fn_t) (void *priv);
+typedef int (*gcry_kdf_dispatch_job_fn_t) (void *jobs_context,
+                                           gcry_kdf_job_fn_t job_fn,
+                                           void *job_priv);
+typedef int (*gcry_kdf_wait_all_jobs_fn_t) (void *jobs_context);
+
+struct gcry_kdf_thread_ops
+{
+  void *jobs_context;
+  gcry_kdf_dispatch_job_fn_t dispatch_job;
+  gcry_kdf_wait_all_jobs_fn_t wait_all_jobs;
+};
+
+/* Create a handle for the KDF ALGO.  */
+gcry_error_t gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+                            const unsigned long *param, unsigned int paramlen,
+                            const void *passphrase, size_t passphraselen,
+                            const void *salt, size_t saltlen,
+                            const void *key, size_t keylen,
+                            const void *ad, size_t adlen);
+
+/* Run the KDF of H, optionally with the thread functions OPS.  */
+gcry_error_t gcry_kdf_compute (gcry_kdf_hd_t h,
+                               const struct gcry_kdf_thread_ops *ops);
+
+/* Store the RESULTLEN bytes of the derived key of H at RESULT.  */
+gcry_error_t gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen, void *result);
+
+/* Release the handle H.  */
+void gcry_kdf_close (gcry_kdf_hd_t h);
+
 
 
 
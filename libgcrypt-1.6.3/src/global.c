@@ -55,6 +55,10 @@ static int force_fips_mode;
 /* Controlled by global_init().  */
 static int any_init_done;
 
+/* The number of threads Libgcrypt may use for CPU bound operations;
+   see GCRYCTL_SET_WORKER_THREADS.  */
+static int worker_threads = 1;
+
 /* Memory management. */
 
 static gcry_handler_alloc_t alloc_func;
@@ -675,11 +679,32 @@ _gcry_vcontrol (enum gcry_ctl_cmds cmd, va_list arg_ptr)
 			       | GCRY_SECMEM_FLAG_NO_PRIV_DROP));
       break;
 
+    case GCRYCTL_AUTO_EXPAND_SECMEM:
+      _gcry_secmem_set_auto_expand (va_arg (arg_ptr, unsigned int));
+      break;
+
     case GCRYCTL_INACTIVATE_FIPS_FLAG:
     case GCRYCTL_REACTIVATE_FIPS_FLAG:
       rc = GPG_ERR_NOT_IMPLEMENTED;
       break;
 
+    case GCRYCTL_SET_WORKER_THREADS:
+      {
+        int n = va_arg (arg_ptr, int);
+#ifdef HAVE_SYSCONF
+        if (!n)
+          {
+            long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+            n = ncpu > 0? (ncpu < ATH_MAX_PARALLEL? ncpu : ATH_MAX_PARALLEL) : 1;
+          }
+#endif
+        if (n < 1 || n > ATH_MAX_PARALLEL)
+          rc = GPG_ERR_INV_ARG;
+        else
+          worker_threads = n;
+      }
+      break;
+
     default:
       _gcry_set_preferred_rng_type (0);
       rc = GPG_ERR_INV_OP;
@@ -1066,6 +1091,15 @@ _gcry_xstrdup (const char *string)
 }
 
 
+/* Return the number of threads which may be used for CPU bound
+   operations.  This is 1 unless changed by the application.  */
+int
+_gcry_get_worker_threads (void)
+{
+  return worker_threads;
+}
+
+
 int
 _gcry_get_debug_flag (unsigned int mask)
 {
@@ -96,7 +96,8 @@ get_cpuid(unsigned int in, unsigned int *eax, unsigned int *ebx,
     *edx = regs[3];
 }
 
-#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT)
+#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT) \
+    || defined(ENABLE_AVX512_SUPPORT)
 static unsigned int
 get_xgetbv(void)
 {
@@ -110,7 +111,7 @@ get_xgetbv(void)
 
   return t_eax;
 }
-#endif /* ENABLE_AVX_SUPPORT || ENABLE_AVX2_SUPPORT */
+#endif /* ENABLE_AVX_SUPPORT || ENABLE_AVX2_SUPPORT || ENABLE_AVX512_SUPPORT */
 
 #endif /* i386 && GNUC */
 
@@ -147,7 +148,8 @@ get_cpuid(unsigned int in, unsigned int *eax, unsigned int *ebx,
     *edx = regs[3];
 }
 
-#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT)
+#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT) \
+    || defined(ENABLE_AVX512_SUPPORT)
 static unsigned int
 get_xgetbv(void)
 {
@@ -161,7 +163,7 @@ get_xgetbv(void)
 
   return t_eax;
 }
-#endif /* ENABLE_AVX_SUPPORT || ENABLE_AVX2_SUPPORT */
+#endif /* ENABLE_AVX_SUPPORT || ENABLE_AVX2_SUPPORT || ENABLE_AVX512_SUPPORT */
 
 #endif /* x86-64 && GNUC */
 
@@ -173,10 +175,12 @@ detect_x86_gnuc (void)
   char vendor_id[12+1];
   unsigned int features;
   unsigned int os_supports_avx_avx2_registers = 0;
+  unsigned int os_supports_avx512_registers = 0;
   unsigned int max_cpuid_level;
   unsigned int result = 0;
 
   (void)os_supports_avx_avx2_registers;
+  (void)os_supports_avx512_registers;
 
   if (!is_cpuid_available())
     return 0;
@@ -252,13 +256,19 @@ detect_x86_gnuc (void)
   if (features & 0x02000000)
      result |= HWF_INTEL_AESNI;
 #endif /*ENABLE_AESNI_SUPPORT*/
-#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT)
-  /* Test bit 27 for OSXSAVE (required for AVX/AVX2).  */
+#if defined(ENABLE_AVX_SUPPORT) || defined(ENABLE_AVX2_SUPPORT) \
+    || defined(ENABLE_AVX512_SUPPORT)
+  /* Test bit 27 for OSXSAVE (required for AVX/AVX2/AVX-512).  */
   if (features & 0x08000000)
     {
+      unsigned int xcr0 = get_xgetbv();
+
       /* Check that OS has enabled both XMM and YMM state support.  */
-      if ((get_xgetbv() & 0x6) == 0x6)
+      if ((xcr0 & 0x6) == 0x6)
         os_supports_avx_avx2_registers = 1;
+      /* And additionally the opmask and ZMM state for AVX-512.  */
+      if ((xcr0 & 0xe6) == 0xe6)
+        os_supports_avx512_registers = 1;
     }
 #endif
 #ifdef ENABLE_AVX_SUPPORT
@@ -279,19 +289,48 @@ detect_x86_gnuc (void)
    * Source: http://www.sandpile.org/x86/cpuid.htm  */
   if (max_cpuid_level >= 7 && (features & 0x00000001))
     {
+      unsigned int features_ecx;
+
       /* Get CPUID:7 contains further Intel feature flags. */
-      get_cpuid(7, NULL, &features, NULL, NULL);
+      get_cpuid(7, NULL, &features, &features_ecx, NULL);
 
       /* Test bit 8 for BMI2.  */
       if (features & 0x00000100)
           result |= HWF_INTEL_BMI2;
 
+      /* Test bit 19 for ADX.  */
+      if (features & 0x00080000)
+          result |= HWF_INTEL_ADX;
+
 #ifdef ENABLE_AVX2_SUPPORT
       /* Test bit 5 for AVX2.  */
       if (features & 0x00000020)
         if (os_supports_avx_avx2_registers)
           result |= HWF_INTEL_AVX2;
 #endif /*ENABLE_AVX_SUPPORT*/
+
+#ifdef ENABLE_AVX512_SUPPORT
+      /* Test bits 16 and 30 for AVX512F and AVX512BW.  */
+      if ((features & 0x40010000) == 0x40010000)
+        if (os_supports_avx512_registers)
+          result |= HWF_INTEL_AVX512;
+
+      /* Test bit 9 of ECX for VAES.  */
+      if (features_ecx & 0x00000200)
+        if (os_supports_avx_avx2_registers)
+          result |= HWF_INTEL_VAES;
+
+      /* Test bit 10 of ECX for VPCLMULQDQ.  */
+      if (features_ecx & 0x00000400)
+        if (os_supports_avx_avx2_registers)
+          result |= HWF_INTEL_VPCLMUL;
+#endif /*ENABLE_AVX512_SUPPORT*/
+
+#ifdef ENABLE_SHAEXT_SUPPORT
+      /* Test bit 29 for SHA Extensions. */
+      if (features & (1 << 29))
+          result |= HWF_INTEL_SHAEXT;
+#endif /*ENABLE_SHAEXT_SUPPORT*/
     }
 
   return result;
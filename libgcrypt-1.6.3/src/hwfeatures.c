@@ -54,6 +54,11 @@ static struct
     { HWF_INTEL_RDRAND,"intel-rdrand" },
     { HWF_INTEL_AVX,   "intel-avx" },
     { HWF_INTEL_AVX2,  "intel-avx2" },
+    { HWF_INTEL_ADX,   "intel-adx" },
+    { HWF_INTEL_AVX512,"intel-avx512" },
+    { HWF_INTEL_VAES,  "intel-vaes" },
+    { HWF_INTEL_VPCLMUL,"intel-vpclmul" },
+    { HWF_INTEL_SHAEXT,"intel-shaext" },
     { HWF_ARM_NEON,    "arm-neon" }
   };
 
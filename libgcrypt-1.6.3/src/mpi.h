@@ -120,10 +120,12 @@ void _gcry_mpi_immutable_failed (void);
 #define mpi_m_check(a)        _gcry_mpi_m_check ((a))
 #define mpi_const(n)          _gcry_mpi_const ((n))
 #define mpi_set_cond(w,u,set)  _gcry_mpi_set_cond ((w),(u),(set))
+#define mpi_swap_cond(a,b,sw)  _gcry_mpi_swap_cond ((a),(b),(sw))
 
 void _gcry_mpi_clear( gcry_mpi_t a );
 gcry_mpi_t _gcry_mpi_set_cond (gcry_mpi_t w, const gcry_mpi_t u,
                                unsigned long swap);
+void _gcry_mpi_swap_cond (gcry_mpi_t a, gcry_mpi_t b, unsigned long swap);
 gcry_mpi_t  _gcry_mpi_alloc_like( gcry_mpi_t a );
 gcry_mpi_t  _gcry_mpi_alloc_set_ui( unsigned long u);
 void _gcry_mpi_m_check( gcry_mpi_t a );
@@ -207,6 +209,21 @@ void _gcry_mpi_mul_barrett (gcry_mpi_t w, gcry_mpi_t u, gcry_mpi_t v,
                             mpi_barrett_t ctx);
 
 
+/*-- mpi-pow.c --*/
+#define mpi_mont_init(m,f)        _gcry_mpi_mont_init ((m),(f))
+#define mpi_mont_free(c)          _gcry_mpi_mont_free ((c))
+#define mpi_powm_mont(w,b,e,c)    _gcry_mpi_powm_mont ((w),(b),(e),(c))
+
+/* Context used with Montgomery multiplication.  */
+struct mont_ctx_s;
+typedef struct mont_ctx_s *mpi_mont_t;
+
+mpi_mont_t _gcry_mpi_mont_init (gcry_mpi_t m, int copy);
+void _gcry_mpi_mont_free (mpi_mont_t ctx);
+void _gcry_mpi_powm_mont (gcry_mpi_t res, gcry_mpi_t base, gcry_mpi_t expo,
+                          mpi_mont_t ctx);
+
+
 /*-- mpi-mpow.c --*/
 #define mpi_mulpowm(a,b,c,d) _gcry_mpi_mulpowm ((a),(b),(c),(d))
 void _gcry_mpi_mulpowm( gcry_mpi_t res, gcry_mpi_t *basearray, gcry_mpi_t *exparray, gcry_mpi_t mod);
@@ -285,8 +302,25 @@ void _gcry_mpi_ec_add_points (mpi_point_t result,
 void _gcry_mpi_ec_mul_point (mpi_point_t result,
                              gcry_mpi_t scalar, mpi_point_t point,
                              mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_add_points (mpi_point_t result,
+                                  gcry_mpi_t k1, mpi_point_t p1,
+                                  gcry_mpi_t k2, mpi_point_t p2,
+                                  mpi_ec_t ctx);
+void _gcry_mpi_ec_mul_multi (mpi_point_t result, unsigned int n,
+                             gcry_mpi_t *scalars, mpi_point_t points,
+                             mpi_ec_t ctx);
 int  _gcry_mpi_ec_curve_point (gcry_mpi_point_t point, mpi_ec_t ctx);
 
+struct mpi_ec_base_table_s;
+typedef struct mpi_ec_base_table_s *mpi_ec_base_table_t;
+
+mpi_ec_base_table_t _gcry_mpi_ec_base_table_new (mpi_point_t G,
+                                                 mpi_ec_t ctx);
+void _gcry_mpi_ec_base_table_free (mpi_ec_base_table_t tbl);
+void _gcry_mpi_ec_mul_base (mpi_point_t result, gcry_mpi_t scalar,
+                            mpi_point_t G, mpi_ec_base_table_t tbl,
+                            mpi_ec_t ctx);
+
 gcry_mpi_t _gcry_mpi_ec_ec2os (gcry_mpi_point_t point, mpi_ec_t ectx);
 
 gcry_mpi_t _gcry_mpi_ec_get_mpi (const char *name, gcry_ctx_t ctx, int copy);
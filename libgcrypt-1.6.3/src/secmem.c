@@ -60,18 +60,37 @@ typedef struct memblock
 /* This flag specifies that the memory block is in use.  */
 #define MB_FLAG_ACTIVE (1 << 0)
 
-/* The pool of secure memory.  */
-static void *pool;
+/* This flag specifies that the memory block is a chunk of a slab.  */
+#define MB_FLAG_SLAB   (1 << 1)
 
-/* Size of POOL in bytes.  */
-static size_t pool_size;
+/* A pool of secure memory.  */
+typedef struct pooldesc_s
+{
+  /* A link to the next pool.  Pools are only appended to the list
+     and never removed while the secure memory is in use; thus the
+     list may be walked without holding the lock.  */
+  struct pooldesc_s * volatile next;
+
+  /* The actual memory.  */
+  void *mem;
+
+  /* Size of MEM in bytes.  */
+  size_t size;
+
+  /* True, if the memory pool is ready for use.  May be checked in an
+     atexit function.  */
+  volatile int okay;
+
+  /* True, if the memory pool is mmapped.  */
+  volatile int is_mmapped;
 
-/* True, if the memory pool is ready for use.  May be checked in an
-   atexit function.  */
-static volatile int pool_okay;
+  /* Stats.  */
+  unsigned int cur_alloced, cur_blocks;
+} pooldesc_t;
 
-/* True, if the memory pool is mmapped.  */
-static volatile int pool_is_mmapped;
+/* The main pool.  If it is exhausted further pools are linked to
+   it.  */
+static pooldesc_t mainpool;
 
 /* FIXME?  */
 static int disable_secmem;
@@ -82,8 +101,10 @@ static int suspend_warning;
 static int no_mlock;
 static int no_priv_drop;
 
-/* Stats.  */
-static unsigned int cur_alloced, cur_blocks;
+/* Whether further pools are added when the main pool is exhausted
+   and their minimum size; 0 uses the size of the main pool.  */
+static int auto_expand;
+static size_t auto_expand_size;
 
 /* Lock protecting accesses to the memory pool.  */
 static ath_mutex_t secmem_lock;
@@ -101,9 +122,64 @@ static ath_mutex_t secmem_lock;
 #define ADDR_TO_BLOCK(addr) \
   (memblock_t *) ((char *) addr - BLOCK_HEAD_SIZE)
 
-/* Check whether P points into the pool.  */
+/* The link of a free chunk.  It is stored in the user part.  */
+#define MB_NEXT(mb) (*(memblock_t **) &(mb)->aligned.c)
+
+
+/* Small requests are served from slabs.  A slab is a block of
+   SLAB_SIZE bytes, including its header, taken from a pool and split
+   into chunks of one of the sizes in CLASS_SIZES.  Freed chunks are not merged but put on a
+   free list of their size class: first on a short list owned by the
+   freeing thread, which is used without taking the lock, and then on
+   the global list.  Slabs are not given back to their pool.  */
+#define SLAB_SIZE 4096
+
+static const unsigned short class_sizes[] =
+  { 32, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+#define N_CLASSES DIM (class_sizes)
+
+/* The global lists of free chunks.  */
+static memblock_t *class_free[N_CLASSES];
+
+/* Maximum number of chunks per class in a thread cache and the
+   number of chunks moved to it at once.  */
+#define TCACHE_MAX  16
+#define TCACHE_FILL 8
+
+/* The per-thread lists of free chunks.  */
+typedef struct tcache_s
+{
+  unsigned int generation;  /* SECMEM_GENERATION at creation.  */
+  unsigned int count[N_CLASSES];
+  memblock_t *head[N_CLASSES];
+} tcache_t;
+
+/* The key to the cache of the current thread.  */
+static ath_key_t tcache_key;
+static int tcache_key_valid;
+
+/* Incremented when the pools are released so that the chunks in the
+   thread caches won't be used again.  */
+static volatile unsigned int secmem_generation;
+
+
+/* Return the size class for a request of SIZE bytes or -1 if SIZE is
+   too large for a slab.  */
+static int
+size_to_class (size_t size)
+{
+  int cls;
+
+  for (cls = 0; cls < N_CLASSES; cls++)
+    if (size <= class_sizes[cls])
+      return cls;
+  return -1;
+}
+
+
+/* Check whether P points into POOL.  */
 static int
-ptr_into_pool_p (const void *p)
+ptr_into_pool_p (pooldesc_t *pool, const void *p)
 {
   /* We need to convert pointers to addresses.  This is required by
      C-99 6.5.8 to avoid undefined behaviour.  Using size_t is at
@@ -111,36 +187,48 @@ ptr_into_pool_p (const void *p)
      http://lists.gnupg.org/pipermail/gcrypt-devel/2007-February/001102.html
   */
   size_t p_addr = (size_t)p;
-  size_t pool_addr = (size_t)pool;
+  size_t pool_addr = (size_t)pool->mem;
+
+  return p_addr >= pool_addr && p_addr <  pool_addr+pool->size;
+}
+
+/* Return the pool P points into or NULL.  */
+static pooldesc_t *
+ptr_to_pool (const void *p)
+{
+  pooldesc_t *pool;
 
-  return p_addr >= pool_addr && p_addr <  pool_addr+pool_size;
+  for (pool = &mainpool; pool; pool = pool->next)
+    if (pool->okay && ptr_into_pool_p (pool, p))
+      return pool;
+  return NULL;
 }
 
 /* Update the stats.  */
 static void
-stats_update (size_t add, size_t sub)
+stats_update (pooldesc_t *pool, size_t add, size_t sub)
 {
   if (add)
     {
-      cur_alloced += add;
-      cur_blocks++;
+      pool->cur_alloced += add;
+      pool->cur_blocks++;
     }
   if (sub)
     {
-      cur_alloced -= sub;
-      cur_blocks--;
+      pool->cur_alloced -= sub;
+      pool->cur_blocks--;
     }
 }
 
 /* Return the block following MB or NULL, if MB is the last block.  */
 static memblock_t *
-mb_get_next (memblock_t *mb)
+mb_get_next (pooldesc_t *pool, memblock_t *mb)
 {
   memblock_t *mb_next;
 
   mb_next = (memblock_t *) ((char *) mb + BLOCK_HEAD_SIZE + mb->size);
 
-  if (! ptr_into_pool_p (mb_next))
+  if (! ptr_into_pool_p (pool, mb_next))
     mb_next = NULL;
 
   return mb_next;
@@ -149,18 +237,18 @@ mb_get_next (memblock_t *mb)
 /* Return the block preceding MB or NULL, if MB is the first
    block.  */
 static memblock_t *
-mb_get_prev (memblock_t *mb)
+mb_get_prev (pooldesc_t *pool, memblock_t *mb)
 {
   memblock_t *mb_prev, *mb_next;
 
-  if (mb == pool)
+  if (mb == pool->mem)
     mb_prev = NULL;
   else
     {
-      mb_prev = (memblock_t *) pool;
+      mb_prev = (memblock_t *) pool->mem;
       while (1)
 	{
-	  mb_next = mb_get_next (mb_prev);
+	  mb_next = mb_get_next (pool, mb_prev);
 	  if (mb_next == mb)
 	    break;
 	  else
@@ -174,12 +262,12 @@ mb_get_prev (memblock_t *mb)
 /* If the preceding block of MB and/or the following block of MB
    exist and are not active, merge them to form a bigger block.  */
 static void
-mb_merge (memblock_t *mb)
+mb_merge (pooldesc_t *pool, memblock_t *mb)
 {
   memblock_t *mb_prev, *mb_next;
 
-  mb_prev = mb_get_prev (mb);
-  mb_next = mb_get_next (mb);
+  mb_prev = mb_get_prev (pool, mb);
+  mb_next = mb_get_next (pool, mb);
 
   if (mb_prev && (! (mb_prev->flags & MB_FLAG_ACTIVE)))
     {
@@ -190,13 +278,13 @@ mb_merge (memblock_t *mb)
     mb->size += BLOCK_HEAD_SIZE + mb_next->size;
 }
 
-/* Return a new block, which can hold SIZE bytes.  */
+/* Return a new block from POOL, which can hold SIZE bytes.  */
 static memblock_t *
-mb_get_new (memblock_t *block, size_t size)
+mb_get_new (pooldesc_t *pool, memblock_t *block, size_t size)
 {
   memblock_t *mb, *mb_split;
 
-  for (mb = block; ptr_into_pool_p (mb); mb = mb_get_next (mb))
+  for (mb = block; ptr_into_pool_p (pool, mb); mb = mb_get_next (pool, mb))
     if (! (mb->flags & MB_FLAG_ACTIVE) && mb->size >= size)
       {
 	/* Found a free block.  */
@@ -212,14 +300,14 @@ mb_get_new (memblock_t *block, size_t size)
 
 	    mb->size = size;
 
-	    mb_merge (mb_split);
+	    mb_merge (pool, mb_split);
 
 	  }
 
 	break;
       }
 
-  if (! ptr_into_pool_p (mb))
+  if (! ptr_into_pool_p (pool, mb))
     {
       gpg_err_set_errno (ENOMEM);
       mb = NULL;
@@ -236,8 +324,10 @@ print_warn (void)
     log_info (_("Warning: using insecure memory!\n"));
 }
 
-/* Lock the memory pages into core and drop privileges.  */
-static void
+/* Lock the memory pages into core and drop privileges.  Returns 0 on
+   success or if locking has been disabled or is not supported, and -1
+   if the memory could not be locked.  */
+static int
 lock_pool (void *p, size_t n)
 {
 #if defined(USE_CAPABILITIES) && defined(HAVE_MLOCK)
@@ -271,8 +361,7 @@ lock_pool (void *p, size_t n)
 #endif
 	  )
 	log_error ("can't lock memory: %s\n", strerror (err));
-      show_warning = 1;
-      not_locked = 1;
+      return -1;
     }
 
 #elif defined(HAVE_MLOCK)
@@ -330,8 +419,7 @@ lock_pool (void *p, size_t n)
 #endif
 	  )
 	log_error ("can't lock memory: %s\n", strerror (err));
-      show_warning = 1;
-      not_locked = 1;
+      return -1;
     }
 
 #elif defined ( __QNX__ )
@@ -358,17 +446,21 @@ lock_pool (void *p, size_t n)
   if (!no_mlock)
     log_info ("Please note that you don't have secure memory on this system\n");
 #endif
+
+  return 0;
 }
 
-/* Initialize POOL.  */
-static void
-init_pool (size_t n)
+/* Initialize POOL with N bytes.  Returns 0 on success or -1 if the
+   memory could not be allocated.  */
+static int
+init_pool (pooldesc_t *pool, size_t n)
 {
   size_t pgsize;
   long int pgsize_val;
   memblock_t *mb;
+  int okay = 0;
 
-  pool_size = n;
+  pool->size = n;
 
   if (disable_secmem)
     log_bug ("secure memory is disabled");
@@ -384,10 +476,10 @@ init_pool (size_t n)
 
 
 #if HAVE_MMAP
-  pool_size = (pool_size + pgsize - 1) & ~(pgsize - 1);
+  pool->size = (pool->size + pgsize - 1) & ~(pgsize - 1);
 #ifdef MAP_ANONYMOUS
-  pool = mmap (0, pool_size, PROT_READ | PROT_WRITE,
-	       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  pool->mem = mmap (0, pool->size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 #else /* map /dev/zero instead */
   {
     int fd;
@@ -396,39 +488,52 @@ init_pool (size_t n)
     if (fd == -1)
       {
 	log_error ("can't open /dev/zero: %s\n", strerror (errno));
-	pool = (void *) -1;
+	pool->mem = (void *) -1;
       }
     else
       {
-	pool = mmap (0, pool_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	pool->mem = mmap (0, pool->size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
         close (fd);
       }
   }
 #endif
-  if (pool == (void *) -1)
+  if (pool->mem == (void *) -1)
     log_info ("can't mmap pool of %u bytes: %s - using malloc\n",
-	      (unsigned) pool_size, strerror (errno));
+	      (unsigned) pool->size, strerror (errno));
   else
     {
-      pool_is_mmapped = 1;
-      pool_okay = 1;
+      pool->is_mmapped = 1;
+      okay = 1;
     }
 
 #endif
-  if (!pool_okay)
+  if (!okay)
     {
-      pool = malloc (pool_size);
-      if (!pool)
-	log_fatal ("can't allocate memory pool of %u bytes\n",
-		   (unsigned) pool_size);
-      else
-	pool_okay = 1;
+      pool->mem = malloc (pool->size);
+      if (!pool->mem)
+        return -1;
     }
 
   /* Initialize first memory block.  */
-  mb = (memblock_t *) pool;
-  mb->size = pool_size;
+  mb = (memblock_t *) pool->mem;
+  mb->size = pool->size - BLOCK_HEAD_SIZE;
   mb->flags = 0;
+
+  pool->okay = 1;
+  return 0;
+}
+
+/* Enable the allocation of further pools if the main pool is
+   exhausted.  Each of these pools has at least CHUNKSIZE bytes; 0
+   uses the size of the main pool.  */
+void
+_gcry_secmem_set_auto_expand (unsigned int chunksize)
+{
+  SECMEM_LOCK;
+  auto_expand = 1;
+  auto_expand_size = chunksize;
+  SECMEM_UNLOCK;
 }
 
 void
@@ -506,10 +611,16 @@ secmem_init (size_t n)
     {
       if (n < MINIMUM_POOL_SIZE)
 	n = MINIMUM_POOL_SIZE;
-      if (! pool_okay)
+      if (! mainpool.okay)
 	{
-	  init_pool (n);
-	  lock_pool (pool, n);
+	  if (init_pool (&mainpool, n))
+            log_fatal ("can't allocate memory pool of %u bytes\n",
+                       (unsigned) mainpool.size);
+	  if (lock_pool (mainpool.mem, mainpool.size))
+            {
+              show_warning = 1;
+              not_locked = 1;
+            }
 	}
       else
 	log_error ("Oops, secure memory pool already initialized\n");
@@ -533,6 +644,268 @@ _gcry_secmem_init (size_t n)
 }
 
 
+/* Add a new pool which can hold a block of SIZE bytes to the list of
+   pools and return it.  Returns NULL if no pool can be added.  This
+   function is expected to be called with the secmem lock held.  */
+static pooldesc_t *
+add_pool (size_t size)
+{
+  pooldesc_t *pool, *last;
+  size_t n;
+
+  /* Additional pools need to be enabled by the application.  In
+     FIPS mode all secure memory must be locked; we can't be sure that
+     this works for another pool.  */
+  if (!auto_expand || !mainpool.okay || fips_mode ())
+    return NULL;
+
+  n = auto_expand_size? auto_expand_size : mainpool.size;
+  if (n < size + BLOCK_HEAD_SIZE)
+    n = size + BLOCK_HEAD_SIZE;
+
+  pool = calloc (1, sizeof *pool);
+  if (!pool)
+    return NULL;
+  if (init_pool (pool, n))
+    {
+      free (pool);
+      return NULL;
+    }
+  /* Don't hand out memory which could be swapped out.  */
+  if (lock_pool (pool->mem, pool->size))
+    {
+#if HAVE_MMAP
+      if (pool->is_mmapped)
+        munmap (pool->mem, pool->size);
+      else
+#endif
+        free (pool->mem);
+      free (pool);
+      return NULL;
+    }
+
+  for (last = &mainpool; last->next; last = last->next)
+    ;
+  last->next = pool;
+
+  return pool;
+}
+
+
+/* Return a new block, which can hold SIZE bytes, from the first pool
+   which has room for it.  A new pool is added if required.  This
+   function is expected to be called with the secmem lock held.  */
+static memblock_t *
+pool_get_block (size_t size)
+{
+  pooldesc_t *pool;
+  memblock_t *mb = NULL;
+
+  for (pool = &mainpool; pool; pool = pool->next)
+    {
+      mb = mb_get_new (pool, (memblock_t *) pool->mem, size);
+      if (mb)
+        break;
+    }
+
+  if (!mb)
+    {
+      pool = add_pool (size);
+      if (pool)
+        mb = mb_get_new (pool, (memblock_t *) pool->mem, size);
+      if (!mb)
+        gpg_err_set_errno (ENOMEM);
+    }
+
+  if (mb)
+    stats_update (pool, mb->size, 0);
+
+  return mb;
+}
+
+
+/* Wipe out the memory of block MB.  */
+static void
+mb_wipe (memblock_t *mb)
+{
+  size_t size = mb->size;
+
+  /* This does not make much sense: probably this memory is held in the
+   * cache. We do it anyway: */
+#define MB_WIPE_OUT(byte) \
+  wipememory2 ((memblock_t *) ((char *) mb + BLOCK_HEAD_SIZE), (byte), size);
+
+  MB_WIPE_OUT (0xff);
+  MB_WIPE_OUT (0xaa);
+  MB_WIPE_OUT (0x55);
+  MB_WIPE_OUT (0x00);
+
+#undef MB_WIPE_OUT
+}
+
+
+/* Take a slab from the pools, split it into chunks of class CLS and
+   put them on the global free list.  Returns 0 on success.  This
+   function is expected to be called with the secmem lock held.  */
+static int
+slab_new (int cls)
+{
+  memblock_t *slab, *mb;
+  size_t stride = BLOCK_HEAD_SIZE + class_sizes[cls];
+  char *p, *end;
+
+  slab = pool_get_block (SLAB_SIZE - BLOCK_HEAD_SIZE);
+  if (!slab)
+    return -1;
+
+  p = (char *) &slab->aligned.c;
+  end = p + slab->size;
+  for (; p + stride <= end; p += stride)
+    {
+      mb = (memblock_t *) p;
+      mb->size = class_sizes[cls];
+      mb->flags = MB_FLAG_ACTIVE | MB_FLAG_SLAB;
+      MB_NEXT (mb) = class_free[cls];
+      class_free[cls] = mb;
+    }
+
+  return 0;
+}
+
+
+/* Return the cache of the calling thread.  If there is none and
+   CREATE is set, a new one is created.  Returns NULL if no cache is
+   available.  */
+static tcache_t *
+get_tcache (int create)
+{
+  tcache_t *tc;
+
+  if (!tcache_key_valid)
+    return NULL;
+
+  tc = ath_key_get (&tcache_key);
+  if (tc && tc->generation != secmem_generation)
+    {
+      /* The pools have been released since the chunks were cached.  */
+      memset (tc, 0, sizeof *tc);
+      tc->generation = secmem_generation;
+    }
+  else if (!tc && create)
+    {
+      tc = calloc (1, sizeof *tc);
+      if (tc)
+        {
+          tc->generation = secmem_generation;
+          if (ath_key_set (&tcache_key, tc))
+            {
+              free (tc);
+              tc = NULL;
+            }
+        }
+    }
+
+  return tc;
+}
+
+
+/* Give the chunks of a terminating thread's cache TC back.  */
+static void
+tcache_release (void *value)
+{
+  tcache_t *tc = value;
+  memblock_t *mb;
+  int cls;
+
+  SECMEM_LOCK;
+  if (tc->generation == secmem_generation)
+    for (cls = 0; cls < N_CLASSES; cls++)
+      while ((mb = tc->head[cls]))
+        {
+          tc->head[cls] = MB_NEXT (mb);
+          MB_NEXT (mb) = class_free[cls];
+          class_free[cls] = mb;
+        }
+  SECMEM_UNLOCK;
+
+  free (tc);
+}
+
+
+/* Return a chunk of class CLS from the cache of the calling thread or
+   NULL if it has none.  */
+static void *
+tcache_alloc (int cls)
+{
+  tcache_t *tc;
+  memblock_t *mb;
+
+  tc = get_tcache (0);
+  if (!tc || !tc->head[cls])
+    return NULL;
+
+  mb = tc->head[cls];
+  tc->head[cls] = MB_NEXT (mb);
+  tc->count[cls]--;
+  MB_NEXT (mb) = NULL;
+
+  return &mb->aligned.c;
+}
+
+
+/* Put the wiped out chunk MB into the cache of the calling thread.
+   Returns false if the cache is not available or full.  */
+static int
+tcache_free (memblock_t *mb)
+{
+  tcache_t *tc;
+  int cls;
+
+  tc = get_tcache (1);
+  cls = size_to_class (mb->size);
+  if (!tc || tc->count[cls] >= TCACHE_MAX)
+    return 0;
+
+  MB_NEXT (mb) = tc->head[cls];
+  tc->head[cls] = mb;
+  tc->count[cls]++;
+
+  return 1;
+}
+
+
+/* Return a chunk of class CLS from the global free list and move a
+   few more to the cache of the calling thread.  This function is
+   expected to be called with the secmem lock held.  */
+static memblock_t *
+slab_alloc (int cls)
+{
+  memblock_t *mb, *mb2;
+  tcache_t *tc;
+  int n;
+
+  if (!class_free[cls] && slab_new (cls))
+    return NULL;
+
+  mb = class_free[cls];
+  class_free[cls] = MB_NEXT (mb);
+  MB_NEXT (mb) = NULL;
+
+  tc = get_tcache (1);
+  for (n = 0; (tc && n < TCACHE_FILL && tc->count[cls] < TCACHE_MAX
+               && class_free[cls]); n++)
+    {
+      mb2 = class_free[cls];
+      class_free[cls] = MB_NEXT (mb2);
+      MB_NEXT (mb2) = tc->head[cls];
+      tc->head[cls] = mb2;
+      tc->count[cls]++;
+    }
+
+  return mb;
+}
+
+
 gcry_err_code_t
 _gcry_secmem_module_init ()
 {
@@ -542,6 +915,9 @@ _gcry_secmem_module_init ()
   if (err)
     log_fatal ("could not allocate secmem lock\n");
 
+  /* Without the key all requests take the lock.  */
+  tcache_key_valid = !ath_key_create (&tcache_key, tcache_release);
+
   return 0;
 }
 
@@ -550,12 +926,13 @@ static void *
 _gcry_secmem_malloc_internal (size_t size)
 {
   memblock_t *mb;
+  int cls;
 
-  if (!pool_okay)
+  if (!mainpool.okay)
     {
       /* Try to initialize the pool if the user forgot about it.  */
       secmem_init (STANDARD_POOL_SIZE);
-      if (!pool_okay)
+      if (!mainpool.okay)
         {
           log_info (_("operation is not possible without "
                       "initialized secure memory\n"));
@@ -578,9 +955,12 @@ _gcry_secmem_malloc_internal (size_t size)
   /* Blocks are always a multiple of 32. */
   size = ((size + 31) / 32) * 32;
 
-  mb = mb_get_new ((memblock_t *) pool, size);
-  if (mb)
-    stats_update (size, 0);
+  /* If no new slab fits into the pools, the request is served like
+     a large one from what is left.  */
+  cls = size_to_class (size);
+  mb = cls >= 0? slab_alloc (cls) : NULL;
+  if (!mb)
+    mb = pool_get_block (size);
 
   return mb ? &mb->aligned.c : NULL;
 }
@@ -589,6 +969,13 @@ void *
 _gcry_secmem_malloc (size_t size)
 {
   void *p;
+  int cls;
+
+  /* Small blocks are first taken from the cache of the calling
+     thread, which does not require the lock.  */
+  cls = size_to_class (size);
+  if (cls >= 0 && (p = tcache_alloc (cls)))
+    return p;
 
   SECMEM_LOCK;
   p = _gcry_secmem_malloc_internal (size);
@@ -597,41 +984,71 @@ _gcry_secmem_malloc (size_t size)
   return p;
 }
 
+/* Put the wiped out chunk MB on the global free list of its class.
+   This function is expected to be called with the secmem lock held.  */
+static void
+slab_free (memblock_t *mb)
+{
+  int cls = size_to_class (mb->size);
+
+  MB_NEXT (mb) = class_free[cls];
+  class_free[cls] = mb;
+}
+
 static void
 _gcry_secmem_free_internal (void *a)
 {
   memblock_t *mb;
-  int size;
+  pooldesc_t *pool;
 
   if (!a)
     return;
 
   mb = ADDR_TO_BLOCK (a);
-  size = mb->size;
+  if ((mb->flags & MB_FLAG_SLAB))
+    {
+      mb_wipe (mb);
+      slab_free (mb);
+      return;
+    }
 
-  /* This does not make much sense: probably this memory is held in the
-   * cache. We do it anyway: */
-#define MB_WIPE_OUT(byte) \
-  wipememory2 ((memblock_t *) ((char *) mb + BLOCK_HEAD_SIZE), (byte), size);
+  pool = ptr_to_pool (a);
+  if (!pool)
+    return;
 
-  MB_WIPE_OUT (0xff);
-  MB_WIPE_OUT (0xaa);
-  MB_WIPE_OUT (0x55);
-  MB_WIPE_OUT (0x00);
+  mb_wipe (mb);
 
-  stats_update (0, size);
+  /* Update stats.  */
+  stats_update (pool, 0, mb->size);
 
   mb->flags &= ~MB_FLAG_ACTIVE;
 
-  /* Update stats.  */
-
-  mb_merge (mb);
+  mb_merge (pool, mb);
 }
 
 /* Wipe out and release memory.  */
 void
 _gcry_secmem_free (void *a)
 {
+  memblock_t *mb;
+
+  if (!a)
+    return;
+
+  /* Chunks of slabs are first put into the cache of the calling
+     thread, which does not require the lock.  */
+  mb = ADDR_TO_BLOCK (a);
+  if ((mb->flags & MB_FLAG_SLAB))
+    {
+      mb_wipe (mb);
+      if (tcache_free (mb))
+        return;
+      SECMEM_LOCK;
+      slab_free (mb);
+      SECMEM_UNLOCK;
+      return;
+    }
+
   SECMEM_LOCK;
   _gcry_secmem_free_internal (a);
   SECMEM_UNLOCK;
@@ -675,7 +1092,7 @@ _gcry_secmem_realloc (void *p, size_t newsize)
 int
 _gcry_private_is_secure (const void *p)
 {
-  return pool_okay && ptr_into_pool_p (p);
+  return !!ptr_to_pool (p);
 }
 
 
@@ -690,20 +1107,32 @@ _gcry_private_is_secure (const void *p)
 void
 _gcry_secmem_term ()
 {
-  if (!pool_okay)
-    return;
+  pooldesc_t *pool, *next;
 
-  wipememory2 (pool, 0xff, pool_size);
-  wipememory2 (pool, 0xaa, pool_size);
-  wipememory2 (pool, 0x55, pool_size);
-  wipememory2 (pool, 0x00, pool_size);
+  for (pool = &mainpool; pool; pool = next)
+    {
+      next = pool->next;
+      if (!pool->okay)
+        continue;
+
+      wipememory2 (pool->mem, 0xff, pool->size);
+      wipememory2 (pool->mem, 0xaa, pool->size);
+      wipememory2 (pool->mem, 0x55, pool->size);
+      wipememory2 (pool->mem, 0x00, pool->size);
 #if HAVE_MMAP
-  if (pool_is_mmapped)
-    munmap (pool, pool_size);
+      if (pool->is_mmapped)
+        munmap (pool->mem, pool->size);
 #endif
-  pool = NULL;
-  pool_okay = 0;
-  pool_size = 0;
+      pool->mem = NULL;
+      pool->okay = 0;
+      pool->size = 0;
+      pool->cur_alloced = pool->cur_blocks = 0;
+      if (pool != &mainpool)
+        free (pool);
+    }
+  mainpool.next = NULL;
+  memset (class_free, 0, sizeof class_free);
+  secmem_generation++;
   not_locked = 0;
 }
 
@@ -711,26 +1140,32 @@ _gcry_secmem_term ()
 void
 _gcry_secmem_dump_stats ()
 {
+  pooldesc_t *pool;
+  int i;
 #if 1
   SECMEM_LOCK;
 
- if (pool_okay)
-    log_info ("secmem usage: %u/%lu bytes in %u blocks\n",
-	      cur_alloced, (unsigned long)pool_size, cur_blocks);
+  for (pool = &mainpool, i = 0; pool; pool = pool->next, i++)
+    if (pool->okay)
+      log_info ("secmem usage: %u/%lu bytes in %u blocks%s\n",
+                pool->cur_alloced, (unsigned long)pool->size, pool->cur_blocks,
+                i? " (overflow pool)":"");
   SECMEM_UNLOCK;
 #else
   memblock_t *mb;
-  int i;
+  int j;
 
   SECMEM_LOCK;
 
-  for (i = 0, mb = (memblock_t *) pool;
-       ptr_into_pool_p (mb);
-       mb = mb_get_next (mb), i++)
-    log_info ("SECMEM: [%s] block: %i; size: %i\n",
-	      (mb->flags & MB_FLAG_ACTIVE) ? "used" : "free",
-	      i,
-	      mb->size);
+  for (pool = &mainpool, j = 0; pool; pool = pool->next, j++)
+    for (i = 0, mb = (memblock_t *) pool->mem;
+         ptr_into_pool_p (pool, mb);
+         mb = mb_get_next (pool, mb), i++)
+      log_info ("SECMEM: pool %d [%s] block: %i; size: %i\n",
+                j,
+                (mb->flags & MB_FLAG_ACTIVE) ? "used" : "free",
+                i,
+                mb->size);
   SECMEM_UNLOCK;
 #endif
 }
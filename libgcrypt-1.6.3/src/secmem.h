@@ -28,6 +28,7 @@ void *_gcry_secmem_realloc (void *a, size_t newsize);
 void _gcry_secmem_free (void *a);
 void _gcry_secmem_dump_stats (void);
 void _gcry_secmem_set_flags (unsigned flags);
+void _gcry_secmem_set_auto_expand (unsigned int chunksize);
 unsigned _gcry_secmem_get_flags(void);
 int _gcry_private_is_secure (const void *p);
 
@@ -981,6 +981,75 @@ gcry_pk_verify (gcry_sexp_t sigval, gcry_sexp_t data, gcry_sexp_t pkey)
   return gpg_error (_gcry_pk_verify (sigval, data, pkey));
 }
 
+gcry_error_t
+gcry_pk_verify_batch (gcry_sexp_t *sigvals, gcry_sexp_t *data,
+                      gcry_sexp_t *pkeys, unsigned int n,
+                      gcry_error_t *r_errors)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_pk_verify_batch (sigvals, data, pkeys, n,
+                                           r_errors));
+}
+
+gcry_error_t
+gcry_pk_open (gcry_pk_hd_t *r_hd, gcry_sexp_t key)
+{
+  if (!fips_is_operational ())
+    {
+      *r_hd = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_open (r_hd, key));
+}
+
+void
+gcry_pk_close (gcry_pk_hd_t hd)
+{
+  _gcry_pk_close (hd);
+}
+
+gcry_error_t
+gcry_pk_hd_encrypt (gcry_pk_hd_t hd, gcry_sexp_t *result, gcry_sexp_t data)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_hd_encrypt (hd, result, data));
+}
+
+gcry_error_t
+gcry_pk_hd_decrypt (gcry_pk_hd_t hd, gcry_sexp_t *result, gcry_sexp_t data)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_hd_decrypt (hd, result, data));
+}
+
+gcry_error_t
+gcry_pk_hd_sign (gcry_pk_hd_t hd, gcry_sexp_t *result, gcry_sexp_t data)
+{
+  if (!fips_is_operational ())
+    {
+      *result = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_pk_hd_sign (hd, result, data));
+}
+
+gcry_error_t
+gcry_pk_hd_verify (gcry_pk_hd_t hd, gcry_sexp_t sigval, gcry_sexp_t data)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_pk_hd_verify (hd, sigval, data));
+}
+
 gcry_error_t
 gcry_pk_testkey (gcry_sexp_t key)
 {
@@ -1151,6 +1220,14 @@ gcry_md_read (gcry_md_hd_t hd, int algo)
   return _gcry_md_read (hd, algo);
 }
 
+gpg_error_t
+gcry_md_extract (gcry_md_hd_t hd, int algo, void *buffer, size_t length)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_md_extract (hd, algo, buffer, length));
+}
+
 void
 gcry_md_hash_buffer (int algo, void *digest,
                      const void *buffer, size_t length)
@@ -1175,6 +1252,19 @@ gcry_md_hash_buffers (int algo, unsigned int flags, void *digest,
   return gpg_error (_gcry_md_hash_buffers (algo, flags, digest, iov, iovcnt));
 }
 
+gpg_error_t
+gcry_md_hash_buffers_multi (int algo, unsigned int flags, void *digests,
+                            const gcry_buffer_t *iov, int iovcnt)
+{
+  if (!fips_is_operational ())
+    {
+      (void)fips_not_operational ();
+      fips_signal_error ("called in non-operational state");
+    }
+  return gpg_error (_gcry_md_hash_buffers_multi (algo, flags, digests,
+                                                 iov, iovcnt));
+}
+
 int
 gcry_md_get_algo (gcry_md_hd_t hd)
 {
@@ -1264,6 +1354,47 @@ gcry_kdf_derive (const void *passphrase, size_t passphraselen,
                                       keysize, keybuffer));
 }
 
+gcry_error_t
+gcry_kdf_open (gcry_kdf_hd_t *hd, int algo, int subalgo,
+               const unsigned long *param, unsigned int paramlen,
+               const void *passphrase, size_t passphraselen,
+               const void *salt, size_t saltlen,
+               const void *key, size_t keylen,
+               const void *ad, size_t adlen)
+{
+  if (!fips_is_operational ())
+    {
+      if (hd)
+        *hd = NULL;
+      return gpg_error (fips_not_operational ());
+    }
+  return gpg_error (_gcry_kdf_open (hd, algo, subalgo, param, paramlen,
+                                    passphrase, passphraselen,
+                                    salt, saltlen, key, keylen, ad, adlen));
+}
+
+gcry_error_t
+gcry_kdf_compute (gcry_kdf_hd_t h, const struct gcry_kdf_thread_ops *ops)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_kdf_compute (h, ops));
+}
+
+gcry_error_t
+gcry_kdf_final (gcry_kdf_hd_t h, size_t resultlen, void *result)
+{
+  if (!fips_is_operational ())
+    return gpg_error (fips_not_operational ());
+  return gpg_error (_gcry_kdf_final (h, resultlen, result));
+}
+
+void
+gcry_kdf_close (gcry_kdf_hd_t h)
+{
+  _gcry_kdf_close (h);
+}
+
 void
 gcry_randomize (void *buffer, size_t length, enum gcry_random_level level)
 {
@@ -99,11 +99,13 @@ MARK_VISIBLEX (gcry_md_close)
 MARK_VISIBLEX (gcry_md_copy)
 MARK_VISIBLEX (gcry_md_ctl)
 MARK_VISIBLEX (gcry_md_enable)
+MARK_VISIBLEX (gcry_md_extract)
 MARK_VISIBLEX (gcry_md_get)
 MARK_VISIBLEX (gcry_md_get_algo)
 MARK_VISIBLEX (gcry_md_get_algo_dlen)
 MARK_VISIBLEX (gcry_md_hash_buffer)
 MARK_VISIBLEX (gcry_md_hash_buffers)
+MARK_VISIBLEX (gcry_md_hash_buffers_multi)
 MARK_VISIBLEX (gcry_md_info)
 MARK_VISIBLEX (gcry_md_is_enabled)
 MARK_VISIBLEX (gcry_md_is_secure)
@@ -162,9 +164,20 @@ MARK_VISIBLEX (gcry_pk_map_name)
 MARK_VISIBLEX (gcry_pk_sign)
 MARK_VISIBLEX (gcry_pk_testkey)
 MARK_VISIBLEX (gcry_pk_verify)
+MARK_VISIBLEX (gcry_pk_verify_batch)
+MARK_VISIBLEX (gcry_pk_open)
+MARK_VISIBLEX (gcry_pk_close)
+MARK_VISIBLEX (gcry_pk_hd_encrypt)
+MARK_VISIBLEX (gcry_pk_hd_decrypt)
+MARK_VISIBLEX (gcry_pk_hd_sign)
+MARK_VISIBLEX (gcry_pk_hd_verify)
 MARK_VISIBLEX (gcry_pubkey_get_sexp)
 
 MARK_VISIBLEX (gcry_kdf_derive)
+MARK_VISIBLEX (gcry_kdf_open)
+MARK_VISIBLEX (gcry_kdf_compute)
+MARK_VISIBLEX (gcry_kdf_final)
+MARK_VISIBLEX (gcry_kdf_close)
 
 MARK_VISIBLEX (gcry_prime_check)
 MARK_VISIBLEX (gcry_prime_generate)
@@ -353,6 +366,13 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_pk_sign                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_testkey             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pk_verify              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_verify_batch        _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_open                _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_close               _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_hd_encrypt          _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_hd_decrypt          _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_hd_sign             _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_pk_hd_verify           _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_pubkey_get_sexp        _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_md_algo_info           _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -361,11 +381,13 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_md_copy                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_ctl                 _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_enable              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_md_extract             _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_get                 _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_get_algo            _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_get_algo_dlen       _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_hash_buffer         _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_hash_buffers        _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_md_hash_buffers_multi  _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_info                _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_is_enabled          _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_md_is_secure           _gcry_USE_THE_UNDERSCORED_FUNCTION
@@ -392,6 +414,10 @@ MARK_VISIBLEX (_gcry_mpi_get_const)
 #define gcry_mac_ctl                _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_kdf_derive             _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_open               _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_compute            _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_final              _gcry_USE_THE_UNDERSCORED_FUNCTION
+#define gcry_kdf_close              _gcry_USE_THE_UNDERSCORED_FUNCTION
 
 #define gcry_prime_check            _gcry_USE_THE_UNDERSCORED_FUNCTION
 #define gcry_prime_generate         _gcry_USE_THE_UNDERSCORED_FUNCTION
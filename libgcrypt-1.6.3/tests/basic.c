@@ -1528,6 +1528,80 @@ _check_gcm_cipher (unsigned int step)
 }
 
 
+/* Run a buffer of more than 1 MiB through GCM in odd sized chunks so
+   that the eight block bulk code is entered at different offsets.  */
+static void
+check_gcm_cipher_largebuf (void)
+{
+  static const unsigned char exptag[16] =
+    "\x30\xF0\x50\xA6\x40\xF9\x0E\x82\x83\x26\x67\x56\xB8\xFE\x90\x9C";
+  const size_t buflen = 1024 * 1024 + 33;
+  const size_t aadlen = 1024 * 1024 + 17;
+  const size_t chunk = 3 * 1024 + 5;
+  gcry_cipher_hd_t hd;
+  unsigned char key[32], iv[12], tag[16];
+  unsigned char *inbuf, *outbuf;
+  size_t pos, n;
+  int i;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  Starting GCM large buffer check.\n");
+
+  inbuf = gcry_xmalloc (buflen);
+  outbuf = gcry_xmalloc (buflen);
+  for (pos = 0; pos < buflen; pos++)
+    inbuf[pos] = pos * 7 + (pos >> 8);
+  for (i = 0; i < sizeof key; i++)
+    key[i] = 0x40 + i;
+  for (i = 0; i < sizeof iv; i++)
+    iv[i] = 0x50 + i;
+
+  err = gcry_cipher_open (&hd, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_GCM, 0);
+  if (!err)
+    err = gcry_cipher_setkey (hd, key, sizeof key);
+  if (!err)
+    err = gcry_cipher_setiv (hd, iv, sizeof iv);
+  if (!err)
+    err = gcry_cipher_authenticate (hd, inbuf, aadlen);
+  for (pos = 0; !err && pos < buflen; pos += n)
+    {
+      n = buflen - pos;
+      if (n > chunk)
+        n = chunk;
+      err = gcry_cipher_encrypt (hd, outbuf + pos, n, inbuf + pos, n);
+    }
+  if (!err)
+    err = gcry_cipher_gettag (hd, tag, sizeof tag);
+  if (err)
+    fail ("gcm-large, encryption failed: %s\n", gpg_strerror (err));
+  else if (memcmp (tag, exptag, sizeof exptag))
+    fail ("gcm-large, tag mismatch\n");
+
+  /* Decrypt in place in one go.  */
+  err = gcry_cipher_reset (hd);
+  if (!err)
+    err = gcry_cipher_setiv (hd, iv, sizeof iv);
+  if (!err)
+    err = gcry_cipher_authenticate (hd, inbuf, aadlen);
+  if (!err)
+    err = gcry_cipher_decrypt (hd, outbuf, buflen, NULL, 0);
+  if (!err)
+    err = gcry_cipher_checktag (hd, exptag, sizeof exptag);
+  if (err)
+    fail ("gcm-large, decryption failed: %s\n", gpg_strerror (err));
+  else if (memcmp (outbuf, inbuf, buflen))
+    fail ("gcm-large, decrypt mismatch\n");
+
+  gcry_cipher_close (hd);
+  gcry_free (inbuf);
+  gcry_free (outbuf);
+
+  if (verbose)
+    fprintf (stderr, "  Completed GCM large buffer check.\n");
+}
+
+
 static void
 check_gcm_cipher (void)
 {
@@ -1539,6 +1613,616 @@ check_gcm_cipher (void)
   _check_gcm_cipher(7);
   /* Split input to 16 byte buffers. */
   _check_gcm_cipher(16);
+
+  check_gcm_cipher_largebuf ();
+}
+
+
+#ifdef USE_CHACHA20
+static void
+_check_poly1305_cipher (unsigned int step)
+{
+  static const struct tv
+  {
+    int noncelen;
+    int aadlen;
+    int inlen;
+    const char *key;
+    const char *nonce;
+    const char *aad;
+    const char *plaintext;
+    const char *out;
+    const char *tag;
+  } tv[] =
+    {
+      /* RFC 7539, 2.8.2 */
+      { 12, 12, 114,
+        "\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f"
+        "\x90\x91\x92\x93\x94\x95\x96\x97\x98\x99\x9a\x9b\x9c\x9d\x9e\x9f",
+        "\x07\x00\x00\x00\x40\x41\x42\x43\x44\x45\x46\x47",
+        "\x50\x51\x52\x53\xc0\xc1\xc2\xc3\xc4\xc5\xc6\xc7",
+        "\x4c\x61\x64\x69\x65\x73\x20\x61\x6e\x64\x20\x47\x65\x6e\x74\x6c"
+        "\x65\x6d\x65\x6e\x20\x6f\x66\x20\x74\x68\x65\x20\x63\x6c\x61\x73"
+        "\x73\x20\x6f\x66\x20\x27\x39\x39\x3a\x20\x49\x66\x20\x49\x20\x63"
+        "\x6f\x75\x6c\x64\x20\x6f\x66\x66\x65\x72\x20\x79\x6f\x75\x20\x6f"
+        "\x6e\x6c\x79\x20\x6f\x6e\x65\x20\x74\x69\x70\x20\x66\x6f\x72\x20"
+        "\x74\x68\x65\x20\x66\x75\x74\x75\x72\x65\x2c\x20\x73\x75\x6e\x73"
+        "\x63\x72\x65\x65\x6e\x20\x77\x6f\x75\x6c\x64\x20\x62\x65\x20\x69"
+        "\x74\x2e",
+        "\xd3\x1a\x8d\x34\x64\x8e\x60\xdb\x7b\x86\xaf\xbc\x53\xef\x7e\xc2"
+        "\xa4\xad\xed\x51\x29\x6e\x08\xfe\xa9\xe2\xb5\xa7\x36\xee\x62\xd6"
+        "\x3d\xbe\xa4\x5e\x8c\xa9\x67\x12\x82\xfa\xfb\x69\xda\x92\x72\x8b"
+        "\x1a\x71\xde\x0a\x9e\x06\x0b\x29\x05\xd6\xa5\xb6\x7e\xcd\x3b\x36"
+        "\x92\xdd\xbd\x7f\x2d\x77\x8b\x8c\x98\x03\xae\xe3\x28\x09\x1b\x58"
+        "\xfa\xb3\x24\xe4\xfa\xd6\x75\x94\x55\x85\x80\x8b\x48\x31\xd7\xbc"
+        "\x3f\xf4\xde\xf0\x8e\x4b\x7a\x9d\xe5\x76\xd2\x65\x86\xce\xc6\x4b"
+        "\x61\x16",
+        "\x1a\xe1\x0b\x59\x4f\x09\xe2\x6a\x7e\x90\x2e\xcb\xd0\x60\x06\x91" },
+      /* 64 bit nonce, data spanning several ChaCha20 blocks.  */
+      { 8, 0, 130,
+        "\x20\x21\x22\x23\x24\x25\x26\x27\x28\x29\x2a\x2b\x2c\x2d\x2e\x2f"
+        "\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39\x3a\x3b\x3c\x3d\x3e\x3f",
+        "\x01\x02\x03\x04\x05\x06\x07\x08",
+        "",
+        "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+        "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
+        "\x20\x21\x22\x23\x24\x25\x26\x27\x28\x29\x2a\x2b\x2c\x2d\x2e\x2f"
+        "\x30\x31\x32\x33\x34\x35\x36\x37\x38\x39\x3a\x3b\x3c\x3d\x3e\x3f"
+        "\x40\x41\x42\x43\x44\x45\x46\x47\x48\x49\x4a\x4b\x4c\x4d\x4e\x4f"
+        "\x50\x51\x52\x53\x54\x55\x56\x57\x58\x59\x5a\x5b\x5c\x5d\x5e\x5f"
+        "\x60\x61\x62\x63\x64\x65\x66\x67\x68\x69\x6a\x6b\x6c\x6d\x6e\x6f"
+        "\x70\x71\x72\x73\x74\x75\x76\x77\x78\x79\x7a\x7b\x7c\x7d\x7e\x7f"
+        "\x80\x81",
+        "\xdb\x83\x66\xf8\x8e\xb0\xec\x89\x19\xf8\x1e\x6c\xb4\xc3\x19\xb1"
+        "\xfc\x40\x7d\x85\x22\x99\x90\xa0\x20\x56\x2c\xbb\x35\xed\xf5\xe7"
+        "\x07\xa9\xba\x28\xe4\x04\xc9\x6a\x24\x91\xca\x74\xb8\xaf\xd9\xcb"
+        "\x5f\xf1\xf1\x1a\xc2\xfa\x1b\xd8\x2e\x7f\x41\x33\xca\x1f\x2e\x8d"
+        "\xe7\xe2\xfd\x89\xe7\x1c\x1d\xbb\x82\xa2\xfa\xfc\x7b\x3d\x38\x97"
+        "\xde\xb0\xc8\x03\x38\x8c\x47\x96\xf9\xda\xb6\x77\x33\x41\xf4\x10"
+        "\xeb\x44\xd3\x18\x3d\x1b\xad\x60\x5b\xed\x50\xbf\xc2\xe5\x1e\xa7"
+        "\x45\xab\x6a\x36\xcf\x4f\xd4\xf2\x8a\xe2\x29\x49\x09\xff\x02\xa2"
+        "\x77\xcc",
+        "\xa1\x73\x5f\x20\xbd\x87\x2d\x0a\xf2\x32\x75\x02\xdc\xc3\xe1\xcf" },
+      /* AAD only.  */
+      { 12, 17, 0,
+        "\x40\x41\x42\x43\x44\x45\x46\x47\x48\x49\x4a\x4b\x4c\x4d\x4e\x4f"
+        "\x50\x51\x52\x53\x54\x55\x56\x57\x58\x59\x5a\x5b\x5c\x5d\x5e\x5f",
+        "\x00\x00\x00\x00\x01\x02\x03\x04\x05\x06\x07\x08",
+        "\xa0\xa1\xa2\xa3\xa4\xa5\xa6\xa7\xa8\xa9\xaa\xab\xac\xad\xae\xaf"
+        "\xb0",
+        "",
+        "",
+        "\xe3\xd0\x6a\x1c\x27\x2e\x1d\x17\xf8\xcc\x96\xf0\x8c\xc7\xf3\x1f" },
+    };
+  gcry_cipher_hd_t hde, hdd;
+  unsigned char out[256];
+  unsigned char tag[16];
+  int i;
+  size_t pos, poslen;
+  gcry_error_t err = 0;
+
+  if (verbose)
+    fprintf (stderr, "  Starting POLY1305 checks (step %u).\n", step);
+
+  for (i = 0; i < sizeof (tv) / sizeof (tv[0]); i++)
+    {
+      if (verbose)
+        fprintf (stderr, "    checking POLY1305 mode for %s [%i]\n",
+                 gcry_cipher_algo_name (GCRY_CIPHER_CHACHA20),
+                 GCRY_CIPHER_CHACHA20);
+      err = gcry_cipher_open (&hde, GCRY_CIPHER_CHACHA20,
+                              GCRY_CIPHER_MODE_POLY1305, 0);
+      if (!err)
+        err = gcry_cipher_open (&hdd, GCRY_CIPHER_CHACHA20,
+                                GCRY_CIPHER_MODE_POLY1305, 0);
+      if (err)
+        {
+          fail ("poly1305, gcry_cipher_open failed: %s\n", gpg_strerror (err));
+          return;
+        }
+
+      err = gcry_cipher_setkey (hde, tv[i].key, 32);
+      if (!err)
+        err = gcry_cipher_setkey (hdd, tv[i].key, 32);
+      if (!err)
+        err = gcry_cipher_setiv (hde, tv[i].nonce, tv[i].noncelen);
+      if (!err)
+        err = gcry_cipher_setiv (hdd, tv[i].nonce, tv[i].noncelen);
+      if (err)
+        {
+          fail ("poly1305, gcry_cipher_setkey/setiv failed: %s\n",
+                gpg_strerror (err));
+          goto leave;
+        }
+
+      for (pos = 0; pos < tv[i].aadlen; pos += step)
+        {
+          poslen = (pos + step < tv[i].aadlen) ? step : tv[i].aadlen - pos;
+
+          err = gcry_cipher_authenticate (hde, tv[i].aad + pos, poslen);
+          if (!err)
+            err = gcry_cipher_authenticate (hdd, tv[i].aad + pos, poslen);
+          if (err)
+            {
+              fail ("poly1305, gcry_cipher_authenticate (%d) (%d:%d) failed: "
+                    "%s\n", i, pos, step, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      for (pos = 0; pos < tv[i].inlen; pos += step)
+        {
+          poslen = (pos + step < tv[i].inlen) ? step : tv[i].inlen - pos;
+
+          err = gcry_cipher_encrypt (hde, out + pos, poslen,
+                                     tv[i].plaintext + pos, poslen);
+          if (err)
+            {
+              fail ("poly1305, gcry_cipher_encrypt (%d) (%d:%d) failed: %s\n",
+                    i, pos, step, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      if (memcmp (tv[i].out, out, tv[i].inlen))
+        fail ("poly1305, encrypt mismatch entry %d (step %d)\n", i, step);
+
+      err = gcry_cipher_gettag (hde, tag, sizeof tag);
+      if (err)
+        {
+          fail ("poly1305, gcry_cipher_gettag (%d) failed: %s\n",
+                i, gpg_strerror (err));
+          goto leave;
+        }
+
+      if (memcmp (tv[i].tag, tag, sizeof tag))
+        fail ("poly1305, encrypt tag mismatch entry %d (step %d)\n", i, step);
+
+      for (pos = 0; pos < tv[i].inlen; pos += step)
+        {
+          poslen = (pos + step < tv[i].inlen) ? step : tv[i].inlen - pos;
+
+          err = gcry_cipher_decrypt (hdd, out + pos, poslen, NULL, 0);
+          if (err)
+            {
+              fail ("poly1305, gcry_cipher_decrypt (%d) (%d:%d) failed: %s\n",
+                    i, pos, step, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      if (memcmp (tv[i].plaintext, out, tv[i].inlen))
+        fail ("poly1305, decrypt mismatch entry %d (step %d)\n", i, step);
+
+      err = gcry_cipher_checktag (hdd, tv[i].tag, 16);
+      if (err)
+        fail ("poly1305, gcry_cipher_checktag (%d) failed: %s\n",
+              i, gpg_strerror (err));
+
+      /* Once the tag has been computed no more data is accepted.  */
+      err = gcry_cipher_encrypt (hde, out, 1, tv[i].plaintext, 1);
+      if (gpg_err_code (err) != GPG_ERR_INV_STATE)
+        fail ("poly1305, encrypt after gettag (%d) did not fail as "
+              "expected: %s\n", i, gpg_strerror (err));
+
+      /* A modified tag must be rejected.  */
+      err = gcry_cipher_reset (hdd);
+      if (!err)
+        err = gcry_cipher_setiv (hdd, tv[i].nonce, tv[i].noncelen);
+      if (!err)
+        err = gcry_cipher_authenticate (hdd, tv[i].aad, tv[i].aadlen);
+      if (!err)
+        err = gcry_cipher_decrypt (hdd, out, tv[i].inlen,
+                                   tv[i].out, tv[i].inlen);
+      if (err)
+        {
+          fail ("poly1305, re-decrypt (%d) failed: %s\n",
+                i, gpg_strerror (err));
+          goto leave;
+        }
+      memcpy (tag, tv[i].tag, sizeof tag);
+      tag[0] ^= 1;
+      err = gcry_cipher_checktag (hdd, tag, sizeof tag);
+      if (gpg_err_code (err) != GPG_ERR_CHECKSUM)
+        fail ("poly1305, gcry_cipher_checktag (%d) did not detect a "
+              "modified tag: %s\n", i, gpg_strerror (err));
+
+    leave:
+      gcry_cipher_close (hde);
+      gcry_cipher_close (hdd);
+    }
+  if (verbose)
+    fprintf (stderr, "  Completed POLY1305 checks.\n");
+}
+#endif /*USE_CHACHA20*/
+
+
+static void
+check_poly1305_cipher (void)
+{
+#ifdef USE_CHACHA20
+  /* Large buffers, no splitting. */
+  _check_poly1305_cipher (0xffffffff);
+  /* Split input to one byte buffers. */
+  _check_poly1305_cipher (1);
+  /* Split input to 7 byte buffers. */
+  _check_poly1305_cipher (7);
+  /* Split input to 16 byte buffers. */
+  _check_poly1305_cipher (16);
+  /* Split input to 64 byte buffers. */
+  _check_poly1305_cipher (64);
+#endif /*USE_CHACHA20*/
+}
+
+
+static void
+_check_ocb_cipher (unsigned int step)
+{
+  /* Test vectors from RFC 7253, Appendix A.  The key is 000102..0F,
+     the nonce BBAA99887766554433221100 with the last byte replaced
+     by NONCE_LAST and the associated data and the plaintext are the
+     first AADLEN resp. INLEN bytes of 000102..27.  */
+  static const struct tv
+  {
+    int nonce_last;
+    int aadlen;
+    int inlen;
+    const char *ciph;
+    const char *tag;
+  } tv[] =
+    {
+      { 0x00, 0, 0,
+        "",
+        "\x78\x54\x07\xBF\xFF\xC8\xAD\x9E\xDC\xC5\x52\x0A\xC9\x11\x1E\xE6" },
+      { 0x01, 8, 8,
+        "\x68\x20\xB3\x65\x7B\x6F\x61\x5A",
+        "\x57\x25\xBD\xA0\xD3\xB4\xEB\x3A\x25\x7C\x9A\xF1\xF8\xF0\x30\x09" },
+      { 0x02, 8, 0,
+        "",
+        "\x81\x01\x7F\x82\x03\xF0\x81\x27\x71\x52\xFA\xDE\x69\x4A\x0A\x00" },
+      { 0x03, 0, 8,
+        "\x45\xDD\x69\xF8\xF5\xAA\xE7\x24",
+        "\x14\x05\x4C\xD1\xF3\x5D\x82\x76\x0B\x2C\xD0\x0D\x2F\x99\xBF\xA9" },
+      { 0x04, 16, 16,
+        "\x57\x1D\x53\x5B\x60\xB2\x77\x18\x8B\xE5\x14\x71\x70\xA9\xA2\x2C",
+        "\x3A\xD7\xA4\xFF\x38\x35\xB8\xC5\x70\x1C\x1C\xCE\xC8\xFC\x33\x58" },
+      { 0x07, 24, 24,
+        "\x1C\xA2\x20\x73\x08\xC8\x7C\x01\x07\x56\x10\x4D\x88\x40\xCE\x19"
+        "\x52\xF0\x96\x73\xA4\x48\xA1\x22",
+        "\xC9\x2C\x62\x24\x10\x51\xF5\x73\x56\xD7\xF3\xC9\x0B\xB0\xE0\x7F" },
+      { 0x0A, 32, 32,
+        "\xBD\x6F\x6C\x49\x62\x01\xC6\x92\x96\xC1\x1E\xFD\x13\x8A\x46\x7A"
+        "\xBD\x3C\x70\x79\x24\xB9\x64\xDE\xAF\xFC\x40\x31\x9A\xF5\xA4\x85",
+        "\x40\xFB\xBA\x18\x6C\x55\x53\xC6\x8A\xD9\xF5\x92\xA7\x9A\x42\x40" },
+      { 0x0D, 40, 40,
+        "\xD5\xCA\x91\x74\x84\x10\xC1\x75\x1F\xF8\xA2\xF6\x18\x25\x5B\x68"
+        "\xA0\xA1\x2E\x09\x3F\xF4\x54\x60\x6E\x59\xF9\xC1\xD0\xDD\xC5\x4B"
+        "\x65\xE8\x62\x8E\x56\x8B\xAD\x7A",
+        "\xED\x07\xBA\x06\xA4\xA6\x94\x83\xA7\x03\x54\x90\xC5\x76\x9E\x60" },
+      { 0x0E, 40, 0,
+        "",
+        "\xC5\xCD\x9D\x18\x50\xC1\x41\xE3\x58\x64\x99\x94\xEE\x70\x1B\x68" },
+      { 0x0F, 0, 40,
+        "\x44\x12\x92\x34\x93\xC5\x7D\x5D\xE0\xD7\x00\xF7\x53\xCC\xE0\xD1"
+        "\xD2\xD9\x50\x60\x12\x2E\x9F\x15\xA5\xDD\xBF\xC5\x78\x7E\x50\xB5"
+        "\xCC\x55\xEE\x50\x7B\xCB\x08\x4E",
+        "\x47\x9A\xD3\x63\xAC\x36\x6B\x95\xA9\x8C\xA5\xF3\x00\x0B\x14\x79" },
+    };
+  gcry_cipher_hd_t hde, hdd;
+  unsigned char key[16], nonce[12], data[40];
+  unsigned char out[40];
+  unsigned char tag[16];
+  unsigned int dstep;
+  int i;
+  size_t pos, poslen;
+  gcry_error_t err = 0;
+
+  if (verbose)
+    fprintf (stderr, "  Starting OCB checks (step %u).\n", step);
+
+  for (i = 0; i < sizeof key; i++)
+    key[i] = i;
+  for (i = 0; i < sizeof data; i++)
+    data[i] = i;
+  memcpy (nonce, "\xBB\xAA\x99\x88\x77\x66\x55\x44\x33\x22\x11\x00", 12);
+
+  /* Only the last call may process a partial block.  */
+  dstep = step < 16 ? 16 : (step & ~15);
+
+  for (i = 0; i < sizeof (tv) / sizeof (tv[0]); i++)
+    {
+      nonce[11] = tv[i].nonce_last;
+
+      err = gcry_cipher_open (&hde, GCRY_CIPHER_AES128,
+                              GCRY_CIPHER_MODE_OCB, 0);
+      if (!err)
+        err = gcry_cipher_open (&hdd, GCRY_CIPHER_AES128,
+                                GCRY_CIPHER_MODE_OCB, 0);
+      if (err)
+        {
+          fail ("ocb, gcry_cipher_open failed: %s\n", gpg_strerror (err));
+          return;
+        }
+
+      err = gcry_cipher_setkey (hde, key, sizeof key);
+      if (!err)
+        err = gcry_cipher_setkey (hdd, key, sizeof key);
+      if (!err)
+        err = gcry_cipher_setiv (hde, nonce, sizeof nonce);
+      if (!err)
+        err = gcry_cipher_setiv (hdd, nonce, sizeof nonce);
+      if (err)
+        {
+          fail ("ocb, gcry_cipher_setkey/setiv failed: %s\n",
+                gpg_strerror (err));
+          goto leave;
+        }
+
+      for (pos = 0; pos < tv[i].aadlen; pos += step)
+        {
+          poslen = (pos + step < tv[i].aadlen) ? step : tv[i].aadlen - pos;
+
+          err = gcry_cipher_authenticate (hde, data + pos, poslen);
+          if (!err)
+            err = gcry_cipher_authenticate (hdd, data + pos, poslen);
+          if (err)
+            {
+              fail ("ocb, gcry_cipher_authenticate (%d) (%d:%d) failed: "
+                    "%s\n", i, (int)pos, step, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      for (pos = 0; pos < tv[i].inlen; pos += dstep)
+        {
+          if (pos + dstep < tv[i].inlen)
+            poslen = dstep;
+          else
+            {
+              poslen = tv[i].inlen - pos;
+              gcry_cipher_final (hde);
+            }
+
+          err = gcry_cipher_encrypt (hde, out + pos, poslen,
+                                     data + pos, poslen);
+          if (err)
+            {
+              fail ("ocb, gcry_cipher_encrypt (%d) (%d:%d) failed: %s\n",
+                    i, (int)pos, dstep, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      if (memcmp (tv[i].ciph, out, tv[i].inlen))
+        fail ("ocb, encrypt mismatch entry %d (step %d)\n", i, step);
+
+      err = gcry_cipher_gettag (hde, tag, sizeof tag);
+      if (err)
+        {
+          fail ("ocb, gcry_cipher_gettag (%d) failed: %s\n",
+                i, gpg_strerror (err));
+          goto leave;
+        }
+
+      if (memcmp (tv[i].tag, tag, sizeof tag))
+        fail ("ocb, encrypt tag mismatch entry %d (step %d)\n", i, step);
+
+      for (pos = 0; pos < tv[i].inlen; pos += dstep)
+        {
+          if (pos + dstep < tv[i].inlen)
+            poslen = dstep;
+          else
+            {
+              poslen = tv[i].inlen - pos;
+              gcry_cipher_final (hdd);
+            }
+
+          err = gcry_cipher_decrypt (hdd, out + pos, poslen, NULL, 0);
+          if (err)
+            {
+              fail ("ocb, gcry_cipher_decrypt (%d) (%d:%d) failed: %s\n",
+                    i, (int)pos, dstep, gpg_strerror (err));
+              goto leave;
+            }
+        }
+
+      if (memcmp (data, out, tv[i].inlen))
+        fail ("ocb, decrypt mismatch entry %d (step %d)\n", i, step);
+
+      err = gcry_cipher_checktag (hdd, tv[i].tag, 16);
+      if (err)
+        fail ("ocb, gcry_cipher_checktag (%d) failed: %s\n",
+              i, gpg_strerror (err));
+
+      /* Once the tag has been computed no more data is accepted.  */
+      err = gcry_cipher_encrypt (hde, out, 16, data, 16);
+      if (gpg_err_code (err) != GPG_ERR_INV_STATE)
+        fail ("ocb, encrypt after gettag (%d) did not fail as "
+              "expected: %s\n", i, gpg_strerror (err));
+
+      /* A modified or truncated tag must be rejected.  */
+      memcpy (tag, tv[i].tag, sizeof tag);
+      err = gcry_cipher_checktag (hdd, tag, 12);
+      if (gpg_err_code (err) != GPG_ERR_CHECKSUM)
+        fail ("ocb, gcry_cipher_checktag (%d) did not detect a "
+              "truncated tag: %s\n", i, gpg_strerror (err));
+      tag[0] ^= 1;
+      err = gcry_cipher_checktag (hdd, tag, sizeof tag);
+      if (gpg_err_code (err) != GPG_ERR_CHECKSUM)
+        fail ("ocb, gcry_cipher_checktag (%d) did not detect a "
+              "modified tag: %s\n", i, gpg_strerror (err));
+
+    leave:
+      gcry_cipher_close (hde);
+      gcry_cipher_close (hdd);
+    }
+  if (verbose)
+    fprintf (stderr, "  Completed OCB checks.\n");
+}
+
+
+/* Check OCB with a 96 bit tag (RFC 7253, Appendix A, last vector).  */
+static void
+check_ocb_cipher_taglen96 (void)
+{
+  static const unsigned char ciph[40] =
+    "\x17\x92\xA4\xE3\x1E\x07\x55\xFB\x03\xE3\x1B\x22\x11\x6E\x6C\x2D"
+    "\xDF\x9E\xFD\x6E\x33\xD5\x36\xF1\xA0\x12\x4B\x0A\x55\xBA\xE8\x84"
+    "\xED\x93\x48\x15\x29\xC7\x6B\x6A";
+  static const unsigned char exptag[12] =
+    "\xD0\xC5\x15\xF4\xD1\xCD\xD4\xFD\xAC\x4F\x02\xAA";
+  gcry_cipher_hd_t hd;
+  unsigned char key[16], data[40], out[40], tag[16];
+  int i, taglen;
+  gcry_error_t err;
+
+  for (i = 0; i < sizeof key; i++)
+    key[i] = 15 - i;
+  for (i = 0; i < sizeof data; i++)
+    data[i] = i;
+
+  err = gcry_cipher_open (&hd, GCRY_CIPHER_AES128, GCRY_CIPHER_MODE_OCB, 0);
+  if (err)
+    {
+      fail ("ocb-96, gcry_cipher_open failed: %s\n", gpg_strerror (err));
+      return;
+    }
+
+  /* Only 64, 96 and 128 bit tags are allowed.  */
+  taglen = 10;
+  err = gcry_cipher_ctl (hd, GCRYCTL_SET_TAGLEN, &taglen, sizeof taglen);
+  if (gpg_err_code (err) != GPG_ERR_INV_LENGTH)
+    fail ("ocb-96, invalid tag length not detected: %s\n",
+          gpg_strerror (err));
+
+  taglen = 12;
+  err = gcry_cipher_ctl (hd, GCRYCTL_SET_TAGLEN, &taglen, sizeof taglen);
+  if (!err)
+    err = gcry_cipher_setkey (hd, key, sizeof key);
+  if (!err)
+    err = gcry_cipher_setiv (hd, "\xBB\xAA\x99\x88\x77\x66\x55\x44"
+                             "\x33\x22\x11\x0D", 12);
+  if (!err)
+    err = gcry_cipher_authenticate (hd, data, sizeof data);
+  if (!err)
+    err = gcry_cipher_final (hd);
+  if (!err)
+    err = gcry_cipher_encrypt (hd, out, sizeof out, data, sizeof data);
+  if (!err)
+    err = gcry_cipher_gettag (hd, tag, sizeof tag);
+  if (err)
+    {
+      fail ("ocb-96, encryption failed: %s\n", gpg_strerror (err));
+      goto leave;
+    }
+  if (memcmp (out, ciph, sizeof ciph))
+    fail ("ocb-96, encrypt mismatch\n");
+  if (memcmp (tag, exptag, sizeof exptag))
+    fail ("ocb-96, tag mismatch\n");
+
+  err = gcry_cipher_checktag (hd, exptag, sizeof exptag);
+  if (err)
+    fail ("ocb-96, gcry_cipher_checktag failed: %s\n", gpg_strerror (err));
+
+ leave:
+  gcry_cipher_close (hd);
+}
+
+
+/* Check OCB with more than 2^16 blocks so that the L values beyond
+   the pre-computed table are used.  */
+static void
+check_ocb_cipher_largebuf (void)
+{
+  static const unsigned char exptag[16] =
+    "\x5E\x33\x99\x27\x2F\xCA\xE4\xE0\x1E\x2F\x14\xAC\x83\xFD\xBC\x6E";
+  const size_t buflen = 1024 * 1024 + 33;
+  const size_t aadlen = 1024 * 1024 + 17;
+  const size_t chunk = 3 * 1024;
+  gcry_cipher_hd_t hd;
+  unsigned char key[32], nonce[12], tag[16];
+  unsigned char *inbuf, *outbuf;
+  size_t pos, n;
+  int i;
+  gcry_error_t err;
+
+  if (verbose)
+    fprintf (stderr, "  Starting OCB large buffer check.\n");
+
+  inbuf = gcry_xmalloc (buflen);
+  outbuf = gcry_xmalloc (buflen);
+  for (pos = 0; pos < buflen; pos++)
+    inbuf[pos] = pos * 7 + (pos >> 8);
+  for (i = 0; i < sizeof key; i++)
+    key[i] = 0x40 + i;
+  for (i = 0; i < sizeof nonce; i++)
+    nonce[i] = 0x50 + i;
+
+  err = gcry_cipher_open (&hd, GCRY_CIPHER_AES256, GCRY_CIPHER_MODE_OCB, 0);
+  if (!err)
+    err = gcry_cipher_setkey (hd, key, sizeof key);
+  if (!err)
+    err = gcry_cipher_setiv (hd, nonce, sizeof nonce);
+  if (!err)
+    err = gcry_cipher_authenticate (hd, inbuf, aadlen);
+  for (pos = 0; !err && pos < buflen; pos += n)
+    {
+      n = buflen - pos;
+      if (n > chunk)
+        n = chunk;
+      else
+        gcry_cipher_final (hd);
+      err = gcry_cipher_encrypt (hd, outbuf + pos, n, inbuf + pos, n);
+    }
+  if (!err)
+    err = gcry_cipher_gettag (hd, tag, sizeof tag);
+  if (err)
+    fail ("ocb-large, encryption failed: %s\n", gpg_strerror (err));
+  else if (memcmp (tag, exptag, sizeof exptag))
+    fail ("ocb-large, tag mismatch\n");
+
+  /* Decrypt in place in one go.  */
+  err = gcry_cipher_reset (hd);
+  if (!err)
+    err = gcry_cipher_setiv (hd, nonce, sizeof nonce);
+  if (!err)
+    err = gcry_cipher_authenticate (hd, inbuf, aadlen);
+  if (!err)
+    err = gcry_cipher_final (hd);
+  if (!err)
+    err = gcry_cipher_decrypt (hd, outbuf, buflen, NULL, 0);
+  if (!err)
+    err = gcry_cipher_checktag (hd, exptag, sizeof exptag);
+  if (err)
+    fail ("ocb-large, decryption failed: %s\n", gpg_strerror (err));
+  else if (memcmp (outbuf, inbuf, buflen))
+    fail ("ocb-large, decrypt mismatch\n");
+
+  gcry_cipher_close (hd);
+  gcry_free (inbuf);
+  gcry_free (outbuf);
+
+  if (verbose)
+    fprintf (stderr, "  Completed OCB large buffer check.\n");
+}
+
+
+static void
+check_ocb_cipher (void)
+{
+  /* Large buffers, no splitting. */
+  _check_ocb_cipher (0xffffffff);
+  /* Split input to one byte buffers. */
+  _check_ocb_cipher (1);
+  /* Split input to 7 byte buffers. */
+  _check_ocb_cipher (7);
+  /* Split input to 16 byte buffers. */
+  _check_ocb_cipher (16);
+  /* Split input to 32 byte buffers. */
+  _check_ocb_cipher (32);
+
+  check_ocb_cipher_taglen96 ();
+  check_ocb_cipher_largebuf ();
 }
 
 
@@ -2506,8 +3190,138 @@ check_stream_cipher (void)
           "\x44\xC9\x70\x0A\x0F\x21\x38\xE8\xC1\xA2\x86\xFB\x8C\x1F\xBF\xA0"
         }
       }
-    }
+    },
 #endif /*USE_SALSA20*/
+#ifdef USE_CHACHA20
+    {
+      "ChaCha20 256 bit, IV 64 bit, test 1",
+      GCRY_CIPHER_CHACHA20, 32, 8,
+      "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+      "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+      "\x00\x00\x00\x00\x00\x00\x00\x00",
+      {
+        { 8,
+          "\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\x76\xB8\xE0\xAD\xA0\xF1\x3D\x90"
+        },
+        { 64,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\x76\xB8\xE0\xAD\xA0\xF1\x3D\x90\x40\x5D\x6A\xE5\x53\x86\xBD\x28"
+          "\xBD\xD2\x19\xB8\xA0\x8D\xED\x1A\xA8\x36\xEF\xCC\x8B\x77\x0D\xC7"
+          "\xDA\x41\x59\x7C\x51\x57\x48\x8D\x77\x24\xE0\x3F\xB8\xD8\x4A\x37"
+          "\x6A\x43\xB8\xF4\x15\x18\xA1\x1C\xC3\x87\xB6\x69\xB2\xEE\x65\x86"
+        }
+      }
+    },
+    {
+      "ChaCha20 256 bit, IV 64 bit, test 2",
+      GCRY_CIPHER_CHACHA20, 32, 8,
+      "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF"
+      "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+      "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+      {
+        { 8,
+          "\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\xD9\xBF\x3F\x6B\xCE\x6E\xD0\xB5"
+        },
+        { 64,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\xD9\xBF\x3F\x6B\xCE\x6E\xD0\xB5\x42\x54\x55\x77\x67\xFB\x57\x44"
+          "\x3D\xD4\x77\x89\x11\xB6\x06\x05\x5C\x39\xCC\x25\xE6\x74\xB8\x36"
+          "\x3F\xEA\xBC\x57\xFD\xE5\x4F\x79\x0C\x52\xC8\xAE\x43\x24\x0B\x79"
+          "\xD4\x90\x42\xB7\x77\xBF\xD6\xCB\x80\xE9\x31\x27\x0B\x7F\x50\xEB"
+        }
+      }
+    },
+    {
+      "ChaCha20 256 bit, IV 64 bit, test 3",
+      GCRY_CIPHER_CHACHA20, 32, 8,
+      "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A\x0B\x0C\x0D\x0E\x0F"
+      "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1A\x1B\x1C\x1D\x1E\x1F",
+      "\x00\x01\x02\x03\x04\x05\x06\x07",
+      {
+        { 64,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\xF7\x98\xA1\x89\xF1\x95\xE6\x69\x82\x10\x5F\xFB\x64\x0B\xB7\x75"
+          "\x7F\x57\x9D\xA3\x16\x02\xFC\x93\xEC\x01\xAC\x56\xF8\x5A\xC3\xC1"
+          "\x34\xA4\x54\x7B\x73\x3B\x46\x41\x30\x42\xC9\x44\x00\x49\x17\x69"
+          "\x05\xD3\xBE\x59\xEA\x1C\x53\xF1\x59\x16\x15\x5C\x2B\xE8\x24\x1A"
+        },
+        { 100,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00",
+          "\xF7\x98\xA1\x89\xF1\x95\xE6\x69\x82\x10\x5F\xFB\x64\x0B\xB7\x75"
+          "\x7F\x57\x9D\xA3\x16\x02\xFC\x93\xEC\x01\xAC\x56\xF8\x5A\xC3\xC1"
+          "\x34\xA4\x54\x7B\x73\x3B\x46\x41\x30\x42\xC9\x44\x00\x49\x17\x69"
+          "\x05\xD3\xBE\x59\xEA\x1C\x53\xF1\x59\x16\x15\x5C\x2B\xE8\x24\x1A"
+          "\x38\x00\x8B\x9A\x26\xBC\x35\x94\x1E\x24\x44\x17\x7C\x8A\xDE\x66"
+          "\x89\xDE\x95\x26\x49\x86\xD9\x58\x89\xFB\x60\xE8\x46\x29\xC9\xBD"
+          "\x9A\x5A\xCB\x1C"
+        }
+      }
+    },
+    {
+      "ChaCha20 128 bit, IV 64 bit, test 1",
+      GCRY_CIPHER_CHACHA20, 16, 8,
+      "\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99\xAA\xBB\xCC\xDD\xEE\xFF",
+      "\x0F\x1E\x2D\x3C\x4B\x5A\x69\x78",
+      {
+        { 64,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\xD1\xAB\xF6\x30\x46\x7E\xB4\xF6\x7F\x1C\xFB\x47\xCD\x62\x6A\xAE"
+          "\x8A\xFE\xDB\xBE\x4F\xF8\xFC\x5F\xE9\xCF\xAE\x30\x7E\x74\xED\x45"
+          "\x1F\x14\x04\x42\x5A\xD2\xB5\x45\x69\xD5\xF1\x81\x48\x93\x99\x71"
+          "\xAB\xB8\xFA\xFC\x88\xCE\x4A\xC7\xFE\x1C\x3D\x1F\x7A\x1E\xB7\xCA"
+        }
+      }
+    },
+    {
+      "ChaCha20 256 bit, IV 96 bit, test 1",
+      GCRY_CIPHER_CHACHA20, 32, 12,
+      "\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99\xAA\xBB\xCC\xDD\xEE\xFF"
+      "\x0F\x1E\x2D\x3C\x4B\x5A\x69\x78\x87\x96\xA5\xB4\xC3\xD2\xE1\xF0",
+      "\x00\x00\x00\x00\x00\x00\x00\x00\x4A\x00\x00\x00",
+      {
+        { 16,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+          "\x78\x1C\xF0\x4F\xCE\x66\x47\x8A\x21\x98\xCB\xE1\x25\x97\x17\xCF"
+        },
+        { 100,
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+          "\x00\x00\x00\x00",
+          "\x78\x1C\xF0\x4F\xCE\x66\x47\x8A\x21\x98\xCB\xE1\x25\x97\x17\xCF"
+          "\x0C\xE7\xFD\xA1\x22\x13\x62\xD7\x9B\xFE\x5A\x4F\x73\x87\xFC\x31"
+          "\xCE\xF6\xC5\x39\xDE\x76\x74\xEF\xD6\x1B\xAC\xF4\x37\x5A\xDB\xAA"
+          "\xB8\xAA\xC1\x95\xE2\xC0\x17\x20\x20\x49\x5B\xE6\x6F\xEF\x70\x3F"
+          "\x2A\x7B\x0A\xC5\x84\xB4\x5F\x3B\x0F\xB8\xF4\x55\x9B\xF7\x0A\xD3"
+          "\x62\xC2\xDE\xA8\xE0\x40\xE3\x64\x98\xEC\xDF\xF3\xFD\x50\xC7\x23"
+          "\xCC\xE5\x00\x98"
+        }
+      }
+    }
+#endif /*USE_CHACHA20*/
   };
 
   gcry_cipher_hd_t hde, hdd;
@@ -2940,8 +3754,43 @@ check_stream_cipher_large_block (void)
           "\xD8\x68\x67\x15\x35\x5C\x5A\x5C\xC5\x91\x96\x3A\x75\xE9\x94\xB4"
         }
       }
-    }
+    },
 #endif /*USE_SALSA20*/
+#ifdef USE_CHACHA20
+    {
+      "ChaCha20 256 bit, IV 64 bit, large block test",
+      GCRY_CIPHER_CHACHA20, 32, 8,
+      "\x00\x53\xA6\xF9\x4C\x9F\xF2\x45\x98\xEB\x3E\x91\xE4\x37\x8A\xDD"
+      "\x30\x83\xD6\x29\x7C\xCF\x22\x75\xC8\x1B\x6E\xC1\x14\x67\xBA\x0D",
+      "\x0D\x74\xDB\x42\xA9\x10\x77\xDE",
+      {
+        { 0, 64,
+          "\x57\x45\x99\x75\xBC\x46\x79\x93\x94\x78\x8D\xE8\x0B\x92\x83\x87"
+          "\x86\x29\x85\xA2\x69\xB9\xE8\xE7\x78\x01\xDE\x9D\x87\x4B\x3F\x51"
+          "\xAC\x46\x10\xB9\xF9\xBE\xE8\xCF\x8C\xAC\xD8\xB5\xAD\x0B\xF1\x7D"
+          "\x3D\xDF\x23\xFD\x74\x24\x88\x7E\xB3\xF8\x14\x05\xBD\x49\x8C\xC3"
+        },
+        { 65472, 64,
+          "\xEF\x9A\xEC\x58\xAC\xE7\xDB\x42\x7D\xF0\x12\xB2\xB9\x1A\x0C\x1E"
+          "\x8E\x47\x59\xDC\xE9\xCD\xB0\x0A\x2B\xD5\x92\x07\x35\x7B\xA0\x6C"
+          "\xE0\x2D\x32\x7C\x77\x19\xE8\x3D\x63\x48\xA6\x10\x4B\x08\x1D\xB0"
+          "\x39\x08\xE5\x18\x69\x86\xAE\x41\xE3\xAE\x95\x29\x8B\xB7\xB7\x13"
+        },
+        { 65536, 64,
+          "\x17\xEF\x5F\xF4\x54\xD8\x5A\xBB\xBA\x28\x0F\x3A\x94\xF1\xD2\x6E"
+          "\x95\x0C\x7D\x5B\x05\xC4\xBB\x3A\x78\x32\x6E\x0D\xC5\x73\x1F\x83"
+          "\x84\x20\x5C\x32\xDB\x86\x7D\x1B\x47\x6C\xE1\x21\xA0\xD7\x07\x4B"
+          "\xAA\x7E\xE9\x05\x25\xD1\x53\x00\xF4\x8E\xC0\xA6\x62\x4B\xD0\xAF"
+        },
+        { 131008, 64,
+          "\x9D\x07\xDC\x45\x03\x78\xA4\x4E\xD2\xD3\x85\x5C\x7C\x88\xA4\x21"
+          "\x76\x51\x07\x7F\x80\x04\x6E\x36\xAC\xD6\x11\x8C\x3C\xC4\xB5\xB2"
+          "\x75\x80\xB2\x4E\x3B\xF2\xF4\x8B\x2D\x5D\xF3\x0E\x2E\xCC\x9C\x7E"
+          "\x7D\x8C\xBF\x88\x8F\xA8\x3A\x51\x0B\x54\xBC\x6B\x4E\xA9\xCB\x67"
+        }
+      }
+    }
+#endif /*USE_CHACHA20*/
   };
 
 
@@ -3571,6 +4420,9 @@ check_ciphers (void)
 #if USE_SALSA20
     GCRY_CIPHER_SALSA20,
     GCRY_CIPHER_SALSA20R12,
+#endif
+#if USE_CHACHA20
+    GCRY_CIPHER_CHACHA20,
 #endif
     0
   };
@@ -3639,6 +4491,8 @@ check_cipher_modes(void)
   check_ofb_cipher ();
   check_ccm_cipher ();
   check_gcm_cipher ();
+  check_poly1305_cipher ();
+  check_ocb_cipher ();
   check_stream_cipher ();
   check_stream_cipher_large_block ();
 
@@ -3869,6 +4723,12 @@ check_digests (void)
 #endif
       {	GCRY_MD_CRC24_RFC2440, "", "\xb7\x04\xce" },
       {	GCRY_MD_CRC24_RFC2440, "foo", "\x4f\xc2\x55" },
+      {	GCRY_MD_CRC24_RFC2440,
+	"Libgcrypt is a general purpose cryptographic library originally "
+	"based on code from GnuPG.  It provides functions for all "
+	"cryptographic building blocks",
+	"\x13\x91\xc4" },
+      {	GCRY_MD_CRC24_RFC2440, "!", "\xa5\xcb\x6b" },
 
       {	GCRY_MD_TIGER, "",
 	"\x24\xF0\x13\x0C\x63\xAC\x93\x32\x16\x16\x6E\x76"
@@ -4048,6 +4908,32 @@ check_digests (void)
         "\x9d\xd2\xfe\x4e\x90\x40\x9e\x5d\xa8\x7f\x53\x97\x6d\x74\x05\xb0"
         "\xc0\xca\xc6\x28\xfc\x66\x9a\x74\x1d\x50\x06\x3c\x55\x7e\x8f\x50" },
 #endif
+      { GCRY_MD_SHA3_224, "abc",
+        "\xe6\x42\x82\x4c\x3f\x8c\xf2\x4a\xd0\x92\x34\xee\x7d\x3c\x76\x6f"
+        "\xc9\xa3\xa5\x16\x8d\x0c\x94\xad\x73\xb4\x6f\xdf" },
+      { GCRY_MD_SHA3_256,
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        "\x41\xc0\xdb\xa2\xa9\xd6\x24\x08\x49\x10\x03\x76\xa8\x23\x5e\x2c"
+        "\x82\xe1\xb9\x99\x8a\x99\x9e\x21\xdb\x32\xdd\x97\x49\x6d\x33\x76" },
+      { GCRY_MD_SHA3_256, "!",
+        "\x5c\x88\x75\xae\x47\x4a\x36\x34\xba\x4f\xd5\x5e\xc8\x5b\xff\xd6"
+        "\x61\xf3\x2a\xca\x75\xc6\xd6\x99\xd0\xcd\xcb\x6c\x11\x58\x91\xc1" },
+      { GCRY_MD_SHA3_384,
+        "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+        "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+        "\x79\x40\x7d\x3b\x59\x16\xb5\x9c\x3e\x30\xb0\x98\x22\x97\x47\x91"
+        "\xc3\x13\xfb\x9e\xcc\x84\x9e\x40\x6f\x23\x59\x2d\x04\xf6\x25\xdc"
+        "\x8c\x70\x9b\x98\xb4\x3b\x38\x52\xb3\x37\x21\x61\x79\xaa\x7f\xc7" },
+      { GCRY_MD_SHA3_512, "abc",
+        "\xb7\x51\x85\x0b\x1a\x57\x16\x8a\x56\x93\xcd\x92\x4b\x6b\x09\x6e"
+        "\x08\xf6\x21\x82\x74\x44\xf7\x0d\x88\x4f\x5d\x02\x40\xd2\x71\x2e"
+        "\x10\xe1\x16\xe9\x19\x2a\xf3\xc9\x1a\x7e\xc5\x76\x47\xe3\x93\x40"
+        "\x57\x34\x0b\x4c\xf4\x08\xd5\xa5\x65\x92\xf8\x27\x4e\xec\x53\xf0" },
+      { GCRY_MD_SHA3_512, "!",
+        "\x3c\x3a\x87\x6d\xa1\x40\x34\xab\x60\x62\x7c\x07\x7b\xb9\x8f\x7e"
+        "\x12\x0a\x2a\x53\x70\x21\x2d\xff\xb3\x38\x5a\x18\xd4\xf3\x88\x59"
+        "\xed\x31\x1d\x0a\x9d\x51\x41\xce\x9c\xc5\xc6\x6e\xe6\x89\xb2\x66"
+        "\xa8\xaa\x18\xac\xe8\x28\x2a\x0e\x0d\xb5\x96\xc9\x0b\x0a\x7b\x87" },
       {	0 }
     };
   gcry_error_t err;
@@ -4135,6 +5021,187 @@ check_digests (void)
     fprintf (stderr, "Completed hash checks.\n");
 }
 
+
+/* Check the SHAKE extendable-output functions.  The output is read
+   once in one piece and compared with a known prefix, then again in
+   odd sized pieces crossing the block boundaries.  */
+static void
+check_xof (void)
+{
+  static const struct
+  {
+    int md;
+    const char *data;
+    const char *expect;
+    int expectlen;
+  } tv[] =
+    {
+      { GCRY_MD_SHAKE128, "abc",
+        "\x58\x81\x09\x2d\xd8\x18\xbf\x5c\xf8\xa3\xdd\xb7\x93\xfb\xcb\xa7"
+        "\x40\x97\xd5\xc5\x26\xa6\xd3\x5f\x97\xb8\x33\x51\x94\x0f\x2c\xc8",
+        32 },
+      { GCRY_MD_SHAKE128, "",
+        "\x7f\x9c\x2b\xa4\xe8\x8f\x82\x7d\x61\x60\x45\x50\x76\x05\x85\x3e"
+        "\xd7\x3b\x80\x93\xf6\xef\xbc\x88\xeb\x1a\x6e\xac\xfa\x66\xef\x26",
+        32 },
+      { GCRY_MD_SHAKE256, "abc",
+        "\x48\x33\x66\x60\x13\x60\xa8\x77\x1c\x68\x63\x08\x0c\xc4\x11\x4d"
+        "\x8d\xb4\x45\x30\xf8\xf1\xe1\xee\x4f\x94\xea\x37\xe7\x8b\x57\x39"
+        "\xd5\xa1\x5b\xef\x18\x6a\x53\x86\xc7\x57\x44\xc0\x52\x7e\x1f\xaa"
+        "\x9f\x87\x26\xe4\x62\xa1\x2a\x4f\xeb\x06\xbd\x88\x01\xe7\x51\xe4",
+        64 }
+    };
+  static const int chunks[] = { 1, 7, 8, 13, 168, 3, 64, 36 };
+  unsigned char ref[500];
+  unsigned char out[500];
+  gcry_md_hd_t hd;
+  gcry_error_t err;
+  int i, j, pos;
+
+  if (verbose)
+    fprintf (stderr, "Starting XOF checks.\n");
+
+  for (i = 0; i < DIM (tv); i++)
+    {
+      if (gcry_md_test_algo (tv[i].md))
+        continue;
+
+      err = gcry_md_open (&hd, tv[i].md, 0);
+      if (err)
+        {
+          fail ("xof: algo %d, gcry_md_open failed: %s\n",
+                tv[i].md, gpg_strerror (err));
+          continue;
+        }
+      gcry_md_write (hd, tv[i].data, strlen (tv[i].data));
+      err = gcry_md_extract (hd, tv[i].md, ref, sizeof ref);
+      if (err)
+        fail ("xof: algo %d, gcry_md_extract failed: %s\n",
+              tv[i].md, gpg_strerror (err));
+      else if (memcmp (ref, tv[i].expect, tv[i].expectlen))
+        fail ("xof: algo %d, output mismatch\n", tv[i].md);
+      gcry_md_close (hd);
+
+      err = gcry_md_open (&hd, tv[i].md, 0);
+      if (err)
+        continue;
+      for (j = 0; tv[i].data[j]; j++)
+        gcry_md_write (hd, tv[i].data + j, 1);
+      for (pos = j = 0; pos + chunks[j % DIM (chunks)] <= sizeof out;
+           pos += chunks[j % DIM (chunks)], j++)
+        {
+          err = gcry_md_extract (hd, 0, out + pos, chunks[j % DIM (chunks)]);
+          if (err)
+            {
+              fail ("xof: algo %d, gcry_md_extract failed: %s\n",
+                    tv[i].md, gpg_strerror (err));
+              break;
+            }
+        }
+      if (memcmp (out, ref, pos))
+        fail ("xof: algo %d, chunked output mismatch\n", tv[i].md);
+      gcry_md_close (hd);
+
+      if (gcry_md_get_algo_dlen (tv[i].md))
+        fail ("xof: algo %d, digest length is not 0\n", tv[i].md);
+      err = gcry_md_open (&hd, tv[i].md, GCRY_MD_FLAG_HMAC);
+      if (gpg_err_code (err) != GPG_ERR_DIGEST_ALGO)
+        {
+          fail ("xof: algo %d, HMAC not rejected\n", tv[i].md);
+          if (!err)
+            gcry_md_close (hd);
+        }
+    }
+
+  /* A fixed length digest has no extendable output.  */
+  if (!gcry_md_open (&hd, GCRY_MD_SHA1, 0))
+    {
+      err = gcry_md_extract (hd, GCRY_MD_SHA1, out, 20);
+      if (gpg_err_code (err) != GPG_ERR_DIGEST_ALGO)
+        fail ("xof: gcry_md_extract on SHA1 not rejected\n");
+      gcry_md_close (hd);
+    }
+
+  if (verbose)
+    fprintf (stderr, "Completed XOF checks.\n");
+}
+
+
+/* Compare the output of gcry_md_hash_buffers_multi with the digests of
+   the individual messages.  The message lengths are chosen to hit the
+   padding boundaries and to let the lanes finish at different times.  */
+static void
+check_md_hash_buffers_multi (void)
+{
+  static const int algos[] =
+    { GCRY_MD_SHA1, GCRY_MD_SHA224, GCRY_MD_SHA256, GCRY_MD_MD5,
+      GCRY_MD_SHA3_224, GCRY_MD_SHA3_256, GCRY_MD_SHA3_384,
+      GCRY_MD_SHA3_512 };
+  static const size_t lens[] =
+    { 0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 127, 128, 200, 1000, 4321,
+      119, 0, 64, 5000, 17, 56, 1, 71, 72, 135, 136, 143, 144, 300 };
+  gcry_buffer_t iov[DIM (lens)];
+  unsigned char *data;
+  unsigned char digests[DIM (lens) * 64];
+  unsigned char expect[64];
+  gpg_error_t err;
+  int mdlen;
+  int i, j, n;
+
+  if (verbose)
+    fprintf (stderr, "Starting multi-buffer hash checks.\n");
+
+  data = gcry_xmalloc (8192);
+  for (i = 0; i < 8192; i++)
+    data[i] = i * 37 + (i >> 8);
+
+  memset (iov, 0, sizeof iov);
+  for (i = 0; i < DIM (lens); i++)
+    {
+      iov[i].data = data;
+      iov[i].off = (i * 97) % 1024;
+      iov[i].len = lens[i];
+    }
+
+  for (j = 0; j < DIM (algos); j++)
+    {
+      if (gcry_md_test_algo (algos[j])
+          || (algos[j] == GCRY_MD_MD5 && in_fips_mode))
+        continue;
+      mdlen = gcry_md_get_algo_dlen (algos[j]);
+
+      /* Also try message counts which do not fill all lanes.  */
+      for (n = 1; n <= DIM (lens); n += (n < 10 ? 1 : 19))
+        {
+          memset (digests, 0, sizeof digests);
+          err = gcry_md_hash_buffers_multi (algos[j], 0, digests, iov, n);
+          if (err)
+            {
+              fail ("md_hash_buffers_multi: algo %d, failed: %s\n",
+                    algos[j], gpg_strerror (err));
+              continue;
+            }
+          for (i = 0; i < n; i++)
+            {
+              gcry_md_hash_buffer (algos[j], expect,
+                                   data + iov[i].off, iov[i].len);
+              if (memcmp (digests + i * mdlen, expect, mdlen))
+                fail ("md_hash_buffers_multi: algo %d, n %d, message %d,"
+                      " digest mismatch\n", algos[j], n, i);
+            }
+        }
+    }
+
+  err = gcry_md_hash_buffers_multi (GCRY_MD_SHA1, 1, digests, iov, 1);
+  if (gpg_err_code (err) != GPG_ERR_INV_ARG)
+    fail ("md_hash_buffers_multi: invalid flags not detected\n");
+
+  gcry_free (data);
+
+  if (verbose)
+    fprintf (stderr, "Completed multi-buffer hash checks.\n");
+}
+
 static void
 check_one_hmac (int algo, const char *data, int datalen,
 		const char *key, int keylen, const char *expect)
@@ -5070,6 +6137,23 @@ check_mac (void)
         "\xc9\xfc\xa7\x29\xab\x60\xad\xa0",
         "\x20\x4b\xdb\x1b\xd6\x21\x54\xbf\x08\x92\x2a\xaa\x54\xee\xd7\x05",
         "\x05\xad\x13\xa5\xe2\xc2\xab\x66\x7e\x1a\x6f\xbc" },
+      /* RFC 7539, 2.5.2 */
+      { GCRY_MAC_POLY1305,
+        "Cryptographic Forum Research Group",
+        "\x85\xd6\xbe\x78\x57\x55\x6d\x33\x7f\x44\x52\xfe\x42\xd5\x06\xa8"
+        "\x01\x03\x80\x8a\xfb\x0d\xb2\xfd\x4a\xbf\xf6\xaf\x41\x49\xf5\x1b",
+        "\xa8\x06\x1d\xc1\x30\x51\x36\xc6\xc2\x2b\x8b\xaf\x0c\x01\x27\xa9" },
+      { GCRY_MAC_POLY1305,
+        "\x04\x0b\x12\x19\x20\x27\x2e\x35\x3c\x43\x4a\x51\x58\x5f\x66\x6d"
+        "\x74\x7b\x82\x89\x90\x97\x9e\xa5\xac\xb3\xba\xc1\xc8\xcf\xd6\xdd"
+        "\xe4\xeb\xf2\xf9\x01\x08\x0f\x16\x1d\x24\x2b\x32\x39\x40\x47\x4e"
+        "\x55\x5c\x63\x6a\x71\x78\x7f\x86\x8d\x94\x9b\xa2\xa9\xb0\xb7\xbe"
+        "\xc5\xcc\xd3\xda\xe1\xe8\xef\xf6\xfd\x05\x0c\x13\x1a\x21\x28\x2f"
+        "\x36\x3d\x44\x4b\x52\x59\x60\x67\x6e\x75\x7c\x83\x8a\x91\x98\x9f"
+        "\xa6\xad\xb4\xbb",
+        "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10"
+        "\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f\x20",
+        "\x2f\x01\x82\x08\x37\x64\x2f\xad\xe0\xa0\x84\xb9\x9d\x03\x2d\x25" },
       { 0 },
     };
   int i;
@@ -6098,6 +7182,8 @@ main (int argc, char **argv)
           check_cipher_modes ();
           check_bulk_cipher_modes ();
           check_digests ();
+          check_xof ();
+          check_md_hash_buffers_multi ();
           check_hmac ();
           check_mac ();
           check_pubkey ();
@@ -1028,6 +1028,154 @@ static struct bench_ops gcm_authenticate_ops = {
 };
 
 
+static void
+bench_ocb_encrypt_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
+{
+  gcry_cipher_hd_t hd = obj->priv;
+  int err;
+  char tag[16];
+  char nonce[15] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce,
+                     0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+                     0x00, 0x00, 0x01 };
+
+  gcry_cipher_setiv (hd, nonce, sizeof (nonce));
+  gcry_cipher_final (hd);
+
+  err = gcry_cipher_encrypt (hd, buf, buflen, buf, buflen);
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_encrypt failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+
+  err = gcry_cipher_gettag (hd, tag, sizeof (tag));
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_gettag failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+}
+
+static void
+bench_ocb_decrypt_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
+{
+  gcry_cipher_hd_t hd = obj->priv;
+  int err;
+  char tag[16] = { 0, };
+  char nonce[15] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce,
+                     0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+                     0x00, 0x00, 0x01 };
+
+  gcry_cipher_setiv (hd, nonce, sizeof (nonce));
+  gcry_cipher_final (hd);
+
+  err = gcry_cipher_decrypt (hd, buf, buflen, buf, buflen);
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_decrypt failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+
+  err = gcry_cipher_checktag (hd, tag, sizeof (tag));
+  if (gpg_err_code (err) == GPG_ERR_CHECKSUM)
+    err = gpg_error (GPG_ERR_NO_ERROR);
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_checktag failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+}
+
+static void
+bench_ocb_authenticate_do_bench (struct bench_obj *obj, void *buf,
+                                 size_t buflen)
+{
+  gcry_cipher_hd_t hd = obj->priv;
+  int err;
+  char tag[16] = { 0, };
+  char nonce[15] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce,
+                     0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88,
+                     0x00, 0x00, 0x01 };
+  char data = 0xff;
+
+  gcry_cipher_setiv (hd, nonce, sizeof (nonce));
+
+  err = gcry_cipher_authenticate (hd, buf, buflen);
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_authenticate failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+
+  gcry_cipher_final (hd);
+  err = gcry_cipher_encrypt (hd, &data, sizeof (data), &data, sizeof (data));
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_encrypt failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+
+  err = gcry_cipher_gettag (hd, tag, sizeof (tag));
+  if (err)
+    {
+      fprintf (stderr, PGM ": gcry_cipher_gettag failed: %s\n",
+           gpg_strerror (err));
+      gcry_cipher_close (hd);
+      exit (1);
+    }
+}
+
+static struct bench_ops ocb_encrypt_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_ocb_encrypt_do_bench
+};
+
+static struct bench_ops ocb_decrypt_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_ocb_decrypt_do_bench
+};
+
+static struct bench_ops ocb_authenticate_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_ocb_authenticate_do_bench
+};
+
+
+/* The GCM helpers use a 96 bit nonce which suits Poly1305 as well.  */
+static struct bench_ops poly1305_encrypt_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_gcm_encrypt_do_bench
+};
+
+static struct bench_ops poly1305_decrypt_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_gcm_decrypt_do_bench
+};
+
+static struct bench_ops poly1305_authenticate_ops = {
+  &bench_encrypt_init,
+  &bench_encrypt_free,
+  &bench_gcm_authenticate_do_bench
+};
+
+
 static struct bench_cipher_mode cipher_modes[] = {
   {GCRY_CIPHER_MODE_ECB, "ECB enc", &encrypt_ops},
   {GCRY_CIPHER_MODE_ECB, "ECB dec", &decrypt_ops},
@@ -1047,6 +1195,12 @@ static struct bench_cipher_mode cipher_modes[] = {
   {GCRY_CIPHER_MODE_GCM, "GCM enc", &gcm_encrypt_ops},
   {GCRY_CIPHER_MODE_GCM, "GCM dec", &gcm_decrypt_ops},
   {GCRY_CIPHER_MODE_GCM, "GCM auth", &gcm_authenticate_ops},
+  {GCRY_CIPHER_MODE_OCB, "OCB enc",  &ocb_encrypt_ops},
+  {GCRY_CIPHER_MODE_OCB, "OCB dec",  &ocb_decrypt_ops},
+  {GCRY_CIPHER_MODE_OCB, "OCB auth", &ocb_authenticate_ops},
+  {GCRY_CIPHER_MODE_POLY1305, "POLY1305 enc", &poly1305_encrypt_ops},
+  {GCRY_CIPHER_MODE_POLY1305, "POLY1305 dec", &poly1305_decrypt_ops},
+  {GCRY_CIPHER_MODE_POLY1305, "POLY1305 auth", &poly1305_authenticate_ops},
   {0},
 };
 
@@ -1066,8 +1220,14 @@ cipher_bench_one (int algo, struct bench_cipher_mode *pmode)
   if (!blklen)
     return;
 
+  /* Poly1305 mode is only defined for ChaCha20.  */
+  if (mode.mode == GCRY_CIPHER_MODE_POLY1305)
+    {
+      if (algo != GCRY_CIPHER_CHACHA20)
+        return;
+    }
   /* Stream cipher? Only test with ECB. */
-  if (blklen == 1 && mode.mode != GCRY_CIPHER_MODE_ECB)
+  else if (blklen == 1 && mode.mode != GCRY_CIPHER_MODE_ECB)
     return;
   if (blklen == 1 && mode.mode == GCRY_CIPHER_MODE_ECB)
     {
@@ -1083,6 +1243,10 @@ cipher_bench_one (int algo, struct bench_cipher_mode *pmode)
   if (mode.mode == GCRY_CIPHER_MODE_GCM && blklen != GCRY_GCM_BLOCK_LEN)
     return;
 
+  /* OCB is only implemented for 128 bit block ciphers.  */
+  if (mode.mode == GCRY_CIPHER_MODE_OCB && blklen != 16)
+    return;
+
   bench_print_mode (14, mode.name);
 
   obj.ops = mode.ops;
@@ -1197,25 +1361,102 @@ static struct bench_ops hash_ops = {
 };
 
 
+/* The multi-buffer mode hashes the buffer as eight independent
+   messages with gcry_md_hash_buffers_multi.  */
+#define HASH_MULTI_COUNT 8
+
+static int
+bench_hash_multi_init (struct bench_obj *obj)
+{
+  obj->min_bufsize = BUF_START_SIZE;
+  obj->max_bufsize = BUF_END_SIZE;
+  obj->step_size = BUF_STEP_SIZE;
+  obj->num_measure_repetitions = num_measurement_repetitions;
+
+  return 0;
+}
+
+static void
+bench_hash_multi_free (struct bench_obj *obj)
+{
+  (void)obj;
+}
+
+static void
+bench_hash_multi_do_bench (struct bench_obj *obj, void *buf, size_t buflen)
+{
+  struct bench_hash_mode *mode = obj->priv;
+  gcry_buffer_t iov[HASH_MULTI_COUNT];
+  unsigned char digests[HASH_MULTI_COUNT * 64];
+  size_t msglen = buflen / HASH_MULTI_COUNT;
+  int i;
+
+  memset (iov, 0, sizeof iov);
+  for (i = 0; i < HASH_MULTI_COUNT; i++)
+    {
+      iov[i].data = buf;
+      iov[i].off = i * msglen;
+      iov[i].len = msglen;
+    }
+  iov[HASH_MULTI_COUNT - 1].len += buflen % HASH_MULTI_COUNT;
+
+  gcry_md_hash_buffers_multi (mode->algo, 0, digests, iov, HASH_MULTI_COUNT);
+}
+
+static struct bench_ops hash_multi_ops = {
+  &bench_hash_multi_init,
+  &bench_hash_multi_free,
+  &bench_hash_multi_do_bench
+};
+
+
 static struct bench_hash_mode hash_modes[] = {
   {"", &hash_ops},
+  {"multi", &hash_multi_ops},
   {0},
 };
 
 
+/* Return true if ALGO has a parallel implementation for
+   gcry_md_hash_buffers_multi; other algorithms are not shown in the
+   multi-buffer mode.  */
+static int
+hash_multi_supported (int algo)
+{
+  switch (algo)
+    {
+    case GCRY_MD_SHA1:
+    case GCRY_MD_SHA224:
+    case GCRY_MD_SHA256:
+    case GCRY_MD_SHA3_224:
+    case GCRY_MD_SHA3_256:
+    case GCRY_MD_SHA3_384:
+    case GCRY_MD_SHA3_512:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+
 static void
 hash_bench_one (int algo, struct bench_hash_mode *pmode)
 {
   struct bench_hash_mode mode = *pmode;
   struct bench_obj obj = { 0 };
   double result;
+  char name[64];
 
   mode.algo = algo;
 
   if (mode.name[0] == '\0')
     bench_print_algo (-14, gcry_md_algo_name (algo));
   else
-    bench_print_algo (14, mode.name);
+    {
+      snprintf (name, sizeof name, "%s %s", gcry_md_algo_name (algo),
+                mode.name);
+      bench_print_algo (-14, name);
+    }
 
   obj.ops = mode.ops;
   obj.priv = &mode;
@@ -1231,7 +1472,11 @@ _hash_bench (int algo)
   int i;
 
   for (i = 0; hash_modes[i].name; i++)
-    hash_bench_one (algo, &hash_modes[i]);
+    {
+      if (hash_modes[i].ops == &hash_multi_ops && !hash_multi_supported (algo))
+        continue;
+      hash_bench_one (algo, &hash_modes[i]);
+    }
 }
 
 void
@@ -1405,7 +1650,7 @@ mac_bench (char **argv, int argc)
     }
   else
     {
-      for (i = 1; i < 500; i++)
+      for (i = 1; i < 600; i++)
 	if (!gcry_mac_test_algo (i))
 	  _mac_bench (i);
     }
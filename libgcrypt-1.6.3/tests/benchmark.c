@@ -416,6 +416,14 @@ md_bench ( const char *algoname )
 
   gcry_md_close (hd);
 
+  /* XOFs can't be used with gcry_md_hash_buffer.  */
+  if (!gcry_md_get_algo_dlen (algo))
+    {
+      putchar ('\n');
+      fflush (stdout);
+      return;
+    }
+
   /* Now 100 hash operations on 10000 bytes using the fast function.
      We initialize the buffer so that all memory pages are committed
      and we have repeatable values.  */
@@ -461,7 +469,7 @@ mac_bench ( const char *algoname )
 
   if (!algoname)
     {
-      for (i=1; i < 500; i++)
+      for (i=1; i < 600; i++)
         if (in_fips_mode && i == GCRY_MAC_HMAC_MD5)
           ; /* Don't use MD5 in fips mode.  */
         else if ( !gcry_mac_test_algo (i) )
@@ -865,15 +873,16 @@ rsa_bench (int iterations, int print_header, int no_blinding)
   int testno;
 
   if (print_header)
-    printf ("Algorithm         generate %4d*sign %4d*verify\n"
-            "------------------------------------------------\n",
-            iterations, iterations );
+    printf ("Algorithm         generate %4d*sign %4d*verify %4d*decrypt\n"
+            "----------------------------------------------------------\n",
+            iterations, iterations, iterations );
   for (testno=0; testno < DIM (p_sizes); testno++)
     {
       gcry_sexp_t key_spec, key_pair, pub_key, sec_key;
       gcry_mpi_t x;
       gcry_sexp_t data;
       gcry_sexp_t sig = NULL;
+      gcry_sexp_t enc, plain;
       int count;
 
       printf ("RSA %3d bit    ", p_sizes[testno]);
@@ -941,6 +950,22 @@ rsa_bench (int iterations, int print_header, int no_blinding)
         }
       stop_timer ();
       printf ("     %s", elapsed_time ());
+      fflush (stdout);
+
+      err = gcry_pk_encrypt (&enc, data, pub_key);
+      if (err)
+        die ("encryption failed: %s\n", gpg_strerror (err));
+      start_timer ();
+      for (count=0; count < iterations; count++)
+        {
+          err = gcry_pk_decrypt (&plain, enc, sec_key);
+          if (err)
+            die ("decryption failed (%d): %s\n", count, gpg_strerror (err));
+          gcry_sexp_release (plain);
+        }
+      stop_timer ();
+      printf ("      %s", elapsed_time ());
+      gcry_sexp_release (enc);
 
       if (no_blinding)
         {
@@ -28,8 +28,10 @@
 
 #include "../src/gcrypt-int.h"
 
+#define DIM(v)		     (sizeof(v)/sizeof((v)[0]))
+
 /* Number of curves defined in ../cipger/ecc.c */
-#define N_CURVES 15
+#define N_CURVES 16
 
 /* A real world sample public key.  */
 static char const sample_key_1[] =
@@ -63,6 +65,14 @@ static char const sample_key_2[] =
 static char const sample_key_2_curve[] = "brainpoolP160r1";
 static unsigned int sample_key_2_nbits = 160;
 
+/* The secret key of Alice from RFC 7748, section 6.1.  */
+static char const sample_key_3[] =
+"(private-key\n"
+" (ecc\n"
+"  (curve Curve25519)\n"
+"  (d #6A2CB91DA5FB77B12A99C0EB872F4CDF4566B25172C1163C7DA518730A6D0770#)\n"
+"  ))";
+
 
 /* Program option flags.  */
 static int verbose;
@@ -185,6 +195,51 @@ check_get_params (void)
 }
 
 
+/* Check that ECDH on Curve25519 rejects ephemeral keys of small
+   order instead of returning a useless shared secret.  */
+static void
+check_ecdh_low_order (void)
+{
+  static const char *low_order[] = {
+    /* u = 0 (order 2).  */
+    "(enc-val(ecdh(e #40"
+    "0000000000000000000000000000000000000000000000000000000000000000"
+    "#)))",
+    /* u = 1 (order 4).  */
+    "(enc-val(ecdh(e #40"
+    "0100000000000000000000000000000000000000000000000000000000000000"
+    "#)))"
+  };
+  gpg_error_t err;
+  gcry_sexp_t key, data, plain;
+  int i;
+
+  err = gcry_sexp_new (&key, sample_key_3, 0, 1);
+  if (err)
+    die ("parsing s-expression string failed: %s\n", gpg_strerror (err));
+
+  for (i=0; i < DIM (low_order); i++)
+    {
+      err = gcry_sexp_new (&data, low_order[i], 0, 1);
+      if (err)
+        die ("parsing s-expression string failed: %s\n",
+             gpg_strerror (err));
+      err = gcry_pk_decrypt (&plain, data, key);
+      if (!err)
+        {
+          fail ("low order point %d not rejected\n", i);
+          gcry_sexp_release (plain);
+        }
+      else if (gpg_err_code (err) != GPG_ERR_INV_DATA)
+        fail ("low order point %d: unexpected error: %s\n",
+              i, gpg_strerror (err));
+      gcry_sexp_release (data);
+    }
+
+  gcry_sexp_release (key);
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -205,6 +260,7 @@ main (int argc, char **argv)
   list_curves ();
   check_matching ();
   check_get_params ();
+  check_ecdh_low_order ();
 
   return error_count ? 1 : 0;
 }
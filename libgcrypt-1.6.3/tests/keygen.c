@@ -189,6 +189,51 @@ check_generated_rsa_key (gcry_sexp_t key, unsigned long expected_e)
 }
 
 
+/* Check that the multi-prime RSA KEY has its third prime and that a
+   signature created with the CRT verifies.  */
+static void
+check_multiprime_rsa_key (gcry_sexp_t key)
+{
+  gcry_sexp_t skey, pkey, list, data, sig;
+  int rc;
+
+  skey = gcry_sexp_find_token (key, "private-key", 0);
+  pkey = gcry_sexp_find_token (key, "public-key", 0);
+  if (!skey || !pkey)
+    die ("key part missing in return value\n");
+
+  list = gcry_sexp_find_token (skey, "r3", 0);
+  if (!list)
+    fail ("third prime missing in the private key\n");
+  gcry_sexp_release (list);
+  list = gcry_sexp_find_token (skey, "r4", 0);
+  if (list)
+    fail ("unexpected fourth prime in the private key\n");
+  gcry_sexp_release (list);
+
+  rc = gcry_sexp_build (&data, NULL,
+                        "(data (flags pkcs1) (hash sha256 %b))",
+                        32, "0123456789abcdef0123456789abcdef");
+  if (rc)
+    die ("error building data: %s\n", gpg_strerror (rc));
+  rc = gcry_pk_sign (&sig, data, skey);
+  if (rc)
+    fail ("signing with multi-prime key failed: %s\n", gpg_strerror (rc));
+  else
+    {
+      rc = gcry_pk_verify (sig, data, pkey);
+      if (rc)
+        fail ("verifying multi-prime signature failed: %s\n",
+              gpg_strerror (rc));
+      gcry_sexp_release (sig);
+    }
+
+  gcry_sexp_release (data);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+}
+
+
 static void
 check_rsa_keys (void)
 {
@@ -249,6 +294,47 @@ check_rsa_keys (void)
 
   check_generated_rsa_key (key, 0); /* We don't expect a constant exponent. */
   gcry_sexp_release (key);
+
+  if (verbose)
+    show ("creating 1536 bit RSA key with 3 primes\n");
+  rc = gcry_sexp_new (&keyparm,
+                      "(genkey\n"
+                      " (rsa\n"
+                      "  (nbits 4:1536)\n"
+                      "  (rsa-use-primes 1:3)\n"
+                      " ))", 0, 1);
+  if (rc)
+    die ("error creating S-expression: %s\n", gpg_strerror (rc));
+  rc = gcry_pk_genkey (&key, keyparm);
+  gcry_sexp_release (keyparm);
+  if (rc)
+    die ("error generating RSA key: %s\n", gpg_strerror (rc));
+  if (verbose > 1)
+    show_sexp ("1536 bit RSA key:\n", key);
+
+  check_generated_rsa_key (key, 65537);
+  check_multiprime_rsa_key (key);
+  gcry_sexp_release (key);
+
+  if (verbose)
+    show ("creating 1024 bit RSA key with 4 primes (shall fail)\n");
+  rc = gcry_sexp_new (&keyparm,
+                      "(genkey\n"
+                      " (rsa\n"
+                      "  (nbits 4:1024)\n"
+                      "  (rsa-use-primes 1:4)\n"
+                      " ))", 0, 1);
+  if (rc)
+    die ("error creating S-expression: %s\n", gpg_strerror (rc));
+  rc = gcry_pk_genkey (&key, keyparm);
+  gcry_sexp_release (keyparm);
+  if (gpg_err_code (rc) != GPG_ERR_INV_VALUE)
+    {
+      fail ("generating a 4 prime 1024 bit RSA key did not fail: %s\n",
+            gpg_strerror (rc));
+      if (!rc)
+        gcry_sexp_release (key);
+    }
 }
 
 
@@ -365,7 +451,7 @@ static void
 check_ecc_keys (void)
 {
   const char *curves[] = { "NIST P-521", "NIST P-384", "NIST P-256",
-                           "Ed25519", NULL };
+                           "Ed25519", "Curve25519", NULL };
   int testno;
   gcry_sexp_t keyparm, key;
   int rc;
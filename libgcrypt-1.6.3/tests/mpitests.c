@@ -34,6 +34,8 @@
 
 #define PGM "mpitests"
 
+#define DIM(v)		     (sizeof(v)/sizeof((v)[0]))
+
 static int verbose;
 static int debug;
 static int error_count;
@@ -552,6 +554,56 @@ test_powm (void)
 }
 
 
+/* Compare gcry_mpi_powm for multi-limb odd moduli with a plain
+   square and multiply using gcry_mpi_mulm.  The exponent is tested
+   in standard and in secure memory because that selects different
+   table lookups.  */
+static int
+test_powm_odd (void)
+{
+  static const unsigned int nbits[] = { 65, 512, 1031, 2048 };
+  gcry_mpi_t base, exp, mod, res, ref;
+  int i, j, k;
+
+  for (i=0; i < DIM (nbits); i++)
+    for (k=0; k < 2; k++)
+      {
+        mod = gcry_mpi_new (nbits[i]);
+        gcry_mpi_randomize (mod, nbits[i], GCRY_WEAK_RANDOM);
+        gcry_mpi_set_bit (mod, nbits[i] - 1);
+        gcry_mpi_set_bit (mod, 0);
+        base = gcry_mpi_new (nbits[i] + 64);
+        gcry_mpi_randomize (base, nbits[i] + 64, GCRY_WEAK_RANDOM);
+        exp = k? gcry_mpi_snew (nbits[i]) : gcry_mpi_new (nbits[i]);
+        gcry_mpi_randomize (exp, nbits[i], GCRY_WEAK_RANDOM);
+        res = gcry_mpi_new (0);
+        ref = gcry_mpi_new (0);
+
+        gcry_mpi_powm (res, base, exp, mod);
+
+        gcry_mpi_mod (base, base, mod);
+        gcry_mpi_set_ui (ref, 1);
+        for (j = gcry_mpi_get_nbits (exp) - 1; j >= 0; j--)
+          {
+            gcry_mpi_mulm (ref, ref, ref, mod);
+            if (gcry_mpi_test_bit (exp, j))
+              gcry_mpi_mulm (ref, ref, base, mod);
+          }
+        if (gcry_mpi_cmp (res, ref))
+          die ("test_powm_odd failed for %u bits (secure=%d)\n",
+               nbits[i], k);
+
+        gcry_mpi_release (base);
+        gcry_mpi_release (exp);
+        gcry_mpi_release (mod);
+        gcry_mpi_release (res);
+        gcry_mpi_release (ref);
+      }
+
+  return 1;
+}
+
+
 int
 main (int argc, char* argv[])
 {
@@ -574,6 +626,7 @@ main (int argc, char* argv[])
   test_sub ();
   test_mul ();
   test_powm ();
+  test_powm_odd ();
 
   return !!error_count;
 }
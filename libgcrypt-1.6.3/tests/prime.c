@@ -248,7 +248,17 @@ main (int argc, char **argv)
   if (mode42)
     create_42prime ();
   else
-    check_primes ();
+    {
+      check_primes ();
+
+      /* Run again with the candidates and the Rabin-Miller rounds
+         distributed over several threads.  */
+      if (verbose)
+        fputs ("using 4 worker threads\n", stderr);
+      if (gcry_control (GCRYCTL_SET_WORKER_THREADS, 4))
+        die ("setting the number of worker threads failed\n");
+      check_primes ();
+    }
 
   return 0;
 }
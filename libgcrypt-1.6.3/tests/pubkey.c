@@ -1167,6 +1167,286 @@ check_ed25519ecdsa_sample_key (void)
 }
 
 
+/* Sign HASH using a handle for the private key SKEY and check the
+   signature using a handle for the public key PKEY as well as with
+   gcry_pk_verify.  BADHASH must not verify.  The signature is
+   returned.  */
+static gcry_sexp_t
+check_handle_sign (gcry_sexp_t skey, gcry_sexp_t pkey,
+                   gcry_sexp_t hash, gcry_sexp_t badhash)
+{
+  gpg_error_t err;
+  gcry_pk_hd_t shd, phd;
+  gcry_sexp_t sig, sig2;
+
+  if ((err = gcry_pk_open (&shd, skey)))
+    die ("gcry_pk_open (private) failed: %s\n", gpg_strerror (err));
+  if ((err = gcry_pk_open (&phd, pkey)))
+    die ("gcry_pk_open (public) failed: %s\n", gpg_strerror (err));
+
+  if ((err = gcry_pk_hd_sign (shd, &sig, hash)))
+    die ("gcry_pk_hd_sign failed: %s\n", gpg_strerror (err));
+  if ((err = gcry_pk_hd_verify (phd, sig, hash)))
+    die ("gcry_pk_hd_verify failed: %s\n", gpg_strerror (err));
+  if ((err = gcry_pk_hd_verify (shd, sig, hash)))
+    die ("gcry_pk_hd_verify with private key failed: %s\n",
+         gpg_strerror (err));
+  if ((err = gcry_pk_verify (sig, hash, pkey)))
+    die ("gcry_pk_verify of handle signature failed: %s\n",
+         gpg_strerror (err));
+  if (gpg_err_code (gcry_pk_hd_verify (phd, sig, badhash))
+      != GPG_ERR_BAD_SIGNATURE)
+    fail ("gcry_pk_hd_verify did not detect a bad signature\n");
+
+  /* The handle may be used several times.  */
+  if ((err = gcry_pk_hd_sign (shd, &sig2, hash)))
+    die ("gcry_pk_hd_sign failed: %s\n", gpg_strerror (err));
+  if ((err = gcry_pk_hd_verify (phd, sig2, hash)))
+    die ("gcry_pk_hd_verify failed: %s\n", gpg_strerror (err));
+  gcry_sexp_release (sig2);
+
+  if (gpg_err_code (gcry_pk_hd_sign (phd, &sig2, hash)) != GPG_ERR_NO_SECKEY)
+    fail ("gcry_pk_hd_sign with a public key did not fail\n");
+  gcry_sexp_release (sig2);
+
+  gcry_pk_close (phd);
+  gcry_pk_close (shd);
+  return sig;
+}
+
+
+static void
+check_pk_handle (void)
+{
+  static const char rsa_hash_string[] =
+    "(data (flags pkcs1)\n"
+    " (hash sha1 #00112233445566778899AABBCCDDEEFF00010203#))";
+  static const char rsa_badhash_string[] =
+    "(data (flags pkcs1)\n"
+    " (hash sha1 #00112233445566778899AABBCCDDEEFF00010204#))";
+  static const char ecc_private_key[] =
+    "(private-key\n"
+    " (ecdsa\n"
+    "  (curve \"NIST P-256\")\n"
+    "  (q #04D4F6A6738D9B8D3A7075C1E4EE95015FC0C9B7E4272D2BEB6644D3609FC781"
+    "B71F9A8072F58CB66AE2F89BB12451873ABF7D91F9E1FBF96BF2F70E73AAC9A283#)\n"
+    "  (d #5A1EF0035118F19F3110FB81813D3547BCE1E5BCE77D1F744715E1D5BBE70378#)"
+    "))";
+  static const char ecc_public_key[] =
+    "(public-key\n"
+    " (ecdsa\n"
+    "  (curve \"NIST P-256\")\n"
+    "  (q #04D4F6A6738D9B8D3A7075C1E4EE95015FC0C9B7E4272D2BEB6644D3609FC781"
+    "B71F9A8072F58CB66AE2F89BB12451873ABF7D91F9E1FBF96BF2F70E73AAC9A283#)"
+    "))";
+  static const char ecc_hash_string[] =
+    "(data (flags raw)\n"
+    " (value #00112233445566778899AABBCCDDEEFF"
+    /* */    "000102030405060708090A0B0C0D0E0F#))";
+  static const char ecc_badhash_string[] =
+    "(data (flags raw)\n"
+    " (value #00112233445566778899AABBCCDDEEFF"
+    /* */    "000102030405060708090A0B0C0D0E0E#))";
+  static const char ed_private_key[] =
+    "(private-key\n"
+    " (ecc\n"
+    "  (curve \"Ed25519\")\n"
+    "  (flags eddsa)\n"
+    "  (q #3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c#)"
+    "  (d #4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb#)"
+    "))";
+  static const char ed_public_key[] =
+    "(public-key\n"
+    " (ecc\n"
+    "  (curve \"Ed25519\")\n"
+    "  (flags eddsa)\n"
+    "  (q #3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c#)"
+    "))";
+  static const char dsa_private_key[] =
+    "(private-key\n"
+    " (dsa\n"
+    "  (p #00AD7C0025BA1A15F775F3F2D673718391D00456978D347B33D7B49E7F32EDAB"
+    "      96273899DD8B2BB46CD6ECA263FAF04A28903503D59062A8865D2AE8ADFB5191"
+    "      CF36FFB562D0E2F5809801A1F675DAE59698A9E01EFE8D7DCFCA084F4C6F5A44"
+    "      44D499A06FFAEA5E8EF5E01F2FD20A7B7EF3F6968AFBA1FB8D91F1559D52D8777B#)"
+    "  (q #00EB7B5751D25EBBB7BD59D920315FD840E19AEBF9#)"
+    "  (g #1574363387FDFD1DDF38F4FBE135BB20C7EE4772FB94C337AF86EA8E49666503"
+    "      AE04B6BE81A2F8DD095311E0217ACA698A11E6C5D33CCDAE71498ED35D13991E"
+    "      B02F09AB40BD8F4C5ED8C75DA779D0AE104BC34C960B002377068AB4B5A1F984"
+    "      3FBA91F537F1B7CAC4D8DD6D89B0D863AF7025D549F9C765D2FC07EE208F8D15#)"
+    "  (y #64B11EF8871BE4AB572AA810D5D3CA11A6CDBC637A8014602C72960DB135BF46"
+    "      A1816A724C34F87330FC9E187C5D66897A04535CC2AC9164A7150ABFA8179827"
+    "      6E45831AB811EEE848EBB24D9F5F2883B6E5DDC4C659DEF944DCFD80BF4D0A20"
+    "      42CAA7DC289F0C5A9D155F02D3D551DB741A81695B74D4C8F477F9C7838EB0FB#)"
+    "  (x #11D54E4ADBD3034160F2CED4B7CD292A4EBF3EC0#)))";
+  static const char dsa_public_key[] =
+    "(public-key\n"
+    " (dsa\n"
+    "  (p #00AD7C0025BA1A15F775F3F2D673718391D00456978D347B33D7B49E7F32EDAB"
+    "      96273899DD8B2BB46CD6ECA263FAF04A28903503D59062A8865D2AE8ADFB5191"
+    "      CF36FFB562D0E2F5809801A1F675DAE59698A9E01EFE8D7DCFCA084F4C6F5A44"
+    "      44D499A06FFAEA5E8EF5E01F2FD20A7B7EF3F6968AFBA1FB8D91F1559D52D8777B#)"
+    "  (q #00EB7B5751D25EBBB7BD59D920315FD840E19AEBF9#)"
+    "  (g #1574363387FDFD1DDF38F4FBE135BB20C7EE4772FB94C337AF86EA8E49666503"
+    "      AE04B6BE81A2F8DD095311E0217ACA698A11E6C5D33CCDAE71498ED35D13991E"
+    "      B02F09AB40BD8F4C5ED8C75DA779D0AE104BC34C960B002377068AB4B5A1F984"
+    "      3FBA91F537F1B7CAC4D8DD6D89B0D863AF7025D549F9C765D2FC07EE208F8D15#)"
+    "  (y #64B11EF8871BE4AB572AA810D5D3CA11A6CDBC637A8014602C72960DB135BF46"
+    "      A1816A724C34F87330FC9E187C5D66897A04535CC2AC9164A7150ABFA8179827"
+    "      6E45831AB811EEE848EBB24D9F5F2883B6E5DDC4C659DEF944DCFD80BF4D0A20"
+    "      42CAA7DC289F0C5A9D155F02D3D551DB741A81695B74D4C8F477F9C7838EB0FB#)))";
+  static const char dsa_hash_string[] =
+    "(data (flags rfc6979)\n"
+    " (hash sha1 #00112233445566778899AABBCCDDEEFF00010203#))";
+  static const char dsa_badhash_string[] =
+    "(data (flags rfc6979)\n"
+    " (hash sha1 #00112233445566778899AABBCCDDEEFF00010204#))";
+  static const char ed_hash_string[] =
+    "(data (flags eddsa) (hash-algo sha512) (value #72#))";
+  static const char ed_badhash_string[] =
+    "(data (flags eddsa) (hash-algo sha512) (value #73#))";
+
+  gpg_error_t err;
+  gcry_sexp_t pkey, skey, hash, badhash, sig, sig2, plain, ciph, plain2, l;
+  gcry_pk_hd_t shd, phd;
+  gcry_mpi_t x, x2;
+  int variant;
+
+  if (verbose)
+    fprintf (stderr, "Checking key handles.\n");
+
+  /* RSA with and without the CRT values.  */
+  if ((err = gcry_sexp_new (&hash, rsa_hash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&badhash, rsa_badhash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  for (variant=0; variant < 2; variant++)
+    {
+      get_keys_sample (&pkey, &skey, variant);
+
+      sig = check_handle_sign (skey, pkey, hash, badhash);
+      if ((err = gcry_pk_sign (&sig2, hash, skey)))
+        die ("gcry_pk_sign failed: %s\n", gpg_strerror (err));
+      l = gcry_sexp_find_token (sig, "s", 0);
+      x = gcry_sexp_nth_mpi (l, 1, GCRYMPI_FMT_USG);
+      gcry_sexp_release (l);
+      l = gcry_sexp_find_token (sig2, "s", 0);
+      x2 = gcry_sexp_nth_mpi (l, 1, GCRYMPI_FMT_USG);
+      gcry_sexp_release (l);
+      if (!x || !x2 || gcry_mpi_cmp (x, x2))
+        fail ("RSA signature of handle does not match\n");
+      gcry_mpi_release (x);
+      gcry_mpi_release (x2);
+      gcry_sexp_release (sig);
+      gcry_sexp_release (sig2);
+
+      if ((err = gcry_pk_open (&shd, skey)))
+        die ("gcry_pk_open (private) failed: %s\n", gpg_strerror (err));
+      if ((err = gcry_pk_open (&phd, pkey)))
+        die ("gcry_pk_open (public) failed: %s\n", gpg_strerror (err));
+      x = gcry_mpi_new (800);
+      gcry_mpi_randomize (x, 800, GCRY_WEAK_RANDOM);
+      if ((err = gcry_sexp_build (&plain, NULL,
+                                  "(data (flags raw) (value %m))", x)))
+        die ("line %d: %s", __LINE__, gpg_strerror (err));
+      if ((err = gcry_pk_hd_encrypt (phd, &ciph, plain)))
+        die ("gcry_pk_hd_encrypt failed: %s\n", gpg_strerror (err));
+      if ((err = gcry_pk_hd_decrypt (shd, &plain2, ciph)))
+        die ("gcry_pk_hd_decrypt failed: %s\n", gpg_strerror (err));
+      x2 = gcry_sexp_nth_mpi (plain2, 0, GCRYMPI_FMT_USG);
+      if (!x2 || gcry_mpi_cmp (x, x2))
+        fail ("RSA decryption with handle failed\n");
+      gcry_mpi_release (x2);
+      gcry_sexp_release (plain2);
+      if (gpg_err_code (gcry_pk_hd_decrypt (phd, &plain2, ciph))
+          != GPG_ERR_NO_SECKEY)
+        fail ("gcry_pk_hd_decrypt with a public key did not fail\n");
+      if ((err = gcry_pk_decrypt (&plain2, ciph, skey)))
+        die ("gcry_pk_decrypt failed: %s\n", gpg_strerror (err));
+      x2 = gcry_sexp_nth_mpi (plain2, 0, GCRYMPI_FMT_USG);
+      if (!x2 || gcry_mpi_cmp (x, x2))
+        fail ("RSA decryption of handle ciphertext failed\n");
+      gcry_mpi_release (x2);
+      gcry_sexp_release (plain2);
+      gcry_sexp_release (ciph);
+      gcry_sexp_release (plain);
+      gcry_mpi_release (x);
+      gcry_pk_close (phd);
+      gcry_pk_close (shd);
+
+      gcry_sexp_release (pkey);
+      gcry_sexp_release (skey);
+    }
+  gcry_sexp_release (hash);
+  gcry_sexp_release (badhash);
+
+  /* ECDSA.  */
+  if ((err = gcry_sexp_new (&hash, ecc_hash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&badhash, ecc_badhash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&skey, ecc_private_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&pkey, ecc_public_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  sig = check_handle_sign (skey, pkey, hash, badhash);
+  gcry_sexp_release (sig);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+  gcry_sexp_release (hash);
+  gcry_sexp_release (badhash);
+
+  /* DSA with deterministic signatures.  */
+  if ((err = gcry_sexp_new (&hash, dsa_hash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&badhash, dsa_badhash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&skey, dsa_private_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&pkey, dsa_public_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  sig = check_handle_sign (skey, pkey, hash, badhash);
+  if ((err = gcry_pk_sign (&sig2, hash, skey)))
+    die ("gcry_pk_sign failed: %s\n", gpg_strerror (err));
+  l = gcry_sexp_find_token (sig, "r", 0);
+  x = gcry_sexp_nth_mpi (l, 1, GCRYMPI_FMT_USG);
+  gcry_sexp_release (l);
+  l = gcry_sexp_find_token (sig2, "r", 0);
+  x2 = gcry_sexp_nth_mpi (l, 1, GCRYMPI_FMT_USG);
+  gcry_sexp_release (l);
+  if (!x || !x2 || gcry_mpi_cmp (x, x2))
+    fail ("DSA signature of handle does not match\n");
+  gcry_mpi_release (x);
+  gcry_mpi_release (x2);
+  gcry_sexp_release (sig);
+  gcry_sexp_release (sig2);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+  gcry_sexp_release (hash);
+  gcry_sexp_release (badhash);
+
+  /* EdDSA.  */
+  if ((err = gcry_sexp_new (&hash, ed_hash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&badhash, ed_badhash_string, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&skey, ed_private_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  if ((err = gcry_sexp_new (&pkey, ed_public_key, 0, 1)))
+    die ("line %d: %s", __LINE__, gpg_strerror (err));
+  sig = check_handle_sign (skey, pkey, hash, badhash);
+  /* Test vector 2 of draft-josefsson-eddsa-ed25519-02.  */
+  extract_cmp_data (sig, "r", ("92a009a9f0d4cab8720e820b5f642540"
+                               "a2b27b5416503f8fb3762223ebdb69da"));
+  extract_cmp_data (sig, "s", ("085ac1e43e15996e458f3613d0f11d8c"
+                               "387b2eaeb4302aeeb00d291612bb0c00"));
+  gcry_sexp_release (sig);
+  gcry_sexp_release (pkey);
+  gcry_sexp_release (skey);
+  gcry_sexp_release (hash);
+  gcry_sexp_release (badhash);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -1198,6 +1478,7 @@ main (int argc, char **argv)
 
   check_ecc_sample_key ();
   check_ed25519ecdsa_sample_key ();
+  check_pk_handle ();
 
   return !!error_count;
 }
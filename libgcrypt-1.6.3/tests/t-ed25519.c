@@ -33,6 +33,7 @@
 
 #define PGM "t-ed25519"
 #define N_TESTS 1026
+#define BATCH_SIZE 64
 
 #define my_isascii(c) (!((c) & 0x80))
 #define digitp(p)   (*(p) >= '0' && *(p) <= '9')
@@ -55,6 +56,12 @@ static int sign_with_pk;
 static int no_verify;
 static int custom_data_file;
 
+static gcry_sexp_t batch_sig[BATCH_SIZE];
+static gcry_sexp_t batch_msg[BATCH_SIZE];
+static gcry_sexp_t batch_pk[BATCH_SIZE];
+static int batch_count;
+static int batch_bad_checked;
+
 static void
 die (const char *format, ...)
 {
@@ -248,6 +255,158 @@ hexdowncase (char *string)
 }
 
 
+/* Verify the signatures collected by one_test using
+   gcry_pk_verify_batch.  For the first batch also check that bad
+   signatures are located.  */
+static void
+check_batch (void)
+{
+  gpg_error_t err;
+  gcry_error_t errors[BATCH_SIZE];
+  gcry_sexp_t s_tmp;
+  int i;
+
+  if (!batch_count)
+    return;
+
+  err = gcry_pk_verify_batch (batch_sig, batch_msg, batch_pk,
+                              batch_count, errors);
+  if (err)
+    fail ("gcry_pk_verify_batch failed: %s", gpg_strerror (err));
+  for (i=0; i < batch_count; i++)
+    if (errors[i])
+      fail ("gcry_pk_verify_batch failed for item %d: %s",
+            i, gpg_strerror (errors[i]));
+
+  if (!batch_bad_checked && batch_count > 2)
+    {
+      batch_bad_checked = 1;
+
+      /* Swap the messages of the first two signatures.  */
+      s_tmp = batch_msg[0];
+      batch_msg[0] = batch_msg[1];
+      batch_msg[1] = s_tmp;
+      err = gcry_pk_verify_batch (batch_sig, batch_msg, batch_pk,
+                                  batch_count, errors);
+      if (gpg_err_code (err) != GPG_ERR_BAD_SIGNATURE)
+        fail ("gcry_pk_verify_batch did not detect a bad signature: %s",
+              gpg_strerror (err));
+      for (i=0; i < batch_count; i++)
+        if (gpg_err_code (errors[i]) != (i < 2? GPG_ERR_BAD_SIGNATURE : 0))
+          fail ("gcry_pk_verify_batch returned wrong result for item %d: %s",
+                i, gpg_strerror (errors[i]));
+    }
+
+  for (i=0; i < batch_count; i++)
+    {
+      gcry_sexp_release (batch_sig[i]);
+      gcry_sexp_release (batch_msg[i]);
+      gcry_sexp_release (batch_pk[i]);
+    }
+  batch_count = 0;
+}
+
+
+/* Build a signature s-expression from the hex string RS of R and S.  */
+static gcry_sexp_t
+build_sig (const char *rs)
+{
+  gpg_error_t err;
+  gcry_sexp_t s_sig;
+  void *buffer;
+  size_t buflen;
+
+  if (!(buffer = hex2buffer (rs, &buflen)) || buflen != 64)
+    die ("invalid hex string for a signature");
+  err = gcry_sexp_build (&s_sig, NULL,
+                         "(sig-val(eddsa(r %b)(s %b)))",
+                         32, buffer, 32, (char*)buffer + 32);
+  if (err)
+    die ("error building s-exp for a signature: %s", gpg_strerror (err));
+  xfree (buffer);
+  return s_sig;
+}
+
+
+/* Check that gcry_pk_verify and gcry_pk_verify_batch agree on
+   signatures whose R has an additional component of order 2.  Such
+   an R can only be created by the signer.  The signature TWEAKED
+   recomputes S for that R and holds with the cofactor; BAD takes S
+   from the regular signature and must be rejected.  The batch uses
+   random factors, thus it is run several times.  */
+static void
+check_torsion (void)
+{
+  static const char pk[] =
+    "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c";
+  static const char good[] =
+    "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+    "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00";
+  static const char tweaked[] =
+    "5b5ff6560f2b35478df17df4a09bdabf5d4d84abe9afc0704c89dddc14249625"
+    "0f8fcfec0ff20e26558af1f839a8bdfc97b4d860443324e5bb2450373eba3007";
+  static const char bad[] =
+    "5b5ff6560f2b35478df17df4a09bdabf5d4d84abe9afc0704c89dddc14249625"
+    "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00";
+  gpg_error_t err;
+  gcry_error_t errors[2];
+  gcry_sexp_t s_pk, s_msg, s_sig[3];
+  gcry_sexp_t sigs[2], msgs[2], pks[2];
+  void *buffer;
+  size_t buflen;
+  int i, round;
+
+  if (!(buffer = hex2buffer (pk, &buflen)))
+    die ("invalid hex string for the public key");
+  err = gcry_sexp_build (&s_pk, NULL,
+                         "(public-key"
+                         " (ecc"
+                         "  (curve \"Ed25519\")"
+                         "  (flags eddsa)"
+                         "  (q %b)))",  (int)buflen, buffer);
+  if (err)
+    die ("error building s-exp for the public key: %s", gpg_strerror (err));
+  xfree (buffer);
+  err = gcry_sexp_build (&s_msg, NULL,
+                         "(data"
+                         " (flags eddsa)"
+                         " (hash-algo sha512)"
+                         " (value %b))",  1, "\x72");
+  if (err)
+    die ("error building s-exp for the message: %s", gpg_strerror (err));
+  s_sig[0] = build_sig (good);
+  s_sig[1] = build_sig (tweaked);
+  s_sig[2] = build_sig (bad);
+
+  for (i=0; i < 3; i++)
+    {
+      err = gcry_pk_verify (s_sig[i], s_msg, s_pk);
+      if (gpg_err_code (err) != (i < 2? 0 : GPG_ERR_BAD_SIGNATURE))
+        fail ("gcry_pk_verify returned wrong result for torsion test %d: %s",
+              i, gpg_strerror (err));
+    }
+
+  msgs[0] = msgs[1] = s_msg;
+  pks[0] = pks[1] = s_pk;
+  sigs[0] = s_sig[0];
+  for (round=0; round < 20; round++)
+    for (i=1; i < 3; i++)
+      {
+        sigs[1] = s_sig[i];
+        err = gcry_pk_verify_batch (sigs, msgs, pks, 2, errors);
+        if (errors[0] || gpg_err_code (errors[1]) != gpg_err_code (err)
+            || gpg_err_code (err) != (i < 2? 0 : GPG_ERR_BAD_SIGNATURE))
+          fail ("gcry_pk_verify_batch returned wrong result for"
+                " torsion test %d: %s", i, gpg_strerror (err));
+      }
+
+  for (i=0; i < 3; i++)
+    gcry_sexp_release (s_sig[i]);
+  gcry_sexp_release (s_msg);
+  gcry_sexp_release (s_pk);
+}
+
+
 static void
 one_test (int testno, const char *sk, const char *pk,
           const char *msg, const char *sig)
@@ -390,9 +549,18 @@ one_test (int testno, const char *sk, const char *pk,
     }
 
   if (!no_verify)
-    if ((err = gcry_pk_verify (s_sig, s_msg, s_pk)))
-      fail ("gcry_pk_verify failed for test %d: %s",
-            testno, gpg_strerror (err));
+    {
+      if ((err = gcry_pk_verify (s_sig, s_msg, s_pk)))
+        fail ("gcry_pk_verify failed for test %d: %s",
+              testno, gpg_strerror (err));
+
+      /* Keep the signature for the batch verification test.  */
+      batch_sig[batch_count] = s_sig;  s_sig = NULL;
+      batch_msg[batch_count] = s_msg;  s_msg = NULL;
+      batch_pk[batch_count] = s_pk;    s_pk = NULL;
+      if (++batch_count == BATCH_SIZE)
+        check_batch ();
+    }
 
 
  leave:
@@ -460,6 +628,7 @@ check_ed25519 (const char *fname)
   xfree (sk);
   xfree (msg);
   xfree (sig);
+  check_batch ();
 
   if (ntests != N_TESTS && !custom_data_file)
     fail ("did %d tests but expected %d", ntests, N_TESTS);
@@ -550,6 +719,8 @@ main (int argc, char **argv)
 
   start_timer ();
   check_ed25519 (fname);
+  if (!no_verify)
+    check_torsion ();
   stop_timer ();
 
   xfree (fname);
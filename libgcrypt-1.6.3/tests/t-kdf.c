@@ -823,11 +823,40 @@ check_openpgp (void)
       24,
       "\xde\x5c\xb8\xd5\x75\xf6\xad\x69\x5b\xc9\xf6\x2f\xba\xeb\xfb\x36"
       "\x34\xf2\xb8\xee\x3b\x37\x21\xb7"
+    },
+    /* The following vectors have been created with Libgcrypt 1.6.3.
+       Their keys take several passes of the hash function.  */
+    {
+      "\x4c\x6f\x6e\x67\x5f\x73\x65\x6e\x74\x65\x6e\x63\x65\x5f\x75\x73"
+      "\x65\x64\x5f\x61\x73\x5f\x70\x61\x73\x73\x70\x68\x72\x61\x73\x65", 32,
+      GCRY_KDF_ITERSALTED_S2K, GCRY_MD_SHA1,
+      "\x3a\x9d\x2e\x51\x07\xc4\xf8\x61", 8,
+      65536,
+      80,
+      "\x0a\x8f\x39\x23\x03\xd6\x71\x66\x3f\x4b\xb5\x80\xff\x35\x91\xce"
+      "\xe8\xae\x57\x98\xc2\xab\x42\x8f\x17\x59\x81\x29\x27\x4e\x50\x72"
+      "\xeb\x13\x9c\xf6\x5c\xae\xb4\x4e\xd8\xf6\x7e\x29\x38\xa6\xa6\xe0"
+      "\xd0\xec\x2c\xed\x4a\xba\x09\x4d\x93\x75\xbe\xe2\x86\x55\xcc\x45"
+      "\xa9\x70\xb1\x5f\x89\xc2\x7b\xdf\x12\xae\xff\x41\xc2\x2c\xec\xa2"
+    },
+    {
+      "\x4c\x6f\x6e\x67\x5f\x73\x65\x6e\x74\x65\x6e\x63\x65\x5f\x75\x73"
+      "\x65\x64\x5f\x61\x73\x5f\x70\x61\x73\x73\x70\x68\x72\x61\x73\x65", 32,
+      GCRY_KDF_ITERSALTED_S2K, GCRY_MD_SHA256,
+      "\x3a\x9d\x2e\x51\x07\xc4\xf8\x61", 8,
+      100000,
+      96,
+      "\xe7\xcd\x97\xb6\xc5\x08\xb2\x8f\xcf\x52\xec\xb8\x7e\x26\xff\xb0"
+      "\xa8\xed\x63\xa5\xfb\xa3\xf0\x6a\x89\xa6\x33\xc4\x8d\x8f\x0c\x3f"
+      "\x14\xb8\x8b\x11\x93\x4c\xd7\xa7\xe6\x96\x4c\x7d\x13\x7a\xbb\xe2"
+      "\xed\x00\x0b\xf9\xb3\xa7\x27\x33\xef\x4a\x66\x45\x05\xd5\xea\x1a"
+      "\x13\xa7\x0a\x85\x72\xc4\xa7\xdf\x9c\xb9\xc0\xba\x18\xfd\xca\x90"
+      "\x25\x84\x06\xd4\x84\xdc\xc5\x0c\x79\xd4\x54\x4d\x32\x2d\xd7\x95"
     }
   };
   int tvidx;
   gpg_error_t err;
-  unsigned char outbuf[32];
+  unsigned char outbuf[96];
   int i;
 
   for (tvidx=0; tvidx < DIM(tv); tvidx++)
@@ -1055,13 +1084,240 @@ check_scrypt (void)
 }
 
 
+/* Thread functions for gcry_kdf_compute which run each job right
+   away.  JOBS_CONTEXT counts the jobs.  */
+static int
+run_job_now (void *jobs_context, gcry_kdf_job_fn_t job_fn, void *job_priv)
+{
+  (*(unsigned int *)jobs_context)++;
+  job_fn (job_priv);
+  return 0;
+}
+
+static int
+wait_all_jobs_now (void *jobs_context)
+{
+  (void)jobs_context;
+  return 0;
+}
+
+
+/* Derive the DKLEN bytes at DK with the Argon2 variant SUBALGO.  If
+   USE_OPS is set the jobs are run by the thread functions above.  */
+static gpg_error_t
+derive_argon2 (int subalgo, const unsigned long *param,
+               unsigned int paramlen,
+               const char *p, size_t plen, const char *salt, size_t saltlen,
+               const char *key, size_t keylen, const char *ad, size_t adlen,
+               int use_ops, size_t dklen, unsigned char *dk)
+{
+  gcry_kdf_hd_t hd;
+  gpg_error_t err;
+  unsigned int njobs = 0;
+  struct gcry_kdf_thread_ops ops = { &njobs, run_job_now, wait_all_jobs_now };
+
+  err = gcry_kdf_open (&hd, GCRY_KDF_ARGON2, subalgo, param, paramlen,
+                       p, plen, salt, saltlen, key, keylen, ad, adlen);
+  if (err)
+    return err;
+  err = gcry_kdf_compute (hd, use_ops? &ops : NULL);
+  if (!err)
+    err = gcry_kdf_final (hd, dklen, dk);
+  gcry_kdf_close (hd);
+
+  /* One job for each lane of the 4 slices of each pass.  */
+  if (!err && use_ops && njobs != param[1] * 4 * (paramlen > 3? param[3]:1))
+    fail ("argon2: %u jobs have been dispatched\n", njobs);
+  return err;
+}
+
+
+static void
+check_argon2 (void)
+{
+  /* The first three vectors are from RFC 9106; the next one has more
+     than one pass and the last one a tag longer than a BLAKE2b
+     digest.  */
+  static struct {
+    int subalgo;
+    const char *p;      /* Passphrase.  */
+    size_t plen;        /* Length of P. */
+    const char *salt;
+    size_t saltlen;
+    const char *key;    /* Secret value K.  */
+    size_t keylen;
+    const char *ad;     /* Associated data X.  */
+    size_t adlen;
+    unsigned long param[4];  /* Tag length, T, M and P.  */
+    const char *dk;     /* Derived key.  */
+  } tv[] = {
+    {
+      GCRY_KDF_ARGON2D,
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01"
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01",
+      32,
+      "\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02",
+      16,
+      "\x03\x03\x03\x03\x03\x03\x03\x03",
+      8,
+      "\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04",
+      12,
+      { 32, 3, 32, 4 },
+      "\x51\x2b\x39\x1b\x6f\x11\x62\x97\x53\x71\xd3\x09\x19\x73\x42\x94"
+      "\xf8\x68\xe3\xbe\x39\x84\xf3\xc1\xa1\x3a\x4d\xb9\xfa\xbe\x4a\xcb"
+    },
+    {
+      GCRY_KDF_ARGON2I,
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01"
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01",
+      32,
+      "\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02",
+      16,
+      "\x03\x03\x03\x03\x03\x03\x03\x03",
+      8,
+      "\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04",
+      12,
+      { 32, 3, 32, 4 },
+      "\xc8\x14\xd9\xd1\xdc\x7f\x37\xaa\x13\xf0\xd7\x7f\x24\x94\xbd\xa1"
+      "\xc8\xde\x6b\x01\x6d\xd3\x88\xd2\x99\x52\xa4\xc4\x67\x2b\x6c\xe8"
+    },
+    {
+      GCRY_KDF_ARGON2ID,
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01"
+      "\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01\x01",
+      32,
+      "\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02\x02",
+      16,
+      "\x03\x03\x03\x03\x03\x03\x03\x03",
+      8,
+      "\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04\x04",
+      12,
+      { 32, 3, 32, 4 },
+      "\x0d\x64\x0d\xf5\x8d\x78\x76\x6c\x08\xc0\x37\xa3\x4a\x8b\x53\xc9"
+      "\xd0\x1e\xf0\x45\x2d\x75\xb6\x5e\xb5\x25\x20\xe9\x6b\x01\xe6\x59"
+    },
+    {
+      GCRY_KDF_ARGON2ID,
+      "password",
+      8,
+      "somesalt",
+      8,
+      NULL, 0,
+      NULL, 0,
+      { 32, 2, 64, 2 },
+      "\x94\x38\x74\x15\xdf\xb8\x4e\xd1\x97\x74\x65\xa1\xe8\x62\x60\x73"
+      "\xad\xf4\x2b\xd4\xee\xae\x1f\xaa\x1d\xd4\xe2\x3a\x1f\xf6\x85\x9f"
+    },
+    {
+      GCRY_KDF_ARGON2ID,
+      "passphrase",
+      10,
+      "saltysalt",
+      9,
+      "secret",
+      6,
+      NULL, 0,
+      { 65, 3, 520, 3 },
+      "\x40\xe7\x52\xca\x8f\xbc\xd3\xb8\xa4\x55\x95\x45\x76\x06\xa9\xb6"
+      "\x3f\xde\x6a\xbf\xd1\xfc\x12\x3a\x89\x1a\x5d\x2f\x68\xc3\x3a\x1f"
+      "\xa6\x7c\x72\x0e\x69\x99\x85\x33\xb3\x75\x44\xd9\xe9\xa7\x9e\x2e"
+      "\xec\xdf\xe3\x06\x00\x53\x24\xbd\xe7\x44\x51\x61\xf3\x32\x20\x3b"
+      "\xe0"
+    }
+  };
+  static const unsigned long small_param[4] = { 32, 1, 15, 2 };
+  int tvidx;
+  gpg_error_t err;
+  unsigned char outbuf[65];
+  int i, use_ops;
+
+  for (tvidx=0; tvidx < DIM(tv); tvidx++)
+    for (use_ops=0; use_ops < 2; use_ops++)
+      {
+        if (verbose)
+          fprintf (stderr, "checking Argon2 test vector %d%s\n", tvidx,
+                   use_ops? " with thread functions":"");
+        assert (tv[tvidx].param[0] <= sizeof outbuf);
+        err = derive_argon2 (tv[tvidx].subalgo, tv[tvidx].param, 4,
+                             tv[tvidx].p, tv[tvidx].plen,
+                             tv[tvidx].salt, tv[tvidx].saltlen,
+                             tv[tvidx].key, tv[tvidx].keylen,
+                             tv[tvidx].ad, tv[tvidx].adlen,
+                             use_ops, tv[tvidx].param[0], outbuf);
+        if (err)
+          fail ("argon2 test %d failed: %s\n", tvidx, gpg_strerror (err));
+        else if (memcmp (outbuf, tv[tvidx].dk, tv[tvidx].param[0]))
+          {
+            fail ("argon2 test %d failed: mismatch\n", tvidx);
+            fputs ("got:", stderr);
+            for (i=0; i < tv[tvidx].param[0]; i++)
+              fprintf (stderr, " %02x", outbuf[i]);
+            putc ('\n', stderr);
+          }
+      }
+
+  /* Less than 8 KiB of memory per lane is not allowed.  */
+  err = derive_argon2 (GCRY_KDF_ARGON2ID, small_param, 4,
+                       "password", 8, "somesalt", 8, NULL, 0, NULL, 0,
+                       0, 32, outbuf);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("argon2 with too little memory: %s\n", gpg_strerror (err));
+
+  /* The result length must match the tag length.  */
+  err = derive_argon2 (GCRY_KDF_ARGON2ID, tv[3].param, 4,
+                       tv[3].p, tv[3].plen, tv[3].salt, tv[3].saltlen,
+                       NULL, 0, NULL, 0, 0, 16, outbuf);
+  if (gpg_err_code (err) != GPG_ERR_INV_VALUE)
+    fail ("argon2 with wrong result length: %s\n", gpg_strerror (err));
+}
+
 int
 main (int argc, char **argv)
 {
-  if (argc > 1 && !strcmp (argv[1], "--verbose"))
-    verbose = 1;
-  else if (argc > 1 && !strcmp (argv[1], "--debug"))
-    verbose = debug = 1;
+  int last_argc = -1;
+
+  if (argc)
+    {
+      argc--; argv++;
+    }
+  while (argc && last_argc != argc )
+    {
+      last_argc = argc;
+      if (!strcmp (*argv, "--help"))
+        {
+          puts (
+"usage: ./t-kdf [options]\n"
+"\n"
+"Options:\n"
+"  --verbose                Show what is going on\n"
+"  --debug                  Flyswatter\n"
+"  --disable-hwf <feature>  Disable hardware acceleration feature\n"
+);
+          exit (0);
+        }
+      else if (!strcmp (*argv, "--verbose"))
+        {
+          verbose = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--debug"))
+        {
+          verbose = debug = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--disable-hwf"))
+        {
+          argc--; argv++;
+          if (argc)
+            {
+              if (gcry_control (GCRYCTL_DISABLE_HWF, *argv, NULL))
+                fprintf (stderr,
+                         "t-kdf: unknown hardware feature `%s'"
+                         " - option ignored\n", *argv);
+              argc--; argv++;
+            }
+        }
+    }
 
   if (!gcry_check_version (GCRYPT_VERSION))
     die ("version mismatch\n");
@@ -1074,6 +1330,12 @@ main (int argc, char **argv)
   check_openpgp ();
   check_pbkdf2 ();
   check_scrypt ();
+  check_argon2 ();
+
+  /* Run the lanes of scrypt and Argon2 in several threads.  */
+  gcry_control (GCRYCTL_SET_WORKER_THREADS, 4);
+  check_scrypt ();
+  check_argon2 ();
 
   return error_count ? 1 : 0;
 }
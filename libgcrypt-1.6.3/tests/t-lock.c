@@ -63,6 +63,9 @@
 /* Requested nonce size.  */
 #define NONCE_SIZE  11
 
+/* The first random block returned to each nonce thread.  */
+static unsigned char first_random[N_NONCE_THREADS][16];
+
 
 /* This tests works by having a a couple of accountant threads which do
    random transactions between accounts and a revision threads which
@@ -140,17 +143,21 @@ external_lock_test_destroy (int line)
 
 
 /* The nonce thread.  We simply request a couple of nonces and
-   return.  */
+   random blocks and return.  */
 static THREAD_RET_TYPE
 nonce_thread (void *argarg)
 {
   struct thread_arg_s *arg = argarg;
   int i;
   char nonce[NONCE_SIZE];
+  unsigned char rnd[16];
 
+  gcry_randomize (first_random[arg->no], sizeof first_random[0],
+                  GCRY_STRONG_RANDOM);
   for (i = 0; i < N_NONCE_ITERATIONS; i++)
     {
       gcry_create_nonce (nonce, sizeof nonce);
+      gcry_randomize (rnd, sizeof rnd, GCRY_STRONG_RANDOM);
       if (i && !(i%100))
         show ("thread %d created %d nonces so far", arg->no, i);
     }
@@ -161,8 +168,8 @@ nonce_thread (void *argarg)
 
 
 /* To check our locking function we run several threads all accessing
-   the nonce functions.  If this function returns we know that there
-   are no obvious deadlocks or failed lock initialization.  */
+   the nonce and random functions.  If this function returns we know
+   that there are no obvious deadlocks or failed lock initialization.  */
 static void
 check_nonce_lock (void)
 {
@@ -218,6 +225,21 @@ check_nonce_lock (void)
 }
 
 
+#if defined(_WIN32) || USE_POSIX_THREADS
+/* Check that the nonce threads did not get the same random.  */
+static void
+check_first_random (void)
+{
+  int i, j;
+
+  for (i=0; i < N_NONCE_THREADS; i++)
+    for (j=i+1; j < N_NONCE_THREADS; j++)
+      if (!memcmp (first_random[i], first_random[j], sizeof first_random[0]))
+        fail ("nonce threads %d and %d got the same random", i, j);
+}
+#endif
+
+
 /* Initialze all accounts.  */
 static void
 init_accounts (void)
@@ -445,6 +467,9 @@ main (int argc, char **argv)
     gcry_control (GCRYCTL_PRINT_CONFIG, NULL);
 
   check_nonce_lock ();
+#if defined(_WIN32) || USE_POSIX_THREADS
+  check_first_random ();
+#endif
 
   init_accounts ();
   check_accounts ();
@@ -48,6 +48,7 @@ static int error_count;
 #define xcalloc(a,b)  gcry_xcalloc ((a),(b))
 #define xfree(a)      gcry_free ((a))
 #define pass() do { ; } while (0)
+#define DIM(v)        (sizeof(v)/sizeof((v)[0]))
 
 
 static struct
@@ -1080,6 +1081,169 @@ twistededwards_math (void)
 }
 
 
+/* Convert the 32 byte little endian X25519 value STRING into an MPI.
+   If CLAMP is set the scalar clamping of RFC 7748 is applied;
+   otherwise only the most significant bit is masked.  */
+static gcry_mpi_t
+x25519_hex2mpi (const char *string, int clamp)
+{
+  unsigned char *buffer;
+  unsigned char tmp;
+  size_t buflen, i;
+  gcry_mpi_t val;
+
+  buffer = hex2buffer (string, &buflen);
+  if (!buffer || buflen != 32)
+    die ("x25519_hex2mpi '%s' failed: parser error\n", string);
+  if (clamp)
+    {
+      buffer[0] &= 0xf8;
+      buffer[31] |= 0x40;
+    }
+  buffer[31] &= 0x7f;
+  for (i=0; i < buflen/2; i++)
+    {
+      tmp = buffer[i];
+      buffer[i] = buffer[buflen-1-i];
+      buffer[buflen-1-i] = tmp;
+    }
+  if (gcry_mpi_scan (&val, GCRYMPI_FMT_USG, buffer, buflen, NULL))
+    die ("x25519_hex2mpi '%s' failed: scan error\n", string);
+  xfree (buffer);
+  return val;
+}
+
+
+/* Check the Montgomery ladder and Curve25519 using the test vectors
+   from RFC 7748.  */
+static void
+montgomery_math (void)
+{
+  static struct {
+    const char *k, *u, *r;
+  } tv[] = {
+    /* Section 5.2.  */
+    { "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+      "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+      "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552" },
+    { "4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+      "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+      "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957" },
+    /* Section 6.1: Alice's and Bob's public keys.  */
+    { "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a",
+      "0900000000000000000000000000000000000000000000000000000000000000",
+      "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a" },
+    { "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb",
+      "0900000000000000000000000000000000000000000000000000000000000000",
+      "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f" },
+    /* Section 6.1: The shared secret.  */
+    { "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a",
+      "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f",
+      "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742" }
+  };
+  gpg_error_t err;
+  gcry_ctx_t ctx;
+  gcry_mpi_point_t G, P, Q;
+  gcry_mpi_t k, u, r, x, n;
+  gcry_sexp_t s_sk, s_data, s_plain;
+  const char *value;
+  size_t valuelen;
+  unsigned char *buffer;
+  unsigned char prefixed[33];
+  size_t buflen;
+  int i;
+
+  wherestr = "montgomery_math";
+  show ("checking basic Montgomery math\n");
+
+  err = gcry_mpi_ec_new (&ctx, NULL, "Curve25519");
+  if (err)
+    die ("gcry_mpi_ec_new failed: %s\n", gpg_strerror (err));
+
+  G = gcry_mpi_ec_get_point ("g", ctx, 1);
+  if (!G)
+    die ("gcry_mpi_ec_get_point(G) failed\n");
+  P = gcry_mpi_point_new (0);
+  Q = gcry_mpi_point_new (0);
+  x = gcry_mpi_new (0);
+  n = gcry_mpi_ec_get_mpi ("n", ctx, 1);
+
+  /* Check: G is on the curve */
+  if (!gcry_mpi_ec_curve_point (G, ctx))
+    fail ("failed assertion: G is on the curve\n");
+
+  /* Check: nG is the point at infinity */
+  gcry_mpi_ec_mul (Q, n, G, ctx);
+  if (!gcry_mpi_ec_get_affine (x, NULL, Q, ctx))
+    fail ("failed assertion: nG is the point at infinity\n");
+
+  for (i=0; i < DIM (tv); i++)
+    {
+      k = x25519_hex2mpi (tv[i].k, 1);
+      u = x25519_hex2mpi (tv[i].u, 0);
+      r = x25519_hex2mpi (tv[i].r, 0);
+
+      gcry_mpi_point_snatch_set (P, u, NULL, gcry_mpi_set_ui (NULL, 1));
+      gcry_mpi_ec_mul (Q, k, P, ctx);
+      if (gcry_mpi_ec_get_affine (x, NULL, Q, ctx))
+        fail ("failed to get affine coordinates\n");
+      if (gcry_mpi_cmp (x, r))
+        {
+          fail ("X25519 test vector %d failed:\n", i);
+          print_mpi ("k", k);
+          print_mpi ("r", r);
+          print_mpi ("x", x);
+        }
+
+      gcry_mpi_release (k);
+      gcry_mpi_release (r);
+    }
+
+  /* Compute the shared secret using the public key API: The
+     ciphertext and the result are the 0x40 prefixed little endian
+     u-coordinates.  */
+  k = x25519_hex2mpi (tv[4].k, 1);
+  err = gcry_sexp_build (&s_sk, NULL,
+                         "(private-key(ecc(curve Curve25519)(d%m)))", k);
+  if (err)
+    die ("building key failed: %s\n", gpg_strerror (err));
+  buffer = hex2buffer (tv[4].u, &buflen);
+  prefixed[0] = 0x40;
+  memcpy (prefixed+1, buffer, 32);
+  xfree (buffer);
+  err = gcry_sexp_build (&s_data, NULL, "(enc-val(ecdh(e%b)))",
+                         33, prefixed);
+  if (err)
+    die ("building data failed: %s\n", gpg_strerror (err));
+  err = gcry_pk_decrypt (&s_plain, s_data, s_sk);
+  if (err)
+    fail ("gcry_pk_decrypt failed: %s\n", gpg_strerror (err));
+  else
+    {
+      buffer = hex2buffer (tv[4].r, &buflen);
+      value = gcry_sexp_nth_data (s_plain, 1, &valuelen);
+      if (!value || valuelen != buflen + 1 || *value != 0x40
+          || memcmp (value + 1, buffer, buflen))
+        {
+          fail ("X25519 shared secret mismatch\n");
+          print_sexp ("result", s_plain);
+        }
+      xfree (buffer);
+      gcry_sexp_release (s_plain);
+    }
+  gcry_sexp_release (s_data);
+  gcry_sexp_release (s_sk);
+  gcry_mpi_release (k);
+
+  gcry_mpi_release (n);
+  gcry_mpi_release (x);
+  gcry_mpi_point_release (Q);
+  gcry_mpi_point_release (P);
+  gcry_mpi_point_release (G);
+  gcry_ctx_release (ctx);
+}
+
+
 int
 main (int argc, char **argv)
 {
@@ -1104,6 +1268,7 @@ main (int argc, char **argv)
   basic_ec_math ();
   basic_ec_math_simplified ();
   twistededwards_math ();
+  montgomery_math ();
 
   show ("All tests completed. Errors: %d\n", error_count);
   return error_count ? 1 : 0;
@@ -0,0 +1,272 @@
+/* t-secmem.c - Check the secure memory allocator
+ * Copyright (C) 2015 g10 Code GmbH
+ *
+ * This file is part of Libgcrypt.
+ *
+ * Libgcrypt is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * Libgcrypt is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#if USE_POSIX_THREADS
+# include <pthread.h>
+#endif
+
+#define PGM "t-secmem"
+
+#include "t-common.h"
+
+/* Mingw requires us to include windows.h after winsock2.h which is
+   included by gcrypt.h.  */
+#ifdef _WIN32
+# include <windows.h>
+#endif
+
+#ifdef _WIN32
+# define THREAD_RET_TYPE  DWORD WINAPI
+# define THREAD_RET_VALUE 0
+#else
+# define THREAD_RET_TYPE  void *
+# define THREAD_RET_VALUE NULL
+#endif
+
+/* Size of the secure memory pool.  */
+#define POOL_SIZE 16384
+
+/* Number of blocks used by one test run.  */
+#define N_BLOCKS 64
+
+/* Number of threads and their rounds.  */
+#define N_THREADS 4
+#define N_ROUNDS  500
+
+
+/* Allocate N_BLOCKS blocks of sizes derived from SEED, fill them,
+   check that they do not overlap and release them again.  */
+static void
+check_blocks (unsigned int seed)
+{
+  unsigned char *p[N_BLOCKS];
+  size_t len[N_BLOCKS];
+  int i;
+  size_t j;
+
+  for (i=0; i < N_BLOCKS; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      len[i] = (seed >> 16) % ((i & 7)? 256 : 1500) + 1;
+      p[i] = gcry_malloc_secure (len[i]);
+      if (!p[i])
+        die ("allocating %u bytes of secure memory failed: %s",
+             (unsigned int)len[i], strerror (errno));
+      if (!gcry_is_secure (p[i]))
+        fail ("block of %u bytes is not secure", (unsigned int)len[i]);
+      memset (p[i], i, len[i]);
+    }
+
+  /* Release every other block first, to mix freed and used blocks. */
+  for (i=0; i < N_BLOCKS; i += 2)
+    {
+      for (j=0; j < len[i]; j++)
+        if (p[i][j] != i)
+          {
+            fail ("block %d of %u bytes has been overwritten",
+                  i, (unsigned int)len[i]);
+            break;
+          }
+      gcry_free (p[i]);
+    }
+  for (i=1; i < N_BLOCKS; i += 2)
+    {
+      for (j=0; j < len[i]; j++)
+        if (p[i][j] != i)
+          {
+            fail ("block %d of %u bytes has been overwritten",
+                  i, (unsigned int)len[i]);
+            break;
+          }
+      gcry_free (p[i]);
+    }
+}
+
+
+/* Check that requests larger than the pool fail unless more pools
+   have been enabled.  */
+static void
+check_no_expand (void)
+{
+  void *p;
+
+  p = gcry_malloc_secure (4 * POOL_SIZE);
+  if (p)
+    {
+      fail ("secure memory has been expanded without being enabled");
+      gcry_free (p);
+    }
+}
+
+
+/* Check that requests larger than the pool can be served.  */
+static void
+check_large (void)
+{
+  unsigned char *p, *q;
+  size_t n = 4 * POOL_SIZE;
+
+  p = gcry_malloc_secure (n);
+  if (!p)
+    {
+      fail ("allocating %u bytes of secure memory failed: %s",
+            (unsigned int)n, strerror (errno));
+      return;
+    }
+  if (!gcry_is_secure (p))
+    fail ("large block is not secure");
+  memset (p, 0xa5, n);
+
+  q = gcry_realloc (p, 2 * n);
+  if (!q)
+    {
+      fail ("reallocating to %u bytes failed", (unsigned int)(2 * n));
+      gcry_free (p);
+      return;
+    }
+  if (!gcry_is_secure (q))
+    fail ("reallocated block is not secure");
+  if (q[0] != 0xa5 || q[n-1] != 0xa5)
+    fail ("content of reallocated block changed");
+  gcry_free (q);
+}
+
+
+static THREAD_RET_TYPE
+alloc_thread (void *arg)
+{
+  unsigned int seed = (unsigned int)(size_t)arg;
+  int i;
+
+  for (i=0; i < N_ROUNDS; i++)
+    check_blocks (seed + i);
+
+  return THREAD_RET_VALUE;
+}
+
+
+static void
+check_threads (void)
+{
+#ifdef _WIN32
+  HANDLE threads[N_THREADS];
+  int i;
+  int rc;
+
+  for (i=0; i < N_THREADS; i++)
+    {
+      threads[i] = CreateThread (NULL, 0, alloc_thread,
+                                 (void *)(size_t)(i * 1000), 0, NULL);
+      if (!threads[i])
+        die ("error creating thread %d: rc=%d", i, (int)GetLastError ());
+    }
+  for (i=0; i < N_THREADS; i++)
+    {
+      rc = WaitForSingleObject (threads[i], INFINITE);
+      if (rc == WAIT_OBJECT_0)
+        show ("thread %d has terminated", i);
+      else
+        fail ("waiting for thread %d failed: %d", i, (int)GetLastError ());
+      CloseHandle (threads[i]);
+    }
+
+#elif USE_POSIX_THREADS
+  pthread_t threads[N_THREADS];
+  int rc, i;
+
+  for (i=0; i < N_THREADS; i++)
+    pthread_create (&threads[i], NULL, alloc_thread, (void *)(size_t)(i*1000));
+  for (i=0; i < N_THREADS; i++)
+    {
+      rc = pthread_join (threads[i], NULL);
+      if (rc)
+        fail ("pthread_join failed for thread %d: %s", i, strerror (errno));
+      else
+        show ("thread %d has terminated", i);
+    }
+
+#else
+  alloc_thread (NULL);
+#endif
+}
+
+
+int
+main (int argc, char **argv)
+{
+  int last_argc = -1;
+
+  if (argc)
+    {
+      argc--; argv++;
+    }
+  while (argc && last_argc != argc )
+    {
+      last_argc = argc;
+      if (!strcmp (*argv, "--help"))
+        {
+          puts (
+"usage: ./t-secmem [options]\n"
+"\n"
+"Options:\n"
+"  --verbose      Show what is going on\n"
+"  --debug        Flyswatter\n"
+);
+          exit (0);
+        }
+      if (!strcmp (*argv, "--verbose"))
+        {
+          verbose = 1;
+          argc--; argv++;
+        }
+      else if (!strcmp (*argv, "--debug"))
+        {
+          verbose = debug = 1;
+          argc--; argv++;
+        }
+    }
+
+  if (!gcry_check_version (GCRYPT_VERSION))
+    die ("version mismatch");
+  if (debug)
+    gcry_control (GCRYCTL_SET_DEBUG_FLAGS, 1u, 0);
+  gcry_control (GCRYCTL_DISABLE_SECMEM_WARN);
+  gcry_control (GCRYCTL_INIT_SECMEM, POOL_SIZE, 0);
+  gcry_control (GCRYCTL_INITIALIZATION_FINISHED, 0);
+
+  check_no_expand ();
+  gcry_control (GCRYCTL_AUTO_EXPAND_SECMEM, 0);
+  check_blocks (42);
+  check_large ();
+  check_threads ();
+  check_blocks (4711);
+
+  if (verbose)
+    gcry_control (GCRYCTL_DUMP_SECMEM_STATS);
+
+  return errorcount ? 1 : 0;
+}